@@ -290,7 +290,7 @@ sure both macros are undefined; an emulation function will then be used. */
 #undef SUPPORT_DIFF_FUZZ
 
 /* Define to any value to enable support for Just-In-Time compiling. */
-#undef SUPPORT_JIT
+#define SUPPORT_JIT 1
 
 /* Define to any value to allow pcre2grep to be linked with libbz2, so that it
    is able to handle .bz2 files. */
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2025 - TortoiseGit
+// Copyright (C) 2008-2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -29,6 +29,7 @@
 #include "FormatMessageWrapper.h"
 #include "SmartHandle.h"
 #include "MassiveGitTaskBase.h"
+#include "GitCommitGraph.h"
 #include "git2/sys/filter.h"
 #include "git2/sys/transport.h"
 #include "git2/sys/errors.h"
@@ -228,11 +229,13 @@ static int LogicalCompareBranchesPredicate(const CString &left, const CString &r
 
 CString CGit::ms_LastMsysGitDir;
 CString CGit::ms_MsysGitRootDir;
+CComAutoCriticalSection CGit::ms_critGitDllSec;
 int CGit::ms_LastMsysGitVersion = 0;
 CGit g_Git;
 
 
 CGit::CGit()
+	: m_RefsContainsCache(std::make_unique<CGitRefsContainsCache>())
 {
 	git_libgit2_init();
 	GetCurrentDirectory(MAX_PATH, CStrBuf(m_CurrentDir, MAX_PATH));
@@ -270,6 +273,9 @@ bool CGit::IsBranchNameValid(const CString& branchname)
 
 int CGit::RunAsync(CString cmd, PROCESS_INFORMATION& piOut, HANDLE* hReadOut, HANDLE* hErrReadOut, const CString* StdioFile)
 {
+	// git.exe might repack, the packs opened by pooled repositories could not be deleted then
+	InvalidateRepositoryPool();
+
 	CAutoGeneralHandle hRead, hWrite, hReadErr, hWriteErr, hWriteIn, hReadIn;
 	CAutoFile hStdioFile;
 
@@ -629,11 +635,11 @@ CString CGit::GetConfigValue(const CString& name, const CString& def, bool wantB
 {
 	if(this->m_IsUseGitDLL)
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session(*this);
 
 		try
 		{
-			CheckAndInitDll();
+			session.Init();
 		}catch(...)
 		{
 		}
@@ -690,11 +696,11 @@ int CGit::SetConfigValue(const CString& key, const CString& value, CONFIG_TYPE t
 {
 	if(this->m_IsUseGitDLL)
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session(*this);
 
 		try
 		{
-			CheckAndInitDll();
+			session.Init();
 		}catch(...)
 		{
 		}
@@ -742,11 +748,11 @@ int CGit::UnsetConfigValue(const CString& key, CONFIG_TYPE type)
 {
 	if(this->m_IsUseGitDLL)
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session(*this);
 
 		try
 		{
-			CheckAndInitDll();
+			session.Init();
 		}catch(...)
 		{
 		}
@@ -1202,7 +1208,7 @@ int CGit::GetHash(CGitHash &hash, const CString& friendname)
 
 	if (m_IsUseLibGit2)
 	{
-		CAutoRepository repo(GetGitRepository());
+		auto repo = GetPooledGitRepository();
 		if (!repo)
 			return -1;
 
@@ -1644,65 +1650,27 @@ int CGit::GetRefsCommitIsOn(STRING_VECTOR& list, const CGitHash& hash, bool incl
 		if (!repo)
 			return -1;
 
-		CAutoReferenceIterator it;
-		if (git_reference_iterator_new(it.GetPointer(), repo))
+		// the cache walks the history only once for all refs and remembers the result as long as the refs do not change
+		std::vector<std::pair<CString, CGitRefsContainsCache::RefKind>> refs;
+		if (m_RefsContainsCache->GetRefsContaining(repo, hash, refs))
 			return -1;
 
-		auto checkDescendent = [&list, &hash, &repo](const git_oid* oid, const git_reference* ref) {
-			if (!oid)
-				return;
-			if (git_oid_equal(oid, hash) || git_graph_descendant_of(repo, oid, hash) == 1)
-			{
-				const char* name = git_reference_name(ref);
-				if (!name)
-					return;
-
-				list.push_back(CUnicodeUtils::GetUnicode(name));
-			}
-		};
-
-		CAutoReference ref;
-		while (git_reference_next(ref.GetPointer(), it) == 0)
+		for (const auto& [name, kind] : refs)
 		{
-			if (git_reference_is_tag(ref))
+			if (kind == CGitRefsContainsCache::REF_TAG)
 			{
 				if (!includeTags)
 					continue;
-
-				CAutoTag tag;
-				if (git_tag_lookup(tag.GetPointer(), repo, git_reference_target(ref)) == 0)
-				{
-					CAutoObject obj;
-					if (git_tag_peel(obj.GetPointer(), tag) < 0)
-						continue;
-					checkDescendent(git_object_id(obj), ref);
-					continue;
-				}
 			}
-			else if (git_reference_is_remote(ref))
+			else if (kind == CGitRefsContainsCache::REF_REMOTE_BRANCH)
 			{
 				if (!includeBranches || !(type & BRANCH_REMOTE))
 					continue;
 			}
-			else if (git_reference_is_branch(ref))
-			{
-				if (!includeBranches || !(type & BRANCH_LOCAL))
-					continue;
-			}
-			else
+			else if (!includeBranches || !(type & BRANCH_LOCAL))
 				continue;
 
-			if (git_reference_type(ref) == GIT_REFERENCE_SYMBOLIC)
-			{
-				CAutoReference peeledRef;
-				if (git_reference_resolve(peeledRef.GetPointer(), ref) < 0)
-					continue;
-
-				checkDescendent(git_reference_target(peeledRef), ref);
-				continue;
-			}
-
-			checkDescendent(git_reference_target(ref), ref);
+			list.push_back(name);
 		}
 	}
 	else
@@ -2488,7 +2456,7 @@ bool CGit::IsFastForward(const CString &from, const CString &to, CGitHash * comm
 {
 	if (UsingLibGit2(GIT_CMD_MERGE_BASE))
 	{
-		CAutoRepository repo(GetGitRepository());
+		auto repo = GetPooledGitRepository();
 		if (!repo)
 			return false;
 
@@ -2545,10 +2513,10 @@ int CGit::RefreshGitIndex()
 	// HACK: don't use internal update-index if we have a git-lfs enabled repository as the libgit version fails when executing the filter, issue #3220
 	if (g_Git.m_IsUseGitDLL && !CTGitPath(g_Git.m_CurrentDir).HasLFS())
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session;
 		try
 		{
-			g_Git.CheckAndInitDll();
+			session.Init();
 
 			int result = git_update_index();
 			git_exit_cleanup();
@@ -2620,10 +2588,10 @@ int CGit::GetOneFile(const CString &Refname, const CTGitPath &path, const CStrin
 	}
 	else if (g_Git.m_IsUseGitDLL)
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session;
 		try
 		{
-			g_Git.CheckAndInitDll();
+			session.Init();
 			CStringA ref, patha, outa;
 			ref = CUnicodeUtils::GetUTF8(Refname);
 			patha = CUnicodeUtils::GetUTF8(path.GetGitPathString());
@@ -3220,11 +3188,263 @@ bool CGit::LoadTextFile(const CString &filename, CString &msg)
 	return true; // load no further files
 }
 
+static char GetRawDiffStatus(git_delta_t status)
+{
+	switch (status)
+	{
+	case GIT_DELTA_ADDED:		return 'A';
+	case GIT_DELTA_DELETED:		return 'D';
+	case GIT_DELTA_MODIFIED:	return 'M';
+	case GIT_DELTA_RENAMED:		return 'R';
+	case GIT_DELTA_COPIED:		return 'C';
+	case GIT_DELTA_TYPECHANGE:	return 'T';
+	case GIT_DELTA_CONFLICTED:	return 'U';
+	default:					return '\0';
+	}
+}
+
+// writes the deltas in the format of "git diff-index --raw --numstat -z", so that they are parsed exactly like the output of git.exe
+static int AppendRawAndNumstat(git_diff* diff, BYTE_VECTOR& out)
+{
+	auto appendString = [&out](const char* str) { out.append(str, strlen(str) + 1); };
+
+	const size_t deltas = git_diff_num_deltas(diff);
+	for (size_t i = 0; i < deltas; ++i)
+	{
+		const git_diff_delta* delta = git_diff_get_delta(diff, i);
+		const char status = GetRawDiffStatus(delta->status);
+		if (!status)
+			continue;
+
+		char oldHash[GIT_HASH_SIZE * 2 + 1];
+		char newHash[GIT_HASH_SIZE * 2 + 1];
+		git_oid_tostr(oldHash, sizeof(oldHash), &delta->old_file.id);
+		git_oid_tostr(newHash, sizeof(newHash), &delta->new_file.id);
+		CStringA line;
+		if (status == 'R' || status == 'C')
+			line.Format(":%06o %06o %s %s %c%03u", delta->old_file.mode, delta->new_file.mode, oldHash, newHash, status, static_cast<unsigned int>(delta->similarity));
+		else
+			line.Format(":%06o %06o %s %s %c", delta->old_file.mode, delta->new_file.mode, oldHash, newHash, status);
+		appendString(line);
+		if (status == 'R' || status == 'C')
+			appendString(delta->old_file.path);
+		appendString(delta->new_file.path);
+	}
+
+	for (size_t i = 0; i < deltas; ++i)
+	{
+		const git_diff_delta* delta = git_diff_get_delta(diff, i);
+		if (!GetRawDiffStatus(delta->status) || delta->status == GIT_DELTA_CONFLICTED)
+			continue;
+
+		CAutoPatch patch;
+		if (git_patch_from_diff(patch.GetPointer(), diff, i) < 0)
+			return -1;
+
+		CStringA stat;
+		if (git_patch_get_delta(patch)->flags & GIT_DIFF_FLAG_BINARY)
+			stat = "-\t-\t";
+		else
+		{
+			size_t adds, dels;
+			if (git_patch_line_stats(nullptr, &adds, &dels, patch) < 0)
+				return -1;
+			stat.Format("%zu\t%zu\t", adds, dels);
+		}
+		if (delta->status == GIT_DELTA_RENAMED || delta->status == GIT_DELTA_COPIED)
+		{
+			appendString(stat);
+			appendString(delta->old_file.path);
+		}
+		else
+			out.append(stat, stat.GetLength());
+		appendString(delta->new_file.path);
+	}
+	return 0;
+}
+
+static int FindSimilar(git_diff* diff, int threshold)
+{
+	if (threshold <= 0)
+		return 0;
+
+	git_diff_find_options findopts = GIT_DIFF_FIND_OPTIONS_INIT;
+	findopts.flags = GIT_DIFF_FIND_COPIES | GIT_DIFF_FIND_RENAMES;
+	findopts.rename_threshold = findopts.copy_threshold = static_cast<uint16_t>(threshold);
+	return git_diff_find_similar(diff, &findopts);
+}
+
+int CGit::GetWorkingTreeChangesLibGit2(CTGitPathList& result, bool amend, const CTGitPathList* filterlist, bool includedStaged, bool getStagingStatus)
+{
+	CAutoRepository repo(GetGitRepository());
+	if (!repo)
+		return -1;
+
+	CAutoTree headTree;
+	if (resolve_to_tree(repo, amend ? "HEAD~1" : "HEAD", headTree.GetPointer()))
+		return -1;
+
+	CAutoIndex index;
+	if (git_repository_index(index.GetPointer(), repo) < 0)
+		return -1;
+
+	// all pathspecs are handled at once instead of one git.exe call per path
+	std::vector<CStringA> pathspecsA;
+	std::vector<char*> pathspecs;
+	if (filterlist)
+	{
+		pathspecsA.reserve(filterlist->GetCount());
+		for (int i = 0; i < filterlist->GetCount(); ++i)
+		{
+			ATLASSERT(!(*filterlist)[i].GetGitPathString().IsEmpty());
+			pathspecsA.push_back(CUnicodeUtils::GetUTF8((*filterlist)[i].GetGitPathString()));
+		}
+		for (auto& pathspec : pathspecsA)
+			pathspecs.push_back(pathspec.GetBuffer());
+	}
+	const git_strarray pathspecArray = { pathspecs.data(), pathspecs.size() };
+	CAutoPathspec pathspecMatcher;
+	if (filterlist && git_pathspec_new(pathspecMatcher.GetPointer(), &pathspecArray) < 0)
+		return -1;
+	auto matchesFilter = [&pathspecMatcher](const char* path) { return !pathspecMatcher || git_pathspec_matches_path(pathspecMatcher, GIT_PATHSPEC_DEFAULT, path) == 1; };
+
+	git_diff_options filteredOpts = GIT_DIFF_OPTIONS_INIT;
+	filteredOpts.flags = GIT_DIFF_INCLUDE_TYPECHANGE;
+	filteredOpts.pathspec = pathspecArray;
+	git_diff_options unfilteredOpts = GIT_DIFF_OPTIONS_INIT;
+	unfilteredOpts.flags = GIT_DIFF_INCLUDE_TYPECHANGE;
+
+	// also list staged files which will be in the commit
+	BYTE_VECTOR out;
+	CAutoDiff stagedDiff;
+	const bool stagedUnfiltered = includedStaged || !filterlist;
+	if (git_diff_tree_to_index(stagedDiff.GetPointer(), repo, headTree, index, stagedUnfiltered ? &unfilteredOpts : &filteredOpts) < 0)
+		return -1;
+	if (FindSimilar(stagedDiff, 50) < 0 || AppendRawAndNumstat(stagedDiff, out))
+		return -1;
+
+	CAutoDiff workingTreeDiff;
+	if (git_diff_tree_to_workdir_with_index(workingTreeDiff.GetPointer(), repo, headTree, &filteredOpts) < 0)
+		return -1;
+	if (FindSimilar(workingTreeDiff, ms_iSimilarityIndexThreshold) < 0 || AppendRawAndNumstat(workingTreeDiff, out))
+		return -1;
+
+	result.ParserFromLog(out);
+
+	// index against working tree, unfiltered if needed for the staging status
+	CAutoDiff unstagedDiff;
+	if (git_diff_index_to_workdir(unstagedDiff.GetPointer(), repo, index, getStagingStatus ? &unfilteredOpts : &filteredOpts) < 0)
+		return -1;
+
+	if (getStagingStatus)
+	{
+		// This will show staged files regardless of any filterlist, so that it has the same behavior that the commit window has when staging support is disabled
+		CAutoDiff stagedUnfilteredDiff;
+		if (!stagedUnfiltered)
+		{
+			if (git_diff_tree_to_index(stagedUnfilteredDiff.GetPointer(), repo, headTree, index, &unfilteredOpts) < 0 || FindSimilar(stagedUnfilteredDiff, 50) < 0)
+				return -1;
+		}
+		git_diff* stagedAll = stagedUnfiltered ? static_cast<git_diff*>(stagedDiff) : static_cast<git_diff*>(stagedUnfilteredDiff);
+
+		std::set<CString> staged, unstaged;
+		for (size_t i = 0, deltas = git_diff_num_deltas(stagedAll); i < deltas; ++i)
+			staged.insert(CUnicodeUtils::GetUnicode(git_diff_get_delta(stagedAll, i)->new_file.path));
+		for (size_t i = 0, deltas = git_diff_num_deltas(unstagedDiff); i < deltas; ++i)
+			unstaged.insert(CUnicodeUtils::GetUnicode(git_diff_get_delta(unstagedDiff, i)->new_file.path));
+
+		// File shows up both in the staged and unstaged list: partially staged
+		// File shows up only in the staged list: totally staged
+		// File shows up only in the unstaged list: totally unstaged
+		for (int j = 0; j < result.GetCount(); ++j)
+		{
+			auto& path = const_cast<CTGitPath&>(result[j]);
+			const bool isStaged = staged.find(path.GetGitPathString()) != staged.cend();
+			const bool isUnstaged = unstaged.find(path.GetGitPathString()) != unstaged.cend();
+			// make sure conflicted files show up as unstaged instead of partially staged
+			if (path.m_Action & CTGitPath::LOGACTIONS_UNMERGED)
+				path.m_stagingStatus = CTGitPath::StagingStatus::TotallyUnstaged;
+			else if (isStaged)
+				path.m_stagingStatus = isUnstaged ? CTGitPath::StagingStatus::PartiallyStaged : CTGitPath::StagingStatus::TotallyStaged;
+			else if (isUnstaged)
+				path.m_stagingStatus = CTGitPath::StagingStatus::TotallyUnstaged;
+		}
+	}
+
+	std::map<CString, int> duplicateMap;
+	for (int i = 0; i < result.GetCount(); ++i)
+		duplicateMap.insert(std::pair<CString, int>(result[i].GetGitPathString(), i));
+
+	// handle delete conflict case, when remote : modified, local : deleted.
+	CAutoIndexConflictIterator conflictIterator;
+	if (git_index_conflict_iterator_new(conflictIterator.GetPointer(), index) < 0)
+		return -1;
+	const git_index_entry* ancestor;
+	const git_index_entry* ours;
+	const git_index_entry* theirs;
+	while (git_index_conflict_next(&ancestor, &ours, &theirs, conflictIterator) == 0)
+	{
+		const git_index_entry* entry = ancestor ? ancestor : ours ? ours : theirs;
+		if (!matchesFilter(entry->path))
+			continue;
+
+		const CString pathString = CUnicodeUtils::GetUnicode(entry->path);
+		if (auto existing = duplicateMap.find(pathString); existing != duplicateMap.end())
+		{
+			CTGitPath& p = const_cast<CTGitPath&>(result[existing->second]);
+			p.m_Action |= CTGitPath::LOGACTIONS_UNMERGED;
+		}
+		else
+		{
+			CTGitPath path;
+			path.SetFromGit(pathString, (entry->mode & S_IFDIR) == S_IFDIR);
+			path.m_Action = CTGitPath::LOGACTIONS_UNMERGED;
+			result.AddPath(path);
+			duplicateMap.insert(std::pair<CString, int>(path.GetGitPathString(), result.GetCount() - 1));
+		}
+	}
+
+	// handle source files of file renames/moves (issue #860)
+	// if a file gets renamed and the new file "git add"ed, diff-index doesn't list the source file anymore
+	for (size_t i = 0, deltas = git_diff_num_deltas(unstagedDiff); i < deltas; ++i)
+	{
+		const git_diff_delta* delta = git_diff_get_delta(unstagedDiff, i);
+		if (delta->status != GIT_DELTA_DELETED || !matchesFilter(delta->old_file.path))
+			continue;
+
+		CTGitPath path;
+		path.SetFromGit(CUnicodeUtils::GetUnicode(delta->old_file.path));
+		if (auto existing = duplicateMap.find(path.GetGitPathString()); existing == duplicateMap.end())
+		{
+			path.m_Action = CTGitPath::LOGACTIONS_DELETED | CTGitPath::LOGACTIONS_MISSING;
+			result.AddPath(path);
+			duplicateMap.insert(std::pair<CString, int>(path.GetGitPathString(), result.GetCount() - 1));
+		}
+		else
+		{
+			CTGitPath& p = const_cast<CTGitPath&>(result[existing->second]);
+			p.m_Action |= CTGitPath::LOGACTIONS_MISSING;
+			result.m_Action |= CTGitPath::LOGACTIONS_MISSING;
+		}
+	}
+
+	return 0;
+}
+
 int CGit::GetWorkingTreeChanges(CTGitPathList& result, bool amend, const CTGitPathList* filterlist, bool includedStaged /* = false */, bool getStagingStatus /* = false */)
 {
 	if (IsInitRepos())
 		return GetInitAddList(result, getStagingStatus);
 
+	if (UsingLibGit2(GIT_CMD_WORKINGTREECHANGES))
+	{
+		if (GetWorkingTreeChangesLibGit2(result, amend, filterlist, includedStaged, getStagingStatus) == 0)
+			return 0;
+		// fall back to git.exe, which also reports errors to the user
+		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": libgit2 failed, falling back to git.exe: %s\n", static_cast<LPCWSTR>(GetLibGit2LastErr()));
+		result.Clear();
+	}
+
 	BYTE_VECTOR out;
 
 	int count = 1;
@@ -3504,7 +3724,7 @@ int CGit::GetGitVersion(CString* versiondebug, CString* errStr)
 
 int CGit::GetGitNotes(const CGitHash& hash, CString& notes)
 {
-	CAutoRepository repo(GetGitRepository());
+	auto repo = GetPooledGitRepository();
 	if (!repo)
 		return -1;
 
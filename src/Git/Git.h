@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2025 - TortoiseGit
+// Copyright (C) 2008-2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -25,6 +25,7 @@
 #include <functional>
 #include "StringUtils.h"
 #include "PathUtils.h"
+#include "GitRepositoryPool.h"
 
 #define REG_MSYSGIT_PATH L"Software\\TortoiseGit\\MSysGit"
 #define REG_SYSTEM_GITCONFIGPATH L"Software\\TortoiseGit\\SystemConfig"
@@ -33,6 +34,7 @@
 #define DEFAULT_USE_LIBGIT2_MASK (1 << CGit::GIT_CMD_MERGE_BASE) | (1 << CGit::GIT_CMD_DELETETAGBRANCH) | (1 << CGit::GIT_CMD_GETONEFILE) | (1 << CGit::GIT_CMD_ADD) | (1 << CGit::GIT_CMD_CHECKCONFLICTS) | (1 << CGit::GIT_CMD_GET_COMMIT) | (1 << CGit::GIT_CMD_GETCONFLICTINFO) | (1 << CGit::GIT_CMD_FOREACHREF)
 
 struct git_repository;
+class CGitRefsContainsCache;
 
 using CAutoLocker = CComCritSecLock<CComCriticalSection>;
 
@@ -187,6 +189,8 @@ class CGit
 {
 private:
 	CString		gitLastErr;
+	std::unique_ptr<CGitRefsContainsCache> m_RefsContainsCache;
+	CGitRepositoryPool m_RepositoryPool;
 protected:
 	GIT_DIFF m_GitDiff = nullptr;
 	GIT_DIFF m_GitSimpleListDiff = nullptr;
@@ -194,8 +198,31 @@ protected:
 public:
 #endif
 	bool m_IsGitDllInited = false;
+private:
+	friend class CGitDllSession;
+	// gitdll state is process wide, only to be used via CGitDllSession
+	static CComAutoCriticalSection ms_critGitDllSec;
+	// only reachable via CGitDllSession::Init()/ForceReInit()
+	inline void ForceReInitDll()
+	{
+#ifdef TGITCACHE
+		ATLASSERT("we should never get here");
+#endif
+		m_IsGitDllInited = false;
+		CheckAndInitDll();
+	}
+	void CheckAndInitDll()
+	{
+#ifdef TGITCACHE
+		ATLASSERT("we should never get here");
+#endif
+		if(!m_IsGitDllInited)
+		{
+			git_init(m_Environment);
+			m_IsGitDllInited=true;
+		}
+	}
 public:
-	CComAutoCriticalSection m_critGitDllSec;
 	bool	m_IsUseGitDLL;
 	bool	m_IsUseLibGit2;
 	DWORD	m_IsUseLibGit2_mask;
@@ -228,26 +255,6 @@ public:
 			return PathFileExists(path);
 	}
 
-	inline void ForceReInitDll()
-	{
-#ifdef TGITCACHE
-		ATLASSERT("we should never get here");
-#endif
-		m_IsGitDllInited = false;
-		CheckAndInitDll();
-	}
-	void CheckAndInitDll()
-	{
-#ifdef TGITCACHE
-		ATLASSERT("we should never get here");
-#endif
-		if(!m_IsGitDllInited)
-		{
-			git_init(m_Environment);
-			m_IsGitDllInited=true;
-		}
-	}
-
 	GIT_DIFF GetGitDiff()
 	{
 #ifdef TGITCACHE
@@ -303,6 +310,7 @@ public:
 		GIT_CMD_BRANCH_CONTAINS,
 		GIT_CMD_GETCONFLICTINFO,
 		GIT_CMD_FOREACHREF,
+		GIT_CMD_WORKINGTREECHANGES,
 		LAST_VALUE,
 	};
 	static_assert(LIBGIT2_CMD::LAST_VALUE < sizeof(DWORD) * 8, "too many flags for storing them in a DWORD bitfield");
@@ -319,6 +327,13 @@ public:
 	CString GetGitGlobalXDGConfig(bool returnDirectory = false) const;
 	CString GetGitSystemConfig() const;
 	CAutoRepository GetGitRepository() const;
+	/**
+	 * Borrows an opened repository of m_CurrentDir from a pool, cheaper than GetGitRepository() if called often.
+	 * Only for reading objects and refs; the repository must not be used by several threads at a time.
+	 */
+	CGitRepositoryPool::CRepository GetPooledGitRepository() { return m_RepositoryPool.Get(GetGitPathStringA(m_CurrentDir)); }
+	/// frees the pooled repositories, e.g. after changes the pool does not detect by itself
+	void InvalidateRepositoryPool() { m_RepositoryPool.Invalidate(); }
 	static CStringA GetGitPathStringA(const CString &path);
 	static CString ms_LastMsysGitDir;	// the last msysgitdir added to the path, blank if none
 	static CString ms_MsysGitRootDir;
@@ -374,6 +389,7 @@ private:
 		CGitCall* pcall;
 	};
 	CString GetUnifiedDiffCmd(const CTGitPath& path, const CString& rev1, const CString& rev2, bool bMerge, bool bCombine, int diffContext, bool bNoPrefix = false);
+	int GetWorkingTreeChangesLibGit2(CTGitPathList& result, bool amend, const CTGitPathList* filterlist, bool includedStaged, bool getStagingStatus);
 
 public:
 #ifdef _MFC_VER
@@ -646,3 +662,67 @@ extern CString GetTempFile();
 extern DWORD GetTortoiseGitTempPath(DWORD nBufferLength, LPWSTR lpBuffer);
 
 extern CGit g_Git;
+
+/**
+ * \ingroup Git
+ * Scoped, exclusive access to gitdll.
+ *
+ * gitdll runs git's own code whose object database, table of parsed objects, diff queue and
+ * revision walking state are process wide, so only one session can be active at a time (sessions
+ * are reentrant on the same thread). Copy what is needed and call Release() before doing expensive
+ * work that does not touch gitdll (decoding, building path lists, ...), so that the log loading,
+ * the asynchronous diff and blame can interleave.
+ */
+class CGitDllSession
+{
+public:
+	explicit CGitDllSession(CGit& git = g_Git)
+		: m_Git(git)
+	{
+		Acquire();
+	}
+
+	~CGitDllSession()
+	{
+		Release();
+	}
+
+	CGitDllSession(const CGitDllSession&) = delete;
+	CGitDllSession& operator=(const CGitDllSession&) = delete;
+
+	void Acquire()
+	{
+		if (m_bActive)
+			return;
+		CGit::ms_critGitDllSec.Lock();
+		m_bActive = true;
+	}
+
+	void Release()
+	{
+		if (!m_bActive)
+			return;
+		m_bActive = false;
+		CGit::ms_critGitDllSec.Unlock();
+	}
+
+	bool IsActive() const { return m_bActive; }
+
+	/// initializes gitdll if not done yet, throws a const char* on failure
+	void Init()
+	{
+		ATLASSERT(m_bActive);
+		m_Git.CheckAndInitDll();
+	}
+
+	/// re-initializes gitdll, e.g. after the working tree was changed, throws a const char* on failure
+	void ForceReInit()
+	{
+		ATLASSERT(m_bActive);
+		m_Git.ForceReInitDll();
+	}
+
+private:
+	CGit&	m_Git;
+	bool	m_bActive = false;
+};
@@ -0,0 +1,597 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "GitCommitGraph.h"
+#include "Git.h"
+#include "UnicodeUtils.h"
+#include "SmartHandle.h"
+
+// see Documentation/gitformat-commit-graph.txt of git
+#define COMMIT_GRAPH_SIGNATURE		0x43475048 // "CGPH"
+#define COMMIT_GRAPH_VERSION		1
+#define COMMIT_GRAPH_HASH_SHA1		1
+#define COMMIT_GRAPH_HEADER_SIZE	8
+#define COMMIT_GRAPH_CHUNK_ENTRY	12
+#define COMMIT_GRAPH_CHUNK_OIDF		0x4f494446 // "OIDF"
+#define COMMIT_GRAPH_CHUNK_OIDL		0x4f49444c // "OIDL"
+#define COMMIT_GRAPH_CHUNK_CDAT		0x43444154 // "CDAT"
+#define COMMIT_GRAPH_CHUNK_EDGE		0x45444745 // "EDGE"
+#define COMMIT_GRAPH_DATA_SIZE		(GIT_HASH_SIZE + 16)
+#define COMMIT_GRAPH_PARENT_NONE	0x70000000
+#define COMMIT_GRAPH_EXTRA_EDGES	0x80000000
+#define COMMIT_GRAPH_EDGE_LAST		0x80000000
+#define COMMIT_GRAPH_GENERATION_MAX	0x3FFFFFFF
+
+// upper bound for the number of remembered lookups of CGitRefsContainsCache
+#define REFS_CONTAINS_MAX_RESULTS	256
+
+static inline uint32_t GetBigEndian32(const BYTE* data)
+{
+	return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+static inline uint64_t GetBigEndian64(const BYTE* data)
+{
+	return (static_cast<uint64_t>(GetBigEndian32(data)) << 32) | GetBigEndian32(data + 4);
+}
+
+CString CGitCommitGraph::GetCommitGraphFile(git_repository* repo)
+{
+	const char* commonDir = git_repository_commondir(repo);
+	if (!commonDir)
+		return CString();
+
+	CString file = CUnicodeUtils::GetUnicode(commonDir);
+	file.Replace(L'/', L'\\');
+	if (!CStringUtils::EndsWith(file, L'\\'))
+		file += L'\\';
+	file += L"objects\\info\\commit-graph";
+	return file;
+}
+
+void CGitCommitGraph::Reset()
+{
+	m_pFileData.reset();
+	m_iFileDataSize = 0;
+	m_FileModifyTime = 0;
+	m_FileSize = -1;
+	m_iFileCommits = 0;
+	m_pFanout = nullptr;
+	m_pOidLookup = nullptr;
+	m_pCommitData = nullptr;
+	m_pExtraEdges = nullptr;
+	m_iExtraEdges = 0;
+	m_ExtraCommits.clear();
+	m_ExtraParentHashes.clear();
+	m_ExtraParentIds.clear();
+	m_ExtraLookup.clear();
+}
+
+int CGitCommitGraph::Init(git_repository* repo)
+{
+	Reset();
+
+	const CString file = GetCommitGraphFile(repo);
+	if (file.IsEmpty())
+		return -1;
+
+	if (CGit::GetFileModifyTime(file, &m_FileModifyTime, nullptr, &m_FileSize))
+	{
+		// no commit-graph file (or a split commit-graph chain, which is not supported), all commits are read via libgit2
+		m_FileModifyTime = 0;
+		m_FileSize = -1;
+		return 0;
+	}
+
+	if (!ReadCommitGraphFile(file) || !ParseCommitGraphFile())
+	{
+		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": ignoring unusable commit-graph file %s\n", static_cast<LPCWSTR>(file));
+		const auto modifyTime = m_FileModifyTime;
+		const auto fileSize = m_FileSize;
+		Reset();
+		// remember the file, so that it is not read again and again as long as it is not changed
+		m_FileModifyTime = modifyTime;
+		m_FileSize = fileSize;
+	}
+	return 0;
+}
+
+bool CGitCommitGraph::IsUpToDate(git_repository* repo) const
+{
+	const CString file = GetCommitGraphFile(repo);
+	if (file.IsEmpty())
+		return false;
+
+	__int64 time = 0;
+	__int64 size = -1;
+	if (CGit::GetFileModifyTime(file, &time, nullptr, &size))
+		return m_FileSize == -1;
+	return time == m_FileModifyTime && size == m_FileSize;
+}
+
+bool CGitCommitGraph::ReadCommitGraphFile(const CString& file)
+{
+	CAutoFile hFile = ::CreateFile(file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (!hFile)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!::GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart != m_FileSize || static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX)
+		return false;
+
+	m_iFileDataSize = static_cast<size_t>(fileSize.QuadPart);
+	m_pFileData = std::make_unique<BYTE[]>(m_iFileDataSize);
+	size_t offset = 0;
+	while (offset < m_iFileDataSize)
+	{
+		const DWORD toRead = static_cast<DWORD>(min(m_iFileDataSize - offset, static_cast<size_t>(1 << 30)));
+		DWORD read = 0;
+		if (!::ReadFile(hFile, m_pFileData.get() + offset, toRead, &read, nullptr) || read == 0)
+			return false;
+		offset += read;
+	}
+	return true;
+}
+
+bool CGitCommitGraph::ParseCommitGraphFile()
+{
+	const BYTE* data = m_pFileData.get();
+	const size_t size = m_iFileDataSize;
+	if (size < COMMIT_GRAPH_HEADER_SIZE + COMMIT_GRAPH_CHUNK_ENTRY + GIT_HASH_SIZE)
+		return false;
+	if (GetBigEndian32(data) != COMMIT_GRAPH_SIGNATURE || data[4] != COMMIT_GRAPH_VERSION || data[5] != COMMIT_GRAPH_HASH_SHA1)
+		return false;
+	const size_t chunkCount = data[6];
+	if (data[7] != 0) // base graphs of a split commit-graph
+		return false;
+	if (size < COMMIT_GRAPH_HEADER_SIZE + (chunkCount + 1) * COMMIT_GRAPH_CHUNK_ENTRY + GIT_HASH_SIZE)
+		return false;
+
+	const size_t dataEnd = size - GIT_HASH_SIZE;
+	size_t oidlSize = 0, cdatSize = 0;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const BYTE* entry = data + COMMIT_GRAPH_HEADER_SIZE + i * COMMIT_GRAPH_CHUNK_ENTRY;
+		const uint32_t id = GetBigEndian32(entry);
+		const uint64_t start = GetBigEndian64(entry + 4);
+		const uint64_t end = GetBigEndian64(entry + 4 + COMMIT_GRAPH_CHUNK_ENTRY);
+		if (start > end || end > dataEnd)
+			return false;
+		const size_t chunkSize = static_cast<size_t>(end - start);
+		switch (id)
+		{
+		case COMMIT_GRAPH_CHUNK_OIDF:
+			if (chunkSize != 256 * sizeof(uint32_t))
+				return false;
+			m_pFanout = data + start;
+			break;
+		case COMMIT_GRAPH_CHUNK_OIDL:
+			m_pOidLookup = data + start;
+			oidlSize = chunkSize;
+			break;
+		case COMMIT_GRAPH_CHUNK_CDAT:
+			m_pCommitData = data + start;
+			cdatSize = chunkSize;
+			break;
+		case COMMIT_GRAPH_CHUNK_EDGE:
+			if (chunkSize % sizeof(uint32_t))
+				return false;
+			m_pExtraEdges = data + start;
+			m_iExtraEdges = chunkSize / sizeof(uint32_t);
+			break;
+		}
+	}
+	if (!m_pFanout || !m_pOidLookup || !m_pCommitData)
+		return false;
+
+	uint32_t previous = 0;
+	for (int i = 0; i < 256; ++i)
+	{
+		const uint32_t count = GetBigEndian32(m_pFanout + i * sizeof(uint32_t));
+		if (count < previous)
+			return false;
+		previous = count;
+	}
+	// ids of extra commits start after the file commits and must not collide with the special values
+	if (previous >= PARENT_UNRESOLVED / 2 || oidlSize != static_cast<size_t>(previous) * GIT_HASH_SIZE || cdatSize != static_cast<size_t>(previous) * COMMIT_GRAPH_DATA_SIZE)
+		return false;
+
+	m_iFileCommits = previous;
+	return true;
+}
+
+uint32_t CGitCommitGraph::Lookup(git_repository* repo, const CGitHash& hash)
+{
+	if (m_iFileCommits)
+	{
+		const BYTE firstByte = hash.ToRaw()[0];
+		uint32_t lo = firstByte ? GetBigEndian32(m_pFanout + (firstByte - 1) * sizeof(uint32_t)) : 0;
+		uint32_t hi = GetBigEndian32(m_pFanout + firstByte * sizeof(uint32_t));
+		while (lo < hi)
+		{
+			const uint32_t mid = lo + (hi - lo) / 2;
+			const int cmp = memcmp(m_pOidLookup + static_cast<size_t>(mid) * GIT_HASH_SIZE, hash.ToRaw(), GIT_HASH_SIZE);
+			if (cmp == 0)
+				return mid;
+			if (cmp < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+	}
+
+	if (auto it = m_ExtraLookup.find(hash); it != m_ExtraLookup.cend())
+		return it->second;
+
+	CAutoCommit commit;
+	if (git_commit_lookup(commit.GetPointer(), repo, hash))
+		return NO_COMMIT;
+
+	SExtraCommit extra;
+	extra.m_Hash = hash;
+	extra.m_ParentStart = m_ExtraParentHashes.size();
+	extra.m_ParentCount = git_commit_parentcount(commit);
+	extra.m_Generation = GENERATION_NOT_COMPUTED;
+	for (uint32_t i = 0; i < extra.m_ParentCount; ++i)
+	{
+		m_ExtraParentHashes.emplace_back(git_commit_parent_id(commit, i));
+		m_ExtraParentIds.push_back(PARENT_UNRESOLVED);
+	}
+	const uint32_t id = m_iFileCommits + static_cast<uint32_t>(m_ExtraCommits.size());
+	m_ExtraCommits.push_back(extra);
+	m_ExtraLookup.emplace(hash, id);
+	return id;
+}
+
+void CGitCommitGraph::GetParents(git_repository* repo, uint32_t commit, std::vector<uint32_t>& parents)
+{
+	parents.clear();
+	if (commit < m_iFileCommits)
+	{
+		const BYTE* commitData = m_pCommitData + static_cast<size_t>(commit) * COMMIT_GRAPH_DATA_SIZE;
+		const uint32_t parent1 = GetBigEndian32(commitData + GIT_HASH_SIZE);
+		const uint32_t parent2 = GetBigEndian32(commitData + GIT_HASH_SIZE + 4);
+		if (parent1 == COMMIT_GRAPH_PARENT_NONE)
+			return;
+		if (parent1 < m_iFileCommits)
+			parents.push_back(parent1);
+		if (parent2 == COMMIT_GRAPH_PARENT_NONE)
+			return;
+		if (!(parent2 & COMMIT_GRAPH_EXTRA_EDGES))
+		{
+			if (parent2 < m_iFileCommits)
+				parents.push_back(parent2);
+			return;
+		}
+		for (size_t edge = parent2 & ~COMMIT_GRAPH_EXTRA_EDGES; edge < m_iExtraEdges; ++edge)
+		{
+			const uint32_t parent = GetBigEndian32(m_pExtraEdges + edge * sizeof(uint32_t));
+			if ((parent & ~COMMIT_GRAPH_EDGE_LAST) < m_iFileCommits)
+				parents.push_back(parent & ~COMMIT_GRAPH_EDGE_LAST);
+			if (parent & COMMIT_GRAPH_EDGE_LAST)
+				break;
+		}
+		return;
+	}
+
+	const size_t index = commit - m_iFileCommits;
+	const size_t parentStart = m_ExtraCommits[index].m_ParentStart;
+	const uint32_t parentCount = m_ExtraCommits[index].m_ParentCount;
+	for (uint32_t i = 0; i < parentCount; ++i)
+	{
+		// Lookup may add commits, so do not keep references into the vectors
+		if (m_ExtraParentIds[parentStart + i] == PARENT_UNRESOLVED)
+		{
+			const CGitHash parentHash = m_ExtraParentHashes[parentStart + i];
+			const uint32_t parent = Lookup(repo, parentHash); // missing parents (e.g. shallow clones) are skipped
+			m_ExtraParentIds[parentStart + i] = parent;
+		}
+		if (m_ExtraParentIds[parentStart + i] != NO_COMMIT)
+			parents.push_back(m_ExtraParentIds[parentStart + i]);
+	}
+}
+
+uint32_t CGitCommitGraph::GetFileGeneration(uint32_t commit) const
+{
+	ASSERT(commit < m_iFileCommits);
+	// the upper 30 bits contain the topological level, 0 means that the writer did not compute it
+	const uint32_t generation = GetBigEndian32(m_pCommitData + static_cast<size_t>(commit) * COMMIT_GRAPH_DATA_SIZE + GIT_HASH_SIZE + 8) >> 2;
+	if (generation == 0 || generation == COMMIT_GRAPH_GENERATION_MAX)
+		return GENERATION_UNKNOWN;
+	return generation;
+}
+
+uint32_t CGitCommitGraph::GetGeneration(git_repository* repo, uint32_t commit)
+{
+	if (commit < m_iFileCommits)
+		return GetFileGeneration(commit);
+	if (m_ExtraCommits[commit - m_iFileCommits].m_Generation != GENERATION_NOT_COMPUTED)
+		return m_ExtraCommits[commit - m_iFileCommits].m_Generation;
+
+	// iteratively, history might be far too deep for recursion
+	std::vector<uint32_t> stack{ commit };
+	std::vector<uint32_t> parents;
+	while (!stack.empty())
+	{
+		const uint32_t current = stack.back();
+		if (m_ExtraCommits[current - m_iFileCommits].m_Generation != GENERATION_NOT_COMPUTED)
+		{
+			stack.pop_back();
+			continue;
+		}
+
+		GetParents(repo, current, parents);
+		uint32_t generation = 1;
+		bool complete = true;
+		for (const auto parent : parents)
+		{
+			const uint32_t parentGeneration = parent < m_iFileCommits ? GetFileGeneration(parent) : m_ExtraCommits[parent - m_iFileCommits].m_Generation;
+			if (parentGeneration == GENERATION_UNKNOWN)
+			{
+				generation = GENERATION_UNKNOWN;
+				break;
+			}
+			if (parentGeneration == GENERATION_NOT_COMPUTED)
+			{
+				stack.push_back(parent);
+				complete = false;
+				continue;
+			}
+			generation = max(generation, parentGeneration + 1);
+		}
+		if (generation != GENERATION_UNKNOWN && !complete)
+			continue;
+
+		m_ExtraCommits[current - m_iFileCommits].m_Generation = generation;
+		stack.pop_back();
+	}
+	return m_ExtraCommits[commit - m_iFileCommits].m_Generation;
+}
+
+int CGitCommitGraph::GetContaining(git_repository* repo, const CGitHash& target, const std::vector<CGitHash>& tips, std::vector<bool>& contained)
+{
+	contained.assign(tips.size(), false);
+
+	const uint32_t targetId = Lookup(repo, target);
+	if (targetId == NO_COMMIT)
+	{
+		// not a commit, only refs pointing directly to it contain it
+		for (size_t i = 0; i < tips.size(); ++i)
+			contained[i] = tips[i] == target;
+		return 0;
+	}
+	const uint32_t targetGeneration = GetGeneration(repo, targetId);
+
+	enum : BYTE
+	{
+		STATE_UNKNOWN = 0,
+		STATE_VISITING,
+		STATE_CONTAINS,
+		STATE_NOT_CONTAINS,
+	};
+	// shared by all tips, so that common history is only walked once
+	std::vector<BYTE> state;
+	struct SFrame
+	{
+		uint32_t				m_Commit;
+		size_t					m_NextParent;
+		std::vector<uint32_t>	m_Parents;
+	};
+	std::vector<SFrame> stack;
+
+	// returns true if the commit needs to be walked
+	auto enter = [&](uint32_t commit) {
+		const size_t commitCount = m_iFileCommits + m_ExtraCommits.size();
+		if (state.size() < commitCount)
+			state.resize(commitCount, STATE_UNKNOWN);
+		if (state[commit] != STATE_UNKNOWN)
+			return false;
+		if (commit == targetId)
+		{
+			state[commit] = STATE_CONTAINS;
+			return false;
+		}
+		// a commit can only reach commits with a smaller generation
+		if (targetGeneration != GENERATION_UNKNOWN)
+		{
+			const uint32_t generation = GetGeneration(repo, commit);
+			if (generation != GENERATION_UNKNOWN && generation <= targetGeneration)
+			{
+				state[commit] = STATE_NOT_CONTAINS;
+				return false;
+			}
+		}
+		state[commit] = STATE_VISITING;
+		stack.push_back({ commit, 0 });
+		GetParents(repo, commit, stack.back().m_Parents);
+		return true;
+	};
+
+	for (size_t i = 0; i < tips.size(); ++i)
+	{
+		if (tips[i] == target)
+		{
+			contained[i] = true;
+			continue;
+		}
+
+		const uint32_t tipId = Lookup(repo, tips[i]);
+		if (tipId == NO_COMMIT)
+			continue;
+
+		enter(tipId);
+		while (!stack.empty())
+		{
+			auto& frame = stack.back();
+			if (frame.m_NextParent == frame.m_Parents.size())
+			{
+				state[frame.m_Commit] = STATE_NOT_CONTAINS;
+				stack.pop_back();
+				continue;
+			}
+
+			const uint32_t parent = frame.m_Parents[frame.m_NextParent++];
+			if (enter(parent))
+				continue;
+			if (state[parent] == STATE_CONTAINS)
+			{
+				// every commit on the stack is a descendant of the parent
+				for (const auto& descendant : stack)
+					state[descendant.m_Commit] = STATE_CONTAINS;
+				stack.clear();
+			}
+		}
+		contained[i] = state[tipId] == STATE_CONTAINS;
+	}
+	return 0;
+}
+
+int CGitRefsContainsCache::UpdateRefs(git_repository* repo)
+{
+	std::vector<std::pair<CStringA, CGitHash>> refState;
+	{
+		CAutoReferenceIterator it;
+		if (git_reference_iterator_new(it.GetPointer(), repo))
+			return -1;
+
+		CAutoReference ref;
+		while (git_reference_next(ref.GetPointer(), it) == 0)
+		{
+			CStringA name = git_reference_name(ref);
+			if (git_reference_type(ref) == GIT_REFERENCE_SYMBOLIC)
+			{
+				name += '\n';
+				name += git_reference_symbolic_target(ref);
+				refState.emplace_back(name, CGitHash());
+			}
+			else
+				refState.emplace_back(name, git_reference_target(ref));
+		}
+	}
+	std::sort(refState.begin(), refState.end());
+	if (refState == m_RefState)
+		return 0;
+
+	m_RefState = std::move(refState);
+	m_Refs.clear();
+	m_Tips.clear();
+	m_Results.clear();
+
+	CAutoReferenceIterator it;
+	if (git_reference_iterator_new(it.GetPointer(), repo))
+		return -1;
+
+	CAutoReference ref;
+	while (git_reference_next(ref.GetPointer(), it) == 0)
+	{
+		SRef entry;
+		if (git_reference_is_tag(ref))
+		{
+			entry.m_Kind = REF_TAG;
+			CAutoTag tag;
+			if (git_reference_target(ref) && git_tag_lookup(tag.GetPointer(), repo, git_reference_target(ref)) == 0)
+			{
+				CAutoObject obj;
+				if (git_tag_peel(obj.GetPointer(), tag) < 0)
+					continue;
+				entry.m_Target = git_object_id(obj);
+			}
+		}
+		else if (git_reference_is_remote(ref))
+			entry.m_Kind = REF_REMOTE_BRANCH;
+		else if (git_reference_is_branch(ref))
+			entry.m_Kind = REF_LOCAL_BRANCH;
+		else
+			continue;
+
+		if (entry.m_Target.IsEmpty())
+		{
+			if (git_reference_type(ref) == GIT_REFERENCE_SYMBOLIC)
+			{
+				CAutoReference peeledRef;
+				if (git_reference_resolve(peeledRef.GetPointer(), ref) < 0)
+					continue;
+				if (!git_reference_target(peeledRef))
+					continue;
+				entry.m_Target = git_reference_target(peeledRef);
+			}
+			else if (git_reference_target(ref))
+				entry.m_Target = git_reference_target(ref);
+			else
+				continue;
+		}
+
+		const char* name = git_reference_name(ref);
+		if (!name)
+			continue;
+		entry.m_Name = CUnicodeUtils::GetUnicode(name);
+		m_Tips.push_back(entry.m_Target);
+		m_Refs.push_back(std::move(entry));
+	}
+	return 0;
+}
+
+int CGitRefsContainsCache::GetRefsContaining(git_repository* repo, const CGitHash& target, std::vector<std::pair<CString, RefKind>>& refs)
+{
+	CAutoLocker lock(m_critSec);
+
+	const char* repoPath = git_repository_path(repo);
+	if (!repoPath)
+		return -1;
+	const CString path = CUnicodeUtils::GetUnicode(repoPath);
+	if (path != m_RepoPath)
+	{
+		m_RepoPath = path;
+		m_RefState.clear();
+		m_Refs.clear();
+		m_Tips.clear();
+		m_Results.clear();
+		m_bCommitGraphInitialized = false;
+	}
+
+	if (UpdateRefs(repo))
+		return -1;
+
+	if (!m_bCommitGraphInitialized || !m_CommitGraph.IsUpToDate(repo))
+	{
+		// extra commits might have been dropped (e.g. by gc), start over
+		if (m_CommitGraph.Init(repo))
+			return -1;
+		m_bCommitGraphInitialized = true;
+	}
+
+	auto it = m_Results.find(target);
+	if (it == m_Results.cend())
+	{
+		std::vector<bool> contained;
+		if (m_CommitGraph.GetContaining(repo, target, m_Tips, contained))
+			return -1;
+		if (m_Results.size() >= REFS_CONTAINS_MAX_RESULTS)
+			m_Results.clear();
+		it = m_Results.emplace(target, std::move(contained)).first;
+	}
+
+	for (size_t i = 0; i < m_Refs.size(); ++i)
+	{
+		if (it->second[i])
+			refs.emplace_back(m_Refs[i].m_Name, m_Refs[i].m_Kind);
+	}
+	return 0;
+}
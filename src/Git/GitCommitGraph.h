@@ -0,0 +1,132 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#pragma once
+#include "GitHash.h"
+
+struct git_repository;
+
+/**
+ * \ingroup Git
+ * Answers reachability questions on the commit history.
+ * Commits are taken from git's commit-graph file (objects/info/commit-graph) if present,
+ * all other commits are parsed via libgit2 on demand and remembered. Generation numbers
+ * are used to stop walking as soon as a commit cannot reach the wanted one anymore.
+ * Commits never change, so an instance stays valid as long as the commit-graph file does not change.
+ */
+class CGitCommitGraph
+{
+public:
+	CGitCommitGraph() = default;
+	CGitCommitGraph(const CGitCommitGraph&) = delete;
+	CGitCommitGraph& operator=(const CGitCommitGraph&) = delete;
+
+	/**
+	 * Loads the commit-graph file of the repository, if there is one.
+	 * \return -1 if the repository path could not be determined, a missing or unusable commit-graph file is not an error
+	 */
+	int Init(git_repository* repo);
+	bool IsUpToDate(git_repository* repo) const;
+	bool HasCommitGraphFile() const { return m_iFileCommits > 0; }
+
+	/**
+	 * Checks for all tips at once whether target is reachable from them (or equals them).
+	 * \param contained receives one entry per tip
+	 */
+	int GetContaining(git_repository* repo, const CGitHash& target, const std::vector<CGitHash>& tips, std::vector<bool>& contained);
+
+private:
+	static const uint32_t NO_COMMIT = UINT32_MAX;
+	static const uint32_t GENERATION_NOT_COMPUTED = 0;
+	static const uint32_t GENERATION_UNKNOWN = UINT32_MAX;
+	static const uint32_t PARENT_UNRESOLVED = UINT32_MAX - 1;
+
+	struct SExtraCommit
+	{
+		CGitHash	m_Hash;
+		size_t		m_ParentStart;
+		uint32_t	m_ParentCount;
+		uint32_t	m_Generation;
+	};
+
+	static CString GetCommitGraphFile(git_repository* repo);
+	bool ReadCommitGraphFile(const CString& file);
+	bool ParseCommitGraphFile();
+	void Reset();
+
+	uint32_t Lookup(git_repository* repo, const CGitHash& hash);
+	void GetParents(git_repository* repo, uint32_t commit, std::vector<uint32_t>& parents);
+	uint32_t GetFileGeneration(uint32_t commit) const;
+	uint32_t GetGeneration(git_repository* repo, uint32_t commit);
+
+	// content of the commit-graph file, commits in it have the ids [0, m_iFileCommits)
+	// the file is read into memory instead of being mapped, so that git can still replace it
+	std::unique_ptr<BYTE[]>	m_pFileData;
+	size_t				m_iFileDataSize = 0;
+	__int64				m_FileModifyTime = 0;
+	__int64				m_FileSize = -1;
+	uint32_t			m_iFileCommits = 0;
+	const BYTE*			m_pFanout = nullptr;
+	const BYTE*			m_pOidLookup = nullptr;
+	const BYTE*			m_pCommitData = nullptr;
+	const BYTE*			m_pExtraEdges = nullptr;
+	size_t				m_iExtraEdges = 0;
+
+	// commits parsed via libgit2, they have the ids m_iFileCommits + index
+	std::vector<SExtraCommit>	m_ExtraCommits;
+	std::vector<CGitHash>		m_ExtraParentHashes;
+	std::vector<uint32_t>		m_ExtraParentIds;
+	std::unordered_map<CGitHash, uint32_t> m_ExtraLookup;
+};
+
+/**
+ * \ingroup Git
+ * Remembers which refs contain a commit, valid as long as the refs of the repository do not change.
+ */
+class CGitRefsContainsCache
+{
+public:
+	enum RefKind
+	{
+		REF_TAG,
+		REF_LOCAL_BRANCH,
+		REF_REMOTE_BRANCH,
+	};
+
+	int GetRefsContaining(git_repository* repo, const CGitHash& target, std::vector<std::pair<CString, RefKind>>& refs);
+
+private:
+	struct SRef
+	{
+		CString		m_Name;
+		RefKind		m_Kind;
+		CGitHash	m_Target; // peeled
+	};
+
+	int UpdateRefs(git_repository* repo);
+
+	CComAutoCriticalSection m_critSec;
+	CString m_RepoPath;
+	std::vector<std::pair<CStringA, CGitHash>> m_RefState; // name (plus target for symbolic refs) and direct target of every ref
+	std::vector<SRef> m_Refs;
+	std::vector<CGitHash> m_Tips;
+	std::map<CGitHash, std::vector<bool>> m_Results;
+	CGitCommitGraph m_CommitGraph;
+	bool m_bCommitGraphInitialized = false;
+};
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2025 - TortoiseGit
+// Copyright (C) 2008-2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -26,11 +26,65 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "SmartHandle.h"
+#include "ThreadPoolWork.h"
 #include "git2/sys/repository.h"
 #include <stdexcept>
+#include <intsafe.h>
 
 CGitAdminDirMap g_AdminDirMap;
 
+#define PATH_ARENA_BLOCK_SIZE		(64 * 1024) // in characters
+#define READTREE_MAX_SPLIT_DEPTH	3
+
+#define INDEX_SNAPSHOT_FILE_NAME	L"tortoisegit.indexcache"
+#define INDEX_SNAPSHOT_MAGIC		0x54474958
+#define INDEX_SNAPSHOT_VERSION		2
+#define INDEX_SNAPSHOT_IGNORECASE	0x1
+#define INDEX_SNAPSHOT_CONFLICTS	0x2
+
+/*
+ * Snapshot of the already sorted index entries, stored next to the index.
+ * It is only used if the index and all config files ReadIndex() honours still match the key stored in the header.
+ * Loading it still copies all entries and names into the list (the file is not kept open, TGitCache must not lock
+ * the .git folder), it only saves parsing the index by libgit2 and sorting the entries.
+ * Layout: header, m_EntryCount fixed size entries, string arena with m_ArenaLength NUL-terminated wchar_t file names
+ */
+#pragma pack(push, 1)
+struct SIndexSnapshotHeader
+{
+	DWORD		m_Magic;
+	DWORD		m_Version;
+	__int64		m_IndexModifyTime;
+	__int64		m_IndexFileSize;
+	BYTE		m_IndexChecksum[GIT_HASH_SIZE];
+	__int64		m_ConfigModifyTime;
+	__int64		m_ConfigFileSize;
+	__int64		m_GlobalConfigModifyTime;
+	__int64		m_GlobalConfigFileSize;
+	__int64		m_XDGConfigModifyTime;
+	__int64		m_XDGConfigFileSize;
+	__int64		m_SystemConfigModifyTime;
+	__int64		m_SystemConfigFileSize;
+	int32_t		m_IndexCaps;
+	DWORD		m_Flags;
+	DWORD		m_EntryCount;
+	DWORD		m_ArenaLength;
+};
+
+struct SIndexSnapshotEntry
+{
+	DWORD		m_NameOffset;
+	DWORD		m_NameLength;
+	int32_t		m_ModifyTime;
+	uint32_t	m_ModifyTimeNanos;
+	uint16_t	m_Flags;
+	uint16_t	m_FlagsExtended;
+	uint32_t	m_Size;
+	uint32_t	m_Mode;
+	BYTE		m_IndexHash[GIT_HASH_SIZE];
+};
+#pragma pack(pop)
+
 int CGitIndex::Print()
 {
 	wprintf(L"0x%08X  0x%08X %s %s\n",
@@ -42,10 +96,168 @@ int CGitIndex::Print()
 	return 0;
 }
 
+void CGitPathArena::Reserve(size_t length)
+{
+	if (length <= m_iFree)
+		return;
+
+	m_blocks.push_back(std::unique_ptr<wchar_t[]>(new wchar_t[length]));
+	m_pCurrent = m_blocks.back().get();
+	m_iFree = length;
+	m_iAllocated += length;
+}
+
+void CGitPathArena::Adopt(CGitPathArena& other)
+{
+	// keep allocating from the current block, the adopted blocks are only kept alive
+	m_blocks.reserve(m_blocks.size() + other.m_blocks.size());
+	for (auto& block : other.m_blocks)
+		m_blocks.push_back(std::move(block));
+	m_iAllocated += other.m_iAllocated;
+	other.m_blocks.clear();
+	other.m_pCurrent = nullptr;
+	other.m_iFree = other.m_iAllocated = other.m_iLastAllocation = 0;
+}
+
+wchar_t* CGitPathArena::Allocate(size_t length)
+{
+	size_t needed;
+	if (SizeTAdd(length, 1, &needed) != S_OK)
+		throw std::bad_alloc();
+	if (needed > m_iFree)
+		Reserve(max(needed, static_cast<size_t>(PATH_ARENA_BLOCK_SIZE)));
+
+	auto buffer = m_pCurrent;
+	m_pCurrent += needed;
+	m_iFree -= needed;
+	m_iLastAllocation = needed;
+	return buffer;
+}
+
+void CGitPathArena::Shrink(const wchar_t* buffer, size_t length)
+{
+	ATLASSERT(buffer + m_iLastAllocation == m_pCurrent && length < m_iLastAllocation);
+	UNREFERENCED_PARAMETER(buffer);
+	const size_t unused = m_iLastAllocation - length - 1;
+	m_pCurrent -= unused;
+	m_iFree += unused;
+	m_iLastAllocation = length + 1;
+}
+
+CGitEntryName CGitPathArena::Store(LPCWSTR str, int length)
+{
+	auto buffer = Allocate(length);
+	wmemcpy(buffer, str, length);
+	buffer[length] = L'\0';
+	return { buffer, length };
+}
+
+CGitEntryName CGitPathArena::StoreUTF8(const CString& prefix, const char* name, bool appendSlash)
+{
+	const int prefixLength = prefix.GetLength();
+	const int nameLength = SafeSizeToInt(strlen(name));
+	// a UTF-8 sequence never needs more UTF-16 code units than it has bytes
+	auto buffer = Allocate(static_cast<size_t>(prefixLength) + nameLength + 1);
+	wmemcpy(buffer, prefix, prefixLength);
+	int length = prefixLength;
+	if (nameLength)
+		length += MultiByteToWideChar(CP_UTF8, 0, name, nameLength, buffer + prefixLength, nameLength);
+	if (appendSlash)
+		buffer[length++] = L'/';
+	buffer[length] = L'\0';
+	Shrink(buffer, length);
+	return { buffer, length };
+}
+
+template<class T>
+size_t CGitDirectoryIndex::BuildDirectory(const T& list, size_t start, int prefixLength)
+{
+	const LPCWSTR prefix = list[start].m_FileName;
+	const size_t dirIndex = m_Directories.size();
+	m_Directories.push_back({ prefix, prefixLength, start, start, 0, 0 });
+
+	std::vector<Child> children;
+	size_t i = start;
+	while (i < list.size())
+	{
+		const auto& name = list[i].m_FileName;
+		if (name.GetLength() < prefixLength || Compare(name, prefixLength, prefix, prefixLength) != 0)
+			break;
+
+		size_t end = i + 1;
+		int length;
+		const int slash = name.Find(L'/', prefixLength);
+		if (slash < 0 || slash == name.GetLength() - 1)
+		{
+			// file or submodule, conflicted files have several entries with the same name
+			length = name.GetLength() - prefixLength;
+			while (end < list.size() && Compare(list[end].m_FileName, list[end].m_FileName.GetLength(), name, name.GetLength()) == 0)
+				++end;
+		}
+		else
+		{
+			length = slash + 1 - prefixLength;
+			end = BuildDirectory(list, i, slash + 1);
+		}
+		if (length > 0)
+			children.push_back({ name.GetString() + prefixLength, length, i, end });
+		i = end;
+	}
+
+	auto& dir = m_Directories[dirIndex];
+	dir.m_End = i;
+	dir.m_ChildStart = m_Children.size();
+	m_Children.insert(m_Children.end(), children.cbegin(), children.cend());
+	dir.m_ChildEnd = m_Children.size();
+	return i;
+}
+
+template<class T>
+void CGitDirectoryIndex::Build(const T& list, bool ignoreCase)
+{
+	m_bIgnoreCase = ignoreCase;
+	if (list.empty())
+		return;
+
+	m_Children.reserve(list.size());
+	BuildDirectory(list, 0, 0);
+	std::sort(m_Directories.begin(), m_Directories.end(), [this](const auto& d1, const auto& d2) { return Compare(d1.m_pPath, d1.m_iLength, d2.m_pPath, d2.m_iLength) < 0; });
+}
+
+const CGitDirectoryIndex::Directory* CGitDirectoryIndex::Find(LPCWSTR path, int length) const
+{
+	auto it = std::lower_bound(m_Directories.cbegin(), m_Directories.cend(), path, [this, length](const auto& dir, LPCWSTR str) { return Compare(dir.m_pPath, dir.m_iLength, str, length) < 0; });
+	if (it == m_Directories.cend() || Compare(it->m_pPath, it->m_iLength, path, length) != 0)
+		return nullptr;
+	return &*it;
+}
+
+template<class T>
+static const CGitDirectoryIndex* GetOrBuildDirectoryIndex(const T& list, bool ignoreCase, CComAutoCriticalSection& critSec, std::unique_ptr<CGitDirectoryIndex>& dirIndex)
+{
+	CAutoLocker lock(critSec);
+	if (dirIndex)
+		return dirIndex.get();
+
+	try
+	{
+		auto newDirIndex = std::make_unique<CGitDirectoryIndex>();
+		newDirIndex->Build(list, ignoreCase);
+		dirIndex = std::move(newDirIndex);
+	}
+	catch (const std::bad_alloc& ex)
+	{
+		CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Could not build directory index: %s\n", ex.what());
+		return nullptr;
+	}
+	return dirIndex.get();
+}
+
 CGitIndexList::CGitIndexList()
 {
 #ifndef TGIT_TESTS_ONLY
 	m_iMaxCheckSize = static_cast<__int64>(CRegDWORD(L"Software\\TortoiseGit\\TGitCacheCheckContentMaxSize", 10 * 1024)) * 1024; // stored in KiB
+	m_bUseIndexSnapshot = (CRegStdDWORD(L"Software\\TortoiseGit\\TGitCacheIndexSnapshot", FALSE) != FALSE);
 	m_bCalculateIncomingOutgoing = (CRegStdDWORD(L"Software\\TortoiseGit\\ModifyExplorerTitle", TRUE) != FALSE);
 #endif
 }
@@ -54,6 +266,11 @@ CGitIndexList::~CGitIndexList()
 {
 }
 
+const CGitDirectoryIndex* CGitIndexList::GetDirectoryIndex() const
+{
+	return GetOrBuildDirectoryIndex(*this, IsIgnoreCase(), m_critDirIndex, m_pDirIndex);
+}
+
 bool CGitIndexList::HasIndexChangedOnDisk(const CString& gitdir) const
 {
 	__int64 time = -1, size = -1;
@@ -99,6 +316,21 @@ int CGitIndexList::ReadIndex(const CString& dgitdir)
 
 	CGit::GetFileModifyTime(g_AdminDirMap.GetWorktreeAdminDir(dgitdir) + L"index", &m_LastModifyTime, nullptr, &m_LastFileSize);
 
+	SIndexSnapshotHeader snapshotKey;
+	CString snapshotFile;
+	if (m_bUseIndexSnapshot && GetIndexSnapshotKey(dgitdir, snapshotKey))
+	{
+		snapshotFile = g_AdminDirMap.GetWorktreeAdminDirConcat(dgitdir, INDEX_SNAPSHOT_FILE_NAME);
+		if (!ReadIndexSnapshot(snapshotFile, snapshotKey))
+		{
+			ReadIncomingOutgoing(repository);
+
+			CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Reloaded index from snapshot for repo: %s\n", static_cast<LPCWSTR>(dgitdir));
+
+			return 0;
+		}
+	}
+
 	CAutoIndex index;
 	// load index in order to enumerate files
 	if (git_repository_index(index.GetPointer(), repository))
@@ -109,7 +341,8 @@ int CGitIndexList::ReadIndex(const CString& dgitdir)
 	}
 
 	m_bHasConflicts = FALSE;
-	m_iIndexCaps = git_index_caps(index);
+	const int indexCaps = git_index_caps(index);
+	m_iIndexCaps = indexCaps;
 	if (CRegDWORD(L"Software\\TortoiseGit\\OverlaysCaseSensitive", TRUE) != FALSE)
 		m_iIndexCaps &= ~GIT_INDEX_CAPABILITY_IGNORE_CASE;
 
@@ -135,9 +368,18 @@ int CGitIndexList::ReadIndex(const CString& dgitdir)
 		const git_index_entry *e = git_index_get_byindex(index, i);
 
 		auto& item = (*this)[i];
-		item.m_FileName = CUnicodeUtils::GetUnicode(e->path);
-		if (e->mode & S_IFDIR)
-			item.m_FileName += L'/';
+		try
+		{
+			item.m_FileName = m_NameArena.StoreUTF8(CString(), e->path, (e->mode & S_IFDIR) != 0);
+		}
+		catch (const std::bad_alloc& ex)
+		{
+			config.Free();
+			CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Could not store file name: %s\n", ex.what());
+			clear();
+			m_NameArena.Clear();
+			return -1;
+		}
 		static_assert(std::is_same<decltype(item.m_ModifyTime), decltype(e->mtime.seconds)>::value);
 		item.m_ModifyTime = e->mtime.seconds;
 		static_assert(std::is_same<decltype(item.m_ModifyTimeNanos), decltype(e->mtime.nanoseconds)>::value);
@@ -153,6 +395,14 @@ int CGitIndexList::ReadIndex(const CString& dgitdir)
 
 	DoSortFilenametSortVector(*this, IsIgnoreCase());
 
+	if (!snapshotFile.IsEmpty())
+	{
+		// only store the snapshot if the index was not modified while reading it
+		__int64 time = -1, size = -1;
+		if (!CGit::GetFileModifyTime(g_AdminDirMap.GetWorktreeAdminDir(dgitdir) + L"index", &time, nullptr, &size) && time == snapshotKey.m_IndexModifyTime && size == snapshotKey.m_IndexFileSize)
+			WriteIndexSnapshot(snapshotFile, snapshotKey, indexCaps);
+	}
+
 	ReadIncomingOutgoing(repository);
 
 	CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Reloaded index for repo: %s\n", static_cast<LPCWSTR>(dgitdir));
@@ -160,6 +410,204 @@ int CGitIndexList::ReadIndex(const CString& dgitdir)
 	return 0;
 }
 
+bool CGitIndexList::GetIndexSnapshotKey(const CString& gitdir, SIndexSnapshotHeader& key) const
+{
+	memset(&key, 0, sizeof(SIndexSnapshotHeader));
+	key.m_Magic = INDEX_SNAPSHOT_MAGIC;
+	key.m_Version = INDEX_SNAPSHOT_VERSION;
+	key.m_IndexModifyTime = m_LastModifyTime;
+	key.m_IndexFileSize = m_LastFileSize;
+	if (m_LastFileSize < static_cast<__int64>(GIT_HASH_SIZE))
+		return false;
+
+	// the index file ends with a checksum over its whole content
+	CAutoFile file = ::CreateFile(g_AdminDirMap.GetWorktreeAdminDirConcat(gitdir, L"index"), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (!file)
+		return false;
+	LARGE_INTEGER offset;
+	offset.QuadPart = -static_cast<LONGLONG>(GIT_HASH_SIZE);
+	if (!SetFilePointerEx(file, offset, nullptr, FILE_END))
+		return false;
+	if (DWORD read = 0; !ReadFile(file, key.m_IndexChecksum, GIT_HASH_SIZE, &read, nullptr) || read != GIT_HASH_SIZE)
+		return false;
+
+	// the index capabilities depend on the configuration
+	__int64 time = 0, size = 0;
+	if (!CGit::GetFileModifyTime(g_AdminDirMap.GetAdminDirConcat(gitdir, L"config"), &time, nullptr, &size))
+	{
+		key.m_ConfigModifyTime = time;
+		key.m_ConfigFileSize = size;
+	}
+	if (!CGit::GetFileModifyTime(g_Git.GetGitGlobalConfig(), &time, nullptr, &size))
+	{
+		key.m_GlobalConfigModifyTime = time;
+		key.m_GlobalConfigFileSize = size;
+	}
+	if (!CGit::GetFileModifyTime(g_Git.GetGitGlobalXDGConfig(), &time, nullptr, &size))
+	{
+		key.m_XDGConfigModifyTime = time;
+		key.m_XDGConfigFileSize = size;
+	}
+	// same source as in ReadIndex, also works in TGitCache
+	if (CString systemConfig(CRegString(REG_SYSTEM_GITCONFIGPATH, L"", FALSE)); !systemConfig.IsEmpty() && !CGit::GetFileModifyTime(systemConfig, &time, nullptr, &size))
+	{
+		key.m_SystemConfigModifyTime = time;
+		key.m_SystemConfigFileSize = size;
+	}
+
+	return true;
+}
+
+int CGitIndexList::ReadIndexSnapshot(const CString& snapshotFile, const SIndexSnapshotHeader& key)
+{
+	CAutoFile file = ::CreateFile(snapshotFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (!file)
+		return -1;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SIndexSnapshotHeader)) || static_cast<ULONGLONG>(fileSize.QuadPart) >= SIZE_T_MAX)
+		return -1;
+
+	CAutoGeneralHandle mapping = ::CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+		return -1;
+
+	CAutoViewOfFile view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+		return -1;
+
+	auto header = static_cast<const SIndexSnapshotHeader*>(static_cast<PVOID>(view));
+	// everything up to the flags must match
+	if (memcmp(header, &key, offsetof(SIndexSnapshotHeader, m_IndexCaps)) != 0)
+		return -1;
+
+	int indexCaps = header->m_IndexCaps;
+	if (CRegDWORD(L"Software\\TortoiseGit\\OverlaysCaseSensitive", TRUE) != FALSE)
+		indexCaps &= ~GIT_INDEX_CAPABILITY_IGNORE_CASE;
+	// the entries are stored in sort order, which depends on the case sensitivity
+	if (!!(indexCaps & GIT_INDEX_CAPABILITY_IGNORE_CASE) != !!(header->m_Flags & INDEX_SNAPSHOT_IGNORECASE))
+		return -1;
+
+	size_t len;
+	if (SizeTMult(header->m_EntryCount, sizeof(SIndexSnapshotEntry), &len) != S_OK || SizeTAdd(len, sizeof(SIndexSnapshotHeader), &len) != S_OK)
+		return -1;
+	const size_t arenaStart = len;
+	if (SizeTMult(header->m_ArenaLength, sizeof(wchar_t), &len) != S_OK || SizeTAdd(len, arenaStart, &len) != S_OK || len != static_cast<size_t>(fileSize.QuadPart))
+		return -1;
+
+	auto entries = reinterpret_cast<const SIndexSnapshotEntry*>(header + 1);
+	auto arena = reinterpret_cast<const wchar_t*>(static_cast<const BYTE*>(static_cast<PVOID>(view)) + arenaStart);
+	wchar_t* names = nullptr;
+	try
+	{
+		resize(header->m_EntryCount);
+		// the arena of the snapshot is copied as a whole, entries just point into the copy
+		names = m_NameArena.Allocate(header->m_ArenaLength);
+	}
+	catch (const std::bad_alloc& ex)
+	{
+		CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Could not resize index-vector: %s\n", ex.what());
+		clear();
+		m_NameArena.Clear();
+		return -1;
+	}
+	wmemcpy(names, arena, header->m_ArenaLength);
+	for (DWORD i = 0; i < header->m_EntryCount; ++i)
+	{
+		const auto& e = entries[i];
+		if (e.m_NameOffset >= header->m_ArenaLength || e.m_NameLength >= header->m_ArenaLength - e.m_NameOffset || names[e.m_NameOffset + e.m_NameLength] != L'\0')
+		{
+			clear();
+			m_NameArena.Clear();
+			return -1;
+		}
+
+		auto& item = (*this)[i];
+		item.m_FileName = CGitEntryName(names + e.m_NameOffset, e.m_NameLength);
+		item.m_ModifyTime = e.m_ModifyTime;
+		item.m_ModifyTimeNanos = e.m_ModifyTimeNanos;
+		item.m_Flags = e.m_Flags;
+		item.m_FlagsExtended = e.m_FlagsExtended;
+		item.m_IndexHash = CGitHash::FromRaw(e.m_IndexHash);
+		item.m_Size = e.m_Size;
+		item.m_Mode = e.m_Mode;
+	}
+
+	m_iIndexCaps = indexCaps;
+	m_bHasConflicts = (header->m_Flags & INDEX_SNAPSHOT_CONFLICTS) ? TRUE : FALSE;
+
+	return 0;
+}
+
+int CGitIndexList::WriteIndexSnapshot(const CString& snapshotFile, const SIndexSnapshotHeader& key, int indexCaps) const
+{
+	SIndexSnapshotHeader header = key;
+	header.m_IndexCaps = indexCaps;
+	header.m_Flags = (IsIgnoreCase() ? INDEX_SNAPSHOT_IGNORECASE : 0) | (m_bHasConflicts ? INDEX_SNAPSHOT_CONFLICTS : 0);
+	header.m_EntryCount = static_cast<DWORD>(size());
+
+	std::vector<SIndexSnapshotEntry> entries;
+	std::vector<wchar_t> arena;
+	try
+	{
+		entries.resize(size());
+		size_t arenaLength = 0;
+		for (const auto& item : *this)
+			arenaLength += item.m_FileName.GetLength() + 1;
+		if (arenaLength >= MAXDWORD)
+			return -1;
+		arena.reserve(arenaLength);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return -1;
+	}
+
+	for (size_t i = 0; i < size(); ++i)
+	{
+		const auto& item = (*this)[i];
+		auto& e = entries[i];
+		e.m_NameOffset = static_cast<DWORD>(arena.size());
+		e.m_NameLength = item.m_FileName.GetLength();
+		arena.insert(arena.end(), item.m_FileName.GetString(), item.m_FileName.GetString() + item.m_FileName.GetLength());
+		arena.push_back(L'\0');
+		e.m_ModifyTime = item.m_ModifyTime;
+		e.m_ModifyTimeNanos = item.m_ModifyTimeNanos;
+		e.m_Flags = item.m_Flags;
+		e.m_FlagsExtended = item.m_FlagsExtended;
+		memcpy(e.m_IndexHash, item.m_IndexHash.ToRaw(), GIT_HASH_SIZE);
+		e.m_Size = item.m_Size;
+		e.m_Mode = item.m_Mode;
+	}
+	header.m_ArenaLength = static_cast<DWORD>(arena.size());
+
+	// write to a temporary file first, so that readers never see a partially written snapshot
+	const CString tempFile = snapshotFile + L".tmp";
+	{
+		CAutoFile file = ::CreateFile(tempFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (!file)
+			return -1;
+
+		DWORD written = 0;
+		if (!WriteFile(file, &header, sizeof(header), &written, nullptr)
+			|| (!entries.empty() && !WriteFile(file, entries.data(), static_cast<DWORD>(entries.size() * sizeof(SIndexSnapshotEntry)), &written, nullptr))
+			|| (!arena.empty() && !WriteFile(file, arena.data(), static_cast<DWORD>(arena.size() * sizeof(wchar_t)), &written, nullptr)))
+		{
+			file.CloseHandle();
+			::DeleteFile(tempFile);
+			return -1;
+		}
+	}
+
+	if (!MoveFileEx(tempFile, snapshotFile, MOVEFILE_REPLACE_EXISTING))
+	{
+		::DeleteFile(tempFile);
+		return -1;
+	}
+
+	return 0;
+}
+
 int CGitIndexList::ReadIncomingOutgoing(git_repository* repository)
 {
 	ATLASSERT(m_stashCount == 0 && m_outgoing == static_cast<size_t>(-1) && m_incoming == static_cast<size_t>(-1) && m_branch.IsEmpty());
@@ -276,11 +724,11 @@ int CGitIndexList::GetFileStatus(CAutoRepository& repository, const CString& git
 		}
 
 		git_oid actual;
-		CStringA fileA = CUnicodeUtils::GetUTF8(entry.m_FileName);
+		CStringA fileA = CUnicodeUtils::GetUTF8(CString(entry.m_FileName));
 		if (isSymlink && S_ISLNK(entry.m_Mode))
 		{
 			CStringA linkDestination;
-			if (!CPathUtils::ReadLink(CombinePath(gitdir, entry.m_FileName), &linkDestination) && !git_odb_hash(&actual, static_cast<LPCSTR>(linkDestination), linkDestination.GetLength(), GIT_OBJECT_BLOB) && !git_oid_cmp(&actual, entry.m_IndexHash))
+			if (!CPathUtils::ReadLink(CombinePath(gitdir, CString(entry.m_FileName)), &linkDestination) && !git_odb_hash(&actual, static_cast<LPCSTR>(linkDestination), linkDestination.GetLength(), GIT_OBJECT_BLOB) && !git_oid_cmp(&actual, entry.m_IndexHash))
 			{
 				entry.m_ModifyTime = static_cast<int32_t>(CGit::filetime_to_time_t(time));
 				entry.m_ModifyTimeNanos = (time % 10000000) * 100;
@@ -622,7 +1070,47 @@ bool CGitHeadFileList::CheckHeadUpdate() const
 	return false;
 }
 
-int CGitHeadFileList::ReadTreeRecursive(git_repository& repo, const git_tree* tree, const CString& base)
+// entries of one part of the HEAD tree, each chunk is read by a single thread
+struct SReadTreeChunk
+{
+	CString m_Base;
+	CGitHash m_TreeId;
+	std::vector<CGitTreeItem> m_Items;
+	CGitPathArena m_NameArena;
+	std::vector<std::pair<CString, CGitHash>> m_Subtrees; // unsorted
+	bool m_bFailed = false;
+};
+
+bool CGitHeadFileList::CopySubtree(const CString& path, const CGitHash& treeId, SReadTreeChunk& chunk) const
+{
+	auto subtree = std::lower_bound(m_Subtrees.cbegin(), m_Subtrees.cend(), path, [](const auto& entry, const CString& value) { return entry.first < value; });
+	if (subtree == m_Subtrees.cend() || subtree->first != path || subtree->second != treeId)
+		return false;
+
+	auto dirIndex = GetDirectoryIndex();
+	if (!dirIndex)
+		return false;
+	auto dir = dirIndex->Find(path, path.GetLength());
+	if (!dir)
+		return false;
+
+	for (size_t i = dir->m_Start; i < dir->m_End; ++i)
+	{
+		const auto& entry = (*this)[i];
+		// in case of ignore case the range might also contain other folders only differing in case
+		if (wcsncmp(entry.m_FileName, path, path.GetLength()) != 0)
+			continue;
+		CGitTreeItem item = entry;
+		item.m_FileName = chunk.m_NameArena.Store(entry.m_FileName, entry.m_FileName.GetLength());
+		chunk.m_Items.push_back(item);
+	}
+	for (; subtree != m_Subtrees.cend() && CStringUtils::StartsWith(subtree->first, path); ++subtree)
+		chunk.m_Subtrees.push_back(*subtree);
+
+	return true;
+}
+
+int CGitHeadFileList::ReadTreeRecursive(git_repository& repo, const git_tree* tree, const CString& base, SReadTreeChunk& chunk, const CGitHeadFileList* previous, std::vector<std::pair<CString, CGitHash>>* deferred)
 {
 #define S_IFGITLINK	0160000
 	size_t count = git_tree_entrycount(tree);
@@ -638,11 +1126,21 @@ int CGitHeadFileList::ReadTreeRecursive(git_repository& repo, const git_tree* tr
 		{
 			CGitTreeItem item;
 			item.m_Hash = git_tree_entry_id(entry);
-			item.m_FileName = base;
-			CGit::StringAppend(item.m_FileName, git_tree_entry_name(entry), CP_UTF8);
-			if (isSubmodule)
-				item.m_FileName += L'/';
-			push_back(item);
+			item.m_FileName = chunk.m_NameArena.StoreUTF8(base, git_tree_entry_name(entry), isSubmodule);
+			chunk.m_Items.push_back(item);
+			continue;
+		}
+
+		CString parent = base;
+		CGit::StringAppend(parent, git_tree_entry_name(entry));
+		parent += L'/';
+		const CGitHash treeId = git_tree_entry_id(entry);
+		if (previous && previous->CopySubtree(parent, treeId, chunk))
+			continue;
+		chunk.m_Subtrees.emplace_back(parent, treeId);
+		if (deferred)
+		{
+			deferred->emplace_back(parent, treeId);
 			continue;
 		}
 
@@ -650,17 +1148,38 @@ int CGitHeadFileList::ReadTreeRecursive(git_repository& repo, const git_tree* tr
 		git_tree_entry_to_object(object.GetPointer(), &repo, entry);
 		if (!object)
 			continue;
-		CString parent = base;
-		CGit::StringAppend(parent, git_tree_entry_name(entry));
-		parent += L'/';
-		ReadTreeRecursive(repo, reinterpret_cast<git_tree*>(static_cast<git_object*>(object)), parent);
+		ReadTreeRecursive(repo, reinterpret_cast<git_tree*>(static_cast<git_object*>(object)), parent, chunk, previous);
 	}
 
 	return 0;
 }
 
+template<class T, class V>
+static void MergeSortedRuns(T& vector, std::vector<size_t>& bounds, V less)
+{
+	while (bounds.size() > 2)
+	{
+		std::vector<size_t> merged;
+		size_t i = 0;
+		for (; i + 2 < bounds.size(); i += 2)
+		{
+			std::inplace_merge(vector.begin() + bounds[i], vector.begin() + bounds[i + 1], vector.begin() + bounds[i + 2], less);
+			merged.push_back(bounds[i]);
+		}
+		if (i + 1 < bounds.size())
+			merged.push_back(bounds[i]);
+		merged.push_back(bounds.back());
+		bounds.swap(merged);
+	}
+}
+
+const CGitDirectoryIndex* CGitHeadFileList::GetDirectoryIndex() const
+{
+	return GetOrBuildDirectoryIndex(*this, m_bIgnoreCase, m_critDirIndex, m_pDirIndex);
+}
+
 // ReadTree is/must only be executed on an empty list
-int CGitHeadFileList::ReadTree(bool ignoreCase)
+int CGitHeadFileList::ReadTree(bool ignoreCase, const CGitHeadFileList* previous)
 {
 	ATLASSERT(empty());
 
@@ -668,6 +1187,10 @@ int CGitHeadFileList::ReadTree(bool ignoreCase)
 	if (m_Head.IsEmpty())
 		return 0;
 
+	// reused entries are copied in the sort order of the previous list
+	if (previous && (previous->m_bIgnoreCase != ignoreCase || previous->m_Gitdir != m_Gitdir))
+		previous = nullptr;
+
 	CAutoRepository repository(m_Gitdir);
 	CAutoCommit commit;
 	CAutoTree tree;
@@ -676,28 +1199,120 @@ int CGitHeadFileList::ReadTree(bool ignoreCase)
 	ret = ret && !git_commit_tree(tree.GetPointer(), commit);
 	try
 	{
-		ret = ret && !ReadTreeRecursive(*repository, tree, L"");
+		// the first chunk collects the files of the top level folders, all other chunks are folders read by the workers
+		std::vector<std::unique_ptr<SReadTreeChunk>> chunks;
+		chunks.push_back(std::make_unique<SReadTreeChunk>());
+		std::vector<std::pair<CString, CGitHash>> subtrees;
+		const size_t workers = CThreadPoolWork::GetDefaultWorkerCount();
+		ret = ret && !ReadTreeRecursive(*repository, tree, L"", *chunks[0], previous, workers > 1 ? &subtrees : nullptr);
+		// split the top levels further until there are enough independent folders for all workers
+		for (int depth = 1; ret && depth < READTREE_MAX_SPLIT_DEPTH && !subtrees.empty() && subtrees.size() < workers * 4; ++depth)
+		{
+			std::vector<std::pair<CString, CGitHash>> next;
+			for (const auto& [base, treeId] : subtrees)
+			{
+				CAutoTree subtree;
+				if (git_tree_lookup(subtree.GetPointer(), repository, treeId))
+					continue;
+				ReadTreeRecursive(*repository, subtree, base, *chunks[0], previous, &next);
+			}
+			subtrees.swap(next);
+		}
+		for (auto& [base, treeId] : subtrees)
+		{
+			auto chunk = std::make_unique<SReadTreeChunk>();
+			chunk->m_Base = base;
+			chunk->m_TreeId = treeId;
+			chunks.push_back(std::move(chunk));
+		}
+
+		if (ret)
+		{
+			// git_repository instances must not be shared between threads, but each worker reuses the one of its former chunk
+			CGitRepositoryPool repositories;
+			const CStringA gitdirA = CUnicodeUtils::GetUTF8(m_Gitdir);
+			ParallelFor(chunks.size(), [&chunks, &repositories, &gitdirA, previous, ignoreCase](size_t i) {
+				auto& chunk = *chunks[i];
+				try
+				{
+					if (i > 0)
+					{
+						auto repo = repositories.Get(gitdirA);
+						CAutoTree subtree;
+						if (!repo || git_tree_lookup(subtree.GetPointer(), repo, chunk.m_TreeId) || ReadTreeRecursive(*repo, subtree, chunk.m_Base, chunk, previous))
+						{
+							chunk.m_bFailed = true;
+							return;
+						}
+					}
+					DoSortFilenametSortVector(chunk.m_Items, ignoreCase);
+				}
+				catch (const std::bad_alloc& ex)
+				{
+					CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Catched exception inside ReadTreeRecursive: %s\n", ex.what());
+					chunk.m_bFailed = true;
+				}
+			}, workers);
+
+			size_t total = 0;
+			size_t totalSubtrees = 0;
+			for (const auto& chunk : chunks)
+			{
+				ret = ret && !chunk->m_bFailed;
+				total += chunk->m_Items.size();
+				totalSubtrees += chunk->m_Subtrees.size();
+			}
+			if (ret)
+			{
+				// merge the sorted chunks
+				reserve(total);
+				m_Subtrees.reserve(totalSubtrees);
+				std::vector<size_t> bounds = { 0 };
+				for (auto& chunk : chunks)
+				{
+					m_NameArena.Adopt(chunk->m_NameArena);
+					std::move(chunk->m_Subtrees.begin(), chunk->m_Subtrees.end(), std::back_inserter(m_Subtrees));
+					if (chunk->m_Items.empty())
+						continue;
+					insert(end(), chunk->m_Items.cbegin(), chunk->m_Items.cend());
+					bounds.push_back(size());
+				}
+				if (ignoreCase)
+					MergeSortedRuns(*this, bounds, [](const auto& e1, const auto& e2) { return e1.m_FileName.CompareNoCase(e2.m_FileName) < 0; });
+				else
+					MergeSortedRuns(*this, bounds, [](const auto& e1, const auto& e2) { return e1.m_FileName.Compare(e2.m_FileName) < 0; });
+				std::sort(m_Subtrees.begin(), m_Subtrees.end(), [](const auto& s1, const auto& s2) { return s1.first < s2.first; });
+			}
+		}
 	}
 	catch (const std::bad_alloc& ex)
 	{
 		CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Catched exception inside ReadTreeRecursive: %s\n", ex.what());
+		clear();
+		m_NameArena.Clear();
+		m_Subtrees.clear();
 		return -1;
 	}
 	catch (const std::length_error& ex)
 	{
 		CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Catched exception inside ReadTreeRecursive, length_error: %s\n", ex.what());
+		clear();
+		m_NameArena.Clear();
+		m_Subtrees.clear();
 		return -1;
 	}
 	if (!ret)
 	{
 		clear();
+		m_NameArena.Clear();
+		m_Subtrees.clear();
 		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Could not open git repository in %s and read HEAD commit %s: %s\n", static_cast<LPCWSTR>(m_Gitdir), static_cast<LPCWSTR>(m_Head.ToString()), static_cast<LPCWSTR>(CGit::GetLibGit2LastErr()));
 		m_LastModifyTimeHead = 0;
 		m_LastFileSizeHead = -1;
 		return -1;
 	}
 
-	DoSortFilenametSortVector(*this, ignoreCase);
+	m_bIgnoreCase = ignoreCase;
 
 	CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Reloaded HEAD tree (commit is %s) for repo: %s\n", static_cast<LPCWSTR>(m_Head.ToString()), static_cast<LPCWSTR>(m_Gitdir));
 
@@ -1099,11 +1714,13 @@ int CGitIgnoreList::CheckIgnore(const CString &path, const CString &projectroot,
 
 SHARED_TREE_PTR CGitHeadFileMap::CheckHeadAndUpdate(const CString& gitdir, bool ignoreCase)
 {
-	if (auto ptr = this->SafeGet(gitdir); ptr.get() && !ptr->CheckHeadUpdate())
-		return ptr;
+	auto oldPtr = this->SafeGet(gitdir);
+	if (oldPtr && !oldPtr->CheckHeadUpdate())
+		return oldPtr;
 
+	// unchanged folders are taken over from the outdated list
 	auto newPtr = std::make_shared<CGitHeadFileList>();
-	if (newPtr->ReadHeadHash(gitdir) || newPtr->ReadTree(ignoreCase))
+	if (newPtr->ReadHeadHash(gitdir) || newPtr->ReadTree(ignoreCase, oldPtr.get()))
 	{
 		SafeClear(gitdir);
 		return {};
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2013-2020, 2023 - TortoiseGit
+// Copyright (C) 2013-2020, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -25,13 +25,15 @@ CGitMailmap::CGitMailmap()
 {
 	if (ShouldLoadMailmap())
 	{
+		// reading the mailmap might access the object database (mailmap.blob), so keep the session
+		CGitDllSession session;
 		try
 		{
-			CAutoLocker lock(g_Git.m_critGitDllSec);
-			g_Git.CheckAndInitDll();
+			session.Init();
 		}
 		catch (const char* msg)
 		{
+			session.Release();
 			MessageBox(nullptr, L"Could not initialize libgit. Disabling Mailmap support.\nlibgit reports:\n" + CUnicodeUtils::GetUnicode(msg), L"TortoiseGit", MB_ICONERROR);
 			return;
 		}
@@ -0,0 +1,239 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "GitRepositoryPool.h"
+#include "Git.h"
+#include "UnicodeUtils.h"
+#include "git2/sys/repository.h"
+
+// the files of the repository are checked for changes at most once per interval (ms)
+#define REPOSITORY_POOL_CHECK_INTERVAL	1000
+// lower bound for the number of idle repositories kept
+#define REPOSITORY_POOL_MIN_IDLE		4
+// all repositories are freed if none has been borrowed for that long (ms)
+#define REPOSITORY_POOL_IDLE_TIMEOUT	5000
+
+CGitRepositoryPool::CRepository::CRepository(CRepository&& that) noexcept
+	: m_Pool(std::exchange(that.m_Pool, nullptr))
+	, m_Repo(std::exchange(that.m_Repo, nullptr))
+	, m_Generation(that.m_Generation)
+{
+}
+
+CGitRepositoryPool::CRepository& CGitRepositoryPool::CRepository::operator=(CRepository&& that) noexcept
+{
+	if (this != &that)
+	{
+		Release();
+		m_Pool = std::exchange(that.m_Pool, nullptr);
+		m_Repo = std::exchange(that.m_Repo, nullptr);
+		m_Generation = that.m_Generation;
+	}
+	return *this;
+}
+
+void CGitRepositoryPool::CRepository::Release()
+{
+	if (!m_Repo)
+		return;
+	if (m_Pool)
+		m_Pool->Return(*this);
+	else
+		git_repository_free(m_Repo);
+	m_Pool = nullptr;
+	m_Repo = nullptr;
+}
+
+CGitRepositoryPool::~CGitRepositoryPool()
+{
+	if (m_IdleTimer)
+	{
+		SetThreadpoolTimer(m_IdleTimer, nullptr, 0, 0);
+		WaitForThreadpoolTimerCallbacks(m_IdleTimer, TRUE);
+		CloseThreadpoolTimer(m_IdleTimer);
+	}
+	for (auto repo : Clear())
+		git_repository_free(repo);
+}
+
+CGitRepositoryPool::CRepository CGitRepositoryPool::Get(const CStringA& path)
+{
+	CRepository repo;
+	std::vector<git_repository*> stale;
+	{
+		CAutoLocker lock(m_critSec);
+		if (m_Path != path || HasChanged())
+		{
+			stale = Clear();
+			m_Path = path;
+		}
+		repo.m_Generation = m_Generation;
+		++m_Borrowed;
+		if (!m_Idle.empty())
+		{
+			repo.m_Repo = m_Idle.back();
+			m_Idle.pop_back();
+		}
+	}
+	// freeing and opening repositories takes a while, don't block other threads meanwhile
+	for (auto staleRepo : stale)
+		git_repository_free(staleRepo);
+	if (repo.m_Repo)
+	{
+		repo.m_Pool = this;
+		return repo;
+	}
+
+	if (git_repository_open(&repo.m_Repo, path) < 0)
+	{
+		repo.m_Repo = nullptr;
+		CAutoLocker lock(m_critSec);
+		EndBorrow();
+		return repo;
+	}
+	repo.m_Pool = this;
+
+	CAutoLocker lock(m_critSec);
+	if (repo.m_Generation != m_Generation)
+		return repo; // invalidated meanwhile, the repository gets freed when it is returned
+	if (m_Odb)
+		git_repository_set_odb(repo.m_Repo, m_Odb);
+	else
+	{
+		if (git_repository_odb(&m_Odb, repo.m_Repo) < 0)
+			m_Odb = nullptr;
+		InitStamps(repo.m_Repo);
+	}
+	return repo;
+}
+
+void CGitRepositoryPool::Invalidate()
+{
+	std::vector<git_repository*> stale;
+	{
+		CAutoLocker lock(m_critSec);
+		stale = Clear();
+	}
+	for (auto repo : stale)
+		git_repository_free(repo);
+}
+
+void CGitRepositoryPool::Return(CRepository& repo)
+{
+	static const size_t maxIdle = max(static_cast<size_t>(REPOSITORY_POOL_MIN_IDLE), static_cast<size_t>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS)));
+	{
+		CAutoLocker lock(m_critSec);
+		const bool keep = repo.m_Generation == m_Generation && m_Idle.size() < maxIdle;
+		if (keep)
+			m_Idle.push_back(repo.m_Repo);
+		EndBorrow();
+		if (keep)
+			return;
+	}
+	git_repository_free(repo.m_Repo);
+}
+
+// expects m_critSec to be locked
+void CGitRepositoryPool::EndBorrow()
+{
+	ATLASSERT(m_Borrowed > 0);
+	if (--m_Borrowed || (m_Idle.empty() && !m_Odb))
+		return;
+
+	if (!m_IdleTimer)
+		m_IdleTimer = CreateThreadpoolTimer(IdleTimerCallback, this, nullptr);
+	if (!m_IdleTimer)
+		return;
+	// relative due time in 100 ns units, setting it again restarts the timer
+	ULARGE_INTEGER due;
+	due.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(REPOSITORY_POOL_IDLE_TIMEOUT) * 10000);
+	FILETIME dueTime = { due.LowPart, due.HighPart };
+	SetThreadpoolTimer(m_IdleTimer, &dueTime, 0, REPOSITORY_POOL_IDLE_TIMEOUT / 10);
+}
+
+void CALLBACK CGitRepositoryPool::IdleTimerCallback(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context, PTP_TIMER /*timer*/)
+{
+	auto pool = static_cast<CGitRepositoryPool*>(context);
+	std::vector<git_repository*> stale;
+	{
+		CAutoLocker lock(pool->m_critSec);
+		// borrowed again meanwhile, the timer is restarted once all are returned
+		if (pool->m_Borrowed)
+			return;
+		stale = pool->Clear();
+	}
+	for (auto repo : stale)
+		git_repository_free(repo);
+}
+
+// expects m_critSec to be locked
+std::vector<git_repository*> CGitRepositoryPool::Clear()
+{
+	++m_Generation;
+	git_odb_free(m_Odb);
+	m_Odb = nullptr;
+	m_Stamps.clear();
+	std::vector<git_repository*> idle;
+	idle.swap(m_Idle);
+	return idle;
+}
+
+// expects m_critSec to be locked
+void CGitRepositoryPool::InitStamps(git_repository* repo)
+{
+	const CString gitDir = CUnicodeUtils::GetUnicode(git_repository_path(repo));
+	const CString commonDir = CUnicodeUtils::GetUnicode(git_repository_commondir(repo));
+	m_Stamps.clear();
+	// refs are looked up on disk by libgit2 anyway, but the current branch, packed-refs and the config are cached
+	for (const auto& path : { gitDir + L"HEAD", commonDir + L"packed-refs", commonDir + L"config", commonDir + L"objects/pack" })
+	{
+		SStamp stamp{ path };
+		ReadStamp(stamp);
+		m_Stamps.push_back(stamp);
+	}
+	m_LastCheck = GetTickCount64();
+}
+
+// expects m_critSec to be locked
+bool CGitRepositoryPool::HasChanged()
+{
+	if (m_Stamps.empty() || GetTickCount64() - m_LastCheck < REPOSITORY_POOL_CHECK_INTERVAL)
+		return false;
+	m_LastCheck = GetTickCount64();
+	for (const auto& stamp : m_Stamps)
+	{
+		SStamp current{ stamp.m_Path };
+		ReadStamp(current);
+		if (current.m_WriteTime != stamp.m_WriteTime || current.m_Size != stamp.m_Size)
+			return true;
+	}
+	return false;
+}
+
+void CGitRepositoryPool::ReadStamp(SStamp& stamp)
+{
+	stamp.m_WriteTime = 0;
+	stamp.m_Size = 0;
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesEx(stamp.m_Path, GetFileExInfoStandard, &attributes))
+		return;
+	stamp.m_WriteTime = static_cast<ULONGLONG>(attributes.ftLastWriteTime.dwHighDateTime) << 32 | attributes.ftLastWriteTime.dwLowDateTime;
+	stamp.m_Size = static_cast<ULONGLONG>(attributes.nFileSizeHigh) << 32 | attributes.nFileSizeLow;
+}
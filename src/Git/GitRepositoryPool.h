@@ -0,0 +1,104 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#pragma once
+
+struct git_repository;
+struct git_odb;
+
+/**
+ * \ingroup Git
+ * Keeps opened libgit2 repositories of one repository for reuse.
+ * Opening a repository reads its config and the first object lookup loads the pack indexes, so
+ * reusing an opened one is much cheaper when many commits are looked at (e.g. in the log list).
+ * A borrowed repository belongs to one thread until it is returned. All repositories share one
+ * object database, so the object cache and the opened packs are shared as well.
+ * The pool is invalidated when HEAD, packed-refs, the config or the packs of the repository change:
+ * idle repositories are freed and borrowed ones are freed instead of being returned.
+ * Once no repository has been borrowed for a few seconds, the pool is invalidated as well, so that
+ * the opened packs don't keep e.g. git gc from deleting them.
+ */
+class CGitRepositoryPool
+{
+public:
+	/**
+	 * A repository borrowed from the pool, it is returned on destruction.
+	 * Must not be used by more than one thread at a time.
+	 */
+	class CRepository
+	{
+	public:
+		CRepository() = default;
+		CRepository(CRepository&& that) noexcept;
+		CRepository& operator=(CRepository&& that) noexcept;
+		CRepository(const CRepository&) = delete;
+		CRepository& operator=(const CRepository&) = delete;
+		~CRepository() { Release(); }
+
+		operator git_repository*() const { return m_Repo; }
+
+		/// returns the repository to the pool
+		void Release();
+
+	private:
+		friend class CGitRepositoryPool;
+		CGitRepositoryPool* m_Pool = nullptr;
+		git_repository* m_Repo = nullptr;
+		ULONGLONG m_Generation = 0;
+	};
+
+	CGitRepositoryPool() = default;
+	CGitRepositoryPool(const CGitRepositoryPool&) = delete;
+	CGitRepositoryPool& operator=(const CGitRepositoryPool&) = delete;
+	~CGitRepositoryPool();
+
+	/**
+	 * Borrows an opened repository of \a path (UTF-8, as for git_repository_open), a new one is opened
+	 * if none is idle. Returns an empty object on failure, the libgit2 error is set then.
+	 */
+	CRepository Get(const CStringA& path);
+	/// Frees all idle repositories, repositories currently borrowed are freed when they are returned.
+	void Invalidate();
+
+private:
+	struct SStamp
+	{
+		CString		m_Path;
+		ULONGLONG	m_WriteTime;
+		ULONGLONG	m_Size;
+	};
+
+	void Return(CRepository& repo);
+	void EndBorrow();
+	static void CALLBACK IdleTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+	void InitStamps(git_repository* repo);
+	bool HasChanged();
+	static void ReadStamp(SStamp& stamp);
+	std::vector<git_repository*> Clear();
+
+	CComAutoCriticalSection m_critSec;
+	CStringA m_Path;
+	ULONGLONG m_Generation = 0;
+	std::vector<git_repository*> m_Idle;
+	git_odb* m_Odb = nullptr;
+	std::vector<SStamp> m_Stamps;
+	ULONGLONG m_LastCheck = 0;
+	size_t m_Borrowed = 0;
+	PTP_TIMER m_IdleTimer = nullptr;
+};
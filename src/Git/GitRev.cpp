@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2016, 2018-2021, 2023 - TortoiseGit
+// Copyright (C) 2008-2016, 2018-2021, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -176,12 +176,12 @@ void GitRev::DbgPrint()
 
 int GitRev::GetParentFromHash(const CGitHash& hash)
 {
-	CAutoLocker lock(g_Git.m_critGitDllSec);
+	CGitDllSession session;
 
 	GIT_COMMIT commit;
 	try
 	{
-		g_Git.CheckAndInitDll();
+		session.Init();
 
 		if (git_get_commit_from_hash(&commit, hash.ToRaw()))
 		{
@@ -205,9 +205,9 @@ int GitRev::GetParentFromHash(const CGitHash& hash)
 
 int GitRev::GetCommitFromHash(const CGitHash& hash)
 {
-	CAutoLocker lock(g_Git.m_critGitDllSec);
+	CGitDllSession session;
 
-	g_Git.CheckAndInitDll();
+	session.Init();
 
 	return GetCommitFromHash_withoutLock(hash);
 }
@@ -250,11 +250,11 @@ int GitRev::GetCommit(const CString& refname)
 		return GetCommit(repo, refname);
 	}
 
-	CAutoLocker lock(g_Git.m_critGitDllSec);
+	CGitDllSession session;
 
 	try
 	{
-		g_Git.CheckAndInitDll();
+		session.Init();
 	}
 	catch (const char* msg)
 	{
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2025 - TortoiseGit
+// Copyright (C) 2008-2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -56,7 +56,7 @@ int GitRevLoglist::SafeGetSimpleList(CGit* git)
 	m_SimpleFileList.clear();
 	if (git->UsingLibGit2(CGit::GIT_CMD_LOGLISTDIFF))
 	{
-		CAutoRepository repo(git->GetGitRepository());
+		auto repo = git->GetPooledGitRepository();
 		if (!repo)
 			return -1;
 		CAutoCommit commit;
@@ -104,11 +104,12 @@ int GitRevLoglist::SafeGetSimpleList(CGit* git)
 	GIT_COMMIT_LIST list;
 	GIT_HASH parent;
 
-	CAutoLocker lock(g_Git.m_critGitDllSec);
-	git->CheckAndInitDll();
-
+	// only collect the raw names while holding the gitdll session, converting them does not need gitdll
+	std::vector<CStringA> names;
+	CGitDllSession session(*git);
 	try
 	{
+		session.Init();
 		if (git_get_commit_from_hash(&commit, m_CommitHash.ToRaw()))
 			return -1;
 	}
@@ -153,17 +154,22 @@ int GitRevLoglist::SafeGetSimpleList(CGit* git)
 				return -1;
 			}
 
-			m_SimpleFileList.push_back(CUnicodeUtils::GetUnicode(newname));
+			names.emplace_back(newname);
 		}
 
 		git_diff_flush(git->GetGitSimpleListDiff());
 	}
+	git_free_commit(&commit);
+	session.Release();
+
+	m_SimpleFileList.reserve(m_SimpleFileList.size() + names.size());
+	for (const auto& name : names)
+		m_SimpleFileList.push_back(CUnicodeUtils::GetUnicode(name));
 
 	std::sort(m_SimpleFileList.begin(), m_SimpleFileList.end());
 	m_SimpleFileList.erase(std::unique(m_SimpleFileList.begin(), m_SimpleFileList.end()), m_SimpleFileList.end());
 
 	InterlockedExchange(&m_IsSimpleListReady, TRUE);
-	git_free_commit(&commit);
 
 	return 0;
 }
@@ -176,7 +182,7 @@ int GitRevLoglist::SafeFetchFullInfo(CGit* git)
 	m_Files.Clear();
 	if (git->UsingLibGit2(CGit::GIT_CMD_LOGLISTDIFF))
 	{
-		CAutoRepository repo(git->GetGitRepository());
+		auto repo = git->GetPooledGitRepository();
 		if (!repo)
 		{
 			m_sErr = CGit::GetLibGit2LastErr();
@@ -311,11 +317,25 @@ int GitRevLoglist::SafeFetchFullInfo(CGit* git)
 	GIT_COMMIT_LIST list;
 	GIT_HASH parent;
 
-	CAutoLocker lock(g_Git.m_critGitDllSec);
-	git->CheckAndInitDll();
-
+	// the diff entries are only collected while holding the gitdll session, the (expensive)
+	// path conversion and status parsing happen afterwards, so that other gitdll users are not blocked
+	struct SRawDiffEntry
+	{
+		CStringA	m_NewName;
+		CStringA	m_OldName;
+		int			m_ParentNo;
+		int			m_IsDir;
+		int			m_IsBin;
+		int			m_Inc;
+		int			m_Dec;
+		char		m_Status;
+	};
+	std::vector<SRawDiffEntry> entries;
+
+	CGitDllSession session(*git);
 	try
 	{
+		session.Init();
 		if (git_get_commit_from_hash(&commit, m_CommitHash.ToRaw()))
 		{
 			m_sErr = L"git_get_commit_from_hash failed for " + m_CommitHash.ToString();
@@ -355,53 +375,60 @@ int GitRevLoglist::SafeFetchFullInfo(CGit* git)
 		}
 		isRoot = false;
 
-		CTGitPath path;
-		CString strnewname;
-		CString stroldname;
-
+		entries.reserve(entries.size() + count);
 		for (int j = 0; j < count; ++j)
 		{
 			char* newname;
 			char* oldname;
-
-			strnewname.Empty();
-			stroldname.Empty();
-
-			char status;
-			int isBin, inc, dec, isDir;
-			git_get_diff_file(git->GetGitDiff(), file, j, &newname, &oldname, &isDir, &status, &isBin, &inc, &dec);
-
-			CGit::StringAppend(strnewname, newname, CP_UTF8);
-			// SetFromGit resets the path
-			if (strcmp(newname, oldname) == 0)
-				path.SetFromGit(strnewname, isDir != FALSE);
-			else
-			{
-				CGit::StringAppend(stroldname, oldname, CP_UTF8);
-				path.SetFromGit(strnewname, &stroldname, &isDir);
-			}
-			path.ParseAndUpdateStatus(status);
-			path.m_ParentNo = i;
-
-			m_Action |= path.m_Action;
-
-			if (isBin)
-			{
-				path.m_StatAdd = L"-";
-				path.m_StatDel = L"-";
-			}
-			else
-			{
-				path.m_StatAdd.Format(L"%d", inc);
-				path.m_StatDel.Format(L"%d", dec);
-			}
-			m_Files.AddPath(path);
+			SRawDiffEntry entry;
+			git_get_diff_file(git->GetGitDiff(), file, j, &newname, &oldname, &entry.m_IsDir, &entry.m_Status, &entry.m_IsBin, &entry.m_Inc, &entry.m_Dec);
+			entry.m_NewName = newname;
+			if (strcmp(newname, oldname) != 0)
+				entry.m_OldName = oldname;
+			entry.m_ParentNo = i;
+			entries.push_back(std::move(entry));
 		}
 		git_diff_flush(git->GetGitDiff());
 		++i;
 	}
 
 	git_free_commit(&commit);
+	session.Release();
+
+	CTGitPath path;
+	CString strnewname;
+	CString stroldname;
+	for (auto& entry : entries)
+	{
+		strnewname.Empty();
+		stroldname.Empty();
+
+		CGit::StringAppend(strnewname, entry.m_NewName, CP_UTF8);
+		// SetFromGit resets the path
+		if (entry.m_OldName.IsEmpty())
+			path.SetFromGit(strnewname, entry.m_IsDir != FALSE);
+		else
+		{
+			CGit::StringAppend(stroldname, entry.m_OldName, CP_UTF8);
+			path.SetFromGit(strnewname, &stroldname, &entry.m_IsDir);
+		}
+		path.ParseAndUpdateStatus(entry.m_Status);
+		path.m_ParentNo = entry.m_ParentNo;
+
+		m_Action |= path.m_Action;
+
+		if (entry.m_IsBin)
+		{
+			path.m_StatAdd = L"-";
+			path.m_StatDel = L"-";
+		}
+		else
+		{
+			path.m_StatAdd.Format(L"%d", entry.m_Inc);
+			path.m_StatDel.Format(L"%d", entry.m_Dec);
+		}
+		m_Files.AddPath(path);
+	}
 
 	return 0;
 }
@@ -453,8 +480,8 @@ int GitRevLoglist::GetRefLog(const CString& ref, std::vector<GitRevLoglist>& ref
 	}
 	else if (g_Git.m_IsUseGitDLL)
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
-		g_Git.CheckAndInitDll();
+		CGitDllSession session;
+		session.Init();
 		std::vector<GitRevLoglist> tmp;
 		// no error checking, because the only error which could occur is file not found
 		git_for_each_reflog_ent(CUnicodeUtils::GetUTF8(ref), [](struct GIT_OBJECT_OID* /*old_oid*/, struct GIT_OBJECT_OID* new_oid, const char* /*committer*/, unsigned long long time, int /*sz*/, const char* msg, void* data)
@@ -477,6 +504,7 @@ int GitRevLoglist::GetRefLog(const CString& ref, std::vector<GitRevLoglist>& ref
 
 			return 0;
 		}, &tmp);
+		session.Release();
 
 		for (size_t i = tmp.size(), id = 0; i > 0; --i, ++id)
 		{
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2024 - TortoiseGit
+// Copyright (C) 2008-2024, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -36,6 +36,7 @@ class GitRevLoglist : public GitRev
 {
 public:
 	friend class CLogCache;
+	friend class CLogSearchIndex;
 
 	GitRevLoglist();
 	~GitRevLoglist();
@@ -158,8 +159,20 @@ public:
 	}
 
 	void Parse(GIT_COMMIT* commit, const CGitMailmap* mailmap)
+	{
+		ParseParents(commit);
+		ParseBuffer(commit, mailmap);
+	}
+
+	// accesses the git commit object, so must be called before git_free_commit()
+	void ParseParents(GIT_COMMIT* commit)
 	{
 		ParserParentFromCommit(commit);
+	}
+
+	// only accesses the commit buffer, which might already be detached from the git commit object
+	void ParseBuffer(const GIT_COMMIT* commit, const CGitMailmap* mailmap)
+	{
 		ParserFromCommit(commit);
 		// no caching here, because mailmap might have changed
 		if (mailmap)
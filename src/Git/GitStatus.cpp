@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2019, 2021-2023 - TortoiseGit
+// Copyright (C) 2008-2019, 2021-2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -272,9 +272,9 @@ int GitStatus::GetFileStatus(const CString& gitdir, CString path, git_wc_status2
 }
 
 // checks whether indexPath is a direct submodule and not one in a subfolder
-static bool IsDirectSubmodule(const CString& indexPath, int prefix)
+static bool IsDirectSubmodule(const CGitEntryName& indexPath, int prefix)
 {
-	if (!CStringUtils::EndsWith(indexPath, L'/'))
+	if (indexPath.IsEmpty() || indexPath.GetString()[indexPath.GetLength() - 1] != L'/')
 		return false;
 
 	auto ptr = indexPath.GetString() + prefix;
@@ -345,8 +345,14 @@ int GitStatus::EnumDirStatus(const CString& gitdir, const CString& subpath, git_
 	if (!treeptr)
 		return -1;
 
-	size_t indexpos = SearchInSortVector(*indexptr, path, path.GetLength(), indexptr->IsIgnoreCase()); // match path prefix, (sub)folders end with slash
-	size_t treepos = SearchInSortVector(*treeptr, path, path.GetLength(), indexptr->IsIgnoreCase()); // match path prefix, (sub)folders end with slash
+	auto indexDirs = indexptr->GetDirectoryIndex();
+	auto treeDirs = treeptr->GetDirectoryIndex();
+	if (!indexDirs || !treeDirs)
+		return -1;
+
+	// (sub)folders end with slash
+	auto indexDir = indexDirs->Find(path, path.GetLength());
+	auto treeDir = treeDirs->Find(path, path.GetLength());
 
 	std::set<CString> localLastCheckCache;
 	CString adminDir = g_AdminDirMap.GetAdminDir(gitdir);
@@ -358,7 +364,7 @@ int GitStatus::EnumDirStatus(const CString& gitdir, const CString& subpath, git_
 	*dirstatus = git_wc_status_unknown;
 	if (isRepoRoot)
 		*dirstatus = git_wc_status_normal;
-	else if (indexpos == NPOS && treepos == NPOS)
+	else if (!indexDir && !treeDir)
 	{
 		// if folder does not contain any versioned items, it might be ignored
 		g_IgnoreList.CheckAndUpdateIgnoreFiles(gitdir, subpath, true, &localLastCheckCache);
@@ -367,6 +373,37 @@ int GitStatus::EnumDirStatus(const CString& gitdir, const CString& subpath, git_
 		folderignoredchecked = true;
 	}
 
+	// filelist and the children of the folder in index and HEAD tree are sorted the same way, so they can be merged in one pass
+	const CGitDirectoryIndex::Child* indexChild = nullptr;
+	const CGitDirectoryIndex::Child* indexChildEnd = nullptr;
+	if (indexDir)
+	{
+		indexChild = indexDirs->ChildrenBegin(*indexDir);
+		indexChildEnd = indexDirs->ChildrenEnd(*indexDir);
+	}
+	const CGitDirectoryIndex::Child* treeChild = nullptr;
+	const CGitDirectoryIndex::Child* treeChildEnd = nullptr;
+	if (treeDir)
+	{
+		treeChild = treeDirs->ChildrenBegin(*treeDir);
+		treeChildEnd = treeDirs->ChildrenEnd(*treeDir);
+	}
+	std::vector<const CGitDirectoryIndex::Child*> deletedInIndex;
+	std::vector<const CGitDirectoryIndex::Child*> deletedInTree;
+	auto mergeChildren = [](const CGitDirectoryIndex& dirs, const CGitDirectoryIndex::Child*& child, const CGitDirectoryIndex::Child* childEnd, const CGitFileName& fileentry, std::vector<const CGitDirectoryIndex::Child*>& notOnDisk) {
+		// do full match for filenames and folders ending with "/", a folder matches all entries below it
+		for (; child != childEnd; ++child)
+		{
+			const int cmp = dirs.Compare(child->m_pName, child->m_iLength, fileentry.m_FileName, fileentry.m_FileName.GetLength());
+			if (cmp == 0)
+				return (child++)->m_Start;
+			if (cmp > 0)
+				break;
+			notOnDisk.push_back(child);
+		}
+		return NPOS;
+	};
+
 	CAutoRepository repository;
 	for (auto it = filelist.cbegin(), itend = filelist.cend(); it != itend; ++it)
 	{
@@ -379,11 +416,8 @@ int GitStatus::EnumDirStatus(const CString& gitdir, const CString& subpath, git_
 		if (!onepath.IsEmpty() && onepath[onepath.GetLength() - 1] == L'/')
 			bIsDir = true;
 
-		int matchLength = -1;
-		if (bIsDir)
-			matchLength = onepath.GetLength();
-		size_t pos = SearchInSortVector(*indexptr, onepath, matchLength, indexptr->IsIgnoreCase());
-		size_t posintree = SearchInSortVector(*treeptr, onepath, matchLength, indexptr->IsIgnoreCase());
+		size_t pos = mergeChildren(*indexDirs, indexChild, indexChildEnd, fileentry, deletedInIndex);
+		size_t posintree = mergeChildren(*treeDirs, treeChild, treeChildEnd, fileentry, deletedInTree);
 
 		git_wc_status2_t status = { git_wc_status_none, false, false };
 
@@ -448,85 +482,65 @@ int GitStatus::EnumDirStatus(const CString& gitdir, const CString& subpath, git_
 		}
 	}/*End of For*/
 	repository.Free(); // explicitly free the handle here in order to keep an open repository as short as possible
+	if (indexChild)
+		deletedInIndex.insert(deletedInIndex.end(), indexChild, indexChildEnd);
+	if (treeChild)
+		deletedInTree.insert(deletedInTree.end(), treeChild, treeChildEnd);
 
 	/* Check deleted file in system */
-	size_t start = 0, end = 0;
 	std::set<CString> alreadyReported;
-	if (GetRangeInSortVector(*indexptr, path, path.GetLength(), indexptr->IsIgnoreCase(), &start, &end, indexpos) == 0)
+	const int commonPrefixLength = path.GetLength();
+	if (indexDir)
 	{
 		*dirstatus = git_wc_status_normal; // here we know that this folder has versioned entries
-		CString oldstring;
-		for (auto it = indexptr->cbegin() + start, itlast = indexptr->cbegin() + end; it <= itlast; ++it)
+		for (auto child : deletedInIndex)
 		{
-			auto& entry = *it;
-			const int commonPrefixLength = path.GetLength();
-			int index = entry.m_FileName.Find(L'/', commonPrefixLength);
-			if (index < 0)
-				index = entry.m_FileName.GetLength();
-			else
-				++index; // include slash at the end for subfolders, so that we do not match files by mistake
-
-			CString filename = entry.m_FileName.Mid(commonPrefixLength, index - commonPrefixLength);
-			if (oldstring != filename)
+			CString filename(child->m_pName, child->m_iLength);
+			const bool isDir = filename[child->m_iLength - 1] == L'/';
+			for (size_t i = child->m_Start; i < child->m_End; ++i)
 			{
-				oldstring = filename;
-				const int length = filename.GetLength();
-				const bool isDir = filename[length - 1] == L'/';
-				if (SearchInSortVector(filelist, filename, isDir ? length : -1, indexptr->IsIgnoreCase()) == NPOS) // do full match for filenames and only prefix-match ending with "/" for folders
+				auto& entry = (*indexptr)[i];
+				git_wc_status2_t status = { (!isDir || IsDirectSubmodule(entry.m_FileName, commonPrefixLength)) ? git_wc_status_deleted : git_wc_status_modified, false, false }; // only report deleted submodules and files as deletedy
+				if ((entry.m_FlagsExtended & GIT_INDEX_ENTRY_SKIP_WORKTREE) != 0)
 				{
-					git_wc_status2_t status = { (!isDir || IsDirectSubmodule(entry.m_FileName, commonPrefixLength)) ? git_wc_status_deleted : git_wc_status_modified, false, false }; // only report deleted submodules and files as deletedy
-					if ((entry.m_FlagsExtended & GIT_INDEX_ENTRY_SKIP_WORKTREE) != 0)
-					{
-						status.skipWorktree = true;
-						status.status = git_wc_status_normal;
-						oldstring.Empty(); // without this a deleted folder which has two versioned files and only the first is skipwoktree flagged gets reported as normal
-						if (alreadyReported.find(filename) != alreadyReported.cend())
-							continue;
-					}
-					alreadyReported.insert(filename);
-					callback(CombinePath(gitdir, subpath, filename), &status, isDir, 0, pData);
-					if (isDir)
+					status.skipWorktree = true;
+					status.status = git_wc_status_normal;
+					if (alreadyReported.find(filename) != alreadyReported.cend())
+						continue;
+				}
+				alreadyReported.insert(filename);
+				callback(CombinePath(gitdir, subpath, filename), &status, isDir, 0, pData);
+				if (isDir)
+				{
+					// folder might be replaced by symlink
+					CString folder(filename);
+					folder.TrimRight(L'/');
+					auto filepos = SearchInSortVector(filelist, folder, -1, indexptr->IsIgnoreCase());
+					if (filepos != NPOS && filelist[filepos].m_bSymlink)
 					{
-						// folder might be replaced by symlink
-						filename.TrimRight(L'/');
-						auto filepos = SearchInSortVector(filelist, filename, -1, indexptr->IsIgnoreCase());
-						if (filepos == NPOS || !filelist[filepos].m_bSymlink)
-							continue;
-						status.status = git_wc_status_deleted;
-						callback(CombinePath(gitdir, subpath, filename), &status, false, 0, pData);
+						git_wc_status2_t symlinkStatus = status;
+						symlinkStatus.status = git_wc_status_deleted;
+						callback(CombinePath(gitdir, subpath, folder), &symlinkStatus, false, 0, pData);
 					}
 				}
+				// without this a deleted folder which has two versioned files and only the first is skipwoktree flagged gets reported as normal
+				if (!status.skipWorktree)
+					break;
 			}
 		}
 	}
 
-	start = end = 0;
-	if (GetRangeInSortVector(*treeptr, path, path.GetLength(), indexptr->IsIgnoreCase(), &start, &end, treepos) == 0)
+	if (treeDir)
 	{
 		*dirstatus = git_wc_status_normal; // here we know that this folder has versioned entries
-		CString oldstring;
-		for (auto it = treeptr->cbegin() + start, itlast = treeptr->cbegin() + end; it <= itlast; ++it)
+		for (auto child : deletedInTree)
 		{
-			auto& entry = *it;
-			const int commonPrefixLength = path.GetLength();
-			int index = entry.m_FileName.Find(L'/', commonPrefixLength);
-			if (index < 0)
-				index = entry.m_FileName.GetLength();
-			else
-				++index; // include slash at the end for subfolders, so that we do not match files by mistake
-
-			CString filename = entry.m_FileName.Mid(commonPrefixLength, index - commonPrefixLength);
-			if (oldstring != filename && alreadyReported.find(filename) == alreadyReported.cend())
-			{
-				oldstring = filename;
-				const int length = filename.GetLength();
-				const bool isDir = filename[length - 1] == L'/';
-				if (SearchInSortVector(filelist, filename, isDir ? length : -1, indexptr->IsIgnoreCase()) == NPOS) // do full match for filenames and only prefix-match ending with "/" for folders
-				{
-					git_wc_status2_t status = { (!isDir || IsDirectSubmodule(entry.m_FileName, commonPrefixLength)) ? git_wc_status_deleted : git_wc_status_modified, false, false };
-					callback(CombinePath(gitdir, subpath, filename), &status, isDir, 0, pData);
-				}
-			}
+			CString filename(child->m_pName, child->m_iLength);
+			if (alreadyReported.find(filename) != alreadyReported.cend())
+				continue;
+			const bool isDir = filename[child->m_iLength - 1] == L'/';
+			git_wc_status2_t status = { (!isDir || IsDirectSubmodule((*treeptr)[child->m_Start].m_FileName, commonPrefixLength)) ? git_wc_status_deleted : git_wc_status_modified, false, false };
+			callback(CombinePath(gitdir, subpath, filename), &status, isDir, 0, pData);
 		}
 	}
 	return 0;
@@ -698,7 +712,7 @@ int GitStatus::GetDirStatus(const CString& gitdir, const CString& subpath, git_w
 			continue;
 
 		git_wc_status2_t filestatus = { git_wc_status_none, false, false };
-		GetFileStatus_int(gitdir, sharedRepoLists, indexentry.m_FileName, filestatus, IsFul, IsIgnore, false);
+		GetFileStatus_int(gitdir, sharedRepoLists, CString(indexentry.m_FileName), filestatus, IsFul, IsIgnore, false);
 		switch (filestatus.status)
 		{
 		case git_wc_status_added:
@@ -717,8 +731,11 @@ int GitStatus::GetDirStatus(const CString& gitdir, const CString& subpath, git_w
 #endif
 
 #ifdef TGITCACHE
-bool GitStatus::IsExistIndexLockFile(CString sDirName)
+bool GitStatus::IsExistIndexLockFile(CString sDirName, CString* projectTopDir /* = nullptr */)
 {
+	if (projectTopDir)
+		projectTopDir->Empty();
+
 	if (!PathIsDirectory(sDirName))
 	{
 		const int x = sDirName.ReverseFind(L'\\');
@@ -732,6 +749,9 @@ bool GitStatus::IsExistIndexLockFile(CString sDirName)
 	{
 		if (PathFileExists(CombinePath(sDirName, L".git")))
 		{
+			if (projectTopDir)
+				*projectTopDir = sDirName;
+
 			if (PathFileExists(g_AdminDirMap.GetWorktreeAdminDirConcat(sDirName, L"index.lock")))
 				return true;
 
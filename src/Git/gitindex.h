@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2024 - TortoiseGit
+// Copyright (C) 2008-2024, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -35,10 +35,96 @@
 #define S_ISLNK(m) (((m) & _S_IFMT) == _S_IFLNK)
 #endif
 
+/**
+ * Read-only view of a path name stored in a CGitPathArena.
+ * Provides the subset of the CString interface used on index and tree entries, the name is always NUL terminated.
+ */
+class CGitEntryName
+{
+public:
+	CGitEntryName() = default;
+	CGitEntryName(LPCWSTR name, int length)
+		: m_pszName(name)
+		, m_iLength(length)
+	{
+		ATLASSERT(name && name[length] == L'\0');
+	}
+
+	operator LPCWSTR() const { return m_pszName; }
+	LPCWSTR GetString() const { return m_pszName; }
+	int GetLength() const { return m_iLength; }
+	bool IsEmpty() const { return m_iLength == 0; }
+
+	int Find(wchar_t ch, int start = 0) const
+	{
+		if (start < 0 || start >= m_iLength)
+			return -1;
+		auto found = wmemchr(m_pszName + start, ch, m_iLength - start);
+		return found ? static_cast<int>(found - m_pszName) : -1;
+	}
+
+	CString Mid(int first, int count) const
+	{
+		ATLASSERT(first >= 0 && count >= 0 && first + count <= m_iLength);
+		return CString(m_pszName + first, count);
+	}
+
+	int Compare(LPCWSTR str) const { return wcscmp(m_pszName, str); }
+	int CompareNoCase(LPCWSTR str) const { return _wcsicmp(m_pszName, str); }
+
+private:
+	LPCWSTR m_pszName = L"";
+	int m_iLength = 0;
+};
+
+/**
+ * Append-only storage for the path names of a CGitIndexList or CGitHeadFileList.
+ * Names are allocated from large blocks instead of one heap allocation per entry,
+ * returned pointers stay valid until the arena is destroyed.
+ */
+class CGitPathArena
+{
+public:
+	CGitPathArena() = default;
+	CGitPathArena(const CGitPathArena&) = delete;
+	CGitPathArena& operator=(const CGitPathArena&) = delete;
+
+	/**
+	 * Returns a buffer for length characters plus the terminating NUL, throws std::bad_alloc.
+	 * If the buffer is not completely used, Shrink() must be called before the next allocation.
+	 */
+	wchar_t* Allocate(size_t length);
+	// releases the unused tail of the last allocation, the NUL terminator has to be written by the caller
+	void Shrink(const wchar_t* buffer, size_t length);
+
+	CGitEntryName Store(LPCWSTR str, int length);
+	// stores prefix + UTF-8 converted name (+ an optional trailing slash)
+	CGitEntryName StoreUTF8(const CString& prefix, const char* name, bool appendSlash);
+
+	void Reserve(size_t length);
+	// takes over all blocks of other, names stored in other stay valid
+	void Adopt(CGitPathArena& other);
+	// invalidates all names handed out so far
+	void Clear()
+	{
+		m_blocks.clear();
+		m_pCurrent = nullptr;
+		m_iFree = m_iAllocated = m_iLastAllocation = 0;
+	}
+	size_t GetAllocatedSize() const { return m_iAllocated; }
+
+private:
+	std::vector<std::unique_ptr<wchar_t[]>> m_blocks;
+	wchar_t* m_pCurrent = nullptr;
+	size_t m_iFree = 0;
+	size_t m_iAllocated = 0;
+	size_t m_iLastAllocation = 0;
+};
+
 struct CGitIndex
 {
 	/* m_Size and m_ModifyTime are only uint32_t in libgit2, cf. https://github.com/libgit2/libgit2/blob/8535fdb9cbad8fcd15ee4022ed29c4138547e22d/include/git2/index.h#L48-L51 and https://tortoisegit.org/issue/4108 */
-	CString    m_FileName;
+	CGitEntryName	m_FileName; // stored in the arena of the owning CGitIndexList
 	mutable int32_t	m_ModifyTime;
 	mutable uint32_t	m_ModifyTimeNanos;
 	uint16_t	m_Flags;
@@ -50,6 +136,61 @@ struct CGitIndex
 	int Print();
 };
 
+/**
+ * Directory view of a sorted CGitIndexList or CGitHeadFileList.
+ * For every directory it knows the range of entries below it and its direct children
+ * (files, submodules and subfolders) in the sort order of the list, so that a folder
+ * can be compared against the file system in a single merge pass.
+ */
+class CGitDirectoryIndex
+{
+public:
+	struct Child
+	{
+		LPCWSTR	m_pName;	// not NUL terminated, subfolders and submodules include the trailing slash
+		int		m_iLength;
+		size_t	m_Start;	// range of the entries in the list, m_End is exclusive
+		size_t	m_End;
+	};
+
+	struct Directory
+	{
+		LPCWSTR	m_pPath;	// not NUL terminated, includes the trailing slash (empty for the root)
+		int		m_iLength;
+		size_t	m_Start;	// range of the entries in the list, m_End is exclusive
+		size_t	m_End;
+		size_t	m_ChildStart;
+		size_t	m_ChildEnd;
+	};
+
+	template<class T>
+	void Build(const T& list, bool ignoreCase);
+
+	// path must be empty or end with a slash
+	const Directory* Find(LPCWSTR path, int length) const;
+	const Child* ChildrenBegin(const Directory& dir) const { return m_Children.data() + dir.m_ChildStart; }
+	const Child* ChildrenEnd(const Directory& dir) const { return m_Children.data() + dir.m_ChildEnd; }
+
+	// compares with the same semantics as DoSortFilenametSortVector
+	int Compare(LPCWSTR s1, int len1, LPCWSTR s2, int len2) const
+	{
+		const int ret = m_bIgnoreCase ? _wcsnicmp(s1, s2, min(len1, len2)) : wcsncmp(s1, s2, min(len1, len2));
+		if (ret)
+			return ret;
+		return len1 - len2;
+	}
+
+private:
+	template<class T>
+	size_t BuildDirectory(const T& list, size_t start, int prefixLength);
+
+	std::vector<Directory> m_Directories;
+	std::vector<Child> m_Children;
+	bool m_bIgnoreCase = false;
+};
+
+struct SIndexSnapshotHeader;
+
 class CGitIndexList : private std::vector<CGitIndex>
 {
 public:
@@ -68,6 +209,8 @@ public:
 	int ReadIncomingOutgoing(git_repository* repo);
 	int GetFileStatus(const CString& gitdir, const CString& path, git_wc_status2_t& status, CGitHash* pHash = nullptr) const;
 	int GetFileStatus(CAutoRepository& repository, const CString& gitdir, const CGitIndex& entry, git_wc_status2_t& status, __int64 time, __int64 filesize, bool isSymlink) const;
+	// built on first use, returns nullptr if it could not be built
+	const CGitDirectoryIndex* GetDirectoryIndex() const;
 
 	using std::vector<CGitIndex>::begin;
 	using std::vector<CGitIndex>::end;
@@ -79,6 +222,7 @@ public:
 
 #ifdef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
 	FRIEND_TEST(GitIndexCBasicGitWithTestRepoFixture, GetFileStatus);
+	FRIEND_TEST(GitIndexCBasicGitWithTestRepoFixture, IndexSnapshot);
 #endif
 private:
 	__time64_t m_LastModifyTime = 0;
@@ -87,63 +231,135 @@ private:
 	int		m_iIndexCaps = GIT_INDEX_CAPABILITY_IGNORE_CASE | GIT_INDEX_CAPABILITY_NO_SYMLINKS;
 	__int64 m_iMaxCheckSize = 10 * 1024 * 1024;
 	bool	m_bCalculateIncomingOutgoing = true;
+	bool	m_bUseIndexSnapshot = false;
 	CAutoConfig config;
 	int GetFileStatus(const CString& gitdir, const CString& path, git_wc_status2_t& status, __int64 time, __int64 filesize, bool isSymlink, CGitHash* pHash = nullptr) const;
+
+	bool GetIndexSnapshotKey(const CString& gitdir, SIndexSnapshotHeader& key) const;
+	int ReadIndexSnapshot(const CString& snapshotFile, const SIndexSnapshotHeader& key);
+	int WriteIndexSnapshot(const CString& snapshotFile, const SIndexSnapshotHeader& key, int indexCaps) const;
+
+	CGitPathArena m_NameArena;
+
+	mutable CComAutoCriticalSection m_critDirIndex;
+	mutable std::unique_ptr<CGitDirectoryIndex> m_pDirIndex;
 };
 
 using SHARED_INDEX_PTR = std::shared_ptr<const CGitIndexList>;
 using CAutoLocker = CComCritSecLock<CComCriticalSection>;
 
+class CAutoSRWLockShared
+{
+public:
+	explicit CAutoSRWLockShared(SRWLOCK& lock) : m_lock(lock) { AcquireSRWLockShared(&m_lock); }
+	~CAutoSRWLockShared() { ReleaseSRWLockShared(&m_lock); }
+	CAutoSRWLockShared(const CAutoSRWLockShared&) = delete;
+	CAutoSRWLockShared& operator=(const CAutoSRWLockShared&) = delete;
+
+private:
+	SRWLOCK& m_lock;
+};
+
+class CAutoSRWLockExclusive
+{
+public:
+	explicit CAutoSRWLockExclusive(SRWLOCK& lock) : m_lock(lock) { AcquireSRWLockExclusive(&m_lock); }
+	~CAutoSRWLockExclusive() { ReleaseSRWLockExclusive(&m_lock); }
+	CAutoSRWLockExclusive(const CAutoSRWLockExclusive&) = delete;
+	CAutoSRWLockExclusive& operator=(const CAutoSRWLockExclusive&) = delete;
+
+private:
+	SRWLOCK& m_lock;
+};
+
+#define SHAREDPTRMAP_SHARDS		16
+#define SHAREDPTRMAP_MAX_KEYS	1024
+
+/**
+ * Map from a (normalized) path to a shared pointer, safe to be used from several threads.
+ * Entries are spread over several shards, each guarded by its own slim reader/writer lock,
+ * so that lookups of different threads do not block each other.
+ */
 template<typename SharedPtr>
-class SharedPtrMapTmpl : private std::map<CString, SharedPtr>
+class SharedPtrMapTmpl
 {
 public:
 	[[nodiscard]] SharedPtr SafeGet(const CString& path)
 	{
-		CString thePath(CPathUtils::NormalizePath(path));
-		CAutoLocker lock(m_critSec);
-		auto lookup = this->find(thePath);
-		if (lookup == this->cend())
+		CString thePath(GetKey(path));
+		auto& shard = GetShard(thePath);
+		CAutoSRWLockShared lock(shard.m_lock);
+		auto lookup = shard.m_map.find(thePath);
+		if (lookup == shard.m_map.cend())
 			return {};
 		return lookup->second;
 	}
 
 	bool SafeClear(const CString& path)
 	{
-		CString thePath(CPathUtils::NormalizePath(path));
-		CAutoLocker lock(m_critSec);
-		auto lookup = this->find(thePath);
-		if (lookup == this->cend())
-			return false;
-		this->erase(lookup);
-		return true;
+		CString thePath(GetKey(path));
+		auto& shard = GetShard(thePath);
+		CAutoSRWLockExclusive lock(shard.m_lock);
+		return shard.m_map.erase(thePath) > 0;
 	}
 
 	bool SafeClearRecursively(const CString& path)
 	{
 		CString thePath(CPathUtils::NormalizePath(path));
-		CAutoLocker lock(m_critSec);
-		std::vector<CString> toRemove;
-		for (auto it = this->cbegin(); it != this->cend(); ++it)
+		bool removed = false;
+		for (auto& shard : m_shards)
 		{
-			if (CStringUtils::StartsWith((*it).first, thePath))
-				toRemove.push_back((*it).first);
+			CAutoSRWLockExclusive lock(shard.m_lock);
+			// the keys are sorted, so all paths starting with thePath are adjacent
+			for (auto it = shard.m_map.lower_bound(thePath); it != shard.m_map.cend() && CStringUtils::StartsWith((*it).first, thePath);)
+			{
+				it = shard.m_map.erase(it);
+				removed = true;
+			}
 		}
-		for (auto it = toRemove.cbegin(); it != toRemove.cend(); ++it)
-			this->erase(*it);
-		return !toRemove.empty();
+		return removed;
 	}
 
 protected:
 	void SafeSet(const CString& path, SharedPtr ptr)
 	{
-		CString thePath(CPathUtils::NormalizePath(path));
-		CAutoLocker lock(m_critSec);
-		(*this)[thePath] = ptr;
+		CString thePath(GetKey(path));
+		auto& shard = GetShard(thePath);
+		CAutoSRWLockExclusive lock(shard.m_lock);
+		shard.m_map[thePath] = ptr;
 	}
 
 private:
-	CComAutoCriticalSection m_critSec;
+	struct Shard
+	{
+		SRWLOCK m_lock = SRWLOCK_INIT;
+		std::map<CString, SharedPtr> m_map;
+	};
+
+	// NormalizePath hits the file system, so remember the keys of the (few) repository paths we get asked for
+	CString GetKey(const CString& path)
+	{
+		{
+			CAutoSRWLockShared lock(m_keyLock);
+			if (auto lookup = m_keys.find(path); lookup != m_keys.cend())
+				return lookup->second;
+		}
+		CString thePath(CPathUtils::NormalizePath(path));
+		CAutoSRWLockExclusive lock(m_keyLock);
+		if (m_keys.size() >= SHAREDPTRMAP_MAX_KEYS)
+			m_keys.clear();
+		m_keys.emplace(path, thePath);
+		return thePath;
+	}
+
+	Shard& GetShard(const CString& key)
+	{
+		return m_shards[std::hash<std::wstring_view>{}(std::wstring_view(key, key.GetLength())) % SHAREDPTRMAP_SHARDS];
+	}
+
+	Shard m_shards[SHAREDPTRMAP_SHARDS];
+	SRWLOCK m_keyLock = SRWLOCK_INIT;
+	std::map<CString, CString> m_keys;
 };
 
 class CGitIndexFileMap : protected SharedPtrMapTmpl<SHARED_INDEX_PTR>
@@ -173,11 +389,13 @@ public:
 
 struct CGitTreeItem
 {
-	CString	m_FileName;
+	CGitEntryName	m_FileName; // stored in the arena of the owning CGitHeadFileList
 	CGitHash	m_Hash;
 	int			m_Flags;
 };
 
+struct SReadTreeChunk;
+
 /* After object create, never change field against
  * that needn't lock to get field
 */
@@ -202,12 +420,27 @@ private:
 
 	std::map<CString,CGitHash> m_PackRefMap;
 
+	CGitPathArena m_NameArena;
+	bool		m_bIgnoreCase = false;
+	std::vector<std::pair<CString, CGitHash>> m_Subtrees; // tree id of every folder ("path/") sorted by path, used for reusing unchanged subtrees on the next ReadTree
+
+	mutable CComAutoCriticalSection m_critDirIndex;
+	mutable std::unique_ptr<CGitDirectoryIndex> m_pDirIndex;
+
 public:
 	CGitHeadFileList() = default;
+	CGitHeadFileList(const CGitHeadFileList&) = delete;
+	CGitHeadFileList& operator=(const CGitHeadFileList&) = delete;
 
-	int ReadTree(bool ignoreCase);
+	/**
+	 * Reads the HEAD tree, folders are read in parallel.
+	 * Folders whose tree id did not change compared to previous are copied from it instead of being read again.
+	 */
+	int ReadTree(bool ignoreCase, const CGitHeadFileList* previous = nullptr);
 	int ReadHeadHash(const CString& gitdir);
 	bool CheckHeadUpdate() const;
+	// built on first use, returns nullptr if it could not be built
+	const CGitDirectoryIndex* GetDirectoryIndex() const;
 
 	using std::vector<CGitTreeItem>::begin;
 	using std::vector<CGitTreeItem>::end;
@@ -218,7 +451,8 @@ public:
 	using std::vector<CGitTreeItem>::operator[];
 
 private:
-	int ReadTreeRecursive(git_repository& repo, const git_tree* tree, const CString& base);
+	static int ReadTreeRecursive(git_repository& repo, const git_tree* tree, const CString& base, SReadTreeChunk& chunk, const CGitHeadFileList* previous, std::vector<std::pair<CString, CGitHash>>* deferred = nullptr);
+	bool CopySubtree(const CString& path, const CGitHash& treeId, SReadTreeChunk& chunk) const;
 };
 
 using SHARED_TREE_PTR = std::shared_ptr<const CGitHeadFileList>;
@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005-2006,2008-2010 - TortoiseSVN
-// Copyright (C) 2008-2013, 2016-2017, 2019-2020, 2023 - TortoiseGit
+// Copyright (C) 2008-2013, 2016-2017, 2019-2020, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -63,6 +63,26 @@ struct TGITCacheRequest
 	WCHAR path[MAX_PATH];
 };
 
+/**
+ * \ingroup TGitCache
+ * A request for the status of several items of one directory in one round-trip, e.g. for
+ * prefetching all items of a folder. flags must contain TGITCACHE_FLAGS_BATCH, the other flags apply to all items.
+ * The header is followed by count items, each consisting of a WORD with the item flags
+ * (TGITCACHE_FLAGS_FOLDERISKNOWN, TGITCACHE_FLAGS_ISFOLDER), a WORD with the length of the
+ * name and the name relative to directory (not NUL terminated).
+ * The whole message must not exceed TGITCACHE_BATCH_MAX_REQUEST_SIZE bytes.
+ * The reply is a packed array of count TGITCacheResponse in the order of the items.
+ */
+struct TGITCacheBatchRequest
+{
+	DWORD flags;
+	DWORD count;
+	WCHAR directory[MAX_PATH];
+};
+
+#define TGITCACHE_BATCH_MAX_REQUEST_SIZE	(64 * 1024)
+#define TGITCACHE_BATCH_MAX_ITEMS			1024
+
 // CustomActions will use this header but does not need nor understand the SVN types ...
 
 /**
@@ -103,5 +123,7 @@ struct TGITCacheCommand
 #define TGITCACHE_FLAGS_RECUSIVE_STATUS		0x04
 /// Set this flag if notifications to the shell are not allowed
 #define TGITCACHE_FLAGS_NONOTIFICATIONS		0x08
+/// Set for a TGITCacheBatchRequest
+#define TGITCACHE_FLAGS_BATCH				0x10
 /// all of the above flags or-gated:
-#define TGITCACHE_FLAGS_MASK 0x0f
+#define TGITCACHE_FLAGS_MASK 0x1f
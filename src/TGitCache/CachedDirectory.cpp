@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005-2008 - TortoiseSVN
-// Copyright (C) 2008-2019, 2021-2023 - TortoiseGit
+// Copyright (C) 2008-2019, 2021-2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -23,6 +23,7 @@
 #include "GitStatusCache.h"
 #include "PathUtils.h"
 #include "GitStatus.h"
+#include "StatusCacheSnapshot.h"
 #include <set>
 
 CCachedDirectory::CCachedDirectory()
@@ -44,143 +45,103 @@ CCachedDirectory::CCachedDirectory(const CTGitPath& directoryPath)
 	m_directoryPath.GetGitPathString(); // make sure git path string is set
 }
 
-BOOL CCachedDirectory::SaveToDisk(FILE * pFile)
+void CCachedDirectory::SaveToSnapshot(CStatusCacheSnapshotWriter& writer, const CString& key)
 {
 	AutoLocker lock(m_critSec);
-#define WRITEVALUETOFILE(x) if (fwrite(&x, sizeof(x), 1, pFile)!=1) return false;
-
-	unsigned int value = GIT_CACHE_VERSION;
-	WRITEVALUETOFILE(value);	// 'version' of this save-format
-	value = static_cast<int>(m_entryCache.size());
-	WRITEVALUETOFILE(value);	// size of the cache map
-	// now iterate through the maps and save every entry.
-	for (const auto& entry : m_entryCache)
+	auto& dir = writer.AddDirectory();
+	dir.m_Key = writer.AddString(key);
+	dir.m_Path = writer.AddString(m_directoryPath.GetWinPathString());
+	m_ownStatus.SaveToSnapshot(dir.m_OwnStatus);
+	dir.m_CurrentFullStatus = m_currentFullStatus;
+	dir.m_MostImportantFileStatus = m_mostImportantFileStatus;
+	// dir must not be used anymore from here on, adding members might reallocate it
+
+	if (m_pSnapshot)
 	{
-		const CString& key = entry.first;
-		value = key.GetLength();
-		WRITEVALUETOFILE(value);
-		if (value)
+		// not accessed since loaded, so just copy the records over
+		const auto& snapshotDir = m_pSnapshot->GetDirectory(m_iSnapshotIndex);
+		auto entries = m_pSnapshot->GetEntries(snapshotDir);
+		for (DWORD i = 0; i < snapshotDir.m_EntryCount; ++i)
 		{
-			if (fwrite(static_cast<LPCWSTR>(key), sizeof(wchar_t), value, pFile) != value)
-				return false;
-			if (!entry.second.SaveToDisk(pFile))
-				return false;
+			auto& entry = writer.AddEntry();
+			entry.m_Name = writer.AddString(m_pSnapshot->GetString(entries[i].m_Name), entries[i].m_Name.m_Length);
+			entry.m_Status = entries[i].m_Status;
 		}
-	}
-	value = static_cast<int>(m_childDirectories.size());
-	WRITEVALUETOFILE(value);
-	for (const auto& entry : m_childDirectories)
-	{
-		const CString& path = entry.first;
-		value = path.GetLength();
-		WRITEVALUETOFILE(value);
-		if (value)
+		auto children = m_pSnapshot->GetChildren(snapshotDir);
+		for (DWORD i = 0; i < snapshotDir.m_ChildCount; ++i)
 		{
-			if (fwrite(static_cast<LPCWSTR>(path), sizeof(wchar_t), value, pFile) != value)
-				return false;
-			git_wc_status_kind status = entry.second;
-			WRITEVALUETOFILE(status);
+			auto& child = writer.AddChild();
+			child.m_Path = writer.AddString(m_pSnapshot->GetString(children[i].m_Path), children[i].m_Path.m_Length);
+			child.m_Status = children[i].m_Status;
 		}
+		return;
+	}
+
+	for (const auto& [name, status] : m_entryCache)
+	{
+		if (name.IsEmpty())
+			continue;
+		auto& entry = writer.AddEntry();
+		entry.m_Name = writer.AddString(name);
+		status.SaveToSnapshot(entry.m_Status);
 	}
-	value = m_directoryPath.GetWinPathString().GetLength();
-	WRITEVALUETOFILE(value);
-	if (value)
+	for (const auto& [path, status] : m_childDirectories)
 	{
-		if (fwrite(m_directoryPath.GetWinPath(), sizeof(wchar_t), value, pFile) != value)
-			return false;
+		if (path.IsEmpty())
+			continue;
+		auto& child = writer.AddChild();
+		child.m_Path = writer.AddString(path);
+		child.m_Status = status;
 	}
-	if (!m_ownStatus.SaveToDisk(pFile))
-		return false;
-	WRITEVALUETOFILE(m_currentFullStatus);
-	WRITEVALUETOFILE(m_mostImportantFileStatus);
-	return true;
 }
 
-BOOL CCachedDirectory::LoadFromDisk(FILE * pFile)
+void CCachedDirectory::LoadFromSnapshot(const std::shared_ptr<const CStatusCacheSnapshot>& snapshot, DWORD index)
 {
 	AutoLocker lock(m_critSec);
-#define LOADVALUEFROMFILE(x) if (fread(&x, sizeof(x), 1, pFile)!=1) return false;
-	try
+	const auto& dir = snapshot->GetDirectory(index);
+	if (dir.m_Path.m_Length)
 	{
-		unsigned int value = 0;
-		LOADVALUEFROMFILE(value);
-		if (value != GIT_CACHE_VERSION)
-			return false;		// not the correct version
-		int mapsize = 0;
-		LOADVALUEFROMFILE(mapsize);
-		for (int i=0; i<mapsize; ++i)
-		{
-			LOADVALUEFROMFILE(value);
-			if (value > MAX_PATH)
-				return false;
-			if (value)
-			{
-				CString sKey;
-				if (fread(sKey.GetBuffer(value+1), sizeof(wchar_t), value, pFile) != value)
-				{
-					sKey.ReleaseBuffer(0);
-					return false;
-				}
-				sKey.ReleaseBuffer(value);
-				CStatusCacheEntry entry;
-				if (!entry.LoadFromDisk(pFile))
-					return false;
-				// only read non empty keys (just needed for transition from old TGit clients)
-				if (!sKey.IsEmpty())
-					m_entryCache[sKey] = entry;
-			}
-		}
-		LOADVALUEFROMFILE(mapsize);
-		for (int i=0; i<mapsize; ++i)
-		{
-			LOADVALUEFROMFILE(value);
-			if (value > MAX_PATH)
-				return false;
-			if (value)
-			{
-				CString sPath;
-				if (fread(sPath.GetBuffer(value), sizeof(wchar_t), value, pFile) != value)
-				{
-					sPath.ReleaseBuffer(0);
-					return false;
-				}
-				sPath.ReleaseBuffer(value);
-				git_wc_status_kind status;
-				LOADVALUEFROMFILE(status);
-				m_childDirectories[sPath] = status;
-			}
-		}
-		LOADVALUEFROMFILE(value);
-		if (value > MAX_PATH)
-			return false;
-		if (value)
-		{
-			CString sPath;
-			if (fread(sPath.GetBuffer(value+1), sizeof(wchar_t), value, pFile) != value)
-			{
-				sPath.ReleaseBuffer(0);
-				return false;
-			}
-			sPath.ReleaseBuffer(value);
-			// make sure paths do not end with backslash (just needed for transition from old TGit clients)
-			if (sPath.GetLength() > 3 && sPath[sPath.GetLength() - 1] == L'\\')
-				sPath.TrimRight(L'\\');
-			m_directoryPath.SetFromWin(sPath);
-			m_directoryPath.GetGitPathString(); // make sure git path string is set
-		}
-		if (!m_ownStatus.LoadFromDisk(pFile))
-			return false;
-
-		LOADVALUEFROMFILE(m_currentFullStatus);
-		LOADVALUEFROMFILE(m_mostImportantFileStatus);
+		CString sPath = snapshot->GetCString(dir.m_Path);
+		// make sure paths do not end with backslash (just needed for transition from old TGit clients)
+		if (sPath.GetLength() > 3 && sPath[sPath.GetLength() - 1] == L'\\')
+			sPath.TrimRight(L'\\');
+		m_directoryPath.SetFromWin(sPath);
+		m_directoryPath.GetGitPathString(); // make sure git path string is set
 	}
-	catch ( CAtlException )
+	m_ownStatus.LoadFromSnapshot(dir.m_OwnStatus);
+	m_currentFullStatus = static_cast<git_wc_status_kind>(dir.m_CurrentFullStatus);
+	m_mostImportantFileStatus = static_cast<git_wc_status_kind>(dir.m_MostImportantFileStatus);
+
+	m_entryCache.clear();
+	m_childDirectories.clear();
+	if (dir.m_EntryCount || dir.m_ChildCount)
 	{
-		return false;
+		m_pSnapshot = snapshot;
+		m_iSnapshotIndex = index;
 	}
-	return true;
 }
 
+void CCachedDirectory::MaterializeSnapshot()
+{
+	if (!m_pSnapshot)
+		return;
+
+	const auto& dir = m_pSnapshot->GetDirectory(m_iSnapshotIndex);
+	auto entries = m_pSnapshot->GetEntries(dir);
+	for (DWORD i = 0; i < dir.m_EntryCount; ++i)
+	{
+		CStatusCacheEntry entry;
+		entry.LoadFromSnapshot(entries[i].m_Status);
+		// the entries were written in map order, so inserting at the end is cheap
+		m_entryCache.emplace_hint(m_entryCache.cend(), m_pSnapshot->GetCString(entries[i].m_Name), entry);
+	}
+	auto children = m_pSnapshot->GetChildren(dir);
+	for (DWORD i = 0; i < dir.m_ChildCount; ++i)
+		m_childDirectories.emplace_hint(m_childDirectories.cend(), m_pSnapshot->GetCString(children[i].m_Path), static_cast<git_wc_status_kind>(children[i].m_Status));
+
+	// drop the reference, the file gets unmapped as soon as all directories are materialized
+	m_pSnapshot.reset();
+}
 
 CStatusCacheEntry CCachedDirectory::GetStatusFromCache(const CTGitPath& path, bool bRecursive)
 {
@@ -233,6 +194,7 @@ CStatusCacheEntry CCachedDirectory::GetStatusFromCache(const CTGitPath& path, bo
 
 		// Look up a file in our own cache
 		AutoLocker lock(m_critSec);
+		MaterializeSnapshot();
 		CString strCacheKey = GetCacheKey(path);
 		CacheEntryMap::iterator itMap = m_entryCache.find(strCacheKey);
 		if(itMap != m_entryCache.end())
@@ -278,6 +240,7 @@ CStatusCacheEntry CCachedDirectory::GetStatusFromGit(const CTGitPath &path, cons
 		m_mostImportantFileStatus = git_wc_status_none;
 		{
 			AutoLocker lock(m_critSec);
+			MaterializeSnapshot();
 			for (auto it = m_childDirectories.cbegin(); it != m_childDirectories.cend(); ++it)
 				CGitStatusCache::Instance().AddFolderForCrawling(it->first);
 			m_childDirectories.clear();
@@ -326,6 +289,7 @@ CStatusCacheEntry CCachedDirectory::GetStatusForMember(const CTGitPath& path, bo
 				// shortcut if path is not versioned
 				m_ownStatus = git_wc_status_none;
 				m_mostImportantFileStatus = git_wc_status_none;
+				MaterializeSnapshot();
 				for (auto it = m_childDirectories.cbegin(); it != m_childDirectories.cend(); ++it)
 					CGitStatusCache::Instance().AddFolderForCrawling(it->first);
 				m_childDirectories.clear();
@@ -361,6 +325,7 @@ CStatusCacheEntry CCachedDirectory::GetCacheStatusForMember(const CTGitPath& pat
 {
 	// no disk access!
 	AutoLocker lock(m_critSec);
+	MaterializeSnapshot();
 	CacheEntryMap::iterator itMap = m_entryCache.find(GetCacheKey(path));
 	if(itMap != m_entryCache.end())
 		return itMap->second;
@@ -398,6 +363,7 @@ int CCachedDirectory::EnumFiles(const CTGitPath& path, CString sProjectRoot, con
 		if (isSelf)
 		{
 			AutoLocker lock(m_critSec);
+			MaterializeSnapshot();
 			// clear subdirectory status cache
 			m_childDirectories_tmp.clear();
 			// build new files status cache
@@ -431,6 +397,7 @@ CCachedDirectory::AddEntry(const CTGitPath& path, const git_wc_status2_t* pGitSt
 	if (!path.IsDirectory())
 	{
 		AutoLocker lock(m_critSec);
+		MaterializeSnapshot();
 		CString cachekey = GetCacheKey(path);
 		CacheEntryMap::iterator entry_it = m_entryCache.lower_bound(cachekey);
 		if (entry_it != m_entryCache.end() && entry_it->first == cachekey)
@@ -525,6 +492,7 @@ git_wc_status_kind CCachedDirectory::CalculateRecursiveStatus()
 
 	// Now combine all our child-directorie's status
 	AutoLocker lock(m_critSec);
+	MaterializeSnapshot();
 	ChildDirStatus::const_iterator it;
 	for(it = m_childDirectories.begin(); it != m_childDirectories.end(); ++it)
 	{
@@ -582,6 +550,7 @@ void CCachedDirectory::UpdateChildDirectoryStatus(const CTGitPath& childDir, git
 	git_wc_status_kind currentStatus = git_wc_status_none;
 	{
 		AutoLocker lock(m_critSec);
+		MaterializeSnapshot();
 		currentStatus = m_childDirectories[childDir.GetWinPathString()];
 		m_childDirectories_tmp[childDir.GetWinPathString()] = childStatus;
 	}
@@ -595,6 +564,7 @@ void CCachedDirectory::UpdateChildDirectoryStatus(const CTGitPath& childDir, git
 void CCachedDirectory::KeepChildStatus(const CString& childDir)
 {
 	AutoLocker lock(m_critSec);
+	MaterializeSnapshot();
 	auto it = m_childDirectories.find(childDir);
 	if (it != m_childDirectories.cend())
 	{
@@ -614,6 +584,7 @@ void CCachedDirectory::KeepChildStatus(const CString& childDir)
 void CCachedDirectory::SetChildStatus(const CString& childDir, git_wc_status_kind childStatus)
 {
 	AutoLocker lock(m_critSec);
+	MaterializeSnapshot();
 	m_childDirectories[childDir] = childStatus;
 	m_childDirectories_tmp[childDir] = childStatus;
 }
@@ -654,6 +625,7 @@ void CCachedDirectory::RefreshStatus(bool bRecursive)
 void CCachedDirectory::RefreshMostImportant(bool bUpdateShell /* = true */)
 {
 	AutoLocker lock(m_critSec);
+	MaterializeSnapshot();
 	CacheEntryMap::iterator itMembers;
 	git_wc_status_kind newStatus = git_wc_status_unversioned;
 	for (itMembers = m_entryCache.begin(); itMembers != m_entryCache.end(); ++itMembers)
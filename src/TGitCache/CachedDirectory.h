@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005 - 2006, 2008, 2014 - TortoiseSVN
-// Copyright (C) 2008-2012, 2014, 2016-2017, 2021-2023 - TortoiseGit
+// Copyright (C) 2008-2012, 2014, 2016-2017, 2021-2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -22,13 +22,14 @@
 #include "StatusCacheEntry.h"
 #include "TGitPath.h"
 
+class CStatusCacheSnapshot;
+class CStatusCacheSnapshotWriter;
+
 /**
  * \ingroup TGitCache
  * Holds the status for a folder and all files and folders directly inside
  * that folder.
  */
-#define GIT_CACHE_VERSION 2
-
 class CCachedDirectory
 {
 public:
@@ -54,8 +55,11 @@ public:
 	void RefreshStatus(bool bRecursive);
 private:
 	void RefreshMostImportant(bool bUpdateShell = true);
-	BOOL SaveToDisk(FILE * pFile);
-	BOOL LoadFromDisk(FILE * pFile);
+	void SaveToSnapshot(CStatusCacheSnapshotWriter& writer, const CString& key);
+	/// only the status of the directory itself is read, its members are read on first access
+	void LoadFromSnapshot(const std::shared_ptr<const CStatusCacheSnapshot>& snapshot, DWORD index);
+	/// reads the members from the snapshot if not done yet, requires m_critSec
+	void MaterializeSnapshot();
 public:
 	/// Get the current full status of this folder
 	git_wc_status_kind GetCurrentFullStatus() const {return m_currentFullStatus;}
@@ -104,6 +108,10 @@ private:
 	git_wc_status_kind m_mostImportantFileStatus = git_wc_status_none;
 
 	bool m_bRecursive = true;		// used in the status callback
+
+	// set as long as m_entryCache and m_childDirectories were not read from the status cache file
+	std::shared_ptr<const CStatusCacheSnapshot> m_pSnapshot;
+	DWORD m_iSnapshotIndex = 0;
 	friend class CGitStatusCache;
 };
 
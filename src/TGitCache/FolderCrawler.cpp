@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005-2008,2011,2014 - TortoiseSVN
-// Copyright (C) 2008-2014, 2016-2019, 2021, 2023 - TortoiseGit
+// Copyright (C) 2008-2014, 2016-2019, 2021, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -24,6 +24,7 @@
 #include "registry.h"
 #include "TGitCache.h"
 #include <ShlObj.h>
+#include <thread>
 
 CFolderCrawler::CFolderCrawler()
 {
@@ -43,68 +44,102 @@ void CFolderCrawler::Stop()
 	if (m_hTerminationEvent)
 	{
 		SetEvent(m_hTerminationEvent);
-		if (m_hThread.IsValid() && WaitForSingleObject(m_hThread, 4000) != WAIT_OBJECT_0)
-			CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Error terminating crawler thread\n");
+		std::vector<HANDLE> threads;
+		for (const auto& hThread : m_hThreads)
+		{
+			if (hThread.IsValid())
+				threads.push_back(hThread);
+		}
+		if (!threads.empty() && WaitForMultipleObjects(static_cast<DWORD>(threads.size()), threads.data(), TRUE, 4000) == WAIT_TIMEOUT)
+			CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Error terminating crawler threads\n");
 	}
-	m_hThread.CloseHandle();
+	m_hThreads.clear();
 	m_hTerminationEvent.CloseHandle();
 	m_hWakeEvent.CloseHandle();
 }
 
+DWORD CFolderCrawler::GetWorkerCount()
+{
+	DWORD count = CRegStdDWORD(L"Software\\TortoiseGit\\TGitCacheCrawlerThreads", 0);
+	if (count == 0)
+	{
+		// crawling is mostly disk bound, so don't use up all cores by default
+		count = std::clamp(std::thread::hardware_concurrency() / 2, 1U, 4U);
+	}
+	// WaitForMultipleObjects() in Stop() can't handle more handles
+	return std::min(count, static_cast<DWORD>(MAXIMUM_WAIT_OBJECTS));
+}
+
 void CFolderCrawler::Initialise()
 {
 	// Don't call Initialize more than once
-	ATLASSERT(!m_hThread);
+	ATLASSERT(m_hThreads.empty());
 
-	// Just start the worker thread.
-	// It will wait for event being signaled.
-	// If m_hWakeEvent is already signaled the worker thread
+	// Just start the worker threads.
+	// They will wait for event being signaled.
+	// If m_hWakeEvent is already signaled a worker thread
 	// will behave properly (with normal priority at worst).
 
 	m_bRun = true;
-	unsigned int threadId;
-	m_hThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, ThreadEntry, this, 0, &threadId));
-	SetThreadPriority(m_hThread, THREAD_PRIORITY_BELOW_NORMAL);
+	const DWORD workers = GetWorkerCount();
+	for (DWORD i = 0; i < workers; ++i)
+	{
+		unsigned int threadId;
+		CAutoGeneralHandle hThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, ThreadEntry, this, 0, &threadId));
+		if (!hThread)
+			break;
+		SetThreadPriority(hThread, THREAD_PRIORITY_BELOW_NORMAL);
+		m_hThreads.push_back(std::move(hThread));
+	}
+	CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": started %d crawler threads\n", static_cast<int>(m_hThreads.size()));
 }
 
-void CFolderCrawler::AddDirectoryForUpdate(const CTGitPath& path)
+void CFolderCrawler::PushPath(const CString& repoKey, const CTGitPath& path, bool bFolder)
 {
-	/* Index file changing*/
-	if (GitStatus::IsExistIndexLockFile(path.GetWinPathString()))
-		return;
-
-	if (!CGitStatusCache::Instance().IsPathGood(path))
-		return;
 	{
-		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": AddDirectoryForUpdate %s\n", path.GetWinPath());
-
 		AutoLocker lock(m_critSec);
 
-		m_foldersToUpdate.Push(path);
+		auto& queue = m_repositoryQueues[repoKey];
+		if (bFolder)
+		{
+			queue.m_foldersToUpdate.Push(path);
 
-		//ATLASSERT(path.IsDirectory() || !path.Exists());
-		// set this flag while we are sync'ed
-		// with the worker thread
-		m_bItemsAddedSinceLastCrawl = true;
+			//ATLASSERT(path.IsDirectory() || !path.Exists());
+			// set this flag while we are sync'ed
+			// with the worker threads
+			queue.m_bItemsAddedSinceLastCrawl = true;
+		}
+		else
+			queue.m_pathsToUpdate.Push(path);
 	}
 	//if (SetHoldoff())
 		SetEvent(m_hWakeEvent);
 }
 
-void CFolderCrawler::AddPathForUpdate(const CTGitPath& path)
+void CFolderCrawler::AddDirectoryForUpdate(const CTGitPath& path)
 {
 	/* Index file changing*/
-	if (GitStatus::IsExistIndexLockFile(path.GetWinPathString()))
+	CString repoKey;
+	if (GitStatus::IsExistIndexLockFile(path.GetWinPathString(), &repoKey))
 		return;
 
-	{
-		AutoLocker lock(m_critSec);
+	if (!CGitStatusCache::Instance().IsPathGood(path))
+		return;
 
-		m_pathsToUpdate.Push(path);
-		m_bPathsAddedSinceLastCrawl = true;
-	}
-	//if (SetHoldoff())
-		SetEvent(m_hWakeEvent);
+	CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": AddDirectoryForUpdate %s\n", path.GetWinPath());
+	repoKey.MakeLower();
+	PushPath(repoKey, path, true);
+}
+
+void CFolderCrawler::AddPathForUpdate(const CTGitPath& path)
+{
+	/* Index file changing*/
+	CString repoKey;
+	if (GitStatus::IsExistIndexLockFile(path.GetWinPathString(), &repoKey))
+		return;
+
+	repoKey.MakeLower();
+	PushPath(repoKey, path, false);
 }
 
 void CFolderCrawler::ReleasePathForUpdate(const CTGitPath& path)
@@ -116,6 +151,90 @@ void CFolderCrawler::ReleasePathForUpdate(const CTGitPath& path)
 	SetEvent(m_hWakeEvent);
 }
 
+size_t CFolderCrawler::RequeuePath(const CString& repoKey, const CTGitPath& path)
+{
+	AutoLocker lock(m_critSec);
+	auto& queue = m_repositoryQueues[repoKey];
+	return queue.m_pathsToUpdate.Push(path);
+}
+
+CFolderCrawler::NextItem CFolderCrawler::GetNextItem(CString& repoKey, CTGitPath& path, bool& bFolder)
+{
+	AutoLocker lock(m_critSec);
+
+	if ((m_blockReleasesAt < GetTickCount64()) && (!m_blockedPath.IsEmpty()))
+	{
+		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Crawl stop blocking path %s\n", m_blockedPath.GetWinPath());
+		m_blockedPath.Reset();
+	}
+
+	// first try the repository this worker crawled last, then steal from the others round-robin
+	auto candidate = m_repositoryQueues.find(repoKey);
+	auto next = m_repositoryQueues.upper_bound(m_lastStolenKey);
+	bool bBlocked = false;
+	for (size_t i = 0; i <= m_repositoryQueues.size(); ++i)
+	{
+		if (i > 0)
+		{
+			if (next == m_repositoryQueues.end())
+				next = m_repositoryQueues.begin();
+			candidate = next++;
+		}
+		if (candidate == m_repositoryQueues.end() || candidate->second.m_bBusy)
+			continue;
+
+		auto& queue = candidate->second;
+		if (queue.m_foldersToUpdate.empty() && queue.m_pathsToUpdate.empty())
+			continue;
+
+		bFolder = queue.m_pathsToUpdate.empty() || (queue.m_bFolderNext && !queue.m_foldersToUpdate.empty());
+		auto& items = bFolder ? queue.m_foldersToUpdate : queue.m_pathsToUpdate;
+		if (bFolder)
+		{
+			queue.m_bItemsAddedSinceLastCrawl = false;
+
+			// create a new CTGitPath object to make sure the cached flags are requested again.
+			// without this, a missing file/folder is still treated as missing even if it is available
+			// now when crawling.
+			path = CTGitPath(items.Pop().GetWinPath());
+		}
+		else
+			path = items.Pop();
+		queue.m_bFolderNext = !bFolder;
+
+		if ((!m_blockedPath.IsEmpty()) && (m_blockedPath.IsAncestorOf(path)))
+		{
+			// move the path to the end of the list
+			items.Push(path);
+			bBlocked = true;
+			continue;
+		}
+
+		queue.m_bBusy = true;
+		if (i > 0)
+			m_lastStolenKey = candidate->first;
+		repoKey = candidate->first;
+
+		// wake up another worker if there is work left for it
+		if (std::any_of(m_repositoryQueues.cbegin(), m_repositoryQueues.cend(), [](const auto& entry) { return !entry.second.m_bBusy && !(entry.second.m_foldersToUpdate.empty() && entry.second.m_pathsToUpdate.empty()); }))
+			SetEvent(m_hWakeEvent);
+		return NextItem::Found;
+	}
+	return bBlocked ? NextItem::Blocked : NextItem::None;
+}
+
+void CFolderCrawler::FinishItem(const CString& repoKey)
+{
+	AutoLocker lock(m_critSec);
+	auto it = m_repositoryQueues.find(repoKey);
+	if (it == m_repositoryQueues.end())
+		return;
+
+	it->second.m_bBusy = false;
+	if (it->second.m_foldersToUpdate.empty() && it->second.m_pathsToUpdate.empty())
+		m_repositoryQueues.erase(it);
+}
+
 unsigned int CFolderCrawler::ThreadEntry(void* pContext)
 {
 	reinterpret_cast<CFolderCrawler*>(pContext)->WorkerThread();
@@ -127,8 +246,7 @@ void CFolderCrawler::WorkerThread()
 	HANDLE hWaitHandles[2];
 	hWaitHandles[0] = m_hTerminationEvent;
 	hWaitHandles[1] = m_hWakeEvent;
-	CTGitPath workingPath;
-	ULONGLONG currentTicks = 0;
+	CString repoKey;
 
 	for(;;)
 	{
@@ -161,8 +279,12 @@ void CFolderCrawler::WorkerThread()
 			if (CGitStatusCache::Instance().m_bClearMemory)
 			{
 				CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
-				CGitStatusCache::Instance().ClearCache();
-				CGitStatusCache::Instance().m_bClearMemory = false;
+				// another worker might have been faster
+				if (CGitStatusCache::Instance().m_bClearMemory)
+				{
+					CGitStatusCache::Instance().ClearCache();
+					CGitStatusCache::Instance().m_bClearMemory = false;
+				}
 			}
 			if(m_lCrawlInhibitSet > 0)
 			{
@@ -178,265 +300,241 @@ void CFolderCrawler::WorkerThread()
 				bFirstRunAfterWakeup = false;
 				continue;
 			}
-			if ((m_blockReleasesAt < GetTickCount64()) && (!m_blockedPath.IsEmpty()))
-			{
-				CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Crawl stop blocking path %s\n", m_blockedPath.GetWinPath());
-				m_blockedPath.Reset();
-			}
 			CGitStatusCache::Instance().RemoveTimedoutBlocks();
 
-			while (!m_pathsToRelease.empty())
+			for (;;)
 			{
-				AutoLocker lock(m_critSec);
-				CTGitPath path = m_pathsToRelease.Pop();
+				CTGitPath path;
+				{
+					AutoLocker lock(m_critSec);
+					if (m_pathsToRelease.empty())
+						break;
+					path = m_pathsToRelease.Pop();
+				}
 				GitStatus::ReleasePath(path.GetWinPathString());
 			}
 
-			if (m_foldersToUpdate.empty() && m_pathsToUpdate.empty())
+			CTGitPath workingPath;
+			bool bFolder = false;
+			const NextItem next = GetNextItem(repoKey, workingPath, bFolder);
+			if (next == NextItem::None)
 			{
-				// Nothing left to do
+				// Nothing left to do, or all remaining repositories are crawled by other workers
 				break;
 			}
-			currentTicks = GetTickCount64();
-			if (!m_pathsToUpdate.empty())
+			if (next == NextItem::Blocked)
 			{
-				{
-					AutoLocker lock(m_critSec);
-
-					m_bPathsAddedSinceLastCrawl = false;
+				Sleep(50);
+				continue;
+			}
 
-					workingPath = m_pathsToUpdate.Pop();
-					if ((!m_blockedPath.IsEmpty()) && (m_blockedPath.IsAncestorOf(workingPath)))
-					{
-						// move the path to the end of the list
-						m_pathsToUpdate.Push(workingPath);
-						if (m_pathsToUpdate.size() < 3)
-							Sleep(50);
-						continue;
-					}
-				}
+			if (bFolder)
+				CrawlFolder(repoKey, workingPath, bRecursive);
+			else
+				CrawlPath(repoKey, workingPath, bRecursive);
+			FinishItem(repoKey);
+		}
+	}
+	_endthread();
+}
 
-				// don't crawl paths that are excluded
-				if (!CGitStatusCache::Instance().IsPathAllowed(workingPath))
-					continue;
-				// check if the changed path is inside an .git folder
-				CString projectroot;
-				if ((workingPath.HasAdminDir(&projectroot)&&workingPath.IsDirectory()) || workingPath.IsAdminDir())
-				{
-					// we don't crawl for paths changed in a tmp folder inside an .git folder.
-					// Because we also get notifications for those even if we just ask for the status!
-					// And changes there don't affect the file status at all, so it's safe
-					// to ignore notifications on those paths.
-					if (workingPath.IsAdminDir())
-					{
-						// TODO: add git specific filters here. is there really any change besides index file in .git
-						//       that is relevant for overlays?
-						/*CString lowerpath = workingPath.GetWinPathString();
-						lowerpath.MakeLower();
-						if (lowerpath.Find(L"\\tmp\\") > 0)
-							continue;
-						if (CStringUtils::EndsWith(lowerpath, L"\\tmp"))
-							continue;
-						if (lowerpath.Find(L"\\log") > 0)
-							continue;*/
-						// Here's a little problem:
-						// the lock file is also created for fetching the status
-						// and not just when committing.
-						// If we could find out why the lock file was changed
-						// we could decide to crawl the folder again or not.
-						// But for now, we have to crawl the parent folder
-						// no matter what.
-
-						//if (lowerpath.Find(L"\\lock") > 0)
-						//	continue;
-						// only go back to wc root if we are in .git-dir
-						do
-						{
-							workingPath = workingPath.GetContainingDirectory();
-						} while(workingPath.IsAdminDir());
-					}
-					else if (!workingPath.Exists())
-					{
-						CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
-						CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
-						continue;
-					}
+void CFolderCrawler::CrawlPath(const CString& repoKey, CTGitPath workingPath, bool bRecursive)
+{
+	// don't crawl paths that are excluded
+	if (!CGitStatusCache::Instance().IsPathAllowed(workingPath))
+		return;
+	// check if the changed path is inside an .git folder
+	CString projectroot;
+	if ((workingPath.HasAdminDir(&projectroot)&&workingPath.IsDirectory()) || workingPath.IsAdminDir())
+	{
+		// we don't crawl for paths changed in a tmp folder inside an .git folder.
+		// Because we also get notifications for those even if we just ask for the status!
+		// And changes there don't affect the file status at all, so it's safe
+		// to ignore notifications on those paths.
+		if (workingPath.IsAdminDir())
+		{
+			// TODO: add git specific filters here. is there really any change besides index file in .git
+			//       that is relevant for overlays?
+			/*CString lowerpath = workingPath.GetWinPathString();
+			lowerpath.MakeLower();
+			if (lowerpath.Find(L"\\tmp\\") > 0)
+				return;
+			if (CStringUtils::EndsWith(lowerpath, L"\\tmp"))
+				return;
+			if (lowerpath.Find(L"\\log") > 0)
+				return;*/
+			// Here's a little problem:
+			// the lock file is also created for fetching the status
+			// and not just when committing.
+			// If we could find out why the lock file was changed
+			// we could decide to crawl the folder again or not.
+			// But for now, we have to crawl the parent folder
+			// no matter what.
+
+			//if (lowerpath.Find(L"\\lock") > 0)
+			//	return;
+			// only go back to wc root if we are in .git-dir
+			do
+			{
+				workingPath = workingPath.GetContainingDirectory();
+			} while(workingPath.IsAdminDir());
+		}
+		else if (!workingPath.Exists())
+		{
+			CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
+			CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
+			return;
+		}
 
-					if (!CGitStatusCache::Instance().IsPathGood(workingPath))
-					{
-						AutoLocker lock(m_critSec);
-						// move the path, the root of the repository, to the end of the list
-						if (projectroot.IsEmpty())
-							m_pathsToUpdate.Push(workingPath);
-						else
-							m_pathsToUpdate.Push(CTGitPath(projectroot));
-						if (m_pathsToUpdate.size() < 3)
-							Sleep(50);
-						continue;
-					}
+		if (!CGitStatusCache::Instance().IsPathGood(workingPath))
+		{
+			// move the path, the root of the repository, to the end of the list
+			if (RequeuePath(repoKey, projectroot.IsEmpty() ? workingPath : CTGitPath(projectroot)) < 3)
+				Sleep(50);
+			return;
+		}
 
-					CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Invalidating and refreshing folder: %s\n", workingPath.GetWinPath());
-					{
-						AutoLocker print(critSec);
-						_snwprintf_s(szCurrentCrawledPath[nCurrentCrawledpathIndex], MAX_CRAWLEDPATHSLEN, _TRUNCATE, L"Invalidating and refreshing folder: %s", workingPath.GetWinPath());
-						++nCurrentCrawledpathIndex;
-						if (nCurrentCrawledpathIndex >= MAX_CRAWLEDPATHS)
-							nCurrentCrawledpathIndex = 0;
-					}
-					InvalidateRect(hWndHidden, nullptr, FALSE);
-					{
-						CAutoReadLock readLock(CGitStatusCache::Instance().GetGuard());
-						// Invalidate the cache of this folder, to make sure its status is fetched again.
-						CCachedDirectory * pCachedDir = CGitStatusCache::Instance().GetDirectoryCacheEntry(workingPath);
-						if (pCachedDir)
-						{
-							git_wc_status_kind status = pCachedDir->GetCurrentFullStatus();
-							pCachedDir->Invalidate();
-							if (workingPath.Exists())
-							{
-								pCachedDir->RefreshStatus(bRecursive);
-								// if the previous status wasn't normal and now it is, then
-								// send a notification too.
-								// We do this here because GetCurrentFullStatus() doesn't send
-								// notifications for 'normal' status - if it would, we'd get tons
-								// of notifications when crawling a working copy not yet in the cache.
-								if ((status != git_wc_status_normal) && (pCachedDir->GetCurrentFullStatus() != status))
-								{
-									CGitStatusCache::Instance().UpdateShell(workingPath);
-									CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": shell update in crawler for %s\n", workingPath.GetWinPath());
-								}
-							}
-							else
-							{
-								CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
-								CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
-							}
-						}
-					}
-					//In case that svn_client_stat() modified a file and we got
-					//a notification about that in the directory watcher,
-					//remove that here again - this is to prevent an endless loop
-					AutoLocker lock(m_critSec);
-					m_pathsToUpdate.erase(workingPath);
-				}
-				else if (workingPath.HasAdminDir())
+		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Invalidating and refreshing folder: %s\n", workingPath.GetWinPath());
+		{
+			AutoLocker print(critSec);
+			_snwprintf_s(szCurrentCrawledPath[nCurrentCrawledpathIndex], MAX_CRAWLEDPATHSLEN, _TRUNCATE, L"Invalidating and refreshing folder: %s", workingPath.GetWinPath());
+			++nCurrentCrawledpathIndex;
+			if (nCurrentCrawledpathIndex >= MAX_CRAWLEDPATHS)
+				nCurrentCrawledpathIndex = 0;
+		}
+		InvalidateRect(hWndHidden, nullptr, FALSE);
+		{
+			CAutoReadLock readLock(CGitStatusCache::Instance().GetGuard());
+			// Invalidate the cache of this folder, to make sure its status is fetched again.
+			CCachedDirectory * pCachedDir = CGitStatusCache::Instance().GetDirectoryCacheEntry(workingPath);
+			if (pCachedDir)
+			{
+				git_wc_status_kind status = pCachedDir->GetCurrentFullStatus();
+				pCachedDir->Invalidate();
+				if (workingPath.Exists())
 				{
-					if (!workingPath.Exists())
-					{
-						CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
-						CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
-						if (!workingPath.GetContainingDirectory().Exists())
-							continue;
-						else
-							workingPath = workingPath.GetContainingDirectory();
-					}
-					CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Updating path: %s\n", workingPath.GetWinPath());
-					{
-						AutoLocker print(critSec);
-						_snwprintf_s(szCurrentCrawledPath[nCurrentCrawledpathIndex], MAX_CRAWLEDPATHSLEN, _TRUNCATE, L"Updating path: %s", workingPath.GetWinPath());
-						++nCurrentCrawledpathIndex;
-						if (nCurrentCrawledpathIndex >= MAX_CRAWLEDPATHS)
-							nCurrentCrawledpathIndex = 0;
-					}
-					InvalidateRect(hWndHidden, nullptr, FALSE);
+					pCachedDir->RefreshStatus(bRecursive);
+					// if the previous status wasn't normal and now it is, then
+					// send a notification too.
+					// We do this here because GetCurrentFullStatus() doesn't send
+					// notifications for 'normal' status - if it would, we'd get tons
+					// of notifications when crawling a working copy not yet in the cache.
+					if ((status != git_wc_status_normal) && (pCachedDir->GetCurrentFullStatus() != status))
 					{
-						CAutoReadLock readLock(CGitStatusCache::Instance().GetGuard());
-						// Invalidate the cache of folders manually. The cache of files is invalidated
-						// automatically if the status is asked for it and the file times don't match
-						// anymore, so we don't need to manually invalidate those.
-						CCachedDirectory* cachedDir = CGitStatusCache::Instance().GetDirectoryCacheEntry(workingPath.GetDirectory());
-						if (cachedDir && workingPath.IsDirectory())
-							cachedDir->Invalidate();
-						if (cachedDir && cachedDir->GetStatusForMember(workingPath, bRecursive).GetEffectiveStatus() > git_wc_status_unversioned)
-							CGitStatusCache::Instance().UpdateShell(workingPath);
+						CGitStatusCache::Instance().UpdateShell(workingPath);
+						CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": shell update in crawler for %s\n", workingPath.GetWinPath());
 					}
-					AutoLocker lock(m_critSec);
-					m_pathsToUpdate.erase(workingPath);
 				}
 				else
 				{
-					if (!workingPath.Exists())
-					{
-						CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
-						CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
-					}
+					CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
+					CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
 				}
 			}
-			if (!m_foldersToUpdate.empty())
-			{
-				{
-					AutoLocker lock(m_critSec);
-					m_bItemsAddedSinceLastCrawl = false;
-
-					// create a new CTGitPath object to make sure the cached flags are requested again.
-					// without this, a missing file/folder is still treated as missing even if it is available
-					// now when crawling.
-					workingPath = CTGitPath(m_foldersToUpdate.Pop().GetWinPath());
+		}
+		//In case that svn_client_stat() modified a file and we got
+		//a notification about that in the directory watcher,
+		//remove that here again - this is to prevent an endless loop
+		AutoLocker lock(m_critSec);
+		if (auto it = m_repositoryQueues.find(repoKey); it != m_repositoryQueues.end())
+			it->second.m_pathsToUpdate.erase(workingPath);
+	}
+	else if (workingPath.HasAdminDir())
+	{
+		if (!workingPath.Exists())
+		{
+			CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
+			CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
+			if (!workingPath.GetContainingDirectory().Exists())
+				return;
+			else
+				workingPath = workingPath.GetContainingDirectory();
+		}
+		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Updating path: %s\n", workingPath.GetWinPath());
+		{
+			AutoLocker print(critSec);
+			_snwprintf_s(szCurrentCrawledPath[nCurrentCrawledpathIndex], MAX_CRAWLEDPATHSLEN, _TRUNCATE, L"Updating path: %s", workingPath.GetWinPath());
+			++nCurrentCrawledpathIndex;
+			if (nCurrentCrawledpathIndex >= MAX_CRAWLEDPATHS)
+				nCurrentCrawledpathIndex = 0;
+		}
+		InvalidateRect(hWndHidden, nullptr, FALSE);
+		{
+			CAutoReadLock readLock(CGitStatusCache::Instance().GetGuard());
+			// Invalidate the cache of folders manually. The cache of files is invalidated
+			// automatically if the status is asked for it and the file times don't match
+			// anymore, so we don't need to manually invalidate those.
+			CCachedDirectory* cachedDir = CGitStatusCache::Instance().GetDirectoryCacheEntry(workingPath.GetDirectory());
+			if (cachedDir && workingPath.IsDirectory())
+				cachedDir->Invalidate();
+			if (cachedDir && cachedDir->GetStatusForMember(workingPath, bRecursive).GetEffectiveStatus() > git_wc_status_unversioned)
+				CGitStatusCache::Instance().UpdateShell(workingPath);
+		}
+		AutoLocker lock(m_critSec);
+		if (auto it = m_repositoryQueues.find(repoKey); it != m_repositoryQueues.end())
+			it->second.m_pathsToUpdate.erase(workingPath);
+	}
+	else
+	{
+		if (!workingPath.Exists())
+		{
+			CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
+			CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
+		}
+	}
+}
 
-					if ((!m_blockedPath.IsEmpty())&&(m_blockedPath.IsAncestorOf(workingPath)))
-					{
-						// move the path to the end of the list
-						m_foldersToUpdate.Push(workingPath);
-						if (m_foldersToUpdate.size() < 3)
-							Sleep(50);
-						continue;
-					}
-				}
-				if ((!m_blockedPath.IsEmpty())&&(m_blockedPath.IsAncestorOf(workingPath)))
-					continue;
-				if (!CGitStatusCache::Instance().IsPathAllowed(workingPath))
-					continue;
-				if (!CGitStatusCache::Instance().IsPathGood(workingPath))
-					continue;
-
-				CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Crawling folder: %s\n", workingPath.GetWinPath());
-				{
-					AutoLocker print(critSec);
-					_snwprintf_s(szCurrentCrawledPath[nCurrentCrawledpathIndex], MAX_CRAWLEDPATHSLEN, _TRUNCATE, L"Crawling folder: %s", workingPath.GetWinPath());
-					++nCurrentCrawledpathIndex;
-					if (nCurrentCrawledpathIndex >= MAX_CRAWLEDPATHS)
-						nCurrentCrawledpathIndex = 0;
-				}
-				InvalidateRect(hWndHidden, nullptr, FALSE);
-				{
-					CAutoReadLock readLock(CGitStatusCache::Instance().GetGuard());
-					// Now, we need to visit this folder, to make sure that we know its 'most important' status
-					CCachedDirectory * cachedDir = CGitStatusCache::Instance().GetDirectoryCacheEntry(workingPath.GetDirectory());
-					// check if the path is monitored by the watcher. If it isn't, then we have to invalidate the cache
-					// for that path and add it to the watcher.
-					if (!CGitStatusCache::Instance().IsPathWatched(workingPath))
-					{
-						if (workingPath.HasAdminDir())
-						{
-							CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Add watch path %s\n", workingPath.GetWinPath());
-							CGitStatusCache::Instance().AddPathToWatch(workingPath);
-						}
-						if (cachedDir)
-							cachedDir->Invalidate();
-						else
-						{
-							CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
-							CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
-							// now cacheDir is invalid because it got deleted in the RemoveCacheForPath() call above.
-							cachedDir = nullptr;
-						}
-					}
-					if (cachedDir)
-						cachedDir->RefreshStatus(bRecursive);
-				}
+void CFolderCrawler::CrawlFolder(const CString& repoKey, const CTGitPath& workingPath, bool bRecursive)
+{
+	if (!CGitStatusCache::Instance().IsPathAllowed(workingPath))
+		return;
+	if (!CGitStatusCache::Instance().IsPathGood(workingPath))
+		return;
 
-				// While refreshing the status, we could get another crawl request for the same folder.
-				// This can happen if the crawled folder has a lower status than one of the child folders
-				// (recursively). To avoid double crawlings, remove such a crawl request here
-				AutoLocker lock(m_critSec);
-				if (m_bItemsAddedSinceLastCrawl)
-				{
-					m_foldersToUpdate.erase(workingPath);
-				}
+	CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Crawling folder: %s\n", workingPath.GetWinPath());
+	{
+		AutoLocker print(critSec);
+		_snwprintf_s(szCurrentCrawledPath[nCurrentCrawledpathIndex], MAX_CRAWLEDPATHSLEN, _TRUNCATE, L"Crawling folder: %s", workingPath.GetWinPath());
+		++nCurrentCrawledpathIndex;
+		if (nCurrentCrawledpathIndex >= MAX_CRAWLEDPATHS)
+			nCurrentCrawledpathIndex = 0;
+	}
+	InvalidateRect(hWndHidden, nullptr, FALSE);
+	{
+		CAutoReadLock readLock(CGitStatusCache::Instance().GetGuard());
+		// Now, we need to visit this folder, to make sure that we know its 'most important' status
+		CCachedDirectory * cachedDir = CGitStatusCache::Instance().GetDirectoryCacheEntry(workingPath.GetDirectory());
+		// check if the path is monitored by the watcher. If it isn't, then we have to invalidate the cache
+		// for that path and add it to the watcher.
+		if (!CGitStatusCache::Instance().IsPathWatched(workingPath))
+		{
+			if (workingPath.HasAdminDir())
+			{
+				CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": Add watch path %s\n", workingPath.GetWinPath());
+				CGitStatusCache::Instance().AddPathToWatch(workingPath);
+			}
+			if (cachedDir)
+				cachedDir->Invalidate();
+			else
+			{
+				CAutoWriteLock writeLock(CGitStatusCache::Instance().GetGuard());
+				CGitStatusCache::Instance().RemoveCacheForPath(workingPath);
+				// now cacheDir is invalid because it got deleted in the RemoveCacheForPath() call above.
+				cachedDir = nullptr;
 			}
 		}
+		if (cachedDir)
+			cachedDir->RefreshStatus(bRecursive);
+	}
+
+	// While refreshing the status, we could get another crawl request for the same folder.
+	// This can happen if the crawled folder has a lower status than one of the child folders
+	// (recursively). To avoid double crawlings, remove such a crawl request here
+	AutoLocker lock(m_critSec);
+	if (auto it = m_repositoryQueues.find(repoKey); it != m_repositoryQueues.end() && it->second.m_bItemsAddedSinceLastCrawl)
+	{
+		it->second.m_foldersToUpdate.erase(workingPath);
 	}
-	_endthread();
 }
 
 bool CFolderCrawler::SetHoldoff(DWORD milliseconds /* = 100*/)
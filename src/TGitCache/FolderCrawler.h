@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005-2007, 2009-2011, 2014 TortoiseSVN
-// Copyright (C) 2008-2012, 2023 - TortoiseGit
+// Copyright (C) 2008-2012, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -24,16 +24,38 @@
 #include "SmartHandle.h"
 #include "UniqueQueue.h"
 #include <set>
+#include <map>
 //////////////////////////////////////////////////////////////////////////
 
+/**
+ * \ingroup TGitCache
+ * Hashes paths for UniqueQueue. The ordering of CTGitPath ignores the case of
+ * ASCII characters (CStringUtils::FastCompareNoCase()), so the hash has to do so, too.
+ */
+template <>
+struct UniqueQueueHash<CTGitPath>
+{
+	size_t operator()(const CTGitPath& path) const noexcept
+	{
+		size_t hash = 0;
+		for (const wchar_t c : std::wstring_view(path.GetWinPathString(), path.GetWinPathString().GetLength()))
+			hash = hash * 131 + ((c >= L'A' && c <= L'Z') ? c + (L'a' - L'A') : c);
+		return hash;
+	}
+};
+
 
 
 #pragma pack(push, r1, 16)
 
 /**
  * \ingroup TGitCache
- * Helper class to crawl folders in the background (in a separate thread)
+ * Helper class to crawl folders in the background (in a pool of worker threads)
  * so that the main cache isn't blocked until all the status are fetched.
+ * Every repository has its own queue which is only worked on by one worker
+ * at a time, so the items of a repository are crawled in order. A worker
+ * sticks to the repository it crawled last and steals work from the other
+ * repositories if that one has nothing left to do.
  */
 class CFolderCrawler
 {
@@ -50,14 +72,43 @@ public:
 	bool SetHoldoff(DWORD milliseconds = 100);
 	void BlockPath(const CTGitPath& path, DWORD ticks = 0);
 private:
+	struct SRepositoryQueue
+	{
+		UniqueQueue<CTGitPath> m_foldersToUpdate;
+		UniqueQueue<CTGitPath> m_pathsToUpdate;
+		bool m_bItemsAddedSinceLastCrawl = false;
+		bool m_bFolderNext = false; // alternate between paths and folders
+		bool m_bBusy = false; // a worker is crawling an item of this repository
+	};
+
+	enum class NextItem
+	{
+		None,
+		Blocked,
+		Found,
+	};
+
 	static unsigned int __stdcall ThreadEntry(void* pContext);
 	void WorkerThread();
+	static DWORD GetWorkerCount();
+	void PushPath(const CString& repoKey, const CTGitPath& path, bool bFolder);
+	size_t RequeuePath(const CString& repoKey, const CTGitPath& path);
+	/**
+	 * Takes the next item to crawl and marks its repository busy.
+	 * \param repoKey in: the repository the worker crawled last and prefers, out: the repository of the item
+	 */
+	NextItem GetNextItem(CString& repoKey, CTGitPath& path, bool& bFolder);
+	void FinishItem(const CString& repoKey);
+	void CrawlPath(const CString& repoKey, CTGitPath workingPath, bool bRecursive);
+	void CrawlFolder(const CString& repoKey, const CTGitPath& workingPath, bool bRecursive);
 
 private:
 	CComAutoCriticalSection m_critSec;
-	CAutoGeneralHandle m_hThread;
-	UniqueQueue<CTGitPath> m_foldersToUpdate;
-	UniqueQueue<CTGitPath> m_pathsToUpdate;
+	std::vector<CAutoGeneralHandle> m_hThreads;
+	// key is the lowercase root of the working tree, empty for paths outside of a working tree
+	std::map<CString, SRepositoryQueue> m_repositoryQueues;
+	// the repository a worker stole work from last, used to steal round-robin
+	CString m_lastStolenKey;
 	UniqueQueue<CTGitPath> m_pathsToRelease;
 
 	CAutoGeneralHandle m_hTerminationEvent;
@@ -73,8 +124,6 @@ private:
 	// every shell request, and stops us crawling until
 	// a bit of quiet time has elapsed
 	LONGLONG m_crawlHoldoffReleasesAt;
-	bool m_bItemsAddedSinceLastCrawl = false;
-	bool m_bPathsAddedSinceLastCrawl = false;
 
 	CTGitPath m_blockedPath;
 	ULONGLONG m_blockReleasesAt = 0;
@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005-2006,2008,2010,2014 - TortoiseSVN
-// Copyright (C) 2008-2019, 2021, 2023 - TortoiseGit
+// Copyright (C) 2008-2019, 2021, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -23,6 +23,7 @@
 #include "GitStatus.h"
 #include "GitStatusCache.h"
 #include "CacheInterface.h"
+#include "StatusCacheSnapshot.h"
 #include <ShlObj.h>
 #include "PathUtils.h"
 
@@ -31,8 +32,6 @@
 #define BLOCK_PATH_DEFAULT_TIMEOUT	600		// 10 minutes
 #define BLOCK_PATH_MAX_TIMEOUT		1200	// 20 minutes
 
-#define CACHEDISKVERSION 2
-
 #ifdef _WIN64
 #define STATUSCACHEFILENAME L"cache64"
 #else
@@ -57,93 +56,52 @@ void CGitStatusCache::Create()
 	if (!CRegStdDWORD(L"Software\\TortoiseGit\\CacheSave", TRUE))
 		return;
 
-#define LOADVALUEFROMFILE(x) if (fread(&x, sizeof(x), 1, pFile)!=1) goto exit;
-#define LOADVALUEFROMFILE2(x) if (fread(&x, sizeof(x), 1, pFile)!=1) goto error;
-	unsigned int value = (unsigned int)-1;
 	// find the location of the cache
 	CString path = CPathUtils::GetLocalAppDataDirectory();
-	CString path2;
-	if (!path.IsEmpty())
+	if (path.IsEmpty())
+		return;
+	path += STATUSCACHEFILENAME;
+	// in case the cache file is unusable, we could run into problems every time
+	// we start up. Therefore, the file is moved away and deleted once it is mapped,
+	// so that we start from scratch the next time if we do not get to save the cache.
+	// The file content stays available as long as it is mapped.
+	CString path2 = path + L'2';
+	DeleteFile(path2);
+	if (!MoveFileEx(path, path2, MOVEFILE_REPLACE_EXISTING))
+		return;
+	auto snapshot = CStatusCacheSnapshot::Open(path2);
+	DeleteFile(path2);
+	if (!snapshot)
 	{
-		path += STATUSCACHEFILENAME;
-		// in case the cache file is corrupt, we could crash while
-		// reading it! To prevent crashing every time once that happens,
-		// we make a copy of the cache file and use that copy to read from.
-		// if that copy is corrupt, the original file won't exist anymore
-		// and the second time we start up and try to read the file,
-		// it's not there anymore and we start from scratch without a crash.
-		path2 = path;
-		path2 += L'2';
-		DeleteFile(path2);
-		CopyFile(path, path2, FALSE);
-		DeleteFile(path);
-		CAutoFILE pFile = _wfsopen(path2, L"rb", _SH_DENYWR);
-		if (pFile)
-		{
-			try
-			{
-				LOADVALUEFROMFILE(value);
-				if (value != CACHEDISKVERSION)
-				{
-					goto error;
-				}
-				int mapsize = 0;
-				LOADVALUEFROMFILE(mapsize);
-				for (int i=0; i<mapsize; ++i)
-				{
-					LOADVALUEFROMFILE2(value);
-					if (value > MAX_PATH)
-						goto error;
-					if (value)
-					{
-						CString sKey;
-						if (fread(sKey.GetBuffer(value+1), sizeof(wchar_t), value, pFile) != value)
-						{
-							sKey.ReleaseBuffer(0);
-							goto error;
-						}
-						sKey.ReleaseBuffer(value);
-						auto cacheddir = std::make_unique<CCachedDirectory>();
-						if (!cacheddir.get() || !cacheddir->LoadFromDisk(pFile))
-						{
-							cacheddir.reset();
-							goto error;
-						}
-						CTGitPath KeyPath = CTGitPath(sKey);
-						if (m_pInstance->IsPathAllowed(KeyPath))
-						{
-							// only add the path to the watch list if it is versioned
-							if ((cacheddir->GetCurrentFullStatus() != git_wc_status_unversioned)&&(cacheddir->GetCurrentFullStatus() != git_wc_status_none))
-								m_pInstance->watcher.AddPath(KeyPath, false);
-
-							m_pInstance->m_directoryCache[KeyPath] = cacheddir.release();
-
-							// do *not* add the paths for crawling!
-							// because crawled paths will trigger a shell
-							// notification, which makes the desktop flash constantly
-							// until the whole first time crawling is over
-							// m_pInstance->AddFolderForCrawling(KeyPath);
-						}
-					}
-				}
-			}
-			catch (CAtlException)
-			{
-				goto error;
-			}
-		}
+		CTraceToOutputDebugString::Instance()(__FUNCTION__ ": cache not loaded from disk\n");
+		return;
+	}
+
+	// only the directories themselves are created here, their members are read from the mapped file on first access
+	for (DWORD i = 0; i < snapshot->GetDirectoryCount(); ++i)
+	{
+		CTGitPath KeyPath = CTGitPath(snapshot->GetCString(snapshot->GetDirectory(i).m_Key));
+		if (!m_pInstance->IsPathAllowed(KeyPath))
+			continue;
+
+		auto cacheddir = std::make_unique<CCachedDirectory>();
+		cacheddir->LoadFromSnapshot(snapshot, i);
+		// only add the path to the watch list if it is versioned
+		if ((cacheddir->GetCurrentFullStatus() != git_wc_status_unversioned) && (cacheddir->GetCurrentFullStatus() != git_wc_status_none))
+			m_pInstance->watcher.AddPath(KeyPath, false);
+
+		auto& entry = m_pInstance->m_directoryCache[KeyPath];
+		delete entry;
+		entry = cacheddir.release();
+
+		// do *not* add the paths for crawling!
+		// because crawled paths will trigger a shell
+		// notification, which makes the desktop flash constantly
+		// until the whole first time crawling is over
+		// m_pInstance->AddFolderForCrawling(KeyPath);
 	}
-exit:
-	DeleteFile(path2);
 	m_pInstance->watcher.ClearInfoMap();
 	CTraceToOutputDebugString::Instance()(__FUNCTION__ ": cache loaded from disk successfully!\n");
-	return;
-error:
-	DeleteFile(path2);
-	m_pInstance->watcher.ClearInfoMap();
-	Destroy();
-	m_pInstance = new CGitStatusCache;
-	CTraceToOutputDebugString::Instance()(__FUNCTION__ ": cache not loaded from disk\n");
 }
 
 bool CGitStatusCache::SaveCache()
@@ -151,47 +109,36 @@ bool CGitStatusCache::SaveCache()
 	if (!CRegStdDWORD(L"Software\\TortoiseGit\\CacheSave", TRUE))
 		return false;
 
-#define WRITEVALUETOFILE(x) if (fwrite(&x, sizeof(x), 1, pFile)!=1) goto error;
 	// save the cache to disk
 	// find a location to write the cache to
 	CString path = CPathUtils::GetLocalAppDataDirectory();
-	if (!path.IsEmpty())
+	if (path.IsEmpty())
+		return false;
+	path += STATUSCACHEFILENAME;
+
+	CStatusCacheSnapshotWriter writer;
+	try
 	{
-		path += STATUSCACHEFILENAME;
-		CAutoFILE pFile = _wfsopen(path, L"wb", SH_DENYRW);
-		if (pFile)
+		for (const auto& [key, cacheddir] : m_pInstance->m_directoryCache)
 		{
-			unsigned int value = CACHEDISKVERSION;
-			WRITEVALUETOFILE(value);
-			value = static_cast<int>(m_pInstance->m_directoryCache.size());
-			WRITEVALUETOFILE(value);
-			for (auto I = m_pInstance->m_directoryCache.cbegin(); I != m_pInstance->m_directoryCache.cend(); ++I)
-			{
-				if (!I->second)
-				{
-					value = 0;
-					WRITEVALUETOFILE(value);
-					continue;
-				}
-				const CString& key = I->first.GetWinPathString();
-				value = key.GetLength();
-				WRITEVALUETOFILE(value);
-				if (value)
-				{
-					if (fwrite(static_cast<LPCWSTR>(key), sizeof(wchar_t), value, pFile) != value)
-						goto error;
-					if (!I->second->SaveToDisk(pFile))
-						goto error;
-				}
-			}
+			if (!cacheddir || key.GetWinPathString().IsEmpty())
+				continue;
+			cacheddir->SaveToSnapshot(writer, key.GetWinPathString());
 		}
 	}
+	catch (const std::bad_alloc&)
+	{
+		Destroy();
+		return false;
+	}
+	if (!writer.Write(path))
+	{
+		Destroy();
+		DeleteFile(path);
+		return false;
+	}
 	CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": cache saved to disk at %s\n", static_cast<LPCWSTR>(path));
 	return true;
-error:
-	Destroy();
-	DeleteFile(path);
-	return false;
 }
 
 void CGitStatusCache::Destroy()
@@ -376,6 +323,10 @@ bool CGitStatusCache::RemoveCacheForDirectory(CCachedDirectory* cdir, const CTGi
 		return false;
 
 	CAutoWriteLock writeLock(m_guard);
+	{
+		AutoLocker lock(cdir->m_critSec);
+		cdir->MaterializeSnapshot();
+	}
 	if (!cdir->m_childDirectories.empty())
 	{
 		for (auto it = cdir->m_childDirectories.begin(); it != cdir->m_childDirectories.end();)
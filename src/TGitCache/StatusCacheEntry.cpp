@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005-2006,2008,2014 - TortoiseSVN
-// Copyright (C) 2008-2014, 2016-2017, 2019, 2023 - TortoiseGit
+// Copyright (C) 2008-2014, 2016-2017, 2019, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -22,8 +22,7 @@
 #include "GitStatus.h"
 #include "CacheInterface.h"
 #include "registry.h"
-
-#define CACHEVERION 8
+#include "StatusCacheSnapshot.h"
 
 ULONGLONG cachetimeout = static_cast<ULONGLONG>(CRegStdDWORD(L"Software\\TortoiseGit\\Cachetimeout", LONG_MAX));
 
@@ -51,47 +50,28 @@ CStatusCacheEntry::CStatusCacheEntry(const git_wc_status2_t* pGitStatus, __int64
 		m_discardAtTime = GetTickCount64() + cachetimeout;
 }
 
-bool CStatusCacheEntry::SaveToDisk(FILE* pFile) const
+void CStatusCacheEntry::SaveToSnapshot(SStatusCacheSnapshotStatus& status) const
 {
-#define WRITEVALUETOFILE(x) if (fwrite(&x, sizeof(x), 1, pFile)!=1) return false;
-#define WRITESTRINGTOFILE(x) if (x.IsEmpty()) {value=0;WRITEVALUETOFILE(value);}else{value=x.GetLength();WRITEVALUETOFILE(value);if (fwrite(static_cast<LPCSTR>(x), sizeof(char), value, pFile)!=value) return false;}
-
-	unsigned int value = CACHEVERION;
-	WRITEVALUETOFILE(value); // 'version' of this save-format
-	WRITEVALUETOFILE(m_highestPriorityLocalStatus);
-	WRITEVALUETOFILE(m_lastWriteTime);
-	WRITEVALUETOFILE(m_bSet);
-
-	// now save the status struct (without the entry field, because we don't use that)
-	WRITEVALUETOFILE(m_GitStatus.status);
-	WRITEVALUETOFILE(m_GitStatus.assumeValid);
-	WRITEVALUETOFILE(m_GitStatus.skipWorktree);
-	return true;
+	status.m_HighestPriorityLocalStatus = m_highestPriorityLocalStatus;
+	status.m_LastWriteTime = m_lastWriteTime;
+	status.m_bSet = m_bSet;
+
+	// only the status struct (without the entry field, because we don't use that)
+	status.m_Status = m_GitStatus.status;
+	status.m_bAssumeValid = m_GitStatus.assumeValid;
+	status.m_bSkipWorktree = m_GitStatus.skipWorktree;
 }
 
-bool CStatusCacheEntry::LoadFromDisk(FILE * pFile)
+void CStatusCacheEntry::LoadFromSnapshot(const SStatusCacheSnapshotStatus& status)
 {
-#define LOADVALUEFROMFILE(x) if (fread(&x, sizeof(x), 1, pFile)!=1) return false;
-	try
-	{
-		unsigned int value = 0;
-		LOADVALUEFROMFILE(value);
-		if (value != CACHEVERION)
-			return false;		// not the correct version
-		LOADVALUEFROMFILE(m_highestPriorityLocalStatus);
-		LOADVALUEFROMFILE(m_lastWriteTime);
-		LOADVALUEFROMFILE(m_bSet);
-		SecureZeroMemory(&m_GitStatus, sizeof(m_GitStatus));
-		LOADVALUEFROMFILE(m_GitStatus.status);
-		LOADVALUEFROMFILE(m_GitStatus.assumeValid);
-		LOADVALUEFROMFILE(m_GitStatus.skipWorktree);
-		m_discardAtTime = GetTickCount64() + cachetimeout;
-	}
-	catch ( CAtlException )
-	{
-		return false;
-	}
-	return true;
+	m_highestPriorityLocalStatus = static_cast<git_wc_status_kind>(status.m_HighestPriorityLocalStatus);
+	m_lastWriteTime = status.m_LastWriteTime;
+	m_bSet = !!status.m_bSet;
+	SecureZeroMemory(&m_GitStatus, sizeof(m_GitStatus));
+	m_GitStatus.status = static_cast<git_wc_status_kind>(status.m_Status);
+	m_GitStatus.assumeValid = !!status.m_bAssumeValid;
+	m_GitStatus.skipWorktree = !!status.m_bSkipWorktree;
+	m_discardAtTime = GetTickCount64() + cachetimeout;
 }
 
 void CStatusCacheEntry::SetStatus(const git_wc_status2_t* pGitStatus)
@@ -1,7 +1,7 @@
 // TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005 - 2006 - Will Dean, Stefan Kueng
-// Copyright (C) 2008-2012, 2017, 2023 - TortoiseGit
+// Copyright (C) 2008-2012, 2017, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -20,6 +20,7 @@
 #pragma once
 
 struct TGITCacheResponse;
+struct SStatusCacheSnapshotStatus;
 extern ULONGLONG cachetimeout;
 
 #include "CacheInterface.h"
@@ -43,8 +44,8 @@ public:
 	void SetStatus(const git_wc_status2_t* pGitStatus);
 	bool HasBeenSet() const;
 	void Invalidate();
-	bool SaveToDisk(FILE* pFile) const;
-	bool LoadFromDisk(FILE * pFile);
+	void SaveToSnapshot(SStatusCacheSnapshotStatus& status) const;
+	void LoadFromSnapshot(const SStatusCacheSnapshotStatus& status);
 private:
 	void SetAsUnversioned();
 
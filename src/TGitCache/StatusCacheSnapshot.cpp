@@ -0,0 +1,260 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "stdafx.h"
+#include "StatusCacheSnapshot.h"
+
+#define SNAPSHOT_PAGE_SIZE 4096ULL
+
+static ULONGLONG AlignToPage(ULONGLONG offset)
+{
+	return (offset + SNAPSHOT_PAGE_SIZE - 1) & ~(SNAPSHOT_PAGE_SIZE - 1);
+}
+
+// FNV-1a over 64 bit words, the file size is always a multiple of 8
+static ULONGLONG CalculateChecksum(const BYTE* data, size_t length)
+{
+	ATLASSERT(length % sizeof(ULONGLONG) == 0);
+	ULONGLONG hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < length; i += sizeof(ULONGLONG))
+	{
+		ULONGLONG word;
+		memcpy(&word, data + i, sizeof(word));
+		hash ^= word;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+std::shared_ptr<const CStatusCacheSnapshot> CStatusCacheSnapshot::Open(const CString& file)
+{
+	// no FILE_SHARE_WRITE, the content must not change while it is mapped; the file may be deleted, though
+	std::shared_ptr<CStatusCacheSnapshot> snapshot(new CStatusCacheSnapshot);
+	snapshot->m_hFile = ::CreateFile(file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (!snapshot->m_hFile)
+		return nullptr;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(snapshot->m_hFile, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(SNAPSHOT_PAGE_SIZE) || static_cast<ULONGLONG>(fileSize.QuadPart) >= SIZE_T_MAX)
+		return nullptr;
+
+	snapshot->m_hMapping = ::CreateFileMapping(snapshot->m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!snapshot->m_hMapping)
+		return nullptr;
+
+	snapshot->m_pView = MapViewOfFile(snapshot->m_hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!snapshot->m_pView)
+		return nullptr;
+
+	if (!snapshot->Validate(static_cast<ULONGLONG>(fileSize.QuadPart)))
+	{
+		CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": discarding invalid status cache %s\n", static_cast<LPCWSTR>(file));
+		return nullptr;
+	}
+
+	return snapshot;
+}
+
+bool CStatusCacheSnapshot::Validate(ULONGLONG fileSize)
+{
+	auto base = static_cast<const BYTE*>(static_cast<PVOID>(m_pView));
+	m_pHeader = reinterpret_cast<const SStatusCacheSnapshotHeader*>(base);
+	if (m_pHeader->m_Magic != STATUSCACHESNAPSHOT_MAGIC || m_pHeader->m_Version != STATUSCACHESNAPSHOT_VERSION)
+		return false;
+	if (m_pHeader->m_DirectoryRecordSize != sizeof(SStatusCacheSnapshotDirectory) || m_pHeader->m_EntryRecordSize != sizeof(SStatusCacheSnapshotEntry) || m_pHeader->m_ChildRecordSize != sizeof(SStatusCacheSnapshotChild))
+		return false;
+	if (m_pHeader->m_FileSize != fileSize || fileSize % sizeof(ULONGLONG) != 0)
+		return false;
+
+	// the sections follow each other in this order, each of them page aligned
+	const ULONGLONG sections[][2] = {
+		{ m_pHeader->m_DirectoryOffset, static_cast<ULONGLONG>(m_pHeader->m_DirectoryCount) * sizeof(SStatusCacheSnapshotDirectory) },
+		{ m_pHeader->m_EntryOffset, static_cast<ULONGLONG>(m_pHeader->m_EntryCount) * sizeof(SStatusCacheSnapshotEntry) },
+		{ m_pHeader->m_ChildOffset, static_cast<ULONGLONG>(m_pHeader->m_ChildCount) * sizeof(SStatusCacheSnapshotChild) },
+		{ m_pHeader->m_StringOffset, static_cast<ULONGLONG>(m_pHeader->m_StringLength) * sizeof(wchar_t) },
+	};
+	ULONGLONG end = SNAPSHOT_PAGE_SIZE;
+	for (const auto& section : sections)
+	{
+		if (section[0] != AlignToPage(end) || section[1] > fileSize - section[0])
+			return false;
+		end = section[0] + section[1];
+	}
+	if (fileSize - end >= sizeof(ULONGLONG))
+		return false;
+
+	if (CalculateChecksum(base + SNAPSHOT_PAGE_SIZE, static_cast<size_t>(fileSize - SNAPSHOT_PAGE_SIZE)) != m_pHeader->m_Checksum)
+		return false;
+
+	m_pDirectories = reinterpret_cast<const SStatusCacheSnapshotDirectory*>(base + m_pHeader->m_DirectoryOffset);
+	m_pEntries = reinterpret_cast<const SStatusCacheSnapshotEntry*>(base + m_pHeader->m_EntryOffset);
+	m_pChildren = reinterpret_cast<const SStatusCacheSnapshotChild*>(base + m_pHeader->m_ChildOffset);
+	m_pStrings = reinterpret_cast<const wchar_t*>(base + m_pHeader->m_StringOffset);
+
+	// check all references once, so that the records can be used later on without any further checks
+	for (DWORD i = 0; i < m_pHeader->m_DirectoryCount; ++i)
+	{
+		const auto& dir = m_pDirectories[i];
+		if (dir.m_FirstEntry > m_pHeader->m_EntryCount || dir.m_EntryCount > m_pHeader->m_EntryCount - dir.m_FirstEntry)
+			return false;
+		if (dir.m_FirstChild > m_pHeader->m_ChildCount || dir.m_ChildCount > m_pHeader->m_ChildCount - dir.m_FirstChild)
+			return false;
+		if (!IsValidString(dir.m_Key) || !IsValidString(dir.m_Path) || dir.m_Key.m_Length == 0 || dir.m_Key.m_Length > MAX_PATH || dir.m_Path.m_Length > MAX_PATH)
+			return false;
+	}
+	for (DWORD i = 0; i < m_pHeader->m_EntryCount; ++i)
+	{
+		if (!IsValidString(m_pEntries[i].m_Name) || m_pEntries[i].m_Name.m_Length > MAX_PATH)
+			return false;
+	}
+	for (DWORD i = 0; i < m_pHeader->m_ChildCount; ++i)
+	{
+		if (!IsValidString(m_pChildren[i].m_Path) || m_pChildren[i].m_Path.m_Length > MAX_PATH)
+			return false;
+	}
+
+	return true;
+}
+
+bool CStatusCacheSnapshot::IsValidString(const SStatusCacheSnapshotString& str) const
+{
+	return str.m_Offset < m_pHeader->m_StringLength && str.m_Length < m_pHeader->m_StringLength - str.m_Offset && m_pStrings[str.m_Offset + str.m_Length] == L'\0';
+}
+
+SStatusCacheSnapshotString CStatusCacheSnapshotWriter::AddString(LPCWSTR str, int length)
+{
+	if (static_cast<DWORD>(length) == m_LastString.m_Length && !m_Strings.empty() && wmemcmp(m_Strings.data() + m_LastString.m_Offset, str, length) == 0)
+		return m_LastString;
+
+	m_LastString.m_Offset = static_cast<DWORD>(m_Strings.size());
+	m_LastString.m_Length = static_cast<DWORD>(length);
+	m_Strings.insert(m_Strings.end(), str, str + length);
+	m_Strings.push_back(L'\0');
+	return m_LastString;
+}
+
+SStatusCacheSnapshotDirectory& CStatusCacheSnapshotWriter::AddDirectory()
+{
+	auto& dir = m_Directories.emplace_back();
+	SecureZeroMemory(&dir, sizeof(dir));
+	dir.m_FirstEntry = static_cast<DWORD>(m_Entries.size());
+	dir.m_FirstChild = static_cast<DWORD>(m_Children.size());
+	return dir;
+}
+
+SStatusCacheSnapshotEntry& CStatusCacheSnapshotWriter::AddEntry()
+{
+	ATLASSERT(!m_Directories.empty());
+	++m_Directories.back().m_EntryCount;
+	auto& entry = m_Entries.emplace_back();
+	SecureZeroMemory(&entry, sizeof(entry));
+	return entry;
+}
+
+SStatusCacheSnapshotChild& CStatusCacheSnapshotWriter::AddChild()
+{
+	ATLASSERT(!m_Directories.empty());
+	++m_Directories.back().m_ChildCount;
+	auto& child = m_Children.emplace_back();
+	SecureZeroMemory(&child, sizeof(child));
+	return child;
+}
+
+bool CStatusCacheSnapshotWriter::Write(const CString& file) const
+{
+	if (m_Directories.size() >= MAXDWORD || m_Entries.size() >= MAXDWORD || m_Children.size() >= MAXDWORD || m_Strings.size() >= MAXDWORD)
+		return false;
+
+	SStatusCacheSnapshotHeader header;
+	SecureZeroMemory(&header, sizeof(header));
+	header.m_Magic = STATUSCACHESNAPSHOT_MAGIC;
+	header.m_Version = STATUSCACHESNAPSHOT_VERSION;
+	header.m_DirectoryRecordSize = sizeof(SStatusCacheSnapshotDirectory);
+	header.m_EntryRecordSize = sizeof(SStatusCacheSnapshotEntry);
+	header.m_ChildRecordSize = sizeof(SStatusCacheSnapshotChild);
+	header.m_DirectoryCount = static_cast<DWORD>(m_Directories.size());
+	header.m_EntryCount = static_cast<DWORD>(m_Entries.size());
+	header.m_ChildCount = static_cast<DWORD>(m_Children.size());
+	header.m_StringLength = static_cast<DWORD>(m_Strings.size());
+
+	const std::pair<const void*, ULONGLONG> sections[] = {
+		{ m_Directories.data(), m_Directories.size() * sizeof(SStatusCacheSnapshotDirectory) },
+		{ m_Entries.data(), m_Entries.size() * sizeof(SStatusCacheSnapshotEntry) },
+		{ m_Children.data(), m_Children.size() * sizeof(SStatusCacheSnapshotChild) },
+		{ m_Strings.data(), m_Strings.size() * sizeof(wchar_t) },
+	};
+	ULONGLONG* offsets[] = { &header.m_DirectoryOffset, &header.m_EntryOffset, &header.m_ChildOffset, &header.m_StringOffset };
+
+	// build the content after the header in memory, that's needed for the checksum anyway
+	std::vector<BYTE> content;
+	ULONGLONG end = SNAPSHOT_PAGE_SIZE;
+	try
+	{
+		for (size_t i = 0; i < _countof(sections); ++i)
+		{
+			*offsets[i] = AlignToPage(end);
+			end = *offsets[i] + sections[i].second;
+		}
+		header.m_FileSize = (end + sizeof(ULONGLONG) - 1) & ~(sizeof(ULONGLONG) - 1);
+		if (header.m_FileSize >= SIZE_T_MAX)
+			return false;
+		content.resize(static_cast<size_t>(header.m_FileSize - SNAPSHOT_PAGE_SIZE));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < _countof(sections); ++i)
+	{
+		if (sections[i].second)
+			memcpy(content.data() + (*offsets[i] - SNAPSHOT_PAGE_SIZE), sections[i].first, static_cast<size_t>(sections[i].second));
+	}
+	header.m_Checksum = CalculateChecksum(content.data(), content.size());
+
+	BYTE headerPage[SNAPSHOT_PAGE_SIZE] = { 0 };
+	memcpy(headerPage, &header, sizeof(header));
+
+	const CString tempFile = file + L".tmp";
+	{
+		CAutoFile hFile = ::CreateFile(tempFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (!hFile)
+			return false;
+
+		DWORD written = 0;
+		bool ok = WriteFile(hFile, headerPage, sizeof(headerPage), &written, nullptr) && written == sizeof(headerPage);
+		// write in chunks, WriteFile takes a DWORD
+		for (size_t pos = 0; ok && pos < content.size(); pos += written)
+		{
+			const DWORD chunk = static_cast<DWORD>(min(content.size() - pos, static_cast<size_t>(64 * 1024 * 1024)));
+			ok = WriteFile(hFile, content.data() + pos, chunk, &written, nullptr) && written == chunk;
+		}
+		if (!ok)
+		{
+			hFile.CloseHandle();
+			::DeleteFile(tempFile);
+			return false;
+		}
+	}
+
+	if (!MoveFileEx(tempFile, file, MOVEFILE_REPLACE_EXISTING))
+	{
+		::DeleteFile(tempFile);
+		return false;
+	}
+	return true;
+}
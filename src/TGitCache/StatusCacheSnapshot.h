@@ -0,0 +1,159 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+#include "SmartHandle.h"
+
+#define STATUSCACHESNAPSHOT_MAGIC	0x43534754 // "TGSC"
+#define STATUSCACHESNAPSHOT_VERSION	1
+
+/*
+ * Layout of the status cache file:
+ * - header (one page)
+ * - directory records, entry records, child directory records and the string pool,
+ *   each section starts at a page boundary
+ * All records have a fixed size, strings are stored NUL terminated in the pool and
+ * referenced by offset and length (in wchar_t). The checksum covers everything after
+ * the header, so that a corrupt file can be discarded before any record is used.
+ */
+
+struct SStatusCacheSnapshotString
+{
+	DWORD		m_Offset;
+	DWORD		m_Length;
+};
+
+struct SStatusCacheSnapshotStatus
+{
+	__int64		m_LastWriteTime;
+	int32_t		m_HighestPriorityLocalStatus;
+	int32_t		m_Status;
+	BYTE		m_bSet;
+	BYTE		m_bAssumeValid;
+	BYTE		m_bSkipWorktree;
+	BYTE		m_Reserved[5];
+};
+
+struct SStatusCacheSnapshotDirectory
+{
+	SStatusCacheSnapshotString	m_Key;
+	SStatusCacheSnapshotString	m_Path;
+	DWORD						m_FirstEntry;
+	DWORD						m_EntryCount;
+	DWORD						m_FirstChild;
+	DWORD						m_ChildCount;
+	SStatusCacheSnapshotStatus	m_OwnStatus;
+	int32_t						m_CurrentFullStatus;
+	int32_t						m_MostImportantFileStatus;
+};
+
+struct SStatusCacheSnapshotEntry
+{
+	SStatusCacheSnapshotString	m_Name;
+	SStatusCacheSnapshotStatus	m_Status;
+};
+
+struct SStatusCacheSnapshotChild
+{
+	SStatusCacheSnapshotString	m_Path;
+	int32_t						m_Status;
+};
+
+struct SStatusCacheSnapshotHeader
+{
+	DWORD		m_Magic;
+	DWORD		m_Version;
+	DWORD		m_DirectoryRecordSize;
+	DWORD		m_EntryRecordSize;
+	DWORD		m_ChildRecordSize;
+	DWORD		m_DirectoryCount;
+	DWORD		m_EntryCount;
+	DWORD		m_ChildCount;
+	DWORD		m_StringLength;
+	DWORD		m_Reserved;
+	ULONGLONG	m_DirectoryOffset;
+	ULONGLONG	m_EntryOffset;
+	ULONGLONG	m_ChildOffset;
+	ULONGLONG	m_StringOffset;
+	ULONGLONG	m_FileSize;
+	ULONGLONG	m_Checksum;
+};
+
+/**
+ * \ingroup TGitCache
+ * A read-only, memory mapped status cache file.
+ * CCachedDirectory objects keep a reference on it until they have materialized their
+ * file entries, so the file stays mapped as long as it is needed.
+ */
+class CStatusCacheSnapshot
+{
+public:
+	/**
+	 * Maps and validates the snapshot file.
+	 * \return nullptr if the file does not exist, is of another version or is corrupt
+	 */
+	static std::shared_ptr<const CStatusCacheSnapshot> Open(const CString& file);
+
+	DWORD GetDirectoryCount() const { return m_pHeader->m_DirectoryCount; }
+	const SStatusCacheSnapshotDirectory& GetDirectory(DWORD index) const { return m_pDirectories[index]; }
+	const SStatusCacheSnapshotEntry* GetEntries(const SStatusCacheSnapshotDirectory& dir) const { return m_pEntries + dir.m_FirstEntry; }
+	const SStatusCacheSnapshotChild* GetChildren(const SStatusCacheSnapshotDirectory& dir) const { return m_pChildren + dir.m_FirstChild; }
+	LPCWSTR GetString(const SStatusCacheSnapshotString& str) const { return m_pStrings + str.m_Offset; }
+	CString GetCString(const SStatusCacheSnapshotString& str) const { return CString(m_pStrings + str.m_Offset, str.m_Length); }
+
+private:
+	CStatusCacheSnapshot() = default;
+	bool Validate(ULONGLONG fileSize);
+	bool IsValidString(const SStatusCacheSnapshotString& str) const;
+
+	CAutoFile							m_hFile;
+	CAutoGeneralHandle					m_hMapping;
+	CAutoViewOfFile						m_pView;
+	const SStatusCacheSnapshotHeader*	m_pHeader = nullptr;
+	const SStatusCacheSnapshotDirectory*	m_pDirectories = nullptr;
+	const SStatusCacheSnapshotEntry*	m_pEntries = nullptr;
+	const SStatusCacheSnapshotChild*	m_pChildren = nullptr;
+	const wchar_t*						m_pStrings = nullptr;
+};
+
+/**
+ * \ingroup TGitCache
+ * Collects the records of all cached directories and writes them as one snapshot file.
+ */
+class CStatusCacheSnapshotWriter
+{
+public:
+	SStatusCacheSnapshotString AddString(LPCWSTR str, int length);
+	SStatusCacheSnapshotString AddString(const CString& str) { return AddString(str, str.GetLength()); }
+
+	/// the entries and children of a directory have to be added directly after the directory
+	SStatusCacheSnapshotDirectory& AddDirectory();
+	SStatusCacheSnapshotEntry& AddEntry();
+	SStatusCacheSnapshotChild& AddChild();
+
+	/// writes to a temporary file first, which replaces the file only if everything could be written
+	bool Write(const CString& file) const;
+
+private:
+	std::vector<SStatusCacheSnapshotDirectory>	m_Directories;
+	std::vector<SStatusCacheSnapshotEntry>		m_Entries;
+	std::vector<SStatusCacheSnapshotChild>		m_Children;
+	std::vector<wchar_t>						m_Strings;
+	// directory key and path are mostly equal, so remember the last string
+	SStatusCacheSnapshotString					m_LastString = { 0, 0 };
+};
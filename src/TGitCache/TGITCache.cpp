@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // External Cache Copyright (C) 2005 - 2006,2010 - Will Dean, Stefan Kueng
-// Copyright (C) 2008-2014, 2016-2022 - TortoiseGit
+// Copyright (C) 2008-2014, 2016-2022, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -471,6 +471,85 @@ VOID GetAnswerToRequest(const TGITCacheRequest* pRequest, TGITCacheResponse* pRe
 	}
 }
 
+// number of items of a batch request answered under one lock of the cache
+#define TGITCACHE_BATCH_LOCK_ITEMS 32
+
+static bool GetAnswerToBatchRequest(const BYTE* pRequest, DWORD requestLength, std::vector<TGITCacheResponse>& replies)
+{
+	TGITCacheBatchRequest header;
+	if (requestLength < sizeof(header))
+		return false;
+	memcpy(&header, pRequest, sizeof(header));
+	// sanitize request
+	header.directory[_countof(header.directory) - 1] = L'\0';
+	const DWORD flags = header.flags & TGITCACHE_FLAGS_MASK & ~(TGITCACHE_FLAGS_BATCH | TGITCACHE_FLAGS_FOLDERISKNOWN | TGITCACHE_FLAGS_ISFOLDER);
+	if (header.count > TGITCACHE_BATCH_MAX_ITEMS)
+		return false;
+
+	// parse all items first, so that malformed requests are rejected before doing any work
+	std::vector<std::pair<CString, DWORD>> items;
+	items.reserve(header.count);
+	const CString directory = CString(header.directory).TrimRight(L'\\');
+	DWORD pos = sizeof(header);
+	for (DWORD i = 0; i < header.count; ++i)
+	{
+		WORD itemHeader[2];
+		if (requestLength - pos < sizeof(itemHeader))
+			return false;
+		memcpy(itemHeader, pRequest + pos, sizeof(itemHeader));
+		pos += sizeof(itemHeader);
+		const DWORD nameBytes = itemHeader[1] * sizeof(wchar_t);
+		if (itemHeader[1] == 0 || itemHeader[1] >= MAX_PATH || requestLength - pos < nameBytes)
+			return false;
+		CString path = directory;
+		path += L'\\';
+		path.Append(reinterpret_cast<const wchar_t*>(pRequest + pos), itemHeader[1]);
+		pos += nameBytes;
+		items.emplace_back(path, flags | (itemHeader[0] & (TGITCACHE_FLAGS_FOLDERISKNOWN | TGITCACHE_FLAGS_ISFOLDER)));
+	}
+
+	replies.resize(items.size());
+	DWORD responseLength;
+	CStatusCacheEntry none;
+	if (!bRun)
+	{
+		for (auto& reply : replies)
+			none.BuildCacheResponse(reply, responseLength);
+		return true;
+	}
+
+	CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": app asked for status of %u items in %s\n", header.count, header.directory);
+	// the lock is taken for a few items at a time only, so that the crawler and the watcher are not blocked for the whole batch
+	for (size_t chunkStart = 0; chunkStart < items.size(); chunkStart += TGITCACHE_BATCH_LOCK_ITEMS)
+	{
+		const size_t chunkEnd = min(items.size(), chunkStart + TGITCACHE_BATCH_LOCK_ITEMS);
+		CAutoReadWeakLock readLock(CGitStatusCache::Instance().GetGuard(), 2000);
+		if (!readLock.IsAcquired())
+		{
+			CTraceToOutputDebugString::Instance()(_T(__FUNCTION__) L": timeout for asked status of %u items in %s\n", header.count, header.directory);
+			for (size_t i = chunkStart; i < replies.size(); ++i)
+				none.BuildCacheResponse(replies[i], responseLength);
+			break;
+		}
+
+		for (size_t i = chunkStart; i < chunkEnd; ++i)
+		{
+			CTGitPath path;
+			if (items[i].first.GetLength() >= MAX_PATH)
+			{
+				none.BuildCacheResponse(replies[i], responseLength);
+				continue;
+			}
+			if (items[i].second & TGITCACHE_FLAGS_FOLDERISKNOWN)
+				path.SetFromWin(items[i].first, !!(items[i].second & TGITCACHE_FLAGS_ISFOLDER));
+			else
+				path.SetFromWin(items[i].first);
+			CGitStatusCache::Instance().GetStatusForPath(path, items[i].second).BuildCacheResponse(replies[i], responseLength);
+		}
+	}
+	return true;
+}
+
 DWORD WINAPI ExplorerMonitorThread(LPVOID lpvParam)
 {
 	auto bThreadRun = static_cast<bool*>(lpvParam);
@@ -739,20 +818,23 @@ DWORD WINAPI InstanceThread(LPVOID lpvParam)
 {
 	CTraceToOutputDebugString::Instance()(__FUNCTION__ ": InstanceThread started\n");
 	TGITCacheResponse response;
+	std::vector<TGITCacheResponse> batchResponse;
 	DWORD cbBytesRead, cbWritten;
 
 	// The thread's parameter is a handle to a pipe instance.
 	CAutoFile hPipe(std::move(lpvParam));
 
+	// large enough for single requests as well as batch requests
+	auto requestBuffer = std::make_unique<BYTE[]>(TGITCACHE_BATCH_MAX_REQUEST_SIZE);
+
 	InterlockedIncrement(&nThreadCount);
 	while (bRun)
 	{
 		// Read client requests from the pipe.
-		TGITCacheRequest request;
 		BOOL fSuccess = ReadFile(
 			hPipe,        // handle to pipe
-			&request,    // buffer to receive data
-			sizeof(request), // size of buffer
+			requestBuffer.get(),    // buffer to receive data
+			TGITCACHE_BATCH_MAX_REQUEST_SIZE, // size of buffer
 			&cbBytesRead, // number of bytes read
 			nullptr);        // not overlapped I/O
 
@@ -765,17 +847,41 @@ DWORD WINAPI InstanceThread(LPVOID lpvParam)
 			return 1;
 		}
 
-		// sanitize request
-		request.path[_countof(request.path) - 1] = L'\0';
-		request.flags &= TGITCACHE_FLAGS_MASK;
+		DWORD requestFlags = 0;
+		if (cbBytesRead >= sizeof(requestFlags))
+			memcpy(&requestFlags, requestBuffer.get(), sizeof(requestFlags));
+
+		DWORD responseLength = 0;
+		const void* pResponse = &response;
+		if (requestFlags & TGITCACHE_FLAGS_BATCH)
+		{
+			if (!GetAnswerToBatchRequest(requestBuffer.get(), cbBytesRead, batchResponse))
+			{
+				DisconnectNamedPipe(hPipe);
+				CTraceToOutputDebugString::Instance()(__FUNCTION__ ": malformed batch request, Instance thread exited\n");
+				if (InterlockedDecrement(&nThreadCount) == 0)
+					PostMessage(hWndHidden, WM_CLOSE, 0, 0);
+				return 1;
+			}
+			responseLength = static_cast<DWORD>(batchResponse.size() * sizeof(TGITCacheResponse));
+			pResponse = batchResponse.data();
+		}
+		else
+		{
+			TGITCacheRequest request = { 0 };
+			memcpy(&request, requestBuffer.get(), min(static_cast<size_t>(cbBytesRead), sizeof(request)));
+
+			// sanitize request
+			request.path[_countof(request.path) - 1] = L'\0';
+			request.flags &= TGITCACHE_FLAGS_MASK;
 
-		DWORD responseLength;
-		GetAnswerToRequest(&request, &response, &responseLength);
+			GetAnswerToRequest(&request, &response, &responseLength);
+		}
 
 		// Write the reply to the pipe.
 		fSuccess = WriteFile(
 			hPipe,        // handle to pipe
-			&response,      // buffer to write from
+			pResponse,      // buffer to write from
 			responseLength, // number of bytes to write
 			&cbWritten,   // number of bytes written
 			nullptr);        // not overlapped I/O
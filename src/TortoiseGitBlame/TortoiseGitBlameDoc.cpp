@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2017, 2019-2021, 2023 - TortoiseGit
+// Copyright (C) 2008-2017, 2019-2021, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -137,8 +137,8 @@ BOOL CTortoiseGitBlameDoc::OnOpenDocument(LPCWSTR lpszPathName, CString Rev)
 			g_Git.GetConfigValue(L"doesnot.exist");
 
 			// make sure git_init() works and that .git-dir is ok, even if we open a file from another working tree
-			CAutoLocker lock(g_Git.m_critGitDllSec);
-			g_Git.ForceReInitDll();
+			CGitDllSession session;
+			session.ForceReInit();
 		}
 		catch (const char* libgiterr)
 		{
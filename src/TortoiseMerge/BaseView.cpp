@@ -1,7 +1,7 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
 // Copyright (C) 2003-2021 - TortoiseSVN
-// Copyright (C) 2011-2012, 2017-2024 TortoiseGit
+// Copyright (C) 2011-2012, 2017-2024, 2026 TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -5152,25 +5152,25 @@ void CBaseView::InsertViewData( int index, const viewdata& data )
 
 void CBaseView::RemoveViewData( int index )
 {
-	m_pState->removedlines[index] = m_pViewData->GetData(index);
+	m_pState->removedlines.Set(index, m_pViewData->GetData(index));
 	m_pViewData->RemoveData(index);
 }
 
 void CBaseView::SetViewData( int index, const viewdata& data )
 {
-	m_pState->replacedlines[index] = m_pViewData->GetData(index);
+	m_pState->replacedlines.Set(index, m_pViewData->GetData(index));
 	m_pViewData->SetData(index, data);
 }
 
 void CBaseView::SetViewState(int index, DiffState state)
 {
-	m_pState->linestates[index] = m_pViewData->GetState(index);
+	m_pState->linestates.Set(index, m_pViewData->GetState(index));
 	m_pViewData->SetState(index, state);
 }
 
 void CBaseView::SetViewLine( int index, const CString& sLine )
 {
-	m_pState->difflines[index] = m_pViewData->GetLine(index);
+	m_pState->difflines.Set(index, m_pViewData->GetLine(index));
 	m_pViewData->SetLine(index, sLine);
 }
 
@@ -5178,20 +5178,20 @@ void CBaseView::SetViewLineNumber( int index, int linenumber )
 {
 	int oldLineNumber = m_pViewData->GetLineNumber(index);
 	if (oldLineNumber != linenumber) {
-		m_pState->linelines[index] = oldLineNumber;
+		m_pState->linelines.Set(index, oldLineNumber);
 		m_pViewData->SetLineNumber(index, linenumber);
 	}
 }
 
 void CBaseView::SetViewLineEnding( int index, EOL ending )
 {
-	m_pState->linesEOL[index] = m_pViewData->GetLineEnding(index);
+	m_pState->linesEOL.Set(index, m_pViewData->GetLineEnding(index));
 	m_pViewData->SetLineEnding(index, ending);
 }
 
 void CBaseView::SetViewMarked( int index, bool marked )
 {
-	m_pState->markedlines[index] = m_pViewData->GetMarked(index);
+	m_pState->markedlines.Set(index, m_pViewData->GetMarked(index));
 	m_pViewData->SetMarked(index, marked);
 }
 
@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2023 - TortoiseGit
+// Copyright (C) 2023, 2026 - TortoiseGit
 // Copyright (C) 2006-2017, 2020 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -28,6 +28,7 @@
 #include "UnicodeUtils.h"
 #include "svn_dso.h"
 #include "MovedBlocks.h"
+#include "SVNMemoryDiff.h"
 
 #pragma warning(push)
 #pragma warning(disable: 4702) // unreachable code
@@ -200,16 +201,21 @@ BOOL CDiffData::Load()
 	CRegDWORD regIgnoreEOL = CRegDWORD(L"Software\\TortoiseGitMerge\\IgnoreEOL", TRUE);
 	CRegDWORD regIgnoreCase = CRegDWORD(L"Software\\TortoiseGitMerge\\CaseInsensitive", FALSE);
 	CRegDWORD regIgnoreComments = CRegDWORD(L"Software\\TortoiseGitMerge\\IgnoreComments", FALSE);
+	CRegDWORD regInMemoryDiff = CRegDWORD(L"Software\\TortoiseGitMerge\\InMemoryDiff", TRUE);
+	CRegDWORD regHistogramDiff = CRegDWORD(L"Software\\TortoiseGitMerge\\HistogramDiff", FALSE);
 	IgnoreWS ignoreWs = static_cast<IgnoreWS>(static_cast<DWORD>(regIgnoreWS));
 	bool bIgnoreEOL = static_cast<DWORD>(regIgnoreEOL) != 0;
 	BOOL bIgnoreCase = static_cast<DWORD>(regIgnoreCase) != 0;
 	bool bIgnoreComments = static_cast<DWORD>(regIgnoreComments) != 0;
+	bool bInMemoryDiff = static_cast<DWORD>(regInMemoryDiff) != 0;
 
 	// The Subversion diff API only can ignore whitespaces and eol styles.
 	// It also can only handle one-byte charsets.
 	// To ignore case changes or to handle UTF-16 files, we have to
 	// save the original file in UTF-8 and/or the letters changed to lowercase
 	// so the Subversion diff can handle those.
+	// Unless disabled, the converted files are kept in memory instead of
+	// being written to temp files which the Subversion diff reads again.
 	CString sConvertedBaseFilename = m_baseFile.GetFilename();
 	CString sConvertedYourFilename = m_yourFile.GetFilename();
 	CString sConvertedTheirFilename = m_theirFile.GetFilename();
@@ -272,7 +278,7 @@ BOOL CDiffData::Load()
 	// convert all files we need to
 	bool bIsUtf8 = bBaseIsUtf8 || bTheirIsUtf8 || bYourIsUtf8; // any file end as UTF8
 	bBaseNeedConvert |= (IsBaseFileInUse() && !bBaseIsUtf8 && bIsUtf8);
-	if (bBaseNeedConvert)
+	if (bBaseNeedConvert && !bInMemoryDiff)
 	{
 		sConvertedBaseFilename = CTempFiles::Instance().GetTempFilePathString();
 		m_baseFile.SetConvertedFileName(sConvertedBaseFilename);
@@ -281,7 +287,7 @@ BOOL CDiffData::Load()
 						, m_rx, m_replacement);
 	}
 	bYourNeedConvert |= (IsYourFileInUse() && !bYourIsUtf8 && bIsUtf8);
-	if (bYourNeedConvert)
+	if (bYourNeedConvert && !bInMemoryDiff)
 	{
 		sConvertedYourFilename = CTempFiles::Instance().GetTempFilePathString();
 		m_yourFile.SetConvertedFileName(sConvertedYourFilename);
@@ -290,7 +296,7 @@ BOOL CDiffData::Load()
 						, m_rx, m_replacement);
 	}
 	bTheirNeedConvert |= (IsTheirFileInUse() && !bTheirIsUtf8 && bIsUtf8);
-	if (bTheirNeedConvert)
+	if (bTheirNeedConvert && !bInMemoryDiff)
 	{
 		sConvertedTheirFilename = CTempFiles::Instance().GetTempFilePathString();
 		m_theirFile.SetConvertedFileName(sConvertedTheirFilename);
@@ -299,6 +305,38 @@ BOOL CDiffData::Load()
 						, m_rx, m_replacement);
 	}
 
+	std::unique_ptr<SVNMemoryDiff> memoryDiff;
+	if (bInMemoryDiff)
+	{
+		memoryDiff = std::make_unique<SVNMemoryDiff>();
+		// only used for two-way diffs, three-way diffs always use the LCS of the Subversion diff
+		memoryDiff->SetHistogramDiff(static_cast<DWORD>(regHistogramDiff) != 0);
+		auto setDatasource = [&](svn_diff_datasource_e datasource, CFileTextLines& arFile, bool bNeedConvert)
+		{
+			std::string text;
+			std::vector<size_t> lineStarts;
+			BOOL ret = bNeedConvert
+				? arFile.GetNormalizedText(text, lineStarts, 0, bIgnoreCase, m_bBlame
+										, bIgnoreComments, m_CommentLineStart, m_CommentBlockStart, m_CommentBlockEnd
+										, m_rx, m_replacement)
+				: arFile.GetNormalizedText(text, lineStarts);
+			if (!ret)
+			{
+				m_sError = arFile.GetErrorString();
+				return false;
+			}
+			memoryDiff->SetDatasource(datasource, std::move(text), std::move(lineStarts));
+			return true;
+		};
+		// same order of the datasources as used by svn_diff_file_diff_2() and svn_diff_file_diff3_2() below
+		if (IsBaseFileInUse() && !setDatasource(svn_diff_datasource_original, m_arBaseFile, bBaseNeedConvert))
+			return FALSE;
+		if (IsTheirFileInUse() && !setDatasource(svn_diff_datasource_modified, m_arTheirFile, bTheirNeedConvert))
+			return FALSE;
+		if (IsYourFileInUse() && !setDatasource(IsTheirFileInUse() ? svn_diff_datasource_latest : svn_diff_datasource_modified, m_arYourFile, bYourNeedConvert))
+			return FALSE;
+	}
+
 	// Calculate the number of lines in the largest of the three files
 	int lengthHint = GetLineCount();
 
@@ -325,7 +363,7 @@ BOOL CDiffData::Load()
 	// Is this a two-way diff?
 	if (IsBaseFileInUse() && IsYourFileInUse() && !IsTheirFileInUse())
 	{
-		if (!DoTwoWayDiff(sConvertedBaseFilename, sConvertedYourFilename, ignoreWs, bIgnoreEOL, !!bIgnoreCase, bIgnoreComments, pool))
+		if (!DoTwoWayDiff(sConvertedBaseFilename, sConvertedYourFilename, memoryDiff.get(), ignoreWs, bIgnoreEOL, !!bIgnoreCase, bIgnoreComments, pool))
 		{
 			apr_pool_destroy (pool);                    // free the allocated memory
 			return FALSE;
@@ -342,7 +380,7 @@ BOOL CDiffData::Load()
 	{
 		m_Diff3.Reserve(lengthHint);
 
-		if (!DoThreeWayDiff(sConvertedBaseFilename, sConvertedYourFilename, sConvertedTheirFilename, ignoreWs, bIgnoreEOL, !!bIgnoreCase, bIgnoreComments, pool))
+		if (!DoThreeWayDiff(sConvertedBaseFilename, sConvertedYourFilename, sConvertedTheirFilename, memoryDiff.get(), ignoreWs, bIgnoreEOL, !!bIgnoreCase, bIgnoreComments, pool))
 		{
 			apr_pool_destroy (pool);                    // free the allocated memory
 			return FALSE;
@@ -359,15 +397,21 @@ BOOL CDiffData::Load()
 	return TRUE;
 }
 
-bool CDiffData::DoTwoWayDiff(const CString& sBaseFilename, const CString& sYourFilename, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool)
+bool CDiffData::DoTwoWayDiff(const CString& sBaseFilename, const CString& sYourFilename, SVNMemoryDiff* pMemoryDiff, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool)
 {
 	svn_diff_file_options_t* options = CreateDiffFileOptions(ignoreWs, bIgnoreEOL, pool);
-	// convert CString filenames (UTF-16 or ANSI) to UTF-8
-	CStringA sBaseFilenameUtf8 = CUnicodeUtils::GetUTF8(sBaseFilename);
-	CStringA sYourFilenameUtf8 = CUnicodeUtils::GetUTF8(sYourFilename);
 
 	svn_diff_t* diffYourBase = nullptr;
-	svn_error_t * svnerr = svn_diff_file_diff_2(&diffYourBase, sBaseFilenameUtf8, sYourFilenameUtf8, options, pool);
+	svn_error_t * svnerr = nullptr;
+	if (pMemoryDiff)
+		svnerr = pMemoryDiff->Diff(&diffYourBase, options, pool);
+	else
+	{
+		// convert CString filenames (UTF-16 or ANSI) to UTF-8
+		CStringA sBaseFilenameUtf8 = CUnicodeUtils::GetUTF8(sBaseFilename);
+		CStringA sYourFilenameUtf8 = CUnicodeUtils::GetUTF8(sYourFilename);
+		svnerr = svn_diff_file_diff_2(&diffYourBase, sBaseFilenameUtf8, sYourFilenameUtf8, options, pool);
+	}
 
 	if (svnerr)
 		return HandleSvnError(svnerr);
@@ -666,7 +710,7 @@ bool CDiffData::DoTwoWayDiff(const CString& sBaseFilename, const CString& sYourF
 	return true;
 }
 
-bool CDiffData::DoThreeWayDiff(const CString& sBaseFilename, const CString& sYourFilename, const CString& sTheirFilename, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool)
+bool CDiffData::DoThreeWayDiff(const CString& sBaseFilename, const CString& sYourFilename, const CString& sTheirFilename, SVNMemoryDiff* pMemoryDiff, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool)
 {
 	// the following three arrays are used to check for conflicts even in case the
 	// user has ignored spaces/eols.
@@ -682,13 +726,18 @@ bool CDiffData::DoThreeWayDiff(const CString& sBaseFilename, const CString& sYou
 
 	svn_diff_file_options_t* options = CreateDiffFileOptions(ignoreWs, bIgnoreEOL, pool);
 
-	// convert CString filenames (UTF-16 or ANSI) to UTF-8
-	CStringA sBaseFilenameUtf8  = CUnicodeUtils::GetUTF8(sBaseFilename);
-	CStringA sYourFilenameUtf8  = CUnicodeUtils::GetUTF8(sYourFilename);
-	CStringA sTheirFilenameUtf8 = CUnicodeUtils::GetUTF8(sTheirFilename);
-
 	svn_diff_t* diffTheirYourBase = nullptr;
-	svn_error_t * svnerr = svn_diff_file_diff3_2(&diffTheirYourBase, sBaseFilenameUtf8, sTheirFilenameUtf8, sYourFilenameUtf8, options, pool);
+	svn_error_t * svnerr = nullptr;
+	if (pMemoryDiff)
+		svnerr = pMemoryDiff->Diff3(&diffTheirYourBase, options, pool);
+	else
+	{
+		// convert CString filenames (UTF-16 or ANSI) to UTF-8
+		CStringA sBaseFilenameUtf8  = CUnicodeUtils::GetUTF8(sBaseFilename);
+		CStringA sYourFilenameUtf8  = CUnicodeUtils::GetUTF8(sYourFilename);
+		CStringA sTheirFilenameUtf8 = CUnicodeUtils::GetUTF8(sTheirFilename);
+		svnerr = svn_diff_file_diff3_2(&diffTheirYourBase, sBaseFilenameUtf8, sTheirFilenameUtf8, sYourFilenameUtf8, options, pool);
+	}
 	if (svnerr)
 		return HandleSvnError(svnerr);
 
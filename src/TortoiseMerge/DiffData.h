@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2023 - TortoiseGit
+// Copyright (C) 2023, 2026 - TortoiseGit
 // Copyright (C) 2006-2008, 2010-2014, 2020 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -29,6 +29,8 @@
 #include "ViewData.h"
 #include "MovedBlocks.h"
 
+class SVNMemoryDiff;
+
 #define DIFF_EMPTYLINENUMBER						(static_cast<DWORD>(-1))
 
 enum class IgnoreWS : int
@@ -62,10 +64,10 @@ public:
 	bool	IsYourFileInUse() const		{ return m_yourFile.InUse(); }
 
 private:
-	bool DoTwoWayDiff(const CString& sBaseFilename, const CString& sYourFilename, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool);
+	bool DoTwoWayDiff(const CString& sBaseFilename, const CString& sYourFilename, SVNMemoryDiff* pMemoryDiff, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool);
 
 	void StickAndSkip(svn_diff_t * &tempdiff, apr_off_t &original_length_sticked, apr_off_t &modified_length_sticked) const;
-	bool DoThreeWayDiff(const CString& sBaseFilename, const CString& sYourFilename, const CString& sTheirFilename, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool);
+	bool DoThreeWayDiff(const CString& sBaseFilename, const CString& sYourFilename, const CString& sTheirFilename, SVNMemoryDiff* pMemoryDiff, IgnoreWS ignoreWs, bool bIgnoreEOL, bool bIgnoreCase, bool bIgnoreComments, apr_pool_t* pool);
 	/**
 * Moved blocks detection for further highlighting,
 * implemented exclusively for TwoWayDiff
@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2016, 2019, 2021, 2023 - TortoiseGit
+// Copyright (C) 2016, 2019, 2021, 2023, 2026 - TortoiseGit
 // Copyright (C) 2007-2016, 2019 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -572,13 +572,7 @@ BOOL CFileTextLines::Save( const CString& sFilePath
 		for (int i=0; i<GetCount(); i++)
 		{
 			CString sLineT = GetAt(i);
-			if (bIgnoreComments)
-				bInBlockComment = StripComments(sLineT, bInBlockComment);
-			if (!rx._Empty())
-				LineRegex(sLineT, rx, replacement);
-			StripWhiteSpace(sLineT, dwIgnoreWhitespaces, bBlame);
-			if (bIgnoreCase)
-				sLineT = sLineT.MakeLower();
+			TransformLine(sLineT, bInBlockComment, dwIgnoreWhitespaces, bIgnoreCase, bBlame, bIgnoreComments, rx, replacement);
 			pFilter->Write(sLineT);
 			EOL eEol = GetLineEnding(i);
 			pFilter->Write(oEncodedEol[static_cast<int>(eEol)]);
@@ -594,6 +588,74 @@ BOOL CFileTextLines::Save( const CString& sFilePath
 	return TRUE;
 }
 
+BOOL CFileTextLines::GetNormalizedText(std::string& text
+						, std::vector<size_t>& lineStarts
+						, DWORD dwIgnoreWhitespaces /*= 0 */
+						, BOOL bIgnoreCase /*= FALSE */
+						, bool bBlame /*= false*/
+						, bool bIgnoreComments /*= false*/
+						, const CString& linestart /*= CString()*/
+						, const CString& blockstart /*= CString()*/
+						, const CString& blockend /*= CString()*/
+						, const std::wregex& rx /*= std::wregex()*/
+						, const std::wstring& replacement /*=L""*/)
+{
+	m_sCommentLine = linestart;
+	m_sCommentBlockStart = blockstart;
+	m_sCommentBlockEnd = blockend;
+
+	text.clear();
+	lineStarts.clear();
+	try
+	{
+		// same EOLs Save() uses with bUseSVNCompatibleEOLs
+		std::string_view eols[static_cast<int>(EOL::_COUNT)];
+		for (int nEol = 0; nEol < static_cast<int>(EOL::NoEnding); nEol++)
+			eols[nEol] = "\n";
+		eols[static_cast<int>(EOL::CR)] = "\r";
+		eols[static_cast<int>(EOL::CRLF)] = "\r\n";
+		eols[static_cast<int>(EOL::LFCR)] = "\r";
+		eols[static_cast<int>(EOL::AutoLine)] = eols[static_cast<int>(m_SaveParams.m_LineEndings == EOL::AutoLine ? EOL::CRLF : m_SaveParams.m_LineEndings)];
+
+		CUtf8Filter filter(nullptr);
+		lineStarts.reserve(GetCount() + 1);
+		bool bInBlockComment = false;
+		for (int i = 0; i < GetCount(); ++i)
+		{
+			lineStarts.push_back(text.size());
+			CString sLineT = GetAt(i);
+			TransformLine(sLineT, bInBlockComment, dwIgnoreWhitespaces, bIgnoreCase, bBlame, bIgnoreComments, rx, replacement);
+			const CBuffer& encoded = filter.Encode(sLineT);
+			text.append(static_cast<LPCSTR>(encoded), encoded.GetLength());
+			text.append(eols[static_cast<int>(GetLineEnding(i))]);
+		}
+		lineStarts.push_back(text.size());
+	}
+	catch (CException* e)
+	{
+		e->GetErrorMessage(CStrBuf(m_sErrorString, 4096), 4096);
+		e->Delete();
+		return FALSE;
+	}
+	catch (const std::bad_alloc&)
+	{
+		m_sErrorString = static_cast<LPCWSTR>(CFormatMessageWrapper(ERROR_NOT_ENOUGH_MEMORY));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void CFileTextLines::TransformLine(CString& sLine, bool& bInBlockComment, DWORD dwIgnoreWhitespaces, BOOL bIgnoreCase, bool bBlame, bool bIgnoreComments, const std::wregex& rx, const std::wstring& replacement)
+{
+	if (bIgnoreComments)
+		bInBlockComment = StripComments(sLine, bInBlockComment);
+	if (!rx._Empty())
+		LineRegex(sLine, rx, replacement);
+	StripWhiteSpace(sLine, dwIgnoreWhitespaces, bBlame);
+	if (bIgnoreCase)
+		sLine = sLine.MakeLower();
+}
+
 void CFileTextLines::SetErrorString()
 {
 	m_sErrorString = static_cast<LPCWSTR>(CFormatMessageWrapper());
@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2023 - TortoiseGit
+// Copyright (C) 2023, 2026 - TortoiseGit
 // Copyright (C) 2006-2007, 2012-2016, 2019, 2023 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -133,6 +133,23 @@ public:
 			 , const CString& blockend = CString()
 			 , const std::wregex& rx = std::wregex()
 			 , const std::wstring& replacement = L"");
+	/**
+	 * Creates the same content Save() writes with bSaveAsUTF8 and bUseSVNCompatibleEOLs,
+	 * but in memory instead of a file.
+	 * \param text receives the UTF-8 encoded lines including their EOLs
+	 * \param lineStarts receives the offset of every line in text plus the length of text as last entry
+	 */
+	BOOL GetNormalizedText(std::string& text
+			 , std::vector<size_t>& lineStarts
+			 , DWORD dwIgnoreWhitespaces = 0
+			 , BOOL bIgnoreCase = FALSE
+			 , bool bBlame = false
+			 , bool bIgnoreComments = false
+			 , const CString& linestart = CString()
+			 , const CString& blockstart = CString()
+			 , const CString& blockend = CString()
+			 , const std::wregex& rx = std::wregex()
+			 , const std::wstring& replacement = L"");
 	/**
 	 * Returns an error string of the last failed operation
 	 */
@@ -174,6 +191,7 @@ private:
 	bool			StripComments(CString& sLine, bool bInBlockComment);
 	bool			IsInsideString(const CString& sLine, int pos);
 	void			LineRegex(CString& sLine, const std::wregex& rx, const std::wstring& replacement) const;
+	void			TransformLine(CString& sLine, bool& bInBlockComment, DWORD dwIgnoreWhitespaces, BOOL bIgnoreCase, bool bBlame, bool bIgnoreComments, const std::wregex& rx, const std::wstring& replacement);
 
 
 private:
@@ -0,0 +1,321 @@
+﻿// TortoiseGitMerge - a Diff/Patch program
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "stdafx.h"
+#include "HistogramDiff.h"
+#include "ThreadPoolWork.h"
+
+CHistogramDiff::CHistogramDiff(std::span<const uint32_t> lines1, std::span<const uint32_t> lines2, size_t idCount, size_t begin1, size_t end1)
+	: m_lines1(lines1)
+	, m_lines2(lines2)
+	, m_counts(idCount, 0)
+	, m_chainHeads(idCount, NO_LINE)
+	, m_chainNext(end1 - begin1, NO_LINE)
+	, m_chainBase(begin1)
+{
+}
+
+std::vector<CHistogramDiff::SCommonRun> CHistogramDiff::Diff(std::span<const uint32_t> lines1, std::span<const uint32_t> lines2, bool bParallel)
+{
+	// line numbers are stored as uint32_t, just like CFileTextLines only handles int line numbers
+	ASSERT(lines1.size() < NO_LINE);
+	uint32_t maxId = 0;
+	for (auto id : lines1)
+		maxId = std::max(maxId, id);
+	const size_t idCount = lines1.empty() ? 0 : static_cast<size_t>(maxId) + 1;
+	CHistogramDiff diff(lines1, lines2, idCount, 0, lines1.size());
+
+	std::vector<SItem> items = { { Kind::Range, 0, lines1.size(), 0, lines2.size() } };
+	if (bParallel && CThreadPoolWork::GetDefaultWorkerCount() > 1)
+	{
+		// split large inputs a few times, the resulting ranges are independent of each other
+		for (int depth = 0; depth < PARALLEL_MAX_DEPTH; ++depth)
+		{
+			std::vector<SItem> parts;
+			for (const auto& item : items)
+			{
+				if (item.kind == Kind::Range && (item.end1 - item.begin1) + (item.end2 - item.begin2) >= PARALLEL_MIN_LINES)
+					diff.Split(item, parts);
+				else
+					parts.push_back(item);
+			}
+			items.swap(parts);
+		}
+	}
+
+	std::vector<SCommonRun> runs;
+	if (items.size() == 1)
+	{
+		diff.DiffItem(items[0], runs);
+		return runs;
+	}
+
+	std::vector<std::vector<SCommonRun>> itemRuns(items.size());
+	ParallelFor(items.size(), [&](size_t i)
+	{
+		// common parts and Myers' algorithm do not use the histogram, so they can share diff
+		if (items[i].kind != Kind::Range)
+		{
+			diff.DiffItem(items[i], itemRuns[i]);
+			return;
+		}
+		CHistogramDiff rangeDiff(lines1, lines2, idCount, items[i].begin1, items[i].end1);
+		rangeDiff.DiffItem(items[i], itemRuns[i]);
+	});
+	for (const auto& part : itemRuns)
+		AppendRuns(runs, part);
+	return runs;
+}
+
+void CHistogramDiff::AddRun(std::vector<SCommonRun>& runs, size_t start1, size_t start2, size_t length)
+{
+	if (!length)
+		return;
+	if (!runs.empty())
+	{
+		auto& last = runs.back();
+		if (last.start1 + last.length == start1 && last.start2 + last.length == start2)
+		{
+			last.length += length;
+			return;
+		}
+	}
+	runs.push_back({ start1, start2, length });
+}
+
+void CHistogramDiff::AppendRuns(std::vector<SCommonRun>& runs, const std::vector<SCommonRun>& toAppend)
+{
+	for (const auto& run : toAppend)
+		AddRun(runs, run.start1, run.start2, run.length);
+}
+
+void CHistogramDiff::DiffItem(const SItem& item, std::vector<SCommonRun>& runs)
+{
+	// an explicit stack instead of recursion, inputs with lots of small regions (e.g. swapped lines) are split very often
+	std::vector<SItem> stack = { item };
+	std::vector<SItem> parts;
+	while (!stack.empty())
+	{
+		const SItem current = stack.back();
+		stack.pop_back();
+		switch (current.kind)
+		{
+		case Kind::Common:
+			AddRun(runs, current.begin1, current.begin2, current.end1 - current.begin1);
+			break;
+		case Kind::Myers:
+			DiffMyers(current.begin1, current.end1, current.begin2, current.end2, runs);
+			break;
+		case Kind::Range:
+			parts.clear();
+			Split(current, parts);
+			stack.insert(stack.end(), parts.crbegin(), parts.crend());
+			break;
+		}
+	}
+}
+
+// splits a range into its common prefix, the range before the region, the region, the range after it and the common suffix
+void CHistogramDiff::Split(const SItem& range, std::vector<SItem>& parts)
+{
+	size_t begin1 = range.begin1, end1 = range.end1, begin2 = range.begin2, end2 = range.end2;
+	size_t prefix = 0;
+	while (begin1 + prefix < end1 && begin2 + prefix < end2 && m_lines1[begin1 + prefix] == m_lines2[begin2 + prefix])
+		++prefix;
+	if (prefix)
+		parts.push_back({ Kind::Common, begin1, begin1 + prefix, begin2, begin2 + prefix });
+	begin1 += prefix;
+	begin2 += prefix;
+
+	size_t suffix = 0;
+	while (end1 - suffix > begin1 && end2 - suffix > begin2 && m_lines1[end1 - suffix - 1] == m_lines2[end2 - suffix - 1])
+		++suffix;
+	end1 -= suffix;
+	end2 -= suffix;
+
+	if (begin1 < end1 && begin2 < end2)
+	{
+		SCommonRun region;
+		if (!FindRegion(begin1, end1, begin2, end2, region))
+			parts.push_back({ Kind::Myers, begin1, end1, begin2, end2 });
+		else
+		{
+			if (begin1 < region.start1 && begin2 < region.start2)
+				parts.push_back({ Kind::Range, begin1, region.start1, begin2, region.start2 });
+			parts.push_back({ Kind::Common, region.start1, region.start1 + region.length, region.start2, region.start2 + region.length });
+			if (region.start1 + region.length < end1 && region.start2 + region.length < end2)
+				parts.push_back({ Kind::Range, region.start1 + region.length, end1, region.start2 + region.length, end2 });
+		}
+	}
+
+	if (suffix)
+		parts.push_back({ Kind::Common, end1, end1 + suffix, end2, end2 + suffix });
+}
+
+bool CHistogramDiff::FindRegion(size_t begin1, size_t end1, size_t begin2, size_t end2, SCommonRun& region)
+{
+	// build the histogram of range 1, the chains list the lines of an id in ascending order
+	for (size_t i = end1; i-- > begin1;)
+	{
+		const uint32_t id = m_lines1[i];
+		++m_counts[id];
+		m_chainNext[i - m_chainBase] = m_chainHeads[id];
+		m_chainHeads[id] = static_cast<uint32_t>(i);
+	}
+
+	bool found = false;
+	uint32_t lowestCount = MAX_CHAIN_LENGTH + 1;
+	region = { 0, 0, 0 };
+	// among equally good regions the one nearest to the middle is taken, so that the ranges stay balanced
+	auto offCenter = [begin2, end2](size_t start2, size_t length) { return std::abs(static_cast<ptrdiff_t>(2 * start2 + length) - static_cast<ptrdiff_t>(begin2 + end2)); };
+	for (size_t i2 = begin2; i2 < end2;)
+	{
+		size_t next2 = i2 + 1;
+		const uint32_t id = m_lines2[i2];
+		if (id >= m_counts.size() || !m_counts[id] || m_counts[id] > lowestCount)
+		{
+			i2 = next2;
+			continue;
+		}
+		for (size_t i1 = m_chainHeads[id]; i1 != NO_LINE;)
+		{
+			uint32_t count = m_counts[id];
+			size_t start1 = i1, start2 = i2, end1Region = i1 + 1, end2Region = i2 + 1;
+			while (start1 > begin1 && start2 > begin2 && m_lines1[start1 - 1] == m_lines2[start2 - 1])
+			{
+				--start1;
+				--start2;
+				count = std::min(count, m_counts[m_lines1[start1]]);
+			}
+			while (end1Region < end1 && end2Region < end2 && m_lines1[end1Region] == m_lines2[end2Region])
+			{
+				count = std::min(count, m_counts[m_lines1[end1Region]]);
+				++end1Region;
+				++end2Region;
+			}
+			next2 = std::max(next2, end2Region);
+			const size_t length = end1Region - start1;
+			if (region.length < length || count < lowestCount || (region.length == length && count == lowestCount && offCenter(start2, length) < offCenter(region.start2, region.length)))
+			{
+				region = { start1, start2, length };
+				lowestCount = count;
+				found = true;
+			}
+			// skip the lines of range 1 which are already part of this region
+			do
+			{
+				i1 = m_chainNext[i1 - m_chainBase];
+			} while (i1 != NO_LINE && i1 < end1Region);
+		}
+		i2 = next2;
+	}
+
+	for (size_t i = begin1; i < end1; ++i)
+	{
+		m_counts[m_lines1[i]] = 0;
+		m_chainHeads[m_lines1[i]] = NO_LINE;
+	}
+	return found;
+}
+
+void CHistogramDiff::DiffMyers(size_t begin1, size_t end1, size_t begin2, size_t end2, std::vector<SCommonRun>& runs) const
+{
+	size_t prefix = 0;
+	while (begin1 + prefix < end1 && begin2 + prefix < end2 && m_lines1[begin1 + prefix] == m_lines2[begin2 + prefix])
+		++prefix;
+	AddRun(runs, begin1, begin2, prefix);
+	begin1 += prefix;
+	begin2 += prefix;
+
+	size_t suffix = 0;
+	while (end1 - suffix > begin1 && end2 - suffix > begin2 && m_lines1[end1 - suffix - 1] == m_lines2[end2 - suffix - 1])
+		++suffix;
+	end1 -= suffix;
+	end2 -= suffix;
+
+	if (begin1 < end1 && begin2 < end2)
+	{
+		// find the middle snake, see "An O(ND) Difference Algorithm and Its Variations" by Eugene W. Myers
+		const ptrdiff_t n = end1 - begin1;
+		const ptrdiff_t m = end2 - begin2;
+		const ptrdiff_t delta = n - m;
+		const bool odd = (delta & 1) != 0;
+		const ptrdiff_t maxD = (n + m + 1) / 2;
+		std::vector<ptrdiff_t> forward(2 * maxD + 3, 0);
+		std::vector<ptrdiff_t> backward(2 * maxD + 3, 0);
+		auto vf = [&](ptrdiff_t k) -> ptrdiff_t& { return forward[k + maxD + 1]; };
+		auto vb = [&](ptrdiff_t k) -> ptrdiff_t& { return backward[k + maxD + 1]; };
+		ptrdiff_t snakeStart1 = -1, snakeStart2 = 0, snakeEnd1 = 0, snakeEnd2 = 0;
+		for (ptrdiff_t d = 0; d <= maxD && snakeStart1 < 0; ++d)
+		{
+			for (ptrdiff_t k = -d; k <= d; k += 2)
+			{
+				ptrdiff_t x = (k == -d || (k != d && vf(k - 1) < vf(k + 1))) ? vf(k + 1) : vf(k - 1) + 1;
+				ptrdiff_t y = x - k;
+				const ptrdiff_t startX = x, startY = y;
+				while (x < n && y < m && m_lines1[begin1 + x] == m_lines2[begin2 + y])
+				{
+					++x;
+					++y;
+				}
+				vf(k) = x;
+				if (odd && delta - k >= -(d - 1) && delta - k <= d - 1 && x + vb(delta - k) >= n)
+				{
+					snakeStart1 = startX;
+					snakeStart2 = startY;
+					snakeEnd1 = x;
+					snakeEnd2 = y;
+					break;
+				}
+			}
+			if (snakeStart1 >= 0)
+				break;
+			for (ptrdiff_t k = -d; k <= d; k += 2)
+			{
+				ptrdiff_t x = (k == -d || (k != d && vb(k - 1) < vb(k + 1))) ? vb(k + 1) : vb(k - 1) + 1;
+				ptrdiff_t y = x - k;
+				const ptrdiff_t startX = x, startY = y;
+				while (x < n && y < m && m_lines1[end1 - 1 - x] == m_lines2[end2 - 1 - y])
+				{
+					++x;
+					++y;
+				}
+				vb(k) = x;
+				if (!odd && delta - k >= -d && delta - k <= d && x + vf(delta - k) >= n)
+				{
+					snakeStart1 = n - x;
+					snakeStart2 = m - y;
+					snakeEnd1 = n - startX;
+					snakeEnd2 = m - startY;
+					break;
+				}
+			}
+		}
+
+		// a snake at one of the ends would not split the range, everything in between differs then
+		const bool bSplits = snakeStart1 >= 0 && snakeEnd1 + snakeEnd2 > 0 && snakeStart1 + snakeStart2 < n + m;
+		if (bSplits)
+		{
+			DiffMyers(begin1, begin1 + snakeStart1, begin2, begin2 + snakeStart2, runs);
+			AddRun(runs, begin1 + snakeStart1, begin2 + snakeStart2, snakeEnd1 - snakeStart1);
+			DiffMyers(begin1 + snakeEnd1, end1, begin2 + snakeEnd2, end2, runs);
+		}
+	}
+
+	AddRun(runs, end1, end2, suffix);
+}
@@ -0,0 +1,89 @@
+﻿// TortoiseGitMerge - a Diff/Patch program
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+#include <span>
+
+/**
+ * \ingroup TortoiseMerge
+ * Histogram diff (the algorithm git and JGit use with --histogram) on lines which
+ * have been interned to ids before, i.e. equal lines have the same id.
+ * The lines are split at the longest common region of the least frequent lines,
+ * which gives good results and stays fast on files with lots of repeated lines
+ * (lockfiles, generated JSON, ...) where the classic LCS degrades. Ranges without
+ * any line occurring less than MAX_CHAIN_LENGTH times are diffed with Myers' algorithm.
+ */
+class CHistogramDiff
+{
+public:
+	struct SCommonRun
+	{
+		size_t start1;
+		size_t start2;
+		size_t length;
+
+		bool operator==(const SCommonRun&) const = default;
+	};
+
+	/**
+	 * Returns the common lines of both sequences as ordered, non adjacent runs.
+	 * \param bParallel diff the ranges before and after the split points of large inputs in parallel
+	 */
+	static std::vector<SCommonRun> Diff(std::span<const uint32_t> lines1, std::span<const uint32_t> lines2, bool bParallel = false);
+
+private:
+	static constexpr uint32_t MAX_CHAIN_LENGTH = 64;
+	static constexpr size_t PARALLEL_MIN_LINES = 20000;
+	static constexpr int PARALLEL_MAX_DEPTH = 3;
+	static constexpr uint32_t NO_LINE = UINT32_MAX;
+
+	enum class Kind
+	{
+		Range,	// still to be diffed
+		Common,	// known to be common
+		Myers,	// no region found, to be diffed with Myers' algorithm
+	};
+
+	// a part of both sequences: [begin1, end1) and [begin2, end2)
+	struct SItem
+	{
+		Kind	kind;
+		size_t	begin1;
+		size_t	end1;
+		size_t	begin2;
+		size_t	end2;
+	};
+
+	CHistogramDiff(std::span<const uint32_t> lines1, std::span<const uint32_t> lines2, size_t idCount, size_t begin1, size_t end1);
+
+	void DiffItem(const SItem& item, std::vector<SCommonRun>& runs);
+	void Split(const SItem& range, std::vector<SItem>& parts);
+	bool FindRegion(size_t begin1, size_t end1, size_t begin2, size_t end2, SCommonRun& region);
+	void DiffMyers(size_t begin1, size_t end1, size_t begin2, size_t end2, std::vector<SCommonRun>& runs) const;
+	static void AddRun(std::vector<SCommonRun>& runs, size_t start1, size_t start2, size_t length);
+	static void AppendRuns(std::vector<SCommonRun>& runs, const std::vector<SCommonRun>& toAppend);
+
+	std::span<const uint32_t>	m_lines1;
+	std::span<const uint32_t>	m_lines2;
+	// indexed by line id, only valid for the ids of the range FindRegion() is working on
+	std::vector<uint32_t>		m_counts;
+	std::vector<uint32_t>		m_chainHeads;
+	// next line of range 1 with the same id, indexed by line - m_chainBase
+	std::vector<uint32_t>		m_chainNext;
+	size_t						m_chainBase;
+};
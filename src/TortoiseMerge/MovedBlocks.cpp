@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2023 - TortoiseGit
+// Copyright (C) 2023, 2026 - TortoiseGit
 // Copyright (C) 2010-2013, 2020 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -21,110 +21,217 @@
 #include "diff.h"
 #include "MovedBlocks.h"
 #include "DiffData.h"
-#include <set>
-#include <map>
+#include <vector>
+#include <string_view>
 
 // This file implements moved blocks detection algorithm, based
 // on WinMerges(http:\\winmerge.org) one
 
-class IntSet
-{
-public:
-	void Add(int val);
-	void Remove(int val);
-	int Count() const;
-	bool IsPresent(int val) const;
-	int GetSingle() const;
-private:
-	std::set<int>		m_set;
-};
-
 struct EquivalencyGroup
 {
-	IntSet m_LinesLeft;  // equivalent lines on left pane
-	IntSet m_LinesRight; // equivalent lines on right pane
+	uint32_t	m_hash = 0;			// hash of the (trimmed) line content
+	int			m_line = 0;			// first line with this content, used to resolve hash collisions
+	int			m_side = 0;			// pane of m_line
+	int			m_countLeft = 0;	// number of equivalent lines on left pane
+	int			m_countRight = 0;	// number of equivalent lines on right pane
+	int64_t		m_sumLeft = 0;		// sum of the equivalent line numbers on left pane
+	int64_t		m_sumRight = 0;		// sum of the equivalent line numbers on right pane
 
 	bool IsPerfectMatch() const;
+	// only valid for a perfect match: the sum of a single line is the line itself
+	int GetSingleLeft() const { return static_cast<int>(m_sumLeft); }
+	int GetSingleRight() const { return static_cast<int>(m_sumRight); }
 };
 
-class LineToGroupMap : private std::map<CString, EquivalencyGroup*>
+/**
+ * Assigns every line to a group of equivalent lines of both panes.
+ * Groups are pooled in a vector and found through an open addressing table
+ * keyed by a hash of the line, so that lines are hashed once and only
+ * compared on hash collisions. The group of each looked up line is cached.
+ */
+class LineToGroupMap
 {
 public:
-	void Add(int lineno, const CString &line, int nside);
-	EquivalencyGroup *find(const CString &line) const;
-	~LineToGroupMap();
+	static constexpr int NO_GROUP = -1;
+
+	LineToGroupMap(const CFileTextLines& left, const CFileTextLines& right, IgnoreWS ignoreWs);
+
+	void Add(int lineno, int nside);
+	void Remove(int lineno, int nside);
+	int find(int lineno, int nside);
+	EquivalencyGroup& GetGroup(int group) { return m_groups[group]; }
+
+private:
+	static constexpr int UNKNOWN_GROUP = -2;
+
+	std::wstring_view GetLine(int lineno, int nside) const;
+	uint32_t HashLine(std::wstring_view line) const;
+	bool IsEqual(std::wstring_view line1, std::wstring_view line2) const;
+	int Lookup(int lineno, int nside, bool bInsert);
+	void Grow();
+
+	const CFileTextLines*			m_lines[2];
+	IgnoreWS						m_ignoreWs;
+	std::vector<EquivalencyGroup>	m_groups;
+	std::vector<uint32_t>			m_slots;		// group index + 1, 0 marks an empty slot
+	std::vector<int>				m_lineGroups[2];
+	std::vector<bool>				m_inGroup[2];	// line is counted in its group
 };
 
-void IntSet::Add(int val)
+static bool IsTrimmedWhiteSpace(wchar_t c)
 {
-	m_set.insert(val);
+	return c == L' ' || c == L'\t';
 }
 
-void IntSet::Remove(int val)
+bool EquivalencyGroup::IsPerfectMatch() const
 {
-	m_set.erase(val);
+	return (m_countLeft == 1) && (m_countRight == 1);
 }
 
-int IntSet::Count() const
+LineToGroupMap::LineToGroupMap(const CFileTextLines& left, const CFileTextLines& right, IgnoreWS ignoreWs)
+	: m_lines{ &left, &right }
+	, m_ignoreWs(ignoreWs)
+	, m_slots(64)
 {
-	return static_cast<int>(m_set.size());
+	for (int nside = 0; nside < 2; ++nside)
+	{
+		m_lineGroups[nside].assign(m_lines[nside]->GetCount(), UNKNOWN_GROUP);
+		m_inGroup[nside].assign(m_lines[nside]->GetCount(), false);
+	}
 }
 
-bool IntSet::IsPresent(int val) const
+std::wstring_view LineToGroupMap::GetLine(int lineno, int nside) const
 {
-	return m_set.find(val) != m_set.end();
+	const CString& sLine = m_lines[nside]->GetAt(lineno);
+	std::wstring_view line(sLine, sLine.GetLength());
+	if (m_ignoreWs == IgnoreWS::WhiteSpaces)
+	{
+		size_t start = 0;
+		while (start < line.size() && IsTrimmedWhiteSpace(line[start]))
+			++start;
+		line.remove_prefix(start);
+	}
+	return line;
 }
 
-int IntSet::GetSingle() const
+uint32_t LineToGroupMap::HashLine(std::wstring_view line) const
 {
-	if (!m_set.empty())
+	// FNV-1a, skipping the whitespaces that are ignored
+	uint32_t hash = 2166136261U;
+	for (wchar_t c : line)
 	{
-		return *m_set.cbegin();
+		if (m_ignoreWs == IgnoreWS::AllWhiteSpaces && IsTrimmedWhiteSpace(c))
+			continue;
+		hash = (hash ^ c) * 16777619U;
 	}
-	return 0;
+	return hash;
 }
 
-bool EquivalencyGroup::IsPerfectMatch() const
+bool LineToGroupMap::IsEqual(std::wstring_view line1, std::wstring_view line2) const
 {
-	return (m_LinesLeft.Count() == 1)&&(m_LinesRight.Count() == 1);
+	if (m_ignoreWs != IgnoreWS::AllWhiteSpaces)
+		return line1 == line2;
+
+	size_t i = 0;
+	size_t j = 0;
+	for (;;)
+	{
+		while (i < line1.size() && IsTrimmedWhiteSpace(line1[i]))
+			++i;
+		while (j < line2.size() && IsTrimmedWhiteSpace(line2[j]))
+			++j;
+		if (i == line1.size() || j == line2.size())
+			return i == line1.size() && j == line2.size();
+		if (line1[i++] != line2[j++])
+			return false;
+	}
 }
 
-void LineToGroupMap::Add(int lineno, const CString &line, int nside)
+int LineToGroupMap::Lookup(int lineno, int nside, bool bInsert)
 {
-	EquivalencyGroup* pGroup = nullptr;
-	auto it = __super::find(line);
-	if ( it == cend() )
+	int& cached = m_lineGroups[nside][lineno];
+	if (cached != UNKNOWN_GROUP && (cached != NO_GROUP || !bInsert))
+		return cached;
+
+	const std::wstring_view line = GetLine(lineno, nside);
+	const uint32_t hash = HashLine(line);
+	const size_t mask = m_slots.size() - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
 	{
-		pGroup = new EquivalencyGroup;
-		insert(std::pair<CString, EquivalencyGroup*>(line, pGroup));
+		if (m_slots[slot] == 0)
+		{
+			if (!bInsert)
+				return cached = NO_GROUP;
+			EquivalencyGroup group;
+			group.m_hash = hash;
+			group.m_line = lineno;
+			group.m_side = nside;
+			m_groups.push_back(group);
+			m_slots[slot] = static_cast<uint32_t>(m_groups.size());
+			cached = static_cast<int>(m_groups.size()) - 1;
+			if (m_groups.size() * 2 > m_slots.size())
+				Grow();
+			return cached;
+		}
+		const EquivalencyGroup& group = m_groups[m_slots[slot] - 1];
+		if (group.m_hash == hash && IsEqual(GetLine(group.m_line, group.m_side), line))
+			return cached = static_cast<int>(m_slots[slot]) - 1;
 	}
-	else
-		pGroup = it->second;
-	if(nside)
+}
+
+void LineToGroupMap::Grow()
+{
+	std::vector<uint32_t> slots(m_slots.size() * 2);
+	const size_t mask = slots.size() - 1;
+	for (size_t i = 0; i < m_groups.size(); ++i)
 	{
-		pGroup->m_LinesRight.Add(lineno);
+		size_t slot = m_groups[i].m_hash & mask;
+		while (slots[slot])
+			slot = (slot + 1) & mask;
+		slots[slot] = static_cast<uint32_t>(i + 1);
+	}
+	m_slots.swap(slots);
+}
+
+void LineToGroupMap::Add(int lineno, int nside)
+{
+	EquivalencyGroup& group = m_groups[Lookup(lineno, nside, true)];
+	if (m_inGroup[nside][lineno])
+		return;
+	m_inGroup[nside][lineno] = true;
+	if (nside)
+	{
+		++group.m_countRight;
+		group.m_sumRight += lineno;
 	}
 	else
 	{
-		pGroup->m_LinesLeft.Add(lineno);
+		++group.m_countLeft;
+		group.m_sumLeft += lineno;
 	}
 }
 
-EquivalencyGroup *LineToGroupMap::find(const CString &line) const
+void LineToGroupMap::Remove(int lineno, int nside)
 {
-	EquivalencyGroup* pGroup = nullptr;
-	auto it = __super::find(line);
-	if ( it != cend() )
-		pGroup = it->second;
-	return pGroup;
+	if (!m_inGroup[nside][lineno])
+		return;
+	m_inGroup[nside][lineno] = false;
+	EquivalencyGroup& group = m_groups[find(lineno, nside)];
+	if (nside)
+	{
+		--group.m_countRight;
+		group.m_sumRight -= lineno;
+	}
+	else
+	{
+		--group.m_countLeft;
+		group.m_sumLeft -= lineno;
+	}
 }
 
-LineToGroupMap::~LineToGroupMap()
+int LineToGroupMap::find(int lineno, int nside)
 {
-	for (auto it = cbegin(); it != cend(); ++it)
-	{
-		delete it->second;
-	}
+	return Lookup(lineno, nside, false);
 }
 
 tsvn_svn_diff_t_extension * CreateDiffExtension(svn_diff_t * base, apr_pool_t * pool)
@@ -150,30 +257,9 @@ void AdjustExistingAndTail(svn_diff_t * tempdiff, tsvn_svn_diff_t_extension *& e
 	}
 }
 
-CString GetTrimmedString(const CString& s1, IgnoreWS ignoreWs)
-{
-	if (ignoreWs == IgnoreWS::AllWhiteSpaces)
-	{
-		CString s2 = s1;
-		s2.Remove(' ');
-		s2.Remove('\t');
-		return s2;
-	}
-	else if (ignoreWs == IgnoreWS::WhiteSpaces)
-		return CString(s1).TrimLeft(L" \t");
-	return CString(s1).TrimRight(L" \t");
-}
-
-EquivalencyGroup* ExtractGroup(const LineToGroupMap& map, const CString& line, IgnoreWS ignoreWS)
-{
-	if (ignoreWS != IgnoreWS::None)
-		return map.find(GetTrimmedString(line, ignoreWS));
-	return map.find(line);
-}
-
 tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase, IgnoreWS ignoreWs, apr_pool_t* pool)
 {
-	LineToGroupMap map;
+	LineToGroupMap map(m_arBaseFile, m_arYourFile, ignoreWs);
 	tsvn_svn_diff_t_extension* head = nullptr;
 	tsvn_svn_diff_t_extension* tail = nullptr;
 	svn_diff_t * tempdiff = diffYourBase;
@@ -188,24 +274,12 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		if (m_arBaseFile.GetCount() <= (baseLine+tempdiff->original_length))
 			return nullptr;
 		for(int i = 0; i < tempdiff->original_length; ++i, ++baseLine)
-		{
-			const CString &sCurrentBaseLine = m_arBaseFile.GetAt(baseLine);
-			if (ignoreWs != IgnoreWS::None)
-				map.Add(baseLine, GetTrimmedString(sCurrentBaseLine, ignoreWs), 0);
-			else
-				map.Add(baseLine, sCurrentBaseLine, 0);
-		}
+			map.Add(baseLine, 0);
 		yourLine = static_cast<LONG>(tempdiff->modified_start);
 		if (m_arYourFile.GetCount() <= (yourLine+tempdiff->modified_length))
 			return nullptr;
 		for(int i = 0; i < tempdiff->modified_length; ++i, ++yourLine)
-		{
-			const CString &sCurrentYourLine = m_arYourFile.GetAt(yourLine);
-			if (ignoreWs != IgnoreWS::None)
-				map.Add(yourLine, GetTrimmedString(sCurrentYourLine, ignoreWs), 1);
-			else
-				map.Add(yourLine, sCurrentYourLine, 1);
-		}
+			map.Add(yourLine, 1);
 	}
 	for(tempdiff = diffYourBase; tempdiff; tempdiff = tempdiff->next)
 	{
@@ -220,17 +294,17 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		int i;
 		for(i = static_cast<int>(tempdiff->original_start); (i - tempdiff->original_start)< tempdiff->original_length; ++i)
 		{
-			EquivalencyGroup* group = ExtractGroup(map, m_arBaseFile.GetAt(i), ignoreWs);
-			if(group->IsPerfectMatch())
+			EquivalencyGroup& group = map.GetGroup(map.find(i, 0));
+			if(group.IsPerfectMatch())
 			{
-				pGroup = group;
+				pGroup = &group;
 				break;
 			}
 		}
 		if(!pGroup) // if no match
 			continue;
 		// found a match
-		int j = pGroup->m_LinesRight.GetSingle();
+		int j = pGroup->GetSingleRight();
 		// Ok, now our moved block is the single line (i, j)
 
 		// extend moved block upward as far as possible
@@ -238,12 +312,11 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		int j1 = j - 1;
 		for(; (i1 >= tempdiff->original_start) && (j1>=0) && (i1>=0); --i1, --j1)
 		{
-			EquivalencyGroup* pGroup0 = ExtractGroup(map, m_arBaseFile.GetAt(i1), ignoreWs);
-			EquivalencyGroup* pGroup1 = ExtractGroup(map, m_arYourFile.GetAt(j1), ignoreWs);
-			if(pGroup1 != pGroup0)
+			const int group0 = map.find(i1, 0);
+			if (group0 == LineToGroupMap::NO_GROUP || group0 != map.find(j1, 1))
 				break;
-			pGroup0->m_LinesLeft.Remove(i1);
-			pGroup1->m_LinesRight.Remove(j1);
+			map.Remove(i1, 0);
+			map.Remove(j1, 1);
 		}
 		++i1;
 		++j1;
@@ -257,12 +330,11 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		{
 			if(i2 >= m_arBaseFile.GetCount() || j2 >= m_arYourFile.GetCount())
 				break;
-			EquivalencyGroup* pGroup0 = ExtractGroup(map, m_arBaseFile.GetAt(i2), ignoreWs);
-			EquivalencyGroup* pGroup1 = ExtractGroup(map, m_arYourFile.GetAt(j2), ignoreWs);
-			if(pGroup1 != pGroup0)
+			const int group0 = map.find(i2, 0);
+			if (group0 == LineToGroupMap::NO_GROUP || group0 != map.find(j2, 1))
 				break;
-			pGroup0->m_LinesLeft.Remove(i2);
-			pGroup1->m_LinesRight.Remove(j2);
+			map.Remove(i2, 0);
+			map.Remove(j2, 1);
 		}
 		--i2;
 		--j2;
@@ -345,10 +417,10 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		int j = 0;
 		for(j = static_cast<int>(tempdiff->modified_start); (j - tempdiff->modified_start) < tempdiff->modified_length; ++j)
 		{
-			EquivalencyGroup* group = ExtractGroup(map, m_arYourFile.GetAt(j), ignoreWs);
-			if(group->IsPerfectMatch())
+			EquivalencyGroup& group = map.GetGroup(map.find(j, 1));
+			if(group.IsPerfectMatch())
 			{
-				pGroup = group;
+				pGroup = &group;
 				break;
 			}
 		}
@@ -361,7 +433,7 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		}
 
 		// found a match
-		int i = pGroup->m_LinesLeft.GetSingle();
+		int i = pGroup->GetSingleLeft();
 		if (i == 0)
 			continue;
 		// Ok, now our moved block is the single line (i,j)
@@ -371,12 +443,11 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		int j1 = j-1;
 		for ( ; (j1>=tempdiff->modified_start) && (j1>=0) && (i1>=0); --i1, --j1)
 		{
-			EquivalencyGroup* pGroup0 = ExtractGroup(map, m_arBaseFile.GetAt(i1), ignoreWs);
-			EquivalencyGroup* pGroup1 = ExtractGroup(map, m_arYourFile.GetAt(j1), ignoreWs);
-			if (pGroup0 != pGroup1)
+			const int group0 = map.find(i1, 0);
+			if (group0 == LineToGroupMap::NO_GROUP || group0 != map.find(j1, 1))
 				break;
-			pGroup0->m_LinesLeft.Remove(i1);
-			pGroup1->m_LinesRight.Remove(j1);
+			map.Remove(i1, 0);
+			map.Remove(j1, 1);
 		}
 		++i1;
 		++j1;
@@ -389,12 +460,11 @@ tsvn_svn_diff_t_extension* CDiffData::MovedBlocksDetect(svn_diff_t* diffYourBase
 		{
 			if(i2 >= m_arBaseFile.GetCount() || j2 >= m_arYourFile.GetCount())
 				break;
-			EquivalencyGroup* pGroup0 = ExtractGroup(map, m_arBaseFile.GetAt(i2), ignoreWs);
-			EquivalencyGroup* pGroup1 = ExtractGroup(map, m_arYourFile.GetAt(j2), ignoreWs);
-			if (pGroup0 != pGroup1)
+			const int group0 = map.find(i2, 0);
+			if (group0 == LineToGroupMap::NO_GROUP || group0 != map.find(j2, 1))
 				break;
-			pGroup0->m_LinesLeft.Remove(i2);
-			pGroup1->m_LinesRight.Remove(j2);
+			map.Remove(i2, 0);
+			map.Remove(j2, 1);
 		}
 		--i2;
 		--j2;
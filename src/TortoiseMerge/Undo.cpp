@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2023 - TortoiseGit
+// Copyright (C) 2023, 2026 - TortoiseGit
 // Copyright (C) 2006-2007, 2010-2011, 2013,2015, 2021-2022 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -21,20 +21,25 @@
 #include "stdafx.h"
 #include "Undo.h"
 
+#ifndef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
 #include "BaseView.h"
+#endif
+#include "registry.h"
 
+#ifndef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
 void viewstate::AddViewLineFromView(CBaseView *pView, int nViewLine, bool bAddEmptyLine)
 {
 	// is undo good place for this ?
 	if (!pView || !pView->m_pViewData)
 		return;
-	replacedlines[nViewLine] = pView->m_pViewData->GetData(nViewLine);
+	replacedlines.Set(nViewLine, pView->m_pViewData->GetData(nViewLine));
 	if (bAddEmptyLine)
 	{
 		addedlines.push_back(nViewLine + 1);
 		pView->AddEmptyViewLine(nViewLine);
 	}
 }
+#endif
 
 void viewstate::Clear()
 {
@@ -50,6 +55,25 @@ void viewstate::Clear()
 	modifies = false;
 }
 
+void viewstate::Compact()
+{
+	difflines.Compact();
+	linestates.Compact();
+	linelines.Compact();
+	linesEOL.Compact();
+	markedlines.Compact();
+	addedlines.shrink_to_fit();
+
+	removedlines.Compact();
+	replacedlines.Compact();
+}
+
+size_t viewstate::GetMemoryUsage() const
+{
+	return difflines.GetMemoryUsage() + linestates.GetMemoryUsage() + linelines.GetMemoryUsage() + linesEOL.GetMemoryUsage() + markedlines.GetMemoryUsage()
+		+ addedlines.capacity() * sizeof(int) + removedlines.GetMemoryUsage() + replacedlines.GetMemoryUsage();
+}
+
 void CUndo::MarkAsOriginalState(bool bLeft, bool bRight, bool bBottom)
 {
 	// find highest index of changing step
@@ -69,6 +93,7 @@ CUndo& CUndo::GetInstance()
 
 CUndo::CUndo()
 {
+	m_maxMemoryUsage = static_cast<size_t>(static_cast<DWORD>(CRegDWORD(L"Software\\TortoiseGitMerge\\UndoMemoryLimit", 256))) * 1024 * 1024;
 }
 
 CUndo::~CUndo()
@@ -85,19 +110,44 @@ void CUndo::AddState(const allviewstate& allstate, POINT pt)
 		++m_originalstateBottom;
 
 	m_viewstates.push_back(allstate);
+	m_viewstates.back().Compact();
+	m_memoryUsage += m_viewstates.back().GetMemoryUsage();
 	m_caretpoints.push_back(pt);
 	// a new action that can be undone clears the redo since
 	// after this there is nothing to redo anymore
 	m_redoviewstates.clear();
 	m_redocaretpoints.clear();
 	m_redogroups.clear();
+
+	DropOldestStates();
 }
 
-bool CUndo::Undo(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
+void CUndo::DropOldestStates()
 {
-	if (!CanUndo())
-		return false;
+	// always keep the latest step, even if it alone exceeds the limit
+	while (m_maxMemoryUsage && m_memoryUsage > m_maxMemoryUsage && m_viewstates.size() > 1)
+	{
+		m_memoryUsage -= m_viewstates.front().GetMemoryUsage();
+		m_viewstates.pop_front();
+		m_caretpoints.pop_front();
+
+		// the groups store step counts, which are now one less
+		for (auto& group : m_groups)
+		{
+			if (group > 0)
+				--group;
+		}
+		// drop (begin, end) pairs of groups which are completely gone
+		while (m_groups.size() >= 2 && *std::next(m_groups.cbegin()) == 0)
+		{
+			m_groups.pop_front();
+			m_groups.pop_front();
+		}
+	}
+}
 
+size_t CUndo::BeginUndo()
+{
 	if (m_groups.size() && m_groups.back() == m_caretpoints.size())
 	{
 		m_groups.pop_back();
@@ -105,10 +155,32 @@ bool CUndo::Undo(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
 		m_redogroups.push_back(b);
 		m_redogroups.push_back(m_caretpoints.size());
 		m_groups.pop_back();
-		while (b < m_caretpoints.size())
-			UndoOne(pLeft, pRight, pBottom);
+		return m_caretpoints.size() - b;
 	}
-	else
+	return 1;
+}
+
+size_t CUndo::BeginRedo()
+{
+	if (m_redogroups.size() && m_redogroups.back() == m_redocaretpoints.size())
+	{
+		m_redogroups.pop_back();
+		std::list<int>::size_type b = m_redogroups.back();
+		m_groups.push_back(b);
+		m_groups.push_back(m_redocaretpoints.size());
+		m_redogroups.pop_back();
+		return m_redocaretpoints.size() - b;
+	}
+	return 1;
+}
+
+#ifndef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
+bool CUndo::Undo(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
+{
+	if (!CanUndo())
+		return false;
+
+	for (size_t steps = BeginUndo(); steps > 0; --steps)
 		UndoOne(pLeft, pRight, pBottom);
 
 	updateActiveView(pLeft, pRight, pBottom);
@@ -118,8 +190,9 @@ bool CUndo::Undo(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
 
 void CUndo::UndoOne(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
 {
-	allviewstate allstate = m_viewstates.back();
+	allviewstate allstate = std::move(m_viewstates.back());
 	POINT pt = m_caretpoints.back();
+	m_memoryUsage -= allstate.GetMemoryUsage();
 
 	if (pLeft->IsTarget())
 		m_redocaretpoints.push_back(pLeft->GetCaretPosition());
@@ -139,7 +212,7 @@ void CUndo::UndoOne(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
 	allstate.right  = Do(allstate.right, pRight, pt);
 	allstate.bottom = Do(allstate.bottom, pBottom, pt);
 
-	m_redoviewstates.push_back(allstate);
+	m_redoviewstates.push_back(std::move(allstate));
 
 	m_viewstates.pop_back();
 	m_caretpoints.pop_back();
@@ -150,17 +223,7 @@ bool CUndo::Redo(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
 	if (!CanRedo())
 		return false;
 
-	if (m_redogroups.size() && m_redogroups.back() == m_redocaretpoints.size())
-	{
-		m_redogroups.pop_back();
-		std::list<int>::size_type b = m_redogroups.back();
-		m_groups.push_back(b);
-		m_groups.push_back(m_redocaretpoints.size());
-		m_redogroups.pop_back();
-		while (b < m_redocaretpoints.size())
-			RedoOne(pLeft, pRight, pBottom);
-	}
-	else
+	for (size_t steps = BeginRedo(); steps > 0; --steps)
 		RedoOne(pLeft, pRight, pBottom);
 
 	updateActiveView(pLeft, pRight, pBottom);
@@ -170,7 +233,7 @@ bool CUndo::Redo(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom)
 
 void CUndo::RedoOne(CBaseView* pLeft, CBaseView* pRight, CBaseView* pBottom)
 {
-	allviewstate allstate = m_redoviewstates.back();
+	allviewstate allstate = std::move(m_redoviewstates.back());
 	POINT pt = m_redocaretpoints.back();
 
 	if (pLeft->IsTarget())
@@ -191,7 +254,8 @@ void CUndo::RedoOne(CBaseView* pLeft, CBaseView* pRight, CBaseView* pBottom)
 	allstate.right = Do(allstate.right, pRight, pt);
 	allstate.bottom = Do(allstate.bottom, pBottom, pt);
 
-	m_viewstates.push_back(allstate);
+	m_memoryUsage += allstate.GetMemoryUsage();
+	m_viewstates.push_back(std::move(allstate));
 
 	m_redoviewstates.pop_back();
 	m_redocaretpoints.pop_back();
@@ -254,46 +318,48 @@ viewstate CUndo::Do(const viewstate& state, CBaseView * pView, const POINT& pt)
 	viewstate revstate; // the reversed viewstate
 	revstate.modifies = state.modifies;
 
-	for (std::list<int>::const_reverse_iterator it = state.addedlines.rbegin(); it != state.addedlines.rend(); ++it)
-	{
-		revstate.removedlines[*it] = viewData->GetData(*it);
-		viewData->RemoveData(*it);
-	}
-	for (std::map<int, DWORD>::const_iterator it = state.linelines.begin(); it != state.linelines.end(); ++it)
-	{
-		revstate.linelines[it->first] = viewData->GetLineNumber(it->first);
-		viewData->SetLineNumber(it->first, it->second);
-	}
-	for (auto it = state.linestates.cbegin(); it != state.linestates.cend(); ++it)
-	{
-		revstate.linestates[it->first] = viewData->GetState(it->first);
-		viewData->SetState(it->first, it->second);
-	}
-	for (std::map<int, EOL>::const_iterator it = state.linesEOL.begin(); it != state.linesEOL.end(); ++it)
-	{
-		revstate.linesEOL[it->first] = viewData->GetLineEnding(it->first);
-		viewData->SetLineEnding(it->first, it->second);
-	}
-	for (std::map<int, bool>::const_iterator it = state.markedlines.begin(); it != state.markedlines.end(); ++it)
-	{
-		revstate.markedlines[it->first] = viewData->GetMarked(it->first);
-		viewData->SetMarked(it->first, it->second);
-	}
-	for (std::map<int, CString>::const_iterator it = state.difflines.begin(); it != state.difflines.end(); ++it)
-	{
-		revstate.difflines[it->first] = viewData->GetLine(it->first);
-		viewData->SetLine(it->first, it->second);
-	}
-	for (std::map<int, viewdata>::const_iterator it = state.removedlines.begin(); it != state.removedlines.end(); ++it)
+	for (auto it = state.addedlines.crbegin(); it != state.addedlines.crend();)
 	{
-		revstate.addedlines.push_back(it->first);
-		viewData->InsertData(it->first, it->second);
+		// lines added one after another are removed as one range
+		const int last = *it;
+		int first = last;
+		for (++it; it != state.addedlines.crend() && *it == first - 1; ++it)
+			--first;
+		for (int i = first; i <= last; ++i)
+			revstate.removedlines.Set(i, viewData->GetData(i));
+		viewData->RemoveData(first, last - first + 1);
 	}
-	for (std::map<int, viewdata>::const_iterator it = state.replacedlines.begin(); it != state.replacedlines.end(); ++it)
+	state.linelines.ForEach([&](int index, DWORD linenumber) {
+		revstate.linelines.Set(index, viewData->GetLineNumber(index));
+		viewData->SetLineNumber(index, linenumber);
+	});
+	state.linestates.ForEach([&](int index, DiffState linestate) {
+		revstate.linestates.Set(index, viewData->GetState(index));
+		viewData->SetState(index, linestate);
+	});
+	state.linesEOL.ForEach([&](int index, EOL ending) {
+		revstate.linesEOL.Set(index, viewData->GetLineEnding(index));
+		viewData->SetLineEnding(index, ending);
+	});
+	state.markedlines.ForEach([&](int index, bool marked) {
+		revstate.markedlines.Set(index, viewData->GetMarked(index));
+		viewData->SetMarked(index, marked);
+	});
+	state.difflines.ForEach([&](int index, const CString& sLine) {
+		revstate.difflines.Set(index, viewData->GetLine(index));
+		viewData->SetLine(index, sLine);
+	});
+	for (const auto& range : state.removedlines.GetRanges())
 	{
-		revstate.replacedlines[it->first] = viewData->GetData(it->first);
-		viewData->SetData(it->first, it->second);
+		for (int i = 0; i < range.count; ++i)
+			revstate.addedlines.push_back(range.start + i);
+		viewData->InsertData(range.start, state.removedlines.GetValues(range), range.count);
 	}
+	state.replacedlines.ForEach([&](int index, const viewdata& data) {
+		revstate.replacedlines.Set(index, viewData->GetData(index));
+		viewData->SetData(index, data);
+	});
+	revstate.Compact();
 
 	if (pView->IsTarget())
 	{
@@ -302,6 +368,7 @@ viewstate CUndo::Do(const viewstate& state, CBaseView * pView, const POINT& pt)
 	}
 	return revstate;
 }
+#endif
 
 void CUndo::Clear()
 {
@@ -315,4 +382,5 @@ void CUndo::Clear()
 	m_originalstateRight = 0;
 	m_originalstateBottom = 0;
 	m_groupCount = 0;
+	m_memoryUsage = 0;
 }
@@ -1,5 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
+// Copyright (C) 2026 - TortoiseGit
 // Copyright (C) 2006-2007,2009-2015 - TortoiseSVN
 // Copyright (C) 2011, 2023 Sven Strickroth <email@cs-ware.de>
 
@@ -19,11 +20,125 @@
 //
 #pragma once
 #include "ViewData.h"
-#include <map>
 #include <list>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 
 class CBaseView;
 
+/**
+ * \ingroup TortoiseMerge
+ * Holds the values of one property of the lines changed in a single step.
+ * Lines with consecutive indexes are kept as ranges and all values are stored
+ * in one contiguous buffer. As with a map, the last value set for an index
+ * wins and the values are enumerated in ascending index order, once Compact()
+ * was called.
+ */
+template <typename T>
+class CUndoLineValues
+{
+public:
+	struct Range
+	{
+		int		start;
+		int		count;
+		size_t	offset;
+	};
+
+	void Set(int index, const T& value)
+	{
+		if (!m_ranges.empty())
+		{
+			Range& last = m_ranges.back();
+			if (index >= last.start && index < last.start + last.count)
+			{
+				m_values[last.offset + (index - last.start)] = value;
+				return;
+			}
+			if (index == last.start + last.count)
+			{
+				++last.count;
+				m_values.push_back(value);
+				return;
+			}
+			if (index < last.start)
+				m_bSorted = false;
+		}
+		m_ranges.push_back({ index, 1, m_values.size() });
+		m_values.push_back(value);
+	}
+
+	/// sorts the ranges and drops overwritten values, required before enumerating
+	void Compact()
+	{
+		if (!m_bSorted)
+		{
+			// ranges are in the order they were written, so the stable sort keeps the last value of an index at the end
+			std::vector<std::pair<int, size_t>> entries;
+			entries.reserve(m_values.size());
+			for (const auto& range : m_ranges)
+			{
+				for (int i = 0; i < range.count; ++i)
+					entries.emplace_back(range.start + i, range.offset + i);
+			}
+			std::stable_sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+			std::vector<T> values;
+			values.reserve(entries.size());
+			m_ranges.clear();
+			for (size_t i = 0; i < entries.size(); ++i)
+			{
+				if (i + 1 < entries.size() && entries[i + 1].first == entries[i].first)
+					continue;
+				if (!m_ranges.empty() && m_ranges.back().start + m_ranges.back().count == entries[i].first)
+					++m_ranges.back().count;
+				else
+					m_ranges.push_back({ entries[i].first, 1, values.size() });
+				values.push_back(std::move(m_values[entries[i].second]));
+			}
+			m_values.swap(values);
+			m_bSorted = true;
+		}
+		m_ranges.shrink_to_fit();
+		m_values.shrink_to_fit();
+	}
+
+	template <typename Func>
+	void ForEach(Func func) const
+	{
+		for (const auto& range : m_ranges)
+		{
+			for (int i = 0; i < range.count; ++i)
+				func(range.start + i, m_values[range.offset + i]);
+		}
+	}
+
+	const std::vector<Range>& GetRanges() const { return m_ranges; }
+	const T* GetValues(const Range& range) const { return m_values.data() + range.offset; }
+
+	/// estimated memory usage, text buffers are counted even if they are shared with a view
+	size_t GetMemoryUsage() const
+	{
+		size_t size = m_ranges.capacity() * sizeof(Range) + m_values.capacity() * sizeof(T);
+		for (const auto& value : m_values)
+		{
+			if constexpr (std::is_same_v<T, CString>)
+				size += value.GetLength() * sizeof(wchar_t);
+			else if constexpr (std::is_same_v<T, viewdata>)
+				size += value.sLine.GetLength() * sizeof(wchar_t);
+		}
+		return size;
+	}
+
+	bool empty() const { return m_ranges.empty(); }
+	void clear() { m_ranges.clear(); m_values.clear(); m_bSorted = true; }
+
+private:
+	std::vector<Range>	m_ranges;
+	std::vector<T>		m_values;
+	bool				m_bSorted = true;
+};
+
 /**
  * \ingroup TortoiseMerge
  * this struct holds all the information of a single change in TortoiseMerge.
@@ -34,19 +149,21 @@ public:
 	viewstate()
 	{}
 
-	std::map<int, CString>	difflines;
-	std::map<int, DiffState>	linestates;
-	std::map<int, DWORD>	linelines;
-	std::map<int, EOL>		linesEOL;
-	std::map<int, bool>		markedlines;
-	std::list<int>			addedlines;
+	CUndoLineValues<CString>	difflines;
+	CUndoLineValues<DiffState>	linestates;
+	CUndoLineValues<DWORD>		linelines;
+	CUndoLineValues<EOL>		linesEOL;
+	CUndoLineValues<bool>		markedlines;
+	std::vector<int>			addedlines;
 
-	std::map<int, viewdata> removedlines;
-	std::map<int, viewdata> replacedlines;
+	CUndoLineValues<viewdata>	removedlines;
+	CUndoLineValues<viewdata>	replacedlines;
 	bool					modifies = false; ///< this step modifies view (save before and after save differs)
 
 	void	AddViewLineFromView(CBaseView *pView, int nViewLine, bool bAddEmptyLine);
 	void	Clear();
+	void	Compact();
+	size_t	GetMemoryUsage() const;
 	bool	IsEmpty() const { return difflines.empty() && linestates.empty() && linelines.empty() && linesEOL.empty() && markedlines.empty() && addedlines.empty() && removedlines.empty() && replacedlines.empty(); }
 };
 
@@ -61,13 +178,16 @@ struct allviewstate
 	viewstate left;
 
 	void	Clear() { right.Clear(); bottom.Clear(); left.Clear(); }
+	void	Compact() { right.Compact(); bottom.Compact(); left.Compact(); }
 	bool	IsEmpty() const { return right.IsEmpty() && bottom.IsEmpty() && left.IsEmpty(); }
+	size_t	GetMemoryUsage() const { return right.GetMemoryUsage() + bottom.GetMemoryUsage() + left.GetMemoryUsage(); }
 };
 
 /**
  * \ingroup TortoiseMerge
  * Holds all the information of previous changes made to a view content.
  * Of course, can undo those changes.
+ * If the undo steps need more memory than configured, the oldest ones are dropped.
  */
 class CUndo
 {
@@ -92,6 +212,11 @@ protected:
 	void UndoOne(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom);
 	void RedoOne(CBaseView * pLeft, CBaseView * pRight, CBaseView * pBottom);
 	void updateActiveView(CBaseView* pLeft, CBaseView* pRight, CBaseView* pBottom) const;
+	/// moves the group of the last step to the redo groups, returns the number of steps to undo
+	size_t BeginUndo();
+	/// moves the group of the last undone step back, returns the number of steps to redo
+	size_t BeginRedo();
+	void DropOldestStates();
 	std::list<allviewstate> m_viewstates;
 	std::list<POINT> m_caretpoints;
 	std::list< std::list<int>::size_type > m_groups;
@@ -99,12 +224,17 @@ protected:
 	__int64 m_originalstateRight = 0;
 	__int64 m_originalstateBottom = 0;
 	int m_groupCount = 0;
+	size_t m_memoryUsage = 0;
+	size_t m_maxMemoryUsage = 0; ///< 0 for no limit
 
 	std::list<allviewstate> m_redoviewstates;
 	std::list<POINT> m_redocaretpoints;
 	std::list< std::list<int>::size_type > m_redogroups;
 
 private:
+#ifdef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
+public:
+#endif
 	CUndo();
 	~CUndo();
 };
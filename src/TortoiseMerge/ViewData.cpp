@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2023 - TortoiseGit
+// Copyright (C) 2023, 2026 - TortoiseGit
 // Copyright (C) 2007,2009-2010, 2014 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -20,6 +20,8 @@
 #include "stdafx.h"
 #include "ViewData.h"
 
+static_assert(sizeof(viewdata) <= sizeof(CString) + 4 * sizeof(int), "viewdata is stored for every line of every view");
+
 CViewData::CViewData()
 {
 }
@@ -30,14 +32,7 @@ CViewData::~CViewData()
 
 void CViewData::AddData(const CString& sLine, DiffState state, int linenumber, EOL ending, HideState hide, int movedIndex)
 {
-	viewdata data;
-	data.sLine = sLine;
-	data.state = state;
-	data.linenumber = linenumber;
-	data.ending = ending;
-	data.hidestate = hide;
-	data.movedIndex = movedIndex;
-	return AddData(data);
+	m_data.emplace_back(sLine, state, linenumber, ending, hide).movedIndex = movedIndex;
 }
 
 void CViewData::AddData(const viewdata& data)
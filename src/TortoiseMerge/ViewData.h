@@ -1,6 +1,6 @@
 ﻿// TortoiseGitMerge - a Diff/Patch program
 
-// Copyright (C) 2023 - TortoiseGit
+// Copyright (C) 2023, 2026 - TortoiseGit
 // Copyright (C) 2007-2011, 2013-2014 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -33,6 +33,10 @@ enum class HideState
 /**
  * \ingroup TortoiseMerge
  * Holds the information which is required to define a single line of text.
+ * Every view keeps one of these per displayed line, so it is kept compact:
+ * sLine shares the (reference counted) buffer of the CFileTextLines line it
+ * was created from and only gets its own buffer once the line is edited,
+ * and the states are packed into bit fields.
  */
 class viewdata
 {
@@ -46,22 +50,22 @@ public:
 			EOL endingInit,
 			HideState hideInit,
 			bool markedInit = false)
-		: state(stateInit)
+		: sLine(sLineInit)
 		, linenumber(linenumberInit)
+		, state(stateInit)
 		, ending(endingInit)
 		, hidestate(hideInit)
 		, marked(markedInit)
-		, sLine(sLineInit)
 	{
 	}
 
 	CString			sLine;
-	DiffState		state = DiffState::Unknown;
 	int				linenumber = -1;
 	int				movedIndex = -1;
+	DiffState		state : 8 = DiffState::Unknown;
+	EOL				ending : 8 = EOL::AutoLine;
+	HideState		hidestate : 8 = HideState::Hidden;
 	bool			movedFrom = true;
-	EOL				ending = EOL::AutoLine;
-	HideState		hidestate = HideState::Hidden;
 	bool			marked = false;
 };
 
@@ -80,7 +84,9 @@ public:
 	void			AddEmpty() {AddData(CString(), DiffState::Empty, -1, EOL::NoEnding, HideState::Shown, -1);}
 	void			InsertData(int index, const CString& sLine, DiffState state, int linenumber, EOL ending, HideState hide, int movedline);
 	void			InsertData(int index, const viewdata& data);
+	void			InsertData(int index, const viewdata* data, int count) { m_data.insert(m_data.begin() + index, data, data + count); }
 	void			RemoveData(int index) {m_data.erase(m_data.begin() + index);}
+	void			RemoveData(int index, int count) { m_data.erase(m_data.begin() + index, m_data.begin() + index + count); }
 
 	const viewdata&	GetData(int index) const {return m_data[index];}
 	const CString&	GetLine(int index) const {return m_data[index].sLine;}
@@ -0,0 +1,227 @@
+﻿// TortoiseGitMerge - a Diff/Patch program
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "stdafx.h"
+#include <unordered_map>
+extern "C" {
+#include "diff.h"
+}
+#include "private/svn_adler32.h"
+#include "SVNMemoryDiff.h"
+#include "HistogramDiff.h"
+
+// svn_diff_file_diff_2() keeps that many lines of the identical suffix, so that the diff can still be shifted into it
+static const size_t SUFFIX_LINES_TO_KEEP = 50;
+
+const svn_diff_fns2_t SVNMemoryDiff::SVNMemoryDiff_vtable =
+{
+	SVNMemoryDiff::datasources_open,
+	SVNMemoryDiff::datasource_close,
+	SVNMemoryDiff::next_token,
+	SVNMemoryDiff::compare_token,
+	SVNMemoryDiff::discard_token,
+	SVNMemoryDiff::discard_all_token
+};
+
+void SVNMemoryDiff::SetDatasource(svn_diff_datasource_e datasource, std::string&& text, std::vector<size_t>&& lineStarts)
+{
+	auto& source = GetDatasource(datasource);
+	source.text = std::move(text);
+	source.lineStarts = std::move(lineStarts);
+	source.tokens.clear();
+	source.next = source.end = 0;
+}
+
+svn_error_t* SVNMemoryDiff::Diff(svn_diff_t** diff, const svn_diff_file_options_t* options, apr_pool_t* pool)
+{
+	m_options = options;
+	if (m_bHistogramDiff)
+		return DiffHistogram(diff, pool);
+	return svn_diff_diff_2(diff, this, &SVNMemoryDiff_vtable, pool);
+}
+
+svn_error_t* SVNMemoryDiff::Diff3(svn_diff_t** diff, const svn_diff_file_options_t* options, apr_pool_t* pool)
+{
+	m_options = options;
+	return svn_diff_diff3_2(diff, this, &SVNMemoryDiff_vtable, pool);
+}
+
+static svn_diff__lcs_t* PrependLcs(svn_diff__lcs_t* next, apr_off_t offset1, apr_off_t offset2, apr_off_t length, apr_pool_t* pool)
+{
+	auto lcs = static_cast<svn_diff__lcs_t*>(apr_palloc(pool, sizeof(svn_diff__lcs_t)));
+	lcs->position[0] = static_cast<svn_diff__position_t*>(apr_pcalloc(pool, sizeof(svn_diff__position_t)));
+	lcs->position[0]->offset = offset1;
+	lcs->position[1] = static_cast<svn_diff__position_t*>(apr_pcalloc(pool, sizeof(svn_diff__position_t)));
+	lcs->position[1]->offset = offset2;
+	lcs->length = length;
+	lcs->refcount = 1;
+	lcs->next = next;
+	return lcs;
+}
+
+svn_error_t* SVNMemoryDiff::DiffHistogram(svn_diff_t** diff, apr_pool_t* pool)
+{
+	const svn_diff_datasource_e datasources[] = { svn_diff_datasource_original, svn_diff_datasource_modified };
+	apr_off_t prefix_lines = 0;
+	apr_off_t suffix_lines = 0;
+	SVN_ERR(datasources_open(this, &prefix_lines, &suffix_lines, datasources, 2));
+
+	// intern the lines between prefix and suffix, equal lines get the same id
+	std::unordered_map<std::string_view, uint32_t> ids;
+	std::vector<uint32_t> lines[2];
+	apr_off_t tokenCount[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		const auto& source = GetDatasource(datasources[i]);
+		tokenCount[i] = static_cast<apr_off_t>(source.tokens.size());
+		lines[i].reserve(source.end - source.next);
+		for (size_t t = source.next; t < source.end; ++t)
+		{
+			const auto& token = source.tokens[t];
+			lines[i].push_back(ids.try_emplace(std::string_view(token.data, token.length), static_cast<uint32_t>(ids.size())).first->second);
+		}
+	}
+	discard_all_token(this);
+	ids.clear();
+
+	const auto runs = CHistogramDiff::Diff(lines[0], lines[1], true);
+
+	// build the same chain svn_diff__lcs() returns: prefix, common runs, suffix and the EOF sentinel, with 1-based offsets
+	svn_diff__lcs_t* lcs = PrependLcs(nullptr, tokenCount[0] + 1, tokenCount[1] + 1, 0, pool);
+	if (suffix_lines)
+		lcs = PrependLcs(lcs, tokenCount[0] - suffix_lines + 1, tokenCount[1] - suffix_lines + 1, suffix_lines, pool);
+	for (auto it = runs.crbegin(); it != runs.crend(); ++it)
+		lcs = PrependLcs(lcs, prefix_lines + static_cast<apr_off_t>(it->start1) + 1, prefix_lines + static_cast<apr_off_t>(it->start2) + 1, static_cast<apr_off_t>(it->length), pool);
+	if (prefix_lines)
+		lcs = PrependLcs(lcs, 1, 1, prefix_lines, pool);
+
+	*diff = svn_diff__diff(lcs, 1, 1, TRUE, pool);
+	return SVN_NO_ERROR;
+}
+
+void SVNMemoryDiff::Tokenize(SDatasource& source) const
+{
+	source.tokens.clear();
+	if (source.lineStarts.size() < 2)
+		return;
+	source.tokens.reserve(source.lineStarts.size() - 1);
+	// normalize in place, just like the svn file diff does on its read buffer
+	svn_diff__normalize_state_t state = svn_diff__normalize_state_normal;
+	for (size_t i = 0; i + 1 < source.lineStarts.size(); ++i)
+	{
+		char* line = source.text.data() + source.lineStarts[i];
+		auto length = static_cast<apr_off_t>(source.lineStarts[i + 1] - source.lineStarts[i]);
+		// the svn file diff does not create a token for an empty last line without EOL
+		if (length == 0)
+			continue;
+		char* normalized = line;
+		svn_diff__normalize_buffer(&normalized, &length, &state, line, m_options);
+		source.tokens.push_back({ normalized, static_cast<apr_size_t>(length), svn__adler32(0, normalized, length) });
+	}
+}
+
+bool SVNMemoryDiff::IsEqual(const SToken& token1, const SToken& token2)
+{
+	return token1.hash == token2.hash && token1.length == token2.length && memcmp(token1.data, token2.data, token1.length) == 0;
+}
+
+svn_error_t* SVNMemoryDiff::datasources_open(void* baton, apr_off_t* prefix_lines, apr_off_t* suffix_lines, const svn_diff_datasource_e* datasources, apr_size_t datasources_len)
+{
+	auto memorydiff = static_cast<SVNMemoryDiff*>(baton);
+	size_t minTokens = SIZE_MAX;
+	for (apr_size_t i = 0; i < datasources_len; ++i)
+	{
+		auto& source = memorydiff->GetDatasource(datasources[i]);
+		memorydiff->Tokenize(source);
+		minTokens = std::min(minTokens, source.tokens.size());
+	}
+
+	// skip the identical prefix and suffix, they don't need to go through the LCS
+	const auto& first = memorydiff->GetDatasource(datasources[0]);
+	// index is counted from the end of the tokens if fromEnd is set
+	auto allEqual = [&](size_t index, bool fromEnd) {
+		const auto& token = first.tokens[fromEnd ? first.tokens.size() - 1 - index : index];
+		for (apr_size_t i = 1; i < datasources_len; ++i)
+		{
+			const auto& source = memorydiff->GetDatasource(datasources[i]);
+			if (!IsEqual(token, source.tokens[fromEnd ? source.tokens.size() - 1 - index : index]))
+				return false;
+		}
+		return true;
+	};
+	size_t prefix = 0;
+	while (prefix < minTokens && allEqual(prefix, false))
+		++prefix;
+	size_t suffix = 0;
+	while (prefix + suffix < minTokens && allEqual(suffix, true))
+		++suffix;
+	suffix = suffix > SUFFIX_LINES_TO_KEEP ? suffix - SUFFIX_LINES_TO_KEEP : 0;
+
+	for (apr_size_t i = 0; i < datasources_len; ++i)
+	{
+		auto& source = memorydiff->GetDatasource(datasources[i]);
+		source.next = prefix;
+		source.end = source.tokens.size() - suffix;
+	}
+	*prefix_lines = static_cast<apr_off_t>(prefix);
+	*suffix_lines = static_cast<apr_off_t>(suffix);
+
+	return SVN_NO_ERROR;
+}
+
+svn_error_t* SVNMemoryDiff::datasource_close(void* /*baton*/, svn_diff_datasource_e /*datasource*/)
+{
+	return SVN_NO_ERROR;
+}
+
+svn_error_t* SVNMemoryDiff::next_token(apr_uint32_t* hash, void** token, void* baton, svn_diff_datasource_e datasource)
+{
+	auto memorydiff = static_cast<SVNMemoryDiff*>(baton);
+	auto& source = memorydiff->GetDatasource(datasource);
+	*token = nullptr;
+	if (source.next < source.end)
+	{
+		auto& current = source.tokens[source.next++];
+		*token = &current;
+		*hash = current.hash;
+	}
+	return SVN_NO_ERROR;
+}
+
+svn_error_t* SVNMemoryDiff::compare_token(void* /*baton*/, void* token1, void* token2, int* compare)
+{
+	auto t1 = static_cast<const SToken*>(token1);
+	auto t2 = static_cast<const SToken*>(token2);
+	if (t1->length != t2->length)
+		*compare = t1->length < t2->length ? -1 : 1;
+	else
+		*compare = memcmp(t1->data, t2->data, t1->length);
+	return SVN_NO_ERROR;
+}
+
+void SVNMemoryDiff::discard_token(void* /*baton*/, void* /*token*/)
+{
+}
+
+void SVNMemoryDiff::discard_all_token(void* baton)
+{
+	// the diff only works on token indexes from now on, the text isn't needed anymore either
+	auto memorydiff = static_cast<SVNMemoryDiff*>(baton);
+	for (auto& source : memorydiff->m_datasources)
+		source = SDatasource();
+}
@@ -0,0 +1,85 @@
+﻿// TortoiseGitMerge - a Diff/Patch program
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+#include "svn_diff.h"
+
+/**
+ * \ingroup TortoiseMerge
+ * Runs the Subversion line diff on text which is already in memory (see CFileTextLines::GetNormalizedText()),
+ * so that converted files do not need to be written to temp files and read back by svn_diff_file_diff_2().
+ * Lines are compared exactly like svn_diff_file_diff_2() compares them, i.e. the ignore options
+ * for whitespaces and EOLs are applied to every line.
+ * Two-way diffs can use CHistogramDiff instead of the LCS of the Subversion diff, the result
+ * has the same svn_diff_t structure.
+ */
+class SVNMemoryDiff
+{
+public:
+	SVNMemoryDiff() = default;
+	SVNMemoryDiff(const SVNMemoryDiff&) = delete;
+	SVNMemoryDiff& operator=(const SVNMemoryDiff&) = delete;
+
+	/**
+	 * Sets the text of a datasource
+	 * \param lineStarts the offset of every line in text plus the length of text as last entry
+	 */
+	void SetDatasource(svn_diff_datasource_e datasource, std::string&& text, std::vector<size_t>&& lineStarts);
+
+	/// use CHistogramDiff for Diff()
+	void SetHistogramDiff(bool bHistogram) { m_bHistogramDiff = bHistogram; }
+
+	/// like svn_diff_file_diff_2(), uses the datasources original and modified
+	svn_error_t* Diff(svn_diff_t** diff, const svn_diff_file_options_t* options, apr_pool_t* pool);
+	/// like svn_diff_file_diff3_2(), uses the datasources original, modified and latest
+	svn_error_t* Diff3(svn_diff_t** diff, const svn_diff_file_options_t* options, apr_pool_t* pool);
+
+private:
+	struct SToken
+	{
+		const char*		data;
+		apr_size_t		length;
+		apr_uint32_t	hash;
+	};
+
+	struct SDatasource
+	{
+		std::string				text;
+		std::vector<size_t>		lineStarts;
+		std::vector<SToken>		tokens;
+		size_t					next = 0;
+		size_t					end = 0;
+	};
+
+	SDatasource& GetDatasource(svn_diff_datasource_e datasource) { return m_datasources[static_cast<int>(datasource)]; }
+	void Tokenize(SDatasource& source) const;
+	svn_error_t* DiffHistogram(svn_diff_t** diff, apr_pool_t* pool);
+	static bool IsEqual(const SToken& token1, const SToken& token2);
+
+	static svn_error_t* datasources_open(void* baton, apr_off_t* prefix_lines, apr_off_t* suffix_lines, const svn_diff_datasource_e* datasources, apr_size_t datasources_len);
+	static svn_error_t* datasource_close(void* baton, svn_diff_datasource_e datasource);
+	static svn_error_t* next_token(apr_uint32_t* hash, void** token, void* baton, svn_diff_datasource_e datasource);
+	static svn_error_t* compare_token(void* baton, void* token1, void* token2, int* compare);
+	static void discard_token(void* baton, void* token);
+	static void discard_all_token(void* baton);
+	static const svn_diff_fns2_t SVNMemoryDiff_vtable;
+
+	SDatasource							m_datasources[svn_diff_datasource_ancestor + 1];
+	const svn_diff_file_options_t*		m_options = nullptr;
+	bool								m_bHistogramDiff = false;
+};
@@ -0,0 +1,71 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+
+/**
+ * \ingroup TortoiseProc
+ * Collects many small writes to a file in a buffer, used for writing the segments of the log cache side files.
+ */
+class CBufferedFileWriter
+{
+public:
+	explicit CBufferedFileWriter(HANDLE file)
+		: m_File(file)
+	{
+		m_Buffer.reserve(BufferSize);
+	}
+
+	bool Write(const void* data, size_t length)
+	{
+		if (m_Buffer.size() + length > BufferSize && !Flush())
+			return false;
+		if (length > BufferSize)
+			return WriteAll(data, length);
+		auto p = static_cast<const BYTE*>(data);
+		m_Buffer.insert(m_Buffer.end(), p, p + length);
+		return true;
+	}
+
+	bool Flush()
+	{
+		const bool ret = WriteAll(m_Buffer.data(), m_Buffer.size());
+		m_Buffer.clear();
+		return ret;
+	}
+
+private:
+	bool WriteAll(const void* data, size_t length)
+	{
+		auto p = static_cast<const BYTE*>(data);
+		while (length > 0)
+		{
+			const DWORD chunk = static_cast<DWORD>(min(length, static_cast<size_t>(BufferSize)));
+			DWORD written = 0;
+			if (!WriteFile(m_File, p, chunk, &written, nullptr) || written != chunk)
+				return false;
+			p += chunk;
+			length -= chunk;
+		}
+		return true;
+	}
+
+	static constexpr size_t BufferSize = 1024 * 1024;
+	HANDLE m_File;
+	std::vector<BYTE> m_Buffer;
+};
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2018-2023 - TortoiseGit
+// Copyright (C) 2018-2023, 2026 - TortoiseGit
 // Copyright (C) 2010-2017 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -19,6 +19,9 @@
 //
 #include "stdafx.h"
 #include "FilterHelper.h"
+#include "UnicodeUtils.h"
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include "pcre2.h"
 
 // filter utiltiy method
 bool CFilterHelper::Match(std::wstring& text) const
@@ -70,6 +73,22 @@ bool CFilterHelper::Match(std::wstring& text) const
 		}
 	}
 
+	if (!m_jitPatterns.empty())
+	{
+		thread_local std::unique_ptr<pcre2_match_data, decltype(&pcre2_match_data_free)> matchData{ pcre2_match_data_create(1, nullptr), &pcre2_match_data_free };
+		if (matchData)
+		{
+			const std::string textUTF8 = CUnicodeUtils::StdGetUTF8(text);
+			for (const auto& pattern : m_jitPatterns)
+			{
+				// a result of 0 still is a match, the ovector was just too small for all captures
+				if (pcre2_match(pattern.get(), reinterpret_cast<PCRE2_SPTR>(textUTF8.c_str()), textUTF8.size(), 0, PCRE2_NO_UTF_CHECK, matchData.get(), nullptr) < 0)
+					return false;
+			}
+			return true;
+		}
+	}
+
 	for (const auto& pattern : m_patterns)
 	{
 		try
@@ -165,6 +184,111 @@ bool CFilterHelper::ValidateRegexp(const CString& regexp_str, std::vector<std::w
 	return false;
 }
 
+// compiles the regex with PCRE2 for matching, which is much faster than std::wregex
+// the options keep it as close to ECMAScript as possible: "$" only matches at the very end (the texts to match end with "\n"),
+// \d, \w etc. only match ASCII characters (no PCRE2_UCP) and \u is a hex escape
+bool CFilterHelper::CompileJitPattern(const CString& regexp_str)
+{
+	const CStringA pattern = CUnicodeUtils::GetUTF8(regexp_str);
+	int errorCode = 0;
+	PCRE2_SIZE errorOffset = 0;
+	pcre2_code* code = pcre2_compile(reinterpret_cast<PCRE2_SPTR>(static_cast<LPCSTR>(pattern)), pattern.GetLength(), PCRE2_UTF | PCRE2_DOLLAR_ENDONLY | PCRE2_ALT_BSUX | (m_bCaseSensitive ? 0 : PCRE2_CASELESS), &errorCode, &errorOffset, nullptr);
+	if (!code)
+		return false;
+
+	// falls back to the interpreter if JIT is not available
+	pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+	m_jitPatterns.emplace_back(code, pcre2_code_free);
+	return true;
+}
+
+// only plain runs of characters outside of groups, classes and escapes are taken,
+// any character followed by a quantifier might be missing in a match
+void CFilterHelper::GetRegexLiterals(const CString& regexp_str, bool caseSensitive, std::vector<std::wstring>& literals)
+{
+	// alternatives and groups could make any part optional
+	if (regexp_str.FindOneOf(L"|(") >= 0)
+		return;
+
+	std::wstring run;
+	auto endRun = [&run, &literals]() {
+		if (run.size() >= 3)
+		{
+			CString literal(run.c_str(), static_cast<int>(run.size()));
+			literal.MakeLower();
+			literals.emplace_back(static_cast<LPCWSTR>(literal));
+		}
+		run.clear();
+	};
+	const int length = regexp_str.GetLength();
+	for (int i = 0; i < length; ++i)
+	{
+		const wchar_t c = regexp_str[i];
+		switch (c)
+		{
+		case L'?':
+		case L'*':
+		case L'{':
+			if (!run.empty())
+				run.pop_back();
+			endRun();
+			if (c == L'{')
+			{
+				while (i < length && regexp_str[i] != L'}')
+					++i;
+			}
+			break;
+		case L'[':
+			endRun();
+			// a ']' right at the start is part of the class
+			i += (i + 1 < length && regexp_str[i + 1] == L'^') ? 2 : 1;
+			if (i < length && regexp_str[i] == L']')
+				++i;
+			for (; i < length && regexp_str[i] != L']'; ++i)
+			{
+				if (regexp_str[i] == L'\\')
+					++i;
+			}
+			break;
+		case L'\\':
+			endRun();
+			// escaped letters and digits might take arguments, e.g. \x41, \p{L} or \k<name>
+			if (++i < length && iswalnum(regexp_str[i]))
+			{
+				for (; i + 1 < length; ++i)
+				{
+					const wchar_t next = regexp_str[i + 1];
+					if (next == L'{' || next == L'<' || next == L'\'')
+					{
+						const wchar_t close = next == L'{' ? L'}' : next == L'<' ? L'>' : L'\'';
+						for (i += 2; i < length && regexp_str[i] != close; ++i)
+						{
+						}
+						break;
+					}
+					if (!iswalnum(next) && next != L'_')
+						break;
+				}
+			}
+			break;
+		case L'+':
+		case L'.':
+		case L'^':
+		case L'$':
+			endRun();
+			break;
+		default:
+			// Unicode case folding does not necessarily agree with the lower casing of the texts
+			if (!caseSensitive && c > 0x7F)
+				endRun();
+			else
+				run += c;
+			break;
+		}
+	}
+	endRun();
+}
+
 // construction utility
 void CFilterHelper::AddSubString(CString token, Prefix prefix)
 {
@@ -219,7 +343,12 @@ CFilterHelper::CFilterHelper(const CString& filter, bool filterWithRegex, DWORD
 	bool useRegex = filterWithRegex && !filterText.IsEmpty();
 
 	if (useRegex)
+	{
 		useRegex = ValidateRegexp(filterText, m_patterns);
+		// PCRE2 syntax differs slightly from ECMAScript, keep using std::wregex for patterns it rejects
+		if (useRegex)
+			CompileJitPattern(filterText);
+	}
 	else
 	{
 		// now split the search string into words so we can search for each of them
@@ -290,6 +419,23 @@ CFilterHelper::CFilterHelper(const CString& filter, bool filterWithRegex, DWORD
 			AddSubString(filterText.Tokenize(L" ", curPos), prefix);
 		}
 	}
+
+	if (!m_bNegate)
+	{
+		if (useRegex)
+			GetRegexLiterals(filterText, m_bCaseSensitive, m_requiredSubStrings);
+		else if (std::none_of(subStringConditions.cbegin(), subStringConditions.cend(), [](const SCondition& condition) { return condition.prefix == Prefix::Or; }))
+		{
+			for (const auto& condition : subStringConditions)
+			{
+				if (condition.prefix != Prefix::And)
+					continue;
+				CString subString(condition.subString.c_str(), static_cast<int>(condition.subString.size()));
+				subString.MakeLower();
+				m_requiredSubStrings.emplace_back(static_cast<LPCWSTR>(subString));
+			}
+		}
+	}
 }
 
 CFilterHelper::~CFilterHelper() {}
@@ -304,6 +450,8 @@ CFilterHelper& CFilterHelper::operator=(const CFilterHelper& rhs)
 
 		subStringConditions = rhs.subStringConditions;
 		m_patterns = rhs.m_patterns;
+		m_jitPatterns = rhs.m_jitPatterns;
+		m_requiredSubStrings = rhs.m_requiredSubStrings;
 
 		scratch.clear();
 	}
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2018-2019, 2021, 2023 - TortoiseGit
+// Copyright (C) 2018-2019, 2021, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -18,13 +18,23 @@
 //
 #pragma once
 #include <regex>
+#include <memory>
 
 class CGitLogListBase;
+struct pcre2_real_code_8;
 
 class CFilterHelper {
 private:
 	std::vector<std::wregex> m_patterns;
 
+#ifdef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
+public:
+#endif
+	/// m_patterns compiled with PCRE2 (JIT) for Match(); empty if PCRE2 could not compile them
+	std::vector<std::shared_ptr<pcre2_real_code_8>> m_jitPatterns;
+private:
+	bool CompileJitPattern(const CString& regexp_str);
+
 	/// sub-string matching info
 	enum class Prefix
 	{
@@ -65,6 +75,15 @@ private:
 	/// negate pattern matching result
 	bool m_bNegate = false;
 
+	/// sub-strings (lower case) every matching text contains, cf. GetRequiredSubStrings()
+	std::vector<std::wstring> m_requiredSubStrings;
+
+#ifdef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
+public:
+#endif
+	/// collects literal parts of the regex which any match has to contain
+	static void GetRegexLiterals(const CString& regexp_str, bool caseSensitive, std::vector<std::wstring>& literals);
+
 protected:
 	/// temp / scratch objects to minimize the number memory
 	/// allocation operations
@@ -99,4 +118,8 @@ public:
 	bool ValidateRegexp(const CString& regexp_str, std::vector<std::wregex>& patterns);
 
 	inline DWORD GetSelectedFilters() const { return m_dwAttributeSelector; }
+
+	/// returns the sub-strings (lower case) every text matching the filter contains,
+	/// empty if they cannot be determined, e.g. for negated filters or "+" alternatives
+	inline const std::vector<std::wstring>& GetRequiredSubStrings() const { return m_requiredSubStrings; }
 };
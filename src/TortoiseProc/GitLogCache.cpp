@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2019, 2023-2025 - TortoiseGit
+// Copyright (C) 2008-2019, 2023-2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -30,6 +30,7 @@ int static Compare(const void *p1, const void*p2)
 CLogCache::CLogCache()
 {
 	m_bEnabled = CRegDWORD(L"Software\\TortoiseGit\\EnableLogCache", TRUE);
+	m_bSearchIndex = CRegDWORD(L"Software\\TortoiseGit\\LogCacheSearchIndex", TRUE);
 }
 
 void CLogCache::CloseDataHandles()
@@ -70,6 +71,8 @@ void CLogCache::CloseIndexHandles()
 		CloseHandle(m_IndexFile);
 		m_IndexFile=INVALID_HANDLE_VALUE;
 	}
+
+	m_IndexTail.clear();
 }
 CLogCache::~CLogCache()
 {
@@ -83,23 +86,27 @@ GitRevLoglist* CLogCache::GetCacheData(const CGitHash& hash)
 	return &m_HashMap[hash];
 }
 
-ULONGLONG CLogCache::GetOffset(const CGitHash& hash, SLogCacheIndexFile* pData)
+ULONGLONG CLogCache::GetOffset(const CGitHash& hash) const
 {
-	if (!pData)
-		pData = m_pCacheIndex;
-
-	if (!pData)
+	if (!m_pCacheIndex)
 		return 0;
 
-	SLogCacheIndexItem* p = reinterpret_cast<SLogCacheIndexItem*>(bsearch(hash.ToRaw(), pData->m_Item,
-			pData->m_Header.m_ItemCount,
-			sizeof(SLogCacheIndexItem),
-			Compare));
+	// the fan-out table narrows the search down to the items sharing the first byte of the hash
+	const auto& header = m_pCacheIndex->m_Header;
+	const BYTE first = hash.ToRaw()[0];
+	const DWORD begin = first ? header.m_FanOut[first - 1] : 0;
+	const DWORD end = header.m_FanOut[first];
+	if (begin < end)
+	{
+		auto p = reinterpret_cast<const SLogCacheIndexItem*>(bsearch(hash.ToRaw(), m_pCacheIndex->m_Item + begin, end - begin, sizeof(SLogCacheIndexItem), Compare));
+		if (p)
+			return p->m_Offset;
+	}
 
-	if(p)
-		return p->m_Offset;
-	else
-		return 0;
+	if (auto it = m_IndexTail.find(hash); it != m_IndexTail.cend())
+		return it->second;
+
+	return 0;
 }
 
 int CLogCache::FetchCacheIndex(CString GitDir)
@@ -182,6 +189,11 @@ int CLogCache::FetchCacheIndex(CString GitDir)
 		if (size_t len; SizeTMult(sizeof(SLogCacheIndexItem), m_pCacheIndex->m_Header.m_ItemCount, &len) != S_OK || SizeTAdd(len, sizeof(SLogCacheIndexHeader), &len) != S_OK || static_cast<size_t>(indexFileSize.QuadPart) != len)
 			break;
 
+		m_IndexTail.clear();
+		m_IndexTail.reserve(m_pCacheIndex->m_Header.m_ItemCount - m_pCacheIndex->m_Header.m_SortedCount);
+		for (DWORD i = m_pCacheIndex->m_Header.m_SortedCount; i < m_pCacheIndex->m_Header.m_ItemCount; ++i)
+			m_IndexTail.try_emplace(m_pCacheIndex->m_Item[i].m_Hash, m_pCacheIndex->m_Item[i].m_Offset);
+
 		if(	m_DataFile == INVALID_HANDLE_VALUE )
 		{
 			CString file = m_GitDir + DATA_FILE_NAME;
@@ -236,7 +248,12 @@ int CLogCache::FetchCacheIndex(CString GitDir)
 		CloseDataHandles();
 		::DeleteFile(m_GitDir + INDEX_FILE_NAME);
 		::DeleteFile(m_GitDir + DATA_FILE_NAME);
+		m_SearchIndex.Close();
 	}
+	else if (m_bSearchIndex)
+		m_SearchIndex.Load(m_GitDir);
+	// the changed paths do not depend on the other cache files
+	m_PathLists.Load(m_GitDir);
 	return ret;
 }
 
@@ -367,11 +384,10 @@ int CLogCache::LoadOneItem(GitRevLoglist& Rev, ULONGLONG ullOffset)
 }
 int CLogCache::RebuildCacheFile()
 {
-	SLogCacheIndexHeader Indexheader;
+	SLogCacheIndexHeader Indexheader{};
 
 	Indexheader.m_Magic = LOG_INDEX_MAGIC;
 	Indexheader.m_Version = LOG_INDEX_VERSION;
-	Indexheader.m_ItemCount =0;
 
 	SLogCacheDataFileHeader dataheader;
 
@@ -389,6 +405,61 @@ int CLogCache::RebuildCacheFile()
 	SetEndOfFile(this->m_DataFile);
 	return 0;
 }
+
+// merges the unsorted tail of the index file into its sorted part and rewrites the fan-out table
+int CLogCache::CompactIndexFile(SLogCacheIndexHeader& header)
+{
+	std::vector<SLogCacheIndexItem> items;
+	try
+	{
+		items.resize(header.m_ItemCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return -1;
+	}
+
+	LARGE_INTEGER start{};
+	start.QuadPart = sizeof(SLogCacheIndexHeader);
+	if (!SetFilePointerEx(m_IndexFile, start, nullptr, FILE_BEGIN))
+		return -1;
+
+	size_t len;
+	if (SizeTMult(sizeof(SLogCacheIndexItem), header.m_ItemCount, &len) != S_OK || len > MAXDWORD)
+		return -1;
+	if (DWORD num = 0; !ReadFile(m_IndexFile, items.data(), static_cast<DWORD>(len), &num, 0) || num != len)
+		return -1;
+
+	auto byHash = [](const SLogCacheIndexItem& a, const SLogCacheIndexItem& b) { return a.m_Hash < b.m_Hash; };
+	auto tail = items.begin() + header.m_SortedCount;
+	std::sort(tail, items.end(), byHash);
+	std::inplace_merge(items.begin(), tail, items.end(), byHash);
+	// the same commit might have been appended by several instances
+	items.erase(std::unique(items.begin(), items.end(), [](const SLogCacheIndexItem& a, const SLogCacheIndexItem& b) { return a.m_Hash == b.m_Hash; }), items.end());
+
+	header.m_ItemCount = static_cast<DWORD>(items.size());
+	header.m_SortedCount = header.m_ItemCount;
+	memset(header.m_FanOut, 0, sizeof(header.m_FanOut));
+	for (const auto& item : items)
+		++header.m_FanOut[item.m_Hash.ToRaw()[0]];
+	for (int i = 1; i < 256; ++i)
+		header.m_FanOut[i] += header.m_FanOut[i - 1];
+
+	start.QuadPart = 0;
+	if (!SetFilePointerEx(m_IndexFile, start, nullptr, FILE_BEGIN))
+		return -1;
+
+	DWORD dwWritten = 0;
+	if (!WriteFile(m_IndexFile, &header, sizeof(SLogCacheIndexHeader), &dwWritten, 0))
+		return -1;
+	if (!items.empty() && !WriteFile(m_IndexFile, items.data(), static_cast<DWORD>(items.size() * sizeof(SLogCacheIndexItem)), &dwWritten, 0))
+		return -1;
+	if (!SetEndOfFile(m_IndexFile))
+		return -1;
+
+	return 0;
+}
+
 int CLogCache::SaveCache()
 {
 	if (!m_bEnabled)
@@ -402,17 +473,34 @@ int CLogCache::SaveCache()
 	if( this->m_GitDir.IsEmpty())
 		return 0;
 
-	SLogCacheIndexFile* pIndex = nullptr;
-	if (m_pCacheIndex && m_pCacheIndex->m_Header.m_ItemCount > 0)
+	// only commits which are not yet stored get appended, the others are only needed if the cache files have to be rebuilt
+	std::vector<const GitRevLoglist*> newItems;
+	std::vector<const GitRevLoglist*> knownItems;
+	// commits whose files are stored do not need their changed paths separately
+	std::vector<const GitRevLoglist*> simpleLists;
+	bool isShallow = !m_shallowAnchors.empty();
+	for (auto i = m_HashMap.cbegin(); i != m_HashMap.cend(); ++i)
 	{
-		size_t len;
-		if (SizeTMult(sizeof(SLogCacheIndexItem), m_pCacheIndex->m_Header.m_ItemCount - 1, &len) != S_OK || SizeTAdd(len, sizeof(SLogCacheIndexFile), &len) != S_OK)
-			return -1;
-		pIndex = reinterpret_cast<SLogCacheIndexFile*>(malloc(len));
-		if (!pIndex)
-			return -1;
+		if ((*i).second.m_IsSimpleListReady && (*i).second.m_IsDiffFiles != TRUE && !(*i).second.m_CommitHash.IsEmpty() && !(isShallow && m_shallowAnchors.contains((*i).second.m_CommitHash)))
+			simpleLists.push_back(&(*i).second);
+
+		if (!(*i).second.m_IsDiffFiles || (*i).second.m_IsDiffFiles == 2 || (*i).second.m_CommitHash.IsEmpty() || (isShallow && m_shallowAnchors.contains((*i).second.m_CommitHash)))
+			continue;
 
-		memcpy(pIndex, m_pCacheIndex, len);
+		if (GetOffset((*i).second.m_CommitHash) != 0)
+			knownItems.push_back(&(*i).second);
+		else
+			newItems.push_back(&(*i).second);
+	}
+
+	m_PathLists.Update(m_GitDir, simpleLists);
+
+	if (newItems.empty())
+	{
+		// commits stored before might not be indexed yet, e.g. if the search index was disabled back then
+		if (m_bSearchIndex)
+			m_SearchIndex.Update(m_GitDir, knownItems);
+		return 0;
 	}
 
 	this->CloseDataHandles();
@@ -450,8 +538,12 @@ int CLogCache::SaveCache()
 		{
 			memset(&header,0,sizeof(SLogCacheIndexHeader));
 			DWORD num=0;
+			LARGE_INTEGER indexFileSize{};
+			size_t len;
 			if ((!ReadFile(m_IndexFile, &header, sizeof(SLogCacheIndexHeader), &num, 0)) || num != sizeof(SLogCacheIndexHeader) ||
-				!CheckHeader(&header)
+				!CheckHeader(&header) ||
+				!GetFileSizeEx(m_IndexFile, &indexFileSize) ||
+				SizeTMult(sizeof(SLogCacheIndexItem), header.m_ItemCount, &len) != S_OK || SizeTAdd(len, sizeof(SLogCacheIndexHeader), &len) != S_OK || static_cast<ULONGLONG>(indexFileSize.QuadPart) != len
 				)
 			{
 				RebuildCacheFile();
@@ -471,7 +563,12 @@ int CLogCache::SaveCache()
 		}
 
 		if(bIsRebuild)
-			header.m_ItemCount=0;
+		{
+			memset(&header, 0, sizeof(SLogCacheIndexHeader));
+			header.m_Magic = LOG_INDEX_MAGIC;
+			header.m_Version = LOG_INDEX_VERSION;
+			newItems.insert(newItems.end(), knownItems.cbegin(), knownItems.cend());
+		}
 
 		{
 			LARGE_INTEGER start{};
@@ -479,50 +576,55 @@ int CLogCache::SaveCache()
 			SetFilePointerEx(m_IndexFile, start, nullptr, FILE_END);
 		}
 
-		bool isShallow = !m_shallowAnchors.empty();
-		for (auto i = m_HashMap.cbegin(); i != m_HashMap.cend(); ++i)
+		bool writeError = false;
+		for (const auto rev : newItems)
 		{
-			if (!bIsRebuild && GetOffset((*i).second.m_CommitHash, pIndex) != 0)
-				continue;
-
-			if (!(*i).second.m_IsDiffFiles || (*i).second.m_IsDiffFiles == 2 || (*i).second.m_CommitHash.IsEmpty() || (isShallow && m_shallowAnchors.contains((*i).second.m_CommitHash)))
-				continue;
-
 			LARGE_INTEGER offset{};
 			LARGE_INTEGER start{};
 			SetFilePointerEx(m_DataFile, start, &offset, FILE_CURRENT);
-			if (SaveOneItem((*i).second, offset))
+			if (SaveOneItem(*rev, offset))
 			{
 				CTraceToOutputDebugString::Instance()(__FUNCTION__ ": Save one item error\n");
 				if (!SetFilePointerEx(m_DataFile, offset, &offset, FILE_BEGIN))
+				{
+					writeError = true;
 					break;
+				}
 				continue;
 			}
 
 			SLogCacheIndexItem item;
-			item.m_Hash = (*i).second.m_CommitHash;
+			item.m_Hash = rev->m_CommitHash;
 			item.m_Offset = offset.QuadPart;
 
 			DWORD dwWritten = 0;
 			if (!WriteFile(m_IndexFile, &item, sizeof(SLogCacheIndexItem), &dwWritten, 0))
+			{
+				writeError = true;
 				break;
+			}
 			++header.m_ItemCount;
 		}
-		FlushFileBuffers(m_IndexFile);
-
-		m_IndexFileMap = CreateFileMapping(m_IndexFile, nullptr, PAGE_READWRITE, 0, 0, nullptr);
-		if (!m_IndexFileMap)
+		if (writeError)
 			break;
+		FlushFileBuffers(m_DataFile);
 
-		m_pCacheIndex = reinterpret_cast<SLogCacheIndexFile*>(MapViewOfFile(m_IndexFileMap, FILE_MAP_WRITE, 0, 0, 0));
-		if (!m_pCacheIndex)
-			break;
-
-		m_pCacheIndex->m_Header.m_ItemCount = header.m_ItemCount;
-
-		std::qsort(m_pCacheIndex->m_Item, m_pCacheIndex->m_Header.m_ItemCount, sizeof(SLogCacheIndexItem), Compare);
+		if (NeedsCompaction(header))
+		{
+			if (CompactIndexFile(header))
+				break;
+		}
+		else
+		{
+			LARGE_INTEGER start{};
+			if (!SetFilePointerEx(m_IndexFile, start, nullptr, FILE_BEGIN))
+				break;
+			DWORD dwWritten = 0;
+			if (!WriteFile(m_IndexFile, &header, sizeof(SLogCacheIndexHeader), &dwWritten, 0))
+				break;
+		}
+		FlushFileBuffers(m_IndexFile);
 
-		FlushViewOfFile(m_pCacheIndex,0);
 		ret = 0;
 	}while(0);
 
@@ -533,8 +635,13 @@ int CLogCache::SaveCache()
 		::DeleteFile(m_GitDir + INDEX_FILE_NAME);
 		::DeleteFile(m_GitDir + DATA_FILE_NAME);
 	}
+	else if (m_bSearchIndex)
+	{
+		if (!bIsRebuild)
+			newItems.insert(newItems.end(), knownItems.cbegin(), knownItems.cend());
+		m_SearchIndex.Update(m_GitDir, newItems);
+	}
 
-	free(pIndex);
 	return ret;
 }
 
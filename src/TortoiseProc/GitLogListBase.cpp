@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2024 - TortoiseGit
+// Copyright (C) 2008-2024, 2026 - TortoiseGit
 // Copyright (C) 2005-2007 Marco Costalba
 
 // This program is free software; you can redistribute it and/or
@@ -28,6 +28,7 @@
 #include "LoglistUtils.h"
 #include "StringUtils.h"
 #include "UnicodeUtils.h"
+#include "ThreadPoolWork.h"
 #include "../TortoiseShell/Resource.h"
 #include "CommonAppUtils.h"
 #include "DPIAware.h"
@@ -110,6 +111,7 @@ CGitLogListBase::CGitLogListBase() : CHintCtrl<CResizableColumnsListCtrl<CListCt
 	m_LineWidth = max(1, static_cast<int>(CRegDWORD(L"Software\\TortoiseGit\\TortoiseProc\\Graph\\LogLineWidth", 2)));
 	m_NodeSize = max(1, static_cast<int>(CRegDWORD(L"Software\\TortoiseGit\\TortoiseProc\\Graph\\LogNodeSize", 10)));
 
+	m_AsyncDiffPrefetchRows = static_cast<int>(min(DWORD(1000), static_cast<DWORD>(CRegDWORD(L"Software\\TortoiseGit\\LogFileListPrefetchRows", 50))));
 	m_AsyncDiffEvent = ::CreateEvent(nullptr, FALSE, TRUE, nullptr);
 	StartAsyncDiffThread();
 }
@@ -129,13 +131,8 @@ int CGitLogListBase::AsyncDiffThread()
 		::WaitForSingleObject(m_AsyncDiffEvent, INFINITE);
 
 		GitRevLoglist* pRev = nullptr;
-		while(!m_AsyncThreadExit && !m_AsynDiffList.empty())
+		while (!m_AsyncThreadExit && (pRev = GetNextAsyncDiff(pRev)) != nullptr)
 		{
-			m_AsynDiffListLock.Lock();
-			pRev = m_AsynDiffList.back();
-			m_AsynDiffList.pop_back();
-			m_AsynDiffListLock.Unlock();
-
 			if( pRev->m_CommitHash.IsEmpty() )
 			{
 				if(pRev->m_IsDiffFiles)
@@ -156,7 +153,8 @@ int CGitLogListBase::AsyncDiffThread()
 				if (CString err; pRev->GetUnRevFiles().FillUnRev(CTGitPath::LOGACTIONS_UNVER, nullptr, &err))
 				{
 					MessageBox(L"Failed to get UnRev file list\n" + err, L"TortoiseGit", MB_OK | MB_ICONERROR);
-					InterlockedExchange(&m_AsyncThreadRunning, FALSE);
+					::SetEvent(m_AsyncDiffEvent);
+					InterlockedDecrement(&m_AsyncThreadRunning);
 					return -1;
 				}
 
@@ -172,7 +170,8 @@ int CGitLogListBase::AsyncDiffThread()
 
 			pRev->CheckAndDiff();
 			{	// fetch change file list
-				for (int i = GetTopIndex(); !m_AsyncThreadExit && i <= GetTopIndex() + GetCountPerPage(); ++i)
+				const int top = m_AsyncDiffTop;
+				for (int i = top; !m_AsyncThreadExit && i <= top + m_AsyncDiffCount; ++i)
 				{
 					if (i < static_cast<int>(m_arShownList.size()))
 					{
@@ -201,9 +200,123 @@ int CGitLogListBase::AsyncDiffThread()
 			}
 		}
 	}
-	InterlockedExchange(&m_AsyncThreadRunning, FALSE);
+	// wake up the next worker, so that all of them see m_AsyncThreadExit
+	::SetEvent(m_AsyncDiffEvent);
+	InterlockedDecrement(&m_AsyncThreadRunning);
 	return 0;
 }
+
+// called on painting, queues the rows ahead of the scroll direction
+void CGitLogListBase::UpdateAsyncDiffView()
+{
+	const int top = GetTopIndex();
+	const int count = GetCountPerPage();
+	const int oldTop = InterlockedExchange(&m_AsyncDiffTop, top);
+	const int oldCount = InterlockedExchange(&m_AsyncDiffCount, count);
+	if ((top == oldTop && count == oldCount) || m_AsyncDiffPrefetchRows <= 0)
+		return;
+
+	// on the first paint or when resized, the rows below get prefetched
+	const int direction = top > oldTop ? 1 : (top < oldTop ? -1 : m_AsyncDiffDirection);
+	InterlockedExchange(&m_AsyncDiffDirection, direction);
+	const int first = direction > 0 ? top + count + 1 : max(0, top - m_AsyncDiffPrefetchRows);
+	const int last = direction > 0 ? min(static_cast<int>(m_arShownList.size()) - 1, top + count + m_AsyncDiffPrefetchRows) : top - 1;
+	std::vector<std::pair<GitRevLoglist*, int>> prefetch;
+	for (int i = first; i <= last; ++i)
+	{
+		GitRevLoglist* pRev = m_arShownList.SafeGetAt(i);
+		// commits stored in the log cache, e.g. by a former log dialog, are loaded right away
+		if (!pRev || pRev->m_IsDiffFiles || !pRev->m_CallDiffAsync || pRev->m_CommitHash.IsEmpty() || IsCached(pRev))
+			continue;
+		prefetch.emplace_back(pRev, i);
+	}
+	if (prefetch.empty())
+		return;
+
+	bool queued = false;
+	m_AsynDiffListLock.Lock();
+	for (const auto& [pRev, row] : prefetch)
+		queued |= QueueAsyncDiff(pRev, row, true);
+	m_AsynDiffListLock.Unlock();
+	if (queued)
+		::SetEvent(m_AsyncDiffEvent);
+}
+
+int CGitLogListBase::GetAsyncDiffRow(const GitRevLoglist* pRev)
+{
+	const int top = m_AsyncDiffTop;
+	for (int i = top; i <= top + m_AsyncDiffCount; ++i)
+	{
+		if (m_arShownList.SafeGetAt(i) != pRev)
+			continue;
+		// the file list of the selected commit is waited for, even if it gets scrolled out of view
+		if (GetItemState(i, LVIS_SELECTED))
+			return -1;
+		return i;
+	}
+	return -1;
+}
+
+// expects m_AsynDiffListLock to be locked
+bool CGitLogListBase::QueueAsyncDiff(GitRevLoglist* pRev, int row, bool prefetch)
+{
+	if (std::find(m_AsynDiffInProgress.cbegin(), m_AsynDiffInProgress.cend(), pRev) != m_AsynDiffInProgress.cend())
+		return false;
+
+	auto it = std::find_if(m_AsynDiffList.begin(), m_AsynDiffList.end(), [pRev](const auto& request) { return request.pRev == pRev; });
+	if (it == m_AsynDiffList.end())
+	{
+		m_AsynDiffList.push_back({ pRev, row, prefetch });
+		return true;
+	}
+	if (!prefetch && (it->prefetch || it->row >= 0))
+	{
+		it->row = row;
+		it->prefetch = false;
+	}
+	return false;
+}
+
+// returns the most important request, drops the ones which are out of view
+GitRevLoglist* CGitLogListBase::GetNextAsyncDiff(const GitRevLoglist* pDone)
+{
+	Locker lock(m_AsynDiffListLock);
+	if (pDone)
+		std::erase(m_AsynDiffInProgress, pDone);
+
+	const int top = m_AsyncDiffTop;
+	const int bottom = top + m_AsyncDiffCount;
+	const int direction = m_AsyncDiffDirection;
+	auto priority = [&](const SAsyncDiffRequest& request) {
+		if (request.row < 0 || (request.row >= top && request.row <= bottom))
+			return 0;
+		// rows drawn before get requested again once they become visible again
+		if (!request.prefetch)
+			return -1;
+		if (direction > 0 && request.row > bottom && request.row - bottom <= m_AsyncDiffPrefetchRows)
+			return request.row - bottom;
+		if (direction < 0 && request.row < top && top - request.row <= m_AsyncDiffPrefetchRows)
+			return top - request.row;
+		return -1;
+	};
+	std::erase_if(m_AsynDiffList, [&priority](const auto& request) { return priority(request) < 0; });
+	if (m_AsynDiffList.empty())
+		return nullptr;
+
+	// prefer the latest request on equal priority
+	auto best = m_AsynDiffList.begin();
+	for (auto it = m_AsynDiffList.begin(); it != m_AsynDiffList.end(); ++it)
+	{
+		if (priority(*it) <= priority(*best))
+			best = it;
+	}
+	GitRevLoglist* pRev = best->pRev;
+	m_AsynDiffList.erase(best);
+	m_AsynDiffInProgress.push_back(pRev);
+	if (!m_AsynDiffList.empty())
+		::SetEvent(m_AsyncDiffEvent); // let another worker help
+	return pRev;
+}
 void CGitLogListBase::hideFromContextMenu(unsigned __int64 hideMask, bool exclusivelyShow)
 {
 	if (exclusivelyShow)
@@ -1106,6 +1219,7 @@ void CGitLogListBase::OnNMCustomdrawLoglist(NMHDR *pNMHDR, LRESULT *pResult)
 	{
 	case CDDS_PREPAINT:
 		{
+			UpdateAsyncDiffView();
 			*pResult = CDRF_NOTIFYITEMDRAW;
 			return;
 		}
@@ -2727,8 +2841,8 @@ int CGitLogListBase::BeginFetchLog()
 
 	try
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
-		g_Git.CheckAndInitDll();
+		CGitDllSession session;
+		session.Init();
 	}
 	catch (const char* msg)
 	{
@@ -2751,21 +2865,17 @@ int CGitLogListBase::BeginFetchLog()
 		cmd = g_Git.GetLogCmd(list[0], path, mask, &m_Filter, CRegDWORD(L"Software\\TortoiseGit\\LogOrderBy", CGit::LOG_ORDER_TOPOORDER));
 	}
 
-	g_Git.m_critGitDllSec.Lock();
+	CGitDllSession session;
 	try {
 		if (git_open_log(&m_DllGitLog, CUnicodeUtils::GetUTF8(cmd)))
-		{
-			g_Git.m_critGitDllSec.Unlock();
 			return -1;
-		}
 	}
 	catch (const char* msg)
 	{
-		g_Git.m_critGitDllSec.Unlock();
+		session.Release();
 		MessageBox(L"Could not open log.\nlibgit reports:\n" + CUnicodeUtils::GetUnicode(msg), L"TortoiseGit", MB_ICONERROR);
 		return -1;
 	}
-	g_Git.m_critGitDllSec.Unlock();
 
 	return 0;
 }
@@ -2914,23 +3024,22 @@ UINT CGitLogListBase::LogThread()
 
 	if (shouldWalk)
 	{
-		g_Git.m_critGitDllSec.Lock();
 		if (!m_DllGitLog)
 		{
 			MessageBox(L"Opening log failed.", L"TortoiseGit", MB_ICONERROR);
-			g_Git.m_critGitDllSec.Unlock();
 			InterlockedExchange(&s_bThreadRunning, FALSE);
 			InterlockedExchange(&m_bNoDispUpdates, FALSE);
 			return 1;
 		}
 		int total = 0;
+		CGitDllSession session;
 		try
 		{
 			if (git_get_log_firstcommit(m_DllGitLog) < 0)
 			{
-				MessageBox(L"Getting first commit and preparing the revision walk failed. Broken repository?", L"TortoiseGit", MB_ICONERROR);
 				git_close_log(m_DllGitLog, 0);
-				g_Git.m_critGitDllSec.Unlock();
+				session.Release();
+				MessageBox(L"Getting first commit and preparing the revision walk failed. Broken repository?", L"TortoiseGit", MB_ICONERROR);
 				InterlockedExchange(&s_bThreadRunning, FALSE);
 				InterlockedExchange(&m_bNoDispUpdates, FALSE);
 				return 1;
@@ -2939,10 +3048,11 @@ UINT CGitLogListBase::LogThread()
 		}
 		catch (const char* msg)
 		{
+			session.Release();
 			MessageBox(L"Could not get first commit.\nlibgit reports:\n" + CUnicodeUtils::GetUnicode(msg), L"TortoiseGit", MB_ICONERROR);
 			ret = -1;
 		}
-		g_Git.m_critGitDllSec.Unlock();
+		session.Release();
 
 		if (CGitMailmap::ShouldLoadMailmap())
 			GitRevLoglist::s_Mailmap = std::make_shared<CGitMailmap>();
@@ -2962,23 +3072,70 @@ UINT CGitLogListBase::LogThread()
 		int oldprecentage = 0;
 		size_t oldsize = m_logEntries.size();
 		std::unordered_map<CGitHash, std::unordered_set<CGitHash>> commitChildren;
+
+		// The (expensive) filter is evaluated for batches of walked commits on the thread pool,
+		// the commits are then appended in walk order. A new filter or refresh sets m_bExitThread,
+		// which also makes the workers skip the rest of the current batch.
+		struct SPendingRev
+		{
+			CGitHash hash;
+			GitRevLoglist* pRev;
+			bool visible;
+		};
+		constexpr size_t filterBatchSize = 256;
+		std::vector<SPendingRev> pendingRevs;
+		pendingRevs.reserve(filterBatchSize);
+		ULONGLONG tLastFlush = t1;
+		// commits the search index of the log cache rules out do not need to be matched (nor diffed for the paths)
+		const auto searchQuery = filter.GetSearchIndexQuery(m_LogCache.GetSearchIndex());
+		auto isRuledOut = [&](const SPendingRev& pending) {
+			// the indexed paths are only the ones the filter gets if the files are known or cached
+			if (!searchQuery || ((filter.GetSelectedFilters() & LOGFILTER_PATHS) && !pending.pRev->m_IsDiffFiles && !m_LogCache.GetOffset(pending.hash)))
+				return false;
+			return filter.IsRuledOut(*searchQuery, pending.pRev, hashMap);
+		};
+		// the workers only read the bug ID regexes if they are built in advance
+		if (filter.GetSelectedFilters() & LOGFILTER_BUGID)
+			m_ProjectProperties.AutoUpdateRegex();
+		auto flushPendingRevs = [&]() {
+			ParallelFor(pendingRevs.size(), [&](size_t i) {
+				if (pendingRevs[i].visible && !m_bExitThread && (isRuledOut(pendingRevs[i]) || !filter(pendingRevs[i].pRev, this, hashMap)))
+					pendingRevs[i].visible = false;
+			}, filter.IsFilterActive() ? 0 : 1);
+			if (m_bExitThread)
+				return;
+
+			this->m_critSec.Lock();
+			for (const auto& pending : pendingRevs)
+			{
+				m_logEntries.append(pending.hash, pending.visible, m_ShowMask & CGit::LOG_INFO_FIRST_PARENT);
+				if (!pending.visible)
+					continue;
+				m_arShownList.push_back(pending.pRev); // push_back is ok here, because we use the very same lock, otherwise use SafeAdd
+				if (lastSelectedHashNItem == -1 && pending.hash == m_lastSelectedHash)
+					lastSelectedHashNItem = static_cast<int>(m_arShownList.size()) - 1;
+			}
+			this->m_critSec.Unlock();
+			pendingRevs.clear();
+		};
+
 		while (ret== 0 && !m_bExitThread)
 		{
-			g_Git.m_critGitDllSec.Lock();
+			session.Acquire();
 			try
 			{
 				[&] { ret = git_get_log_nextcommit(this->m_DllGitLog, &commit, m_ShowMask & CGit::LOG_INFO_FOLLOW); } ();
 			}
 			catch (const char* msg)
 			{
-				g_Git.m_critGitDllSec.Unlock();
+				session.Release();
 				MessageBox(L"Could not get next commit.\nlibgit reports:\n" + CUnicodeUtils::GetUnicode(msg), L"TortoiseGit", MB_ICONERROR);
 				break;
 			}
 
 			if(ret)
 			{
-				g_Git.m_critGitDllSec.Unlock();
+				session.Release();
 				if (ret != -2) // other than end of revision walking
 					MessageBox((L"Could not get next commit.\nlibgit returns:" + std::to_wstring(ret)).c_str(), L"TortoiseGit", MB_ICONERROR);
 				break;
@@ -2987,7 +3144,7 @@ UINT CGitLogListBase::LogThread()
 			if (commit.m_ignore == 1)
 			{
 				git_free_commit(&commit);
-				g_Git.m_critGitDllSec.Unlock();
+				session.Release();
 				continue;
 			}
 
@@ -2995,14 +3152,14 @@ UINT CGitLogListBase::LogThread()
 			if(m_bExitThread)
 			{
 				git_free_commit(&commit);
-				g_Git.m_critGitDllSec.Unlock();
+				session.Release();
 				break;
 			}
 
 			CGitHash hash = CGitHash::FromRaw(commit.m_hash);
 
 			GitRevLoglist* pRev = m_LogCache.GetCacheData(hash);
-			pRev->Parse(&commit, mailmap.get()); // better parse here than on GITLOG_END in LogDlg::OnLogListLoading for updating the DateSelectors
+			pRev->ParseParents(&commit);
 
 			char* note = nullptr;
 			try
@@ -3011,19 +3168,27 @@ UINT CGitLogListBase::LogThread()
 			}
 			catch (const char* msg)
 			{
-				g_Git.m_critGitDllSec.Unlock();
+				git_free_commit(&commit);
+				session.Release();
 				MessageBox(L"Could not get commit notes.\nlibgit reports:\n" + CUnicodeUtils::GetUnicode(msg), L"TortoiseGit", MB_ICONERROR);
 				break;
 			}
 
+			// take over the commit buffer, so that decoding it does not block other gitdll users
+			GIT_COMMIT detached = commit;
+			commit.buffer = nullptr;
+			git_free_commit(&commit);
+			session.Release();
+
+			pRev->ParseBuffer(&detached, mailmap.get()); // better parse here than on GITLOG_END in LogDlg::OnLogListLoading for updating the DateSelectors
+			free(const_cast<void*>(detached.buffer));
+
 			if(note)
 			{
 				pRev->m_Notes = CUnicodeUtils::GetUnicode(note);
 				free(note);
 				note = nullptr;
 			}
-			git_free_commit(&commit);
-			g_Git.m_critGitDllSec.Unlock();
 
 			if(!pRev->m_IsDiffFiles)
 			{
@@ -3082,21 +3247,12 @@ UINT CGitLogListBase::LogThread()
 					expandedNodes.insert(pRev->m_CommitHash);
 			}
 
-			if (visible && !filter(pRev, this, hashMap))
-				visible = false;
-			this->m_critSec.Lock();
-			m_logEntries.append(hash, visible, m_ShowMask & CGit::LOG_INFO_FIRST_PARENT);
-			if (visible)
-				m_arShownList.push_back(pRev); // push_back is ok here, because we use the very same lock, otherwise use SafeAdd
-			this->m_critSec.Unlock();
-
-			if (!visible)
+			pendingRevs.push_back({ hash, pRev, visible });
+			if (pendingRevs.size() < filterBatchSize && GetTickCount64() - tLastFlush < 100)
 				continue;
 
-			if (lastSelectedHashNItem == -1 && hash == m_lastSelectedHash)
-				lastSelectedHashNItem = static_cast<int>(m_arShownList.size()) - 1;
-
-			t2 = GetTickCount64();
+			flushPendingRevs();
+			tLastFlush = t2 = GetTickCount64();
 
 			if (t2 - t1 > 500UL || (m_logEntries.size() - oldsize > 100))
 			{
@@ -3122,9 +3278,11 @@ UINT CGitLogListBase::LogThread()
 				t1 = t2;
 			}
 		}
-		g_Git.m_critGitDllSec.Lock();
+		if (!m_bExitThread)
+			flushPendingRevs();
+		session.Acquire();
 		git_close_log(m_DllGitLog, 1);
-		g_Git.m_critGitDllSec.Unlock();
+		session.Release();
 	}
 
 	if (m_bExitThread)
@@ -3142,6 +3300,10 @@ UINT CGitLogListBase::LogThread()
 	if (this->m_hWnd)
 		::PostMessage(this->GetParent()->m_hWnd,MSG_LOAD_PERCENTAGE, GITLOG_END, 0);
 
+	// the commits are kept across reloads, so filtering by paths later on only diffs what the prefetch has not done yet
+	if (filter.GetSelectedFilters() & LOGFILTER_PATHS)
+		StartSimpleListPrefetch();
+
 	InterlockedExchange(&s_bThreadRunning, FALSE);
 
 	return 0;
@@ -3183,6 +3345,7 @@ void CGitLogListBase::Refresh(BOOL IsCleanFilter)
 	this->Clear();
 
 	ResetWcRev();
+	g_Git.InvalidateRepositoryPool();
 
 	ShowGraphColumn((m_ShowMask & CGit::LOG_INFO_FOLLOW) ? false : true);
 
@@ -3212,23 +3375,33 @@ void CGitLogListBase::StartAsyncDiffThread()
 {
 	if (m_AsyncThreadExit)
 		return;
-	if (InterlockedExchange(&m_AsyncThreadRunning, TRUE) != FALSE)
+	if (!m_DiffingThreads.empty())
 		return;
-	m_DiffingThread = AfxBeginThread(AsyncThread, this, THREAD_PRIORITY_BELOW_NORMAL, 0, CREATE_SUSPENDED);
-	if (!m_DiffingThread)
+	// diffing merge commits is expensive, but the workers must not starve the log thread
+	const size_t workers = min(static_cast<size_t>(4), max(static_cast<size_t>(2), CThreadPoolWork::GetDefaultWorkerCount() / 2));
+	for (size_t i = 0; i < workers; ++i)
 	{
-		InterlockedExchange(&m_AsyncThreadRunning, FALSE);
-		CMessageBox::Show(GetSafeHwnd(), IDS_ERR_THREADSTARTFAILED, IDS_APPNAME, MB_OK | MB_ICONERROR);
-		return;
+		InterlockedIncrement(&m_AsyncThreadRunning);
+		CWinThread* thread = AfxBeginThread(AsyncThread, this, THREAD_PRIORITY_BELOW_NORMAL, 0, CREATE_SUSPENDED);
+		if (!thread)
+		{
+			InterlockedDecrement(&m_AsyncThreadRunning);
+			break;
+		}
+		thread->m_bAutoDelete = FALSE;
+		thread->ResumeThread();
+		m_DiffingThreads.push_back(thread);
 	}
-	m_DiffingThread->m_bAutoDelete = FALSE;
-	m_DiffingThread->ResumeThread();
+	if (m_DiffingThreads.empty())
+		CMessageBox::Show(GetSafeHwnd(), IDS_ERR_THREADSTARTFAILED, IDS_APPNAME, MB_OK | MB_ICONERROR);
 }
 
 void CGitLogListBase::StartLoadingThread()
 {
 	if (InterlockedExchange(&s_bThreadRunning, TRUE) != FALSE)
 		return;
+	// the prefetch of the former run works on the commits the new one clears
+	StopSimpleListPrefetch();
 	InterlockedExchange(&m_bNoDispUpdates, TRUE);
 	InterlockedExchange(&m_bExitThread, FALSE);
 	m_LoadingThread = AfxBeginThread(LogThreadEntry, this, THREAD_PRIORITY_LOWEST, 0, CREATE_SUSPENDED);
@@ -3243,6 +3416,32 @@ void CGitLogListBase::StartLoadingThread()
 	m_LoadingThread->ResumeThread();
 }
 
+void CGitLogListBase::StartSimpleListPrefetch()
+{
+	ATLASSERT(IsInWorkingThread());
+	if (!m_bPrefetchSimpleLists)
+		return;
+
+	// diffing is the expensive part of filtering by paths, so the changed paths which are neither known nor
+	// cached are computed in the background, the log cache keeps them for the next time
+	std::vector<GitRevLoglist*> revs;
+	for (size_t i = 0; i < m_logEntries.size(); ++i)
+	{
+		auto& rev = m_logEntries.GetGitRevAt(i);
+		if (rev.m_CommitHash.IsEmpty() || rev.m_IsDiffFiles || rev.m_IsSimpleListReady || m_LogCache.GetOffset(rev.m_CommitHash) || m_LogCache.HasSimpleList(rev.m_CommitHash))
+			continue;
+		revs.push_back(&rev);
+	}
+
+	// this runs after every load of the log, so just use two workers (one would run synchronously),
+	// the newest commits come first
+	Locker lock(m_SimpleListPrefetchLock);
+	m_SimpleListPrefetch.Start(revs.size(), [this, revs](size_t i) {
+		if (!m_bExitThread && !revs[i]->m_IsSimpleListReady)
+			revs[i]->SafeGetSimpleList(&g_Git);
+	}, 2);
+}
+
 bool CGitLogListBase::ShouldShowAnyFilter()
 {
 	return m_ShowFilter & FILTERSHOW_ANYCOMMIT;
@@ -3581,6 +3780,8 @@ LRESULT CGitLogListBase::OnFindDialogMessage(WPARAM /*wParam*/, LPARAM /*lParam*
 	{
 		//read data from dialog
 		CLogDlgFilter filter { m_pFindDialog->GetFindString(), m_pFindDialog->Regex(), LOGFILTER_ALL, m_pFindDialog->MatchCase() == TRUE };
+		// the filter computes missing changed paths itself
+		StopSimpleListPrefetch();
 
 		auto hashMapSharedPtr{ m_HashMap.load() };
 		auto& hashMap = *hashMapSharedPtr;
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2024 - TortoiseGit
+// Copyright (C) 2008-2024, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -36,6 +36,7 @@
 #include "FindDlg.h"
 #include <unordered_set>
 #include "LogDlgFilter.h"
+#include "ThreadPoolWork.h"
 
 using Locker = CComCritSecLock<CComCriticalSection>;
 
@@ -278,6 +279,7 @@ public:
 
 	bool				m_hasWC = true;
 	bool				m_bShowWC = false;
+	bool				m_bPrefetchSimpleLists = false; // for filtering by paths
 protected:
 	GitRevLoglist		m_wcRev;
 public:
@@ -513,6 +515,13 @@ protected:
 	}
 	void StartAsyncDiffThread();
 	void StartLoadingThread();
+	void StartSimpleListPrefetch();
+	void StopSimpleListPrefetch()
+	{
+		Locker lock(m_SimpleListPrefetchLock);
+		m_SimpleListPrefetch.Cancel();
+		m_SimpleListPrefetch.Wait();
+	}
 public:
 	void SafeTerminateThread()
 	{
@@ -526,6 +535,7 @@ public:
 			delete m_LoadingThread;
 			m_LoadingThread = nullptr;
 		}
+		StopSimpleListPrefetch();
 	};
 protected:
 	bool IsInWorkingThread()
@@ -629,12 +639,29 @@ protected:
 
 	int GetHeadIndex();
 
-	std::vector<GitRevLoglist*> m_AsynDiffList;
+	struct SAsyncDiffRequest
+	{
+		GitRevLoglist*	pRev;
+		int				row;		// -1 if the commit has to be diffed in any case, e.g. it is selected
+		bool			prefetch;	// not requested for drawing, but ahead of the scroll direction
+	};
+	std::vector<SAsyncDiffRequest> m_AsynDiffList;
+	std::vector<GitRevLoglist*> m_AsynDiffInProgress;
 	CComAutoCriticalSection m_AsynDiffListLock;
 	HANDLE m_AsyncDiffEvent = nullptr;
 	volatile LONG m_AsyncThreadExit = FALSE;
-	CWinThread* m_DiffingThread = nullptr;
-	volatile LONG m_AsyncThreadRunning = FALSE;
+	std::vector<CWinThread*> m_DiffingThreads;
+	volatile LONG m_AsyncThreadRunning = 0; // number of running diff workers
+	// visible rows and scroll direction as of the last paint, used by the diff workers for prioritizing
+	volatile LONG m_AsyncDiffTop = 0;
+	volatile LONG m_AsyncDiffCount = 0;
+	volatile LONG m_AsyncDiffDirection = 1;
+	int m_AsyncDiffPrefetchRows = 0;
+
+	void UpdateAsyncDiffView();
+	int GetAsyncDiffRow(const GitRevLoglist* pRev);
+	bool QueueAsyncDiff(GitRevLoglist* pRev, int row, bool prefetch);
+	GitRevLoglist* GetNextAsyncDiff(const GitRevLoglist* pDone);
 
 public:
 	bool IsCached(GitRevLoglist* rev)
@@ -649,6 +676,15 @@ public:
 		return false;
 	}
 
+	bool IsSimpleListCached(GitRevLoglist* rev)
+	{
+		if (!m_LogCache.LoadSimpleList(*rev))
+			return false;
+
+		InterlockedExchange(&rev->m_IsSimpleListReady, TRUE);
+		return true;
+	}
+
 protected:
 	static void DiffAsync(GitRevLoglist* rev, IAsyncDiffCB* pdata)
 	{
@@ -656,10 +692,12 @@ protected:
 		if (data->IsCached(rev))
 			return;
 
+		const int row = data->GetAsyncDiffRow(rev);
 		data->m_AsynDiffListLock.Lock();
-		data->m_AsynDiffList.push_back(rev);
+		const bool queued = data->QueueAsyncDiff(rev, row, false);
 		data->m_AsynDiffListLock.Unlock();
-		::SetEvent(data->m_AsyncDiffEvent);
+		if (queued)
+			::SetEvent(data->m_AsyncDiffEvent);
 	}
 
 	static UINT AsyncThread(LPVOID data)
@@ -672,20 +710,27 @@ protected:
 public:
 	void SafeTerminateAsyncDiffThread()
 	{
-		if (m_DiffingThread && InterlockedExchange(&m_AsyncThreadExit, TRUE) == FALSE)
+		if (!m_DiffingThreads.empty() && InterlockedExchange(&m_AsyncThreadExit, TRUE) == FALSE)
 		{
-			::SetEvent(m_AsyncDiffEvent);
+			::SetEvent(m_AsyncDiffEvent); // each exiting worker wakes up the next one
+			std::vector<HANDLE> threads;
+			for (auto thread : m_DiffingThreads)
+				threads.push_back(thread->m_hThread);
 			DWORD ret = WAIT_TIMEOUT;
-			// do not block here, but process messages and ask until the thread ends
+			// do not block here, but process messages and ask until the threads end
 			while (ret == WAIT_TIMEOUT && m_AsyncThreadRunning)
 			{
 				MSG msg;
 				if (::PeekMessage(&msg, nullptr, 0,0, PM_NOREMOVE))
-					AfxGetThread()->PumpMessage(); // process messages, so that GetTopIndex and so on in the thread work
-				ret = ::WaitForSingleObject(m_DiffingThread->m_hThread, 100);
+					AfxGetThread()->PumpMessage(); // process messages, so that GetSelectedCount and so on in the threads work
+				ret = ::WaitForMultipleObjects(static_cast<DWORD>(threads.size()), threads.data(), TRUE, 100);
 			}
-			delete m_DiffingThread;
-			m_DiffingThread = nullptr;
+			for (auto thread : m_DiffingThreads)
+				delete thread;
+			m_DiffingThreads.clear();
+			m_AsynDiffListLock.Lock();
+			m_AsynDiffInProgress.clear();
+			m_AsynDiffListLock.Unlock();
 			InterlockedExchange(&m_AsyncThreadExit, FALSE);
 		}
 	};
@@ -723,6 +768,8 @@ protected:
 	bool				m_bFullCommitMessageOnLogLine = false;
 	bool				m_bSymbolizeRefNames = false;
 	bool				m_bIncludeBoundaryCommits = false;
+	CThreadPoolWork		m_SimpleListPrefetch; // computes the changed paths for filtering in the background, started by the log thread
+	CComAutoCriticalSection m_SimpleListPrefetchLock;
 
 	DWORD				m_dwDefaultColumns = 0;
 	wchar_t				m_wszTip[8192];
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2009-2023 - TortoiseGit
+// Copyright (C) 2009-2023, 2026 - TortoiseGit
 // Copyright (C) 2007-2008 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -33,6 +33,10 @@
 #include "TGitPath.h"
 #include "GitLogListBase.h"
 #include "UnicodeUtils.h"
+#include "ThreadPoolWork.h"
+
+// number of commits collected by the revision walk before they are handed over to the parser threads
+#define LOG_PARSE_BATCH_SIZE 1024
 
 void CLogDataVector::ClearAll()
 {
@@ -73,8 +77,8 @@ int CLogDataVector::ParserFromLog(CTGitPath* path, DWORD count, DWORD infomask,
 
 	try
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
-		g_Git.ForceReInitDll();
+		CGitDllSession session;
+		session.ForceReInit();
 	}
 	catch (const char* msg)
 	{
@@ -85,7 +89,7 @@ int CLogDataVector::ParserFromLog(CTGitPath* path, DWORD count, DWORD infomask,
 	GIT_LOG handle;
 	try
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session;
 		if (git_open_log(&handle, CUnicodeUtils::GetUTF8(cmd)))
 			return -1;
 	}
@@ -97,7 +101,7 @@ int CLogDataVector::ParserFromLog(CTGitPath* path, DWORD count, DWORD infomask,
 
 	try
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session;
 		if (git_get_log_firstcommit(handle) < 0)
 		{
 			MessageBox(nullptr, L"Getting first commit and preparing the revision walk failed. Broken repository?", L"TortoiseGit", MB_ICONERROR);
@@ -117,24 +121,59 @@ int CLogDataVector::ParserFromLog(CTGitPath* path, DWORD count, DWORD infomask,
 		GitRevLoglist::s_Mailmap.store(nullptr);
 	auto mailmap{ GitRevLoglist::s_Mailmap.load() };
 
+	// The revision walk only collects the raw commits (with their buffers detached) and the notes while holding
+	// a gitdll session. Decoding them and applying the mailmap happens on the thread pool while the walk goes on.
+	// The order of the vector and of m_HashMap is determined by the walk only.
+	struct SRawCommit
+	{
+		GIT_COMMIT commit;
+		GitRevLoglist* pRev;
+		char* pNote;
+	};
+	std::vector<SRawCommit> batches[2];
+	batches[0].reserve(LOG_PARSE_BATCH_SIZE);
+	batches[1].reserve(LOG_PARSE_BATCH_SIZE);
+	size_t currentBatch = 0;
+	CThreadPoolWork parser;
+	auto parseBatch = [&parser, &batches, &mailmap](size_t batchIndex) {
+		parser.Start(batches[batchIndex].size(), [&batch = batches[batchIndex], mailmap = mailmap.get()](size_t i) {
+			auto& raw = batch[i];
+			raw.pRev->ParseBuffer(&raw.commit, mailmap);
+			free(const_cast<void*>(raw.commit.buffer));
+			raw.commit.buffer = nullptr;
+			if (raw.pNote)
+			{
+				raw.pRev->m_Notes = CUnicodeUtils::GetUnicode(raw.pNote);
+				free(raw.pNote);
+				raw.pNote = nullptr;
+			}
+		});
+	};
+
 	int ret = 0;
 	while (ret == 0)
 	{
 		GIT_COMMIT commit;
+		char* pNote = nullptr;
 
+		// one session per commit, so that other gitdll users can interleave with a long running walk
+		CGitDllSession session;
 		try
 		{
-			CAutoLocker lock(g_Git.m_critGitDllSec);
 			[&]{ ret = git_get_log_nextcommit(handle, &commit, infomask & CGit::LOG_INFO_FOLLOW); }();
+			if (ret == 0 && commit.m_ignore != 1)
+				git_get_notes(commit.m_hash, &pNote);
 		}
 		catch (const char* msg)
 		{
+			session.Release();
 			MessageBox(nullptr, L"Could not get next commit.\nlibgit reports:\n" + CUnicodeUtils::GetUnicode(msg), L"TortoiseGit", MB_ICONERROR);
 			break;
 		}
 
 		if (ret)
 		{
+			session.Release();
 			if (ret != -2) // other than end of revision walking
 				MessageBox(nullptr, (L"Could not get next commit.\nlibgit returns:" + std::to_wstring(ret)).c_str(), L"TortoiseGit", MB_ICONERROR);
 			break;
@@ -148,30 +187,36 @@ int CLogDataVector::ParserFromLog(CTGitPath* path, DWORD count, DWORD infomask,
 
 		CGitHash hash = CGitHash::FromRaw(commit.m_hash);
 
+		// the log cache must only be modified on this thread, pointers to its entries stay valid
 		GitRevLoglist* pRev = this->m_pLogCache->GetCacheData(hash);
+		pRev->ParseParents(&commit);
 
-		char *pNote = nullptr;
-		{
-			CAutoLocker lock(g_Git.m_critGitDllSec);
-			git_get_notes(commit.m_hash, &pNote);
-		}
-		if (pNote)
-		{
-			pRev->m_Notes = CUnicodeUtils::GetUnicode(pNote);
-			free(pNote);
-			pNote = nullptr;
-		}
-
-		pRev->Parse(&commit, mailmap.get());
+		// the parser threads take over the commit buffer, which allows to free the git commit object as early as before
+		SRawCommit raw{ commit, pRev, pNote };
+		commit.buffer = nullptr;
 		git_free_commit(&commit);
+		session.Release();
 
-		this->push_back(pRev->m_CommitHash);
+		this->push_back(hash);
 
-		m_HashMap[pRev->m_CommitHash] = size() - 1;
+		m_HashMap[hash] = size() - 1;
+
+		batches[currentBatch].push_back(raw);
+		if (batches[currentBatch].size() >= LOG_PARSE_BATCH_SIZE)
+		{
+			parser.Wait();
+			batches[currentBatch ^ 1].clear();
+			parseBatch(currentBatch);
+			currentBatch ^= 1;
+		}
 	}
 
+	parser.Wait();
+	parseBatch(currentBatch);
+	parser.Wait();
+
 	{
-		CAutoLocker lock(g_Git.m_critGitDllSec);
+		CGitDllSession session;
 		git_close_log(handle, 1);
 	}
 
@@ -197,7 +242,8 @@ int CLogDataVector::Fill(const std::unordered_set<CGitHash>& hashes)
 	ATLASSERT(m_pLogCache);
 	try
 	{
-		g_Git.ForceReInitDll();
+		CGitDllSession session;
+		session.ForceReInit();
 	}
 	catch (const char* msg)
 	{
@@ -215,14 +261,15 @@ int CLogDataVector::Fill(const std::unordered_set<CGitHash>& hashes)
 	for (const auto& hash : hashes)
 	{
 		GIT_COMMIT commit;
+		CGitDllSession session;
 		try
 		{
-			CAutoLocker lock(g_Git.m_critGitDllSec);
 			if (git_get_commit_from_hash(&commit, hash.ToRaw()))
 				return -1;
 		}
 		catch (const char* msg)
 		{
+			session.Release();
 			MessageBox(nullptr, L"Could not get commit \"" + hash.ToString() + L"\".\nlibgit reports:\n" + CUnicodeUtils::GetUnicode(msg), L"TortoiseGit", MB_ICONERROR);
 			return -1;
 		}
@@ -234,6 +281,7 @@ int CLogDataVector::Fill(const std::unordered_set<CGitHash>& hashes)
 
 		pRev->Parse(&commit, mailmap.get());
 		git_free_commit(&commit);
+		session.Release();
 
 		revs.insert(pRev);
 	}
@@ -1,7 +1,7 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
 // Copyright (C) 2003-2009, 2015 - TortoiseSVN
-// Copyright (C) 2008-2025 - TortoiseGit
+// Copyright (C) 2008-2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -301,6 +301,7 @@ BOOL CLogDlg::OnInitDialog()
 	m_LogList.m_Path=m_path;
 	m_LogList.m_hasWC = !GitAdminDir::IsBareRepo(g_Git.m_CurrentDir);
 	m_LogList.m_bShowWC = !!CRegDWORD(L"Software\\TortoiseGit\\LogIncludeWorkingTreeChanges", TRUE) && m_LogList.m_hasWC && m_bShowWC;
+	m_LogList.m_bPrefetchSimpleLists = !!CRegDWORD(L"Software\\TortoiseGit\\LogCachePrefetchPaths", TRUE);
 	m_LogList.InsertGitColumn();
 
 	if (m_bWholeProject)
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2018-2020 - TortoiseGit
+// Copyright (C) 2018-2020, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -18,53 +18,55 @@
 //
 #include "stdafx.h"
 #include "LogDlgFilter.h"
-#include "LogDlg.h"
+#include "GitLogListBase.h"
 
 bool CLogDlgFilter::operator()(GitRevLoglist* pRev, CGitLogListBase* loglist, const MAP_HASH_NAME& hashMapRefs) const
 {
 	if (!IsFilterActive())
 		return CalculateFinalResult(true);
 
-	// we need to perform expensive string / pattern matching
-	scratch.clear();
+	// we need to perform expensive string / pattern matching,
+	// the log list filters on several threads, so do not use the (shared) scratch member
+	thread_local std::wstring text;
+	text.clear();
 	if (GetSelectedFilters() & (LOGFILTER_SUBJECT | LOGFILTER_MESSAGES))
 	{
-		scratch += pRev->GetSubject();
-		scratch += L'\n';
+		text += pRev->GetSubject();
+		text += L'\n';
 	}
 	if (GetSelectedFilters() & LOGFILTER_MESSAGES)
 	{
-		scratch += pRev->GetBody();
-		scratch += L'\n';
+		text += pRev->GetBody();
+		text += L'\n';
 	}
 	if (GetSelectedFilters() & LOGFILTER_BUGID)
 	{
-		scratch += loglist->m_ProjectProperties.FindBugID(pRev->GetSubjectBody());
-		scratch += L'\n';
+		text += loglist->m_ProjectProperties.FindBugID(pRev->GetSubjectBody());
+		text += L'\n';
 	}
 	if (GetSelectedFilters() & LOGFILTER_AUTHORS)
 	{
-		scratch += pRev->GetAuthorName();
-		scratch += L'\n';
-		scratch += pRev->GetCommitterName();
-		scratch += L'\n';
+		text += pRev->GetAuthorName();
+		text += L'\n';
+		text += pRev->GetCommitterName();
+		text += L'\n';
 	}
 	if (GetSelectedFilters() & LOGFILTER_EMAILS)
 	{
-		scratch += pRev->GetAuthorEmail();
-		scratch += L'\n';
-		scratch += pRev->GetCommitterEmail();
-		scratch += L'\n';
+		text += pRev->GetAuthorEmail();
+		text += L'\n';
+		text += pRev->GetCommitterEmail();
+		text += L'\n';
 	}
 	if (GetSelectedFilters() & LOGFILTER_REVS)
 	{
-		scratch += pRev->m_CommitHash.ToString();
-		scratch += L'\n';
+		text += pRev->m_CommitHash.ToString();
+		text += L'\n';
 	}
 	if (GetSelectedFilters() & LOGFILTER_NOTES)
 	{
-		scratch += pRev->m_Notes;
-		scratch += L'\n';
+		text += pRev->m_Notes;
+		text += L'\n';
 	}
 	if (GetSelectedFilters() & (LOGFILTER_REFNAME | LOGFILTER_ANNOTATEDTAG))
 	{
@@ -75,15 +77,17 @@ bool CLogDlgFilter::operator()(GitRevLoglist* pRev, CGitLogListBase* loglist, co
 			{
 				for (const auto& ref : (*refList).second)
 				{
-					scratch += ref;
-					scratch += L'\n';
+					text += ref;
+					text += L'\n';
 				}
 			}
+#ifndef GOOGLETEST_INCLUDE_GTEST_GTEST_H_
 			if (GetSelectedFilters() & LOGFILTER_ANNOTATEDTAG)
 			{
-				scratch += loglist->GetTagInfo((*refList).second);
-				scratch += L'\n';
+				text += loglist->GetTagInfo((*refList).second);
+				text += L'\n';
 			}
+#endif
 		}
 	}
 	if (GetSelectedFilters() & LOGFILTER_PATHS)
@@ -97,24 +101,105 @@ bool CLogDlgFilter::operator()(GitRevLoglist* pRev, CGitLogListBase* loglist, co
 			auto pathList = pRev->GetFiles(loglist);
 			for (int i = 0; i < pathList.GetCount(); ++i)
 			{
-				scratch += pathList[i].GetGitPathString();
-				scratch += L'|';
-				scratch += pathList[i].GetGitOldPathString();
-				scratch += L'\n';
+				text += pathList[i].GetGitPathString();
+				text += L'|';
+				text += pathList[i].GetGitOldPathString();
+				text += L'\n';
 			}
 		}
 		else
 		{
-			if (!pRev->m_IsSimpleListReady)
+			if (!pRev->m_IsSimpleListReady && !loglist->IsSimpleListCached(pRev))
 				pRev->SafeGetSimpleList(&g_Git);
 
 			for (size_t i = 0; i < pRev->m_SimpleFileList.size(); ++i)
 			{
-				scratch += pRev->m_SimpleFileList[i];
-				scratch += L'\n';
+				text += pRev->m_SimpleFileList[i];
+				text += L'\n';
 			}
 		}
 	}
 
-	return CalculateFinalResult(Match(scratch));
+	return CalculateFinalResult(Match(text));
+}
+
+std::unique_ptr<CLogSearchIndex::CQuery> CLogDlgFilter::GetSearchIndexQuery(const CLogSearchIndex& index) const
+{
+	// only subjects, bodies (containing the bug IDs) and paths are indexed, so there is nothing to gain otherwise
+	if (!IsFilterActive() || !(GetSelectedFilters() & (LOGFILTER_SUBJECT | LOGFILTER_MESSAGES | LOGFILTER_BUGID | LOGFILTER_PATHS)))
+		return nullptr;
+
+	std::vector<std::wstring> subStrings;
+	for (const auto& subString : GetRequiredSubStrings())
+	{
+		// the attributes are separated by these in the text to match, bug IDs are joined by spaces
+		if (subString.size() < 3 || subString.find_first_of((GetSelectedFilters() & LOGFILTER_BUGID) ? L"\n| " : L"\n|") != std::wstring::npos)
+			continue;
+		subStrings.push_back(subString);
+	}
+	if (subStrings.empty())
+		return nullptr;
+
+	return index.Query(subStrings);
+}
+
+bool CLogDlgFilter::IsRuledOut(const CLogSearchIndex::CQuery& query, GitRevLoglist* pRev, const MAP_HASH_NAME& hashMapRefs) const
+{
+	ULONGLONG mayContain = 0;
+	if (!query.Lookup(pRev->m_CommitHash, mayContain))
+		return false;
+
+	const size_t count = query.GetSubStringCount();
+	const ULONGLONG all = count >= 64 ? ~0ULL : (1ULL << count) - 1;
+	if ((mayContain & all) == all)
+		return false;
+
+	auto refList = hashMapRefs.find(pRev->m_CommitHash);
+	// tag messages are expensive to get, leave them to the exact match
+	if ((GetSelectedFilters() & LOGFILTER_ANNOTATEDTAG) && refList != hashMapRefs.cend())
+		return false;
+
+	// the attributes which are not indexed are cheap to check directly
+	thread_local CString text;
+	text.Empty();
+	if (GetSelectedFilters() & LOGFILTER_AUTHORS)
+	{
+		text += pRev->GetAuthorName();
+		text += L'\n';
+		text += pRev->GetCommitterName();
+		text += L'\n';
+	}
+	if (GetSelectedFilters() & LOGFILTER_EMAILS)
+	{
+		text += pRev->GetAuthorEmail();
+		text += L'\n';
+		text += pRev->GetCommitterEmail();
+		text += L'\n';
+	}
+	if (GetSelectedFilters() & LOGFILTER_REVS)
+	{
+		text += pRev->m_CommitHash.ToString();
+		text += L'\n';
+	}
+	if (GetSelectedFilters() & LOGFILTER_NOTES)
+	{
+		text += pRev->m_Notes;
+		text += L'\n';
+	}
+	if ((GetSelectedFilters() & LOGFILTER_REFNAME) && refList != hashMapRefs.cend())
+	{
+		for (const auto& ref : (*refList).second)
+		{
+			text += ref;
+			text += L'\n';
+		}
+	}
+	CLogSearchIndex::Normalize(text);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!(mayContain & (1ULL << i)) && text.Find(query.GetSubString(i)) < 0)
+			return true;
+	}
+	return false;
 }
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2018-2019 - TortoiseGit
+// Copyright (C) 2018-2019, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -19,6 +19,7 @@
 #pragma once
 #include "FilterHelper.h"
 #include "GitRevLoglist.h"
+#include "LogSearchIndex.h"
 
 class CGitLogListBase;
 
@@ -30,6 +31,12 @@ public:
 	/// apply filter
 	bool operator()(GitRevLoglist* pRev, CGitLogListBase* loglist, const MAP_HASH_NAME& hashMapRefs) const;
 
+	/// prepares ruling out commits with the search index of the log cache; nullptr if the filter cannot make use of it
+	std::unique_ptr<CLogSearchIndex::CQuery> GetSearchIndexQuery(const CLogSearchIndex& index) const;
+
+	/// returns true if the search index proves that operator() would not match pRev
+	bool IsRuledOut(const CLogSearchIndex::CQuery& query, GitRevLoglist* pRev, const MAP_HASH_NAME& hashMapRefs) const;
+
 	/// assignment operator
 	using CFilterHelper::operator=;
 
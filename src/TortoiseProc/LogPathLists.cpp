@@ -0,0 +1,257 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "stdafx.h"
+#include "LogPathLists.h"
+#include "GitRevLoglist.h"
+#include "BufferedFileWriter.h"
+#include "SegmentedFile.h"
+
+struct SLogPathListsSegment : SSegmentedFileSegment<SLogPathListsSegmentHeader>
+{
+	const DWORD* m_Starts = nullptr; // where the path ids of a commit start
+	const DWORD* m_Ids = nullptr;
+};
+
+struct SLogPathListsMappedFile : SSegmentedMappedFile<SLogPathListsSegment>
+{
+	std::vector<std::wstring_view> m_Paths; // the path table, indexed by path id
+
+	bool Map(HANDLE file);
+};
+
+template <typename T>
+static bool Take(const BYTE* data, size_t length, size_t& offset, ULONGLONG count, const T*& items)
+{
+	if (count > (length - offset) / sizeof(T))
+		return false;
+	items = reinterpret_cast<const T*>(data + offset);
+	offset += static_cast<size_t>(count) * sizeof(T);
+	return true;
+}
+
+static bool ParseSegment(const BYTE* data, size_t length, size_t& offset, SLogPathListsSegment& segment, std::vector<std::wstring_view>& paths)
+{
+	if (!Take(data, length, offset, 1, segment.m_Header) || segment.m_Header->m_Magic != LOG_PATHS_SEGMENT_MAGIC)
+		return false;
+	const auto& header = *segment.m_Header;
+
+	const DWORD* pathStarts;
+	const wchar_t* chars;
+	if (!Take(data, length, offset, header.m_CommitCount, segment.m_Hashes) || !Take(data, length, offset, header.m_CommitCount + 1ULL, segment.m_Starts) || !Take(data, length, offset, header.m_IdCount, segment.m_Ids) || !Take(data, length, offset, header.m_PathCount + 1ULL, pathStarts) || !Take(data, length, offset, header.m_PathLength, chars))
+		return false;
+	// segments are aligned
+	const size_t padding = (8 - offset % 8) % 8;
+	if (length - offset < padding)
+		return false;
+	offset += padding;
+
+	if (!segment.AreHashesSorted() || segment.m_Starts[0] || segment.m_Starts[header.m_CommitCount] != header.m_IdCount || pathStarts[0] || pathStarts[header.m_PathCount] != header.m_PathLength)
+		return false;
+	for (DWORD i = 0; i < header.m_CommitCount; ++i)
+	{
+		if (segment.m_Starts[i] > segment.m_Starts[i + 1])
+			return false;
+	}
+	for (DWORD i = 0; i < header.m_PathCount; ++i)
+	{
+		if (pathStarts[i] > pathStarts[i + 1])
+			return false;
+		paths.emplace_back(chars + pathStarts[i], pathStarts[i + 1] - pathStarts[i]);
+	}
+	// commits can only refer to paths of their own or former segments
+	return std::all_of(segment.m_Ids, segment.m_Ids + header.m_IdCount, [&paths](DWORD id) { return id < paths.size(); });
+}
+
+bool SLogPathListsMappedFile::Map(HANDLE file)
+{
+	return MapSegments(file, LOG_PATHS_MAGIC, LOG_PATHS_VERSION, [this](const BYTE* data, size_t length, size_t& offset, SLogPathListsSegment& segment) { return ParseSegment(data, length, offset, segment, m_Paths); });
+}
+
+namespace
+{
+// writes a segment at the current file position, starts and ids are the path ids of the commits (cf. SLogPathListsSegment)
+bool WriteSegment(HANDLE file, const std::vector<CGitHash>& hashes, const std::vector<DWORD>& starts, const std::vector<DWORD>& ids, const std::vector<std::wstring_view>& paths, ULONGLONG& length)
+{
+	LARGE_INTEGER start{};
+	if (hashes.size() >= MAXDWORD || ids.size() >= MAXDWORD || paths.size() >= MAXDWORD || !SetFilePointerEx(file, LARGE_INTEGER{}, &start, FILE_CURRENT))
+		return false;
+
+	std::vector<DWORD> pathStarts;
+	pathStarts.reserve(paths.size() + 1);
+	pathStarts.push_back(0);
+	for (const auto& path : paths)
+	{
+		if (path.size() > MAXDWORD - pathStarts.back())
+			return false;
+		pathStarts.push_back(pathStarts.back() + static_cast<DWORD>(path.size()));
+	}
+
+	const SLogPathListsSegmentHeader header{ LOG_PATHS_SEGMENT_MAGIC, static_cast<DWORD>(hashes.size()), static_cast<DWORD>(ids.size()), static_cast<DWORD>(paths.size()), pathStarts.back(), 0 };
+	CBufferedFileWriter writer(file);
+	if (!writer.Write(&header, sizeof(header)) || !writer.Write(hashes.data(), hashes.size() * sizeof(CGitHash)) || !writer.Write(starts.data(), starts.size() * sizeof(DWORD)) || !writer.Write(ids.data(), ids.size() * sizeof(DWORD)) || !writer.Write(pathStarts.data(), pathStarts.size() * sizeof(DWORD)))
+		return false;
+	for (const auto& path : paths)
+	{
+		if (!writer.Write(path.data(), path.size() * sizeof(wchar_t)))
+			return false;
+	}
+	length = sizeof(header) + hashes.size() * sizeof(CGitHash) + (starts.size() + ids.size() + pathStarts.size()) * sizeof(DWORD) + static_cast<ULONGLONG>(header.m_PathLength) * sizeof(wchar_t);
+	// keeps the following segment aligned
+	static const BYTE padding[8]{};
+	const size_t paddingLength = (8 - (start.QuadPart + length) % 8) % 8;
+	if (!writer.Write(padding, paddingLength) || !writer.Flush())
+		return false;
+	length += paddingLength;
+	return true;
+}
+
+// writes the single segment of a merged file, the path table (and so the path ids) stay the same
+bool WriteMergedSegment(const SLogPathListsMappedFile& source, HANDLE target, ULONGLONG& length)
+{
+	// (hash, segment, commit id)
+	std::vector<std::tuple<CGitHash, size_t, DWORD>> commits;
+	for (size_t i = 0; i < source.m_Segments.size(); ++i)
+	{
+		for (DWORD id = 0; id < source.m_Segments[i].m_Header->m_CommitCount; ++id)
+			commits.emplace_back(source.m_Segments[i].m_Hashes[id], i, id);
+	}
+	std::sort(commits.begin(), commits.end());
+	commits.erase(std::unique(commits.begin(), commits.end(), [](const auto& a, const auto& b) { return std::get<0>(a) == std::get<0>(b); }), commits.end());
+
+	std::vector<CGitHash> hashes;
+	hashes.reserve(commits.size());
+	std::vector<DWORD> starts;
+	starts.reserve(commits.size() + 1);
+	starts.push_back(0);
+	std::vector<DWORD> ids;
+	for (const auto& [hash, i, id] : commits)
+	{
+		const auto& segment = source.m_Segments[i];
+		hashes.push_back(hash);
+		ids.insert(ids.end(), segment.m_Ids + segment.m_Starts[id], segment.m_Ids + segment.m_Starts[id + 1]);
+		if (ids.size() >= MAXDWORD)
+			return false;
+		starts.push_back(static_cast<DWORD>(ids.size()));
+	}
+
+	return WriteSegment(target, hashes, starts, ids, source.m_Paths, length);
+}
+}
+
+int CLogPathLists::Load(const CString& gitDir)
+{
+	Close();
+
+	m_File = SLogPathListsMappedFile::Load<SLogPathListsMappedFile>(gitDir + PATH_LISTS_FILE_NAME);
+	return m_File ? 0 : -1;
+}
+
+void CLogPathLists::Close()
+{
+	m_File.reset();
+}
+
+bool CLogPathLists::Contains(const CGitHash& hash) const
+{
+	return m_File && m_File->Contains(hash);
+}
+
+bool CLogPathLists::GetList(const CGitHash& hash, STRING_VECTOR& list) const
+{
+	if (!m_File)
+		return false;
+
+	for (const auto& segment : m_File->m_Segments)
+	{
+		DWORD id;
+		if (!segment.Find(hash, id))
+			continue;
+
+		list.clear();
+		list.reserve(segment.m_Starts[id + 1] - segment.m_Starts[id]);
+		for (DWORD i = segment.m_Starts[id]; i < segment.m_Starts[id + 1]; ++i)
+		{
+			const auto& path = m_File->m_Paths[segment.m_Ids[i]];
+			list.emplace_back(path.data(), static_cast<int>(path.size()));
+		}
+		return true;
+	}
+	return false;
+}
+
+int CLogPathLists::Update(const CString& gitDir, const std::vector<const GitRevLoglist*>& revs)
+{
+	if (revs.empty())
+		return 0;
+
+	Close();
+
+	CSegmentedFileUpdater updater(gitDir + PATH_LISTS_FILE_NAME, LOG_PATHS_MAGIC, LOG_PATHS_VERSION);
+	std::vector<const GitRevLoglist*> newRevs;
+	// the paths are interned, new ones get the next free id
+	std::unordered_map<std::wstring, DWORD> pathIds;
+	DWORD pathCount = 0;
+	if (!updater.Open<SLogPathListsMappedFile>([&](const SLogPathListsMappedFile* existing) {
+		if (existing)
+		{
+			pathIds.reserve(existing->m_Paths.size());
+			for (const auto& path : existing->m_Paths)
+				pathIds.try_emplace(std::wstring(path), pathCount++);
+		}
+		for (const auto rev : revs)
+		{
+			if (!rev->m_CommitHash.IsEmpty() && rev->m_IsSimpleListReady && !(existing && existing->Contains(rev->m_CommitHash)))
+				newRevs.push_back(rev);
+		}
+	}))
+		return -1;
+	std::sort(newRevs.begin(), newRevs.end(), [](const GitRevLoglist* a, const GitRevLoglist* b) { return a->m_CommitHash < b->m_CommitHash; });
+	newRevs.erase(std::unique(newRevs.begin(), newRevs.end(), [](const GitRevLoglist* a, const GitRevLoglist* b) { return a->m_CommitHash == b->m_CommitHash; }), newRevs.end());
+	if (newRevs.empty())
+		return 0;
+
+	std::vector<CGitHash> hashes;
+	hashes.reserve(newRevs.size());
+	std::vector<DWORD> starts;
+	starts.reserve(newRevs.size() + 1);
+	starts.push_back(0);
+	std::vector<DWORD> ids;
+	std::vector<std::wstring_view> newPaths;
+	for (const auto rev : newRevs)
+	{
+		hashes.push_back(rev->m_CommitHash);
+		for (const auto& path : rev->m_SimpleFileList)
+		{
+			auto [it, inserted] = pathIds.try_emplace(std::wstring(path, path.GetLength()), pathCount);
+			if (inserted)
+			{
+				newPaths.push_back(it->first);
+				++pathCount;
+			}
+			ids.push_back(it->second);
+		}
+		if (ids.size() >= MAXDWORD)
+			return -1;
+		starts.push_back(static_cast<DWORD>(ids.size()));
+	}
+
+	if (!updater.Append([&](HANDLE file, ULONGLONG& length) { return WriteSegment(file, hashes, starts, ids, newPaths, length); }))
+		return -1;
+	return updater.Commit<SLogPathListsMappedFile>(LOG_PATHS_MAX_SEGMENTS, WriteMergedSegment) ? 0 : -1;
+}
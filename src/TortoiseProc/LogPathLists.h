@@ -0,0 +1,78 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+#include "GitHash.h"
+#include "gittype.h"
+#include <memory>
+
+class GitRevLoglist;
+struct SLogPathListsMappedFile;
+
+#define LOG_PATHS_MAGIC				0x9A7B5011
+#define LOG_PATHS_SEGMENT_MAGIC		0x9A7B5022
+#define LOG_PATHS_VERSION			0x1
+
+// every update appends a segment, all segments are merged into a single one as soon as there are more than this
+#define LOG_PATHS_MAX_SEGMENTS		8
+
+// the file consists of a SSegmentedFileHeader and the segments (cf. SegmentedFile.h)
+#pragma pack (1)
+// followed by m_CommitCount sorted hashes, m_CommitCount + 1 DWORDs where the path ids of each commit start,
+// m_IdCount DWORD path ids, m_PathCount + 1 DWORDs where each new path starts and m_PathLength characters.
+// The paths of all segments form one path table, a path id is the position of the path in it.
+struct SLogPathListsSegmentHeader
+{
+	DWORD m_Magic;
+	DWORD m_CommitCount;
+	DWORD m_IdCount;
+	DWORD m_PathCount; // paths added to the path table by this segment
+	DWORD m_PathLength;
+	DWORD m_Reserved;
+};
+# pragma pack ()
+
+#define PATH_LISTS_FILE_NAME L"tortoisegit.paths"
+
+/**
+ * \ingroup TortoiseProc
+ * Persistent store of the changed paths of commits as used for filtering the log by paths
+ * (cf. GitRevLoglist::m_SimpleFileList), so that they do not need to be diffed again.
+ * Every path is stored only once, the commits refer to it by its id.
+ */
+class CLogPathLists
+{
+public:
+	CLogPathLists() = default;
+	CLogPathLists(const CLogPathLists&) = delete;
+	CLogPathLists& operator=(const CLogPathLists&) = delete;
+
+	int Load(const CString& gitDir);
+	void Close();
+	bool IsLoaded() const { return !!m_File; }
+
+	/// adds the commits which are not stored yet, all of them need to have their simple file list ready
+	int Update(const CString& gitDir, const std::vector<const GitRevLoglist*>& revs);
+
+	bool Contains(const CGitHash& hash) const;
+	/// returns false if the commit is not stored
+	bool GetList(const CGitHash& hash, STRING_VECTOR& list) const;
+
+private:
+	std::shared_ptr<const SLogPathListsMappedFile> m_File;
+};
@@ -0,0 +1,436 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "stdafx.h"
+#include "LogSearchIndex.h"
+#include "GitRevLoglist.h"
+#include "BufferedFileWriter.h"
+#include "SegmentedFile.h"
+#include <intsafe.h>
+
+struct SLogSearchSegment : SSegmentedFileSegment<SLogSearchSegmentHeader>
+{
+	const BYTE* m_Postings = nullptr;
+	const SLogSearchTrigram* m_Trigrams = nullptr;
+
+	const SLogSearchTrigram* FindTrigram(DWORD trigram) const
+	{
+		auto end = m_Trigrams + m_Header->m_TrigramCount;
+		auto it = std::lower_bound(m_Trigrams, end, trigram, [](const SLogSearchTrigram& item, DWORD value) { return item.m_Trigram < value; });
+		if (it == end || it->m_Trigram != trigram)
+			return nullptr;
+		return it;
+	}
+
+	bool GetPostings(const SLogSearchTrigram& trigram, std::vector<DWORD>& ids) const
+	{
+		ids.clear();
+		const BYTE* p = m_Postings + trigram.m_Offset;
+		const BYTE* end = m_Postings + m_Header->m_PostingsLength;
+		DWORD id = 0;
+		for (DWORD i = 0; i < trigram.m_Count; ++i)
+		{
+			DWORD delta = 0;
+			for (int shift = 0;; shift += 7)
+			{
+				if (p >= end || shift > 28)
+					return false;
+				const BYTE b = *p++;
+				delta |= static_cast<DWORD>(b & 0x7F) << shift;
+				if (!(b & 0x80))
+					break;
+			}
+			if ((i && !delta) || delta >= m_Header->m_CommitCount - id)
+				return false;
+			id += delta;
+			ids.push_back(id);
+		}
+		return true;
+	}
+};
+
+struct SLogSearchMappedFile : SSegmentedMappedFile<SLogSearchSegment>
+{
+	bool Map(HANDLE file);
+};
+
+static bool ParseSegment(const BYTE* data, size_t length, size_t& offset, SLogSearchSegment& segment)
+{
+	if (length - offset < sizeof(SLogSearchSegmentHeader))
+		return false;
+	segment.m_Header = reinterpret_cast<const SLogSearchSegmentHeader*>(data + offset);
+	offset += sizeof(SLogSearchSegmentHeader);
+	const auto& header = *segment.m_Header;
+	if (header.m_Magic != LOG_SEARCH_SEGMENT_MAGIC)
+		return false;
+
+	size_t len;
+	if (SizeTMult(header.m_CommitCount, sizeof(CGitHash), &len) != S_OK || length - offset < len)
+		return false;
+	segment.m_Hashes = reinterpret_cast<const CGitHash*>(data + offset);
+	offset += len;
+
+	if (header.m_PostingsLength > static_cast<ULONGLONG>(length - offset))
+		return false;
+	segment.m_Postings = data + offset;
+	offset += static_cast<size_t>(header.m_PostingsLength);
+
+	if (SizeTMult(header.m_TrigramCount, sizeof(SLogSearchTrigram), &len) != S_OK || length - offset < len)
+		return false;
+	segment.m_Trigrams = reinterpret_cast<const SLogSearchTrigram*>(data + offset);
+	offset += len;
+
+	if (!segment.AreHashesSorted())
+		return false;
+	for (DWORD i = 0; i < header.m_TrigramCount; ++i)
+	{
+		const auto& trigram = segment.m_Trigrams[i];
+		if ((i && segment.m_Trigrams[i - 1].m_Trigram >= trigram.m_Trigram) || !trigram.m_Count || trigram.m_Count > header.m_CommitCount || trigram.m_Offset >= header.m_PostingsLength)
+			return false;
+	}
+	return true;
+}
+
+bool SLogSearchMappedFile::Map(HANDLE file)
+{
+	return MapSegments(file, LOG_SEARCH_MAGIC, LOG_SEARCH_VERSION, ParseSegment);
+}
+
+namespace
+{
+void AppendVarInt(std::vector<BYTE>& out, DWORD value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<BYTE>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<BYTE>(value));
+}
+
+// writes a segment at the current file position, nextPostings(trigram, ids) provides the
+// ascending commit ids for one trigram after the other in ascending order and returns false at the end
+template <typename NextPostings>
+bool WriteSegment(HANDLE file, const std::vector<CGitHash>& hashes, NextPostings nextPostings, ULONGLONG& length)
+{
+	LARGE_INTEGER start{};
+	if (!SetFilePointerEx(file, LARGE_INTEGER{}, &start, FILE_CURRENT))
+		return false;
+
+	SLogSearchSegmentHeader header{ LOG_SEARCH_SEGMENT_MAGIC, static_cast<DWORD>(hashes.size()), 0, 0, 0 };
+	CBufferedFileWriter writer(file);
+	if (!writer.Write(&header, sizeof(header)) || !writer.Write(hashes.data(), hashes.size() * sizeof(CGitHash)))
+		return false;
+
+	std::vector<SLogSearchTrigram> trigrams;
+	std::vector<DWORD> ids;
+	std::vector<BYTE> encoded;
+	DWORD trigram = 0;
+	while (nextPostings(trigram, ids))
+	{
+		if (ids.empty())
+			continue;
+		encoded.clear();
+		DWORD previous = 0;
+		for (const auto id : ids)
+		{
+			AppendVarInt(encoded, id - previous);
+			previous = id;
+		}
+		trigrams.push_back({ trigram, static_cast<DWORD>(ids.size()), header.m_PostingsLength });
+		if (!writer.Write(encoded.data(), encoded.size()))
+			return false;
+		header.m_PostingsLength += encoded.size();
+	}
+	// keeps the trigram table and the following segment aligned
+	static const BYTE padding[8]{};
+	const size_t paddingLength = (8 - (start.QuadPart + sizeof(header) + hashes.size() * sizeof(CGitHash) + header.m_PostingsLength) % 8) % 8;
+	if (!writer.Write(padding, paddingLength))
+		return false;
+	header.m_PostingsLength += paddingLength;
+	header.m_TrigramCount = static_cast<DWORD>(trigrams.size());
+	if (!writer.Write(trigrams.data(), trigrams.size() * sizeof(SLogSearchTrigram)) || !writer.Flush())
+		return false;
+
+	// the header could only be completed now
+	LARGE_INTEGER end{};
+	if (!SetFilePointerEx(file, LARGE_INTEGER{}, &end, FILE_CURRENT) || !SetFilePointerEx(file, start, nullptr, FILE_BEGIN))
+		return false;
+	if (DWORD written = 0; !WriteFile(file, &header, sizeof(header), &written, nullptr) || written != sizeof(header))
+		return false;
+	if (!SetFilePointerEx(file, end, nullptr, FILE_BEGIN))
+		return false;
+
+	length = end.QuadPart - start.QuadPart;
+	return true;
+}
+
+// writes the single segment of a merged index, the postings of the trigrams are merged one after the other
+bool WriteMergedSegment(const SLogSearchMappedFile& source, HANDLE target, bool& corrupt, ULONGLONG& length)
+{
+	const auto& segments = source.m_Segments;
+	std::vector<CGitHash> hashes;
+	for (const auto& segment : segments)
+		hashes.insert(hashes.end(), segment.m_Hashes, segment.m_Hashes + segment.m_Header->m_CommitCount);
+	std::sort(hashes.begin(), hashes.end());
+	hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+	std::vector<std::vector<DWORD>> newIds(segments.size());
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		newIds[i].reserve(segments[i].m_Header->m_CommitCount);
+		for (DWORD id = 0; id < segments[i].m_Header->m_CommitCount; ++id)
+			newIds[i].push_back(static_cast<DWORD>(std::lower_bound(hashes.cbegin(), hashes.cend(), segments[i].m_Hashes[id]) - hashes.cbegin()));
+	}
+
+	std::vector<DWORD> positions(segments.size(), 0);
+	std::vector<DWORD> ids;
+	return WriteSegment(target, hashes, [&](DWORD& trigram, std::vector<DWORD>& merged) {
+		// continue with the smallest trigram not yet merged
+		bool found = false;
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			if (positions[i] < segments[i].m_Header->m_TrigramCount && (!found || segments[i].m_Trigrams[positions[i]].m_Trigram < trigram))
+			{
+				trigram = segments[i].m_Trigrams[positions[i]].m_Trigram;
+				found = true;
+			}
+		}
+		if (!found)
+			return false;
+
+		merged.clear();
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			if (positions[i] >= segments[i].m_Header->m_TrigramCount || segments[i].m_Trigrams[positions[i]].m_Trigram != trigram)
+				continue;
+			if (!segments[i].GetPostings(segments[i].m_Trigrams[positions[i]], ids))
+			{
+				corrupt = true;
+				return false;
+			}
+			for (const auto id : ids)
+				merged.push_back(newIds[i][id]);
+			++positions[i];
+		}
+		std::sort(merged.begin(), merged.end());
+		merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+		return true;
+	}, length) && !corrupt;
+}
+
+inline DWORD HashTrigram(wchar_t a, wchar_t b, wchar_t c)
+{
+	const ULONGLONG key = (static_cast<ULONGLONG>(a) << 32) | (static_cast<ULONGLONG>(b) << 16) | static_cast<ULONGLONG>(c);
+	return static_cast<DWORD>((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+}
+
+bool CLogSearchIndex::WriteNewSegment(HANDLE file, const GitRevLoglist* const* revs, size_t count, ULONGLONG& length)
+{
+	std::vector<CGitHash> hashes;
+	hashes.reserve(count);
+	// (trigram << 32) | commit id
+	std::vector<ULONGLONG> pairs;
+	std::vector<DWORD> trigrams;
+	auto addText = [&trigrams](CString text) {
+		Normalize(text);
+		GetTrigrams(text, trigrams);
+	};
+	for (size_t id = 0; id < count; ++id)
+	{
+		const GitRevLoglist* rev = revs[id];
+		hashes.push_back(rev->m_CommitHash);
+
+		trigrams.clear();
+		addText(rev->GetSubject());
+		addText(rev->GetBody());
+		for (int i = 0; i < rev->m_Files.GetCount(); ++i)
+		{
+			addText(rev->m_Files[i].GetGitPathString());
+			addText(rev->m_Files[i].GetGitOldPathString());
+		}
+		std::sort(trigrams.begin(), trigrams.end());
+		trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+		for (const auto trigram : trigrams)
+			pairs.push_back((static_cast<ULONGLONG>(trigram) << 32) | id);
+	}
+	std::sort(pairs.begin(), pairs.end());
+
+	size_t pos = 0;
+	return WriteSegment(file, hashes, [&pairs, &pos](DWORD& trigram, std::vector<DWORD>& ids) {
+		if (pos >= pairs.size())
+			return false;
+		trigram = static_cast<DWORD>(pairs[pos] >> 32);
+		ids.clear();
+		for (; pos < pairs.size() && static_cast<DWORD>(pairs[pos] >> 32) == trigram; ++pos)
+			ids.push_back(static_cast<DWORD>(pairs[pos]));
+		return true;
+	}, length);
+}
+
+void CLogSearchIndex::Normalize(CString& text)
+{
+	// same lower casing as in CFilterHelper::Match()
+	text.MakeLower();
+	// PCRE2 matches these against ASCII letters if the case is ignored
+	text.Replace(L'\u212A', L'k'); // KELVIN SIGN
+	text.Replace(L'\u017F', L's'); // LATIN SMALL LETTER LONG S
+}
+
+void CLogSearchIndex::GetTrigrams(const CString& text, std::vector<DWORD>& trigrams)
+{
+	for (int i = 2; i < text.GetLength(); ++i)
+		trigrams.push_back(HashTrigram(text[i - 2], text[i - 1], text[i]));
+}
+
+int CLogSearchIndex::Load(const CString& gitDir)
+{
+	Close();
+
+	m_File = SLogSearchMappedFile::Load<SLogSearchMappedFile>(gitDir + SEARCH_INDEX_FILE_NAME);
+	return m_File ? 0 : -1;
+}
+
+void CLogSearchIndex::Close()
+{
+	// queries keep their mapping alive
+	m_File.reset();
+}
+
+int CLogSearchIndex::Update(const CString& gitDir, const std::vector<const GitRevLoglist*>& revs)
+{
+	if (revs.empty())
+		return 0;
+
+	// segments are appended to the file, so it must not be mapped any more
+	Close();
+
+	const CString fileName = gitDir + SEARCH_INDEX_FILE_NAME;
+	CSegmentedFileUpdater updater(fileName, LOG_SEARCH_MAGIC, LOG_SEARCH_VERSION);
+	std::vector<const GitRevLoglist*> newRevs;
+	if (!updater.Open<SLogSearchMappedFile>([&revs, &newRevs](const SLogSearchMappedFile* existing) {
+		for (const auto rev : revs)
+		{
+			if (!rev->m_CommitHash.IsEmpty() && !(existing && existing->Contains(rev->m_CommitHash)))
+				newRevs.push_back(rev);
+		}
+	}))
+		return -1;
+	std::sort(newRevs.begin(), newRevs.end(), [](const GitRevLoglist* a, const GitRevLoglist* b) { return a->m_CommitHash < b->m_CommitHash; });
+	newRevs.erase(std::unique(newRevs.begin(), newRevs.end(), [](const GitRevLoglist* a, const GitRevLoglist* b) { return a->m_CommitHash == b->m_CommitHash; }), newRevs.end());
+	if (newRevs.empty())
+		return 0;
+
+	for (size_t begin = 0; begin < newRevs.size(); begin += LOG_SEARCH_SEGMENT_COMMITS)
+	{
+		if (!updater.Append([&newRevs, begin](HANDLE file, ULONGLONG& length) { return WriteNewSegment(file, newRevs.data() + begin, min(newRevs.size() - begin, static_cast<size_t>(LOG_SEARCH_SEGMENT_COMMITS)), length); }))
+			return -1;
+	}
+
+	bool corrupt = false;
+	if (updater.Commit<SLogSearchMappedFile>(LOG_SEARCH_MAX_SEGMENTS, [&corrupt](const SLogSearchMappedFile& source, HANDLE target, ULONGLONG& length) { return WriteMergedSegment(source, target, corrupt, length); }))
+		return 0;
+
+	if (corrupt)
+		::DeleteFile(fileName);
+	return -1;
+}
+
+std::unique_ptr<CLogSearchIndex::CQuery> CLogSearchIndex::Query(const std::vector<std::wstring>& subStrings) const
+{
+	if (!m_File)
+		return nullptr;
+
+	auto query = std::make_unique<CQuery>();
+	query->m_File = m_File;
+	for (const auto& subString : subStrings)
+	{
+		if (query->m_SubStrings.size() >= 64)
+			break;
+		CString normalized(subString.c_str(), static_cast<int>(subString.size()));
+		Normalize(normalized);
+		query->m_SubStrings.push_back(normalized);
+	}
+
+	std::vector<DWORD> trigrams;
+	std::vector<const SLogSearchTrigram*> postings;
+	std::vector<DWORD> candidates, ids, intersection;
+	for (const auto& segment : m_File->m_Segments)
+	{
+		auto& mayContain = query->m_MayContain.emplace_back(segment.m_Header->m_CommitCount, 0);
+		for (size_t i = 0; i < query->m_SubStrings.size(); ++i)
+		{
+			const ULONGLONG bit = 1ULL << i;
+			trigrams.clear();
+			GetTrigrams(query->m_SubStrings[i], trigrams);
+			std::sort(trigrams.begin(), trigrams.end());
+			trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+			postings.clear();
+			for (const auto trigram : trigrams)
+			{
+				auto p = segment.FindTrigram(trigram);
+				if (!p)
+					break;
+				postings.push_back(p);
+			}
+			if (postings.size() != trigrams.size())
+				continue; // no commit of this segment contains the sub-string
+
+			// intersect the postings, starting with the shortest one
+			std::sort(postings.begin(), postings.end(), [](const SLogSearchTrigram* a, const SLogSearchTrigram* b) { return a->m_Count < b->m_Count; });
+			bool valid = true;
+			candidates.clear();
+			if (!postings.empty())
+				valid = segment.GetPostings(*postings[0], candidates);
+			for (size_t j = 1; valid && j < postings.size() && !candidates.empty(); ++j)
+			{
+				valid = segment.GetPostings(*postings[j], ids);
+				intersection.clear();
+				std::set_intersection(candidates.cbegin(), candidates.cend(), ids.cbegin(), ids.cend(), std::back_inserter(intersection));
+				candidates.swap(intersection);
+			}
+
+			// sub-strings without trigrams (and broken postings) cannot rule out any commit
+			if (postings.empty() || !valid)
+			{
+				for (auto& value : mayContain)
+					value |= bit;
+				continue;
+			}
+			for (const auto id : candidates)
+				mayContain[id] |= bit;
+		}
+	}
+
+	return query;
+}
+
+bool CLogSearchIndex::CQuery::Lookup(const CGitHash& hash, ULONGLONG& mayContain) const
+{
+	for (size_t i = 0; i < m_File->m_Segments.size(); ++i)
+	{
+		if (DWORD id; m_File->m_Segments[i].Find(hash, id))
+		{
+			mayContain = m_MayContain[i][id];
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,109 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+#include "GitHash.h"
+#include <memory>
+
+class GitRevLoglist;
+struct SLogSearchMappedFile;
+
+#define LOG_SEARCH_MAGIC			0x5EA2C411
+#define LOG_SEARCH_SEGMENT_MAGIC	0x5EA2C422
+#define LOG_SEARCH_VERSION			0x1
+
+// every update appends a segment, all segments are merged into a single one as soon as there are more than this
+#define LOG_SEARCH_MAX_SEGMENTS		8
+// commits per appended segment, limits the memory needed for building a segment
+#define LOG_SEARCH_SEGMENT_COMMITS	16384
+
+// the file consists of a SSegmentedFileHeader and the segments (cf. SegmentedFile.h)
+#pragma pack (1)
+// followed by m_CommitCount sorted hashes (the position of a hash is the id of the commit within the segment),
+// m_PostingsLength bytes of postings and m_TrigramCount SLogSearchTrigram items sorted by trigram
+struct SLogSearchSegmentHeader
+{
+	DWORD m_Magic;
+	DWORD m_CommitCount;
+	DWORD m_TrigramCount;
+	DWORD m_Reserved;
+	ULONGLONG m_PostingsLength;
+};
+
+struct SLogSearchTrigram
+{
+	DWORD m_Trigram;
+	DWORD m_Count; // number of commits containing the trigram
+	ULONGLONG m_Offset; // relative to the postings of the segment; ascending commit ids, stored as variable length encoded deltas
+};
+# pragma pack ()
+
+#define SEARCH_INDEX_FILE_NAME L"tortoisegit.search"
+
+/**
+ * \ingroup TortoiseProc
+ * Persistent trigram index over the subjects, bodies and changed paths of the commits in the log cache.
+ * A lookup only narrows down the commits which might contain some sub-strings (hash collisions and trigrams
+ * spread over the sub-string just add candidates), so candidates still need to be matched exactly.
+ */
+class CLogSearchIndex
+{
+public:
+	class CQuery
+	{
+	public:
+		/// returns false if the commit is not indexed, otherwise sets bit i of mayContain if the commit might contain the i-th sub-string
+		bool Lookup(const CGitHash& hash, ULONGLONG& mayContain) const;
+
+		size_t GetSubStringCount() const { return m_SubStrings.size(); }
+		/// normalized, cf. CLogSearchIndex::Normalize()
+		const CString& GetSubString(size_t i) const { return m_SubStrings[i]; }
+
+	private:
+		friend class CLogSearchIndex;
+
+		std::shared_ptr<const SLogSearchMappedFile> m_File;
+		std::vector<CString> m_SubStrings;
+		std::vector<std::vector<ULONGLONG>> m_MayContain; // per segment and commit id
+	};
+
+	CLogSearchIndex() = default;
+	CLogSearchIndex(const CLogSearchIndex&) = delete;
+	CLogSearchIndex& operator=(const CLogSearchIndex&) = delete;
+
+	int Load(const CString& gitDir);
+	void Close();
+	bool IsLoaded() const { return !!m_File; }
+
+	/// adds the commits which are not indexed yet, all of them need to have their changed files
+	int Update(const CString& gitDir, const std::vector<const GitRevLoglist*>& revs);
+
+	/// prepares looking up commits which might contain all of the (at most 64) sub-strings;
+	/// returns nullptr if no index is loaded
+	std::unique_ptr<CQuery> Query(const std::vector<std::wstring>& subStrings) const;
+
+	/// lower case, plus characters Unicode case folding maps onto ASCII letters
+	static void Normalize(CString& text);
+	/// appends the hashes of all trigrams of a normalized text
+	static void GetTrigrams(const CString& text, std::vector<DWORD>& trigrams);
+
+private:
+	static bool WriteNewSegment(HANDLE file, const GitRevLoglist* const* revs, size_t count, ULONGLONG& length);
+
+	std::shared_ptr<const SLogSearchMappedFile> m_File;
+};
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2009, 2011-2014, 2018, 2020-2021, 2023 - TortoiseGit
+// Copyright (C) 2009, 2011-2014, 2018, 2020-2021, 2023, 2026 - TortoiseGit
 // Copyright (C) 2003-2008,2011-2012 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -220,12 +220,13 @@ public:
 	/// multi line string containing the data for a pre-rebase-hook
 	CString		sPreRebaseHook;
 
-private:
 	/**
 	 * Constructing regex objects is expensive. Therefore, cache them here.
+	 * Call this before looking for bug IDs on several threads, those only read the regexes then.
 	 */
 	void AutoUpdateRegex();
 
+private:
 	void FetchHookString(CAutoConfig& gitconfig, const CString& sBase, CString& sHook);
 
 	bool regExNeedUpdate = true;
@@ -0,0 +1,232 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+#include "GitHash.h"
+#include <memory>
+#include <intsafe.h>
+
+#pragma pack (1)
+struct SSegmentedFileHeader
+{
+	DWORD m_Magic;
+	DWORD m_Version;
+	DWORD m_SegmentCount;
+	DWORD m_Reserved;
+	ULONGLONG m_Length; // end of the last completely written segment
+};
+# pragma pack ()
+
+/**
+ * \ingroup TortoiseProc
+ * A segment of a segmented file, starting with SegmentHeader (which has a m_CommitCount) and the sorted hashes of its commits.
+ */
+template <typename SegmentHeader>
+struct SSegmentedFileSegment
+{
+	const SegmentHeader* m_Header = nullptr;
+	const CGitHash* m_Hashes = nullptr; // the position of a hash is the id of the commit within the segment
+
+	bool Find(const CGitHash& hash, DWORD& id) const
+	{
+		auto end = m_Hashes + m_Header->m_CommitCount;
+		auto it = std::lower_bound(m_Hashes, end, hash);
+		if (it == end || *it != hash)
+			return false;
+		id = static_cast<DWORD>(it - m_Hashes);
+		return true;
+	}
+
+	/// lookups rely on the sort order
+	bool AreHashesSorted() const
+	{
+		for (DWORD i = 1; i < m_Header->m_CommitCount; ++i)
+		{
+			if (!(m_Hashes[i - 1] < m_Hashes[i]))
+				return false;
+		}
+		return true;
+	}
+};
+
+/**
+ * \ingroup TortoiseProc
+ * Read only mapping of a file consisting of a SSegmentedFileHeader and the segments appended by the updates one after the other,
+ * used by the side files of the log cache (cf. CLogSearchIndex and CLogPathLists).
+ */
+template <typename Segment>
+struct SSegmentedMappedFile
+{
+	CAutoFile m_File; // only set if the mapping owns the file
+	CAutoGeneralHandle m_Mapping;
+	CAutoViewOfFile m_View;
+	SSegmentedFileHeader m_Header{};
+	std::vector<Segment> m_Segments;
+
+	bool Contains(const CGitHash& hash) const
+	{
+		DWORD id;
+		return std::any_of(m_Segments.cbegin(), m_Segments.cend(), [&hash, &id](const Segment& segment) { return segment.Find(hash, id); });
+	}
+
+	/// opens and maps a file for reading, returns nullptr if it does not exist or is broken
+	template <typename MappedFile>
+	static std::shared_ptr<const MappedFile> Load(const CString& fileName)
+	{
+		auto file = std::make_shared<MappedFile>();
+		file->m_File = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (!file->m_File || !file->Map(file->m_File))
+			return nullptr;
+		return file;
+	}
+
+protected:
+	/// parseSegment(data, length, offset, segment) parses the segment at offset and advances offset behind it
+	template <typename ParseSegment>
+	bool MapSegments(HANDLE file, DWORD magic, DWORD version, ParseSegment parseSegment)
+	{
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SSegmentedFileHeader)) || static_cast<ULONGLONG>(fileSize.QuadPart) >= SIZE_T_MAX)
+			return false;
+
+		m_Mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_Mapping)
+			return false;
+		m_View = MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_View)
+			return false;
+
+		auto data = static_cast<const BYTE*>(static_cast<PVOID>(m_View));
+		m_Header = *reinterpret_cast<const SSegmentedFileHeader*>(data);
+		if (m_Header.m_Magic != magic || m_Header.m_Version != version || m_Header.m_Length < sizeof(SSegmentedFileHeader) || m_Header.m_Length > static_cast<ULONGLONG>(fileSize.QuadPart))
+			return false;
+
+		const auto length = static_cast<size_t>(m_Header.m_Length);
+		size_t offset = sizeof(SSegmentedFileHeader);
+		for (DWORD i = 0; i < m_Header.m_SegmentCount; ++i)
+		{
+			Segment segment;
+			if (!parseSegment(data, length, offset, segment))
+				return false;
+			m_Segments.push_back(segment);
+		}
+		return offset == length;
+	}
+};
+
+/**
+ * \ingroup TortoiseProc
+ * Appends segments to a segmented file (cf. SSegmentedMappedFile) and merges all of them into a single one
+ * as soon as there are too many. The file must not be mapped by anyone else meanwhile.
+ * Data beyond the length stored in the header is not referenced, so an interrupted update does not harm.
+ */
+class CSegmentedFileUpdater
+{
+public:
+	CSegmentedFileUpdater(const CString& fileName, DWORD magic, DWORD version)
+		: m_FileName(fileName)
+		, m_Header{ magic, version, 0, 0, sizeof(SSegmentedFileHeader) }
+	{
+	}
+
+	/// opens or creates the file, existing(mappedFile) gets the current content or nullptr;
+	/// a broken or outdated file is just started over
+	template <typename MappedFile, typename Existing>
+	bool Open(Existing existing)
+	{
+		m_File = CreateFile(m_FileName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (!m_File)
+			return false;
+
+		MappedFile mappedFile;
+		const bool valid = mappedFile.Map(m_File);
+		if (valid)
+			m_Header = mappedFile.m_Header;
+		existing(valid ? &mappedFile : nullptr);
+		return true;
+	}
+
+	/// writeSegment(file, length) writes a segment at the current file position and sets its length
+	template <typename WriteSegment>
+	bool Append(WriteSegment writeSegment)
+	{
+		LARGE_INTEGER offset;
+		offset.QuadPart = m_Header.m_Length;
+		if (!SetFilePointerEx(m_File, offset, nullptr, FILE_BEGIN))
+			return false;
+		ULONGLONG length = 0;
+		if (!writeSegment(static_cast<HANDLE>(m_File), length))
+			return false;
+		m_Header.m_Length += length;
+		++m_Header.m_SegmentCount;
+		return true;
+	}
+
+	/// makes the appended segments visible, then merges the file if it has more than maxSegments segments;
+	/// writeMerged(mappedFile, target, length) writes the single merged segment at the current position of target
+	template <typename MappedFile, typename WriteMerged>
+	bool Commit(DWORD maxSegments, WriteMerged writeMerged)
+	{
+		if (!SetEndOfFile(m_File) || !FlushFileBuffers(m_File) || !WriteHeader(m_File, m_Header))
+			return false;
+		FlushFileBuffers(m_File);
+
+		if (m_Header.m_SegmentCount <= maxSegments)
+			return true;
+
+		const CString tempFile = m_FileName + L".tmp";
+		bool merged = false;
+		{
+			MappedFile source;
+			CAutoFile target = CreateFile(tempFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			merged = source.Map(m_File) && target && WriteMergedFile(source, target, writeMerged);
+		}
+		m_File.CloseHandle();
+		if (merged && MoveFileEx(tempFile, m_FileName, MOVEFILE_REPLACE_EXISTING))
+			return true;
+
+		::DeleteFile(tempFile);
+		return false;
+	}
+
+private:
+	static bool WriteHeader(HANDLE file, const SSegmentedFileHeader& header)
+	{
+		if (!SetFilePointerEx(file, LARGE_INTEGER{}, nullptr, FILE_BEGIN))
+			return false;
+		DWORD written = 0;
+		return WriteFile(file, &header, sizeof(header), &written, nullptr) && written == sizeof(header);
+	}
+
+	template <typename MappedFile, typename WriteMerged>
+	bool WriteMergedFile(const MappedFile& source, HANDLE target, WriteMerged writeMerged) const
+	{
+		SSegmentedFileHeader header{ m_Header.m_Magic, m_Header.m_Version, 1, 0, sizeof(SSegmentedFileHeader) };
+		if (!WriteHeader(target, header))
+			return false;
+		ULONGLONG length = 0;
+		if (!writeMerged(source, target, length))
+			return false;
+		header.m_Length += length;
+		return SetEndOfFile(target) && WriteHeader(target, header) && FlushFileBuffers(target);
+	}
+
+	CString m_FileName;
+	CAutoFile m_File;
+	SSegmentedFileHeader m_Header;
+};
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2012-2024 - TortoiseGit
+// Copyright (C) 2012-2024, 2026 - TortoiseGit
 // Copyright (C) 2009-2011, 2013 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -47,6 +47,9 @@ CSettingsAdvanced::CSettingsAdvanced()
 	AddSetting<BooleanSetting>(L"FullRowSelect", true);
 	AddSetting<DWORDSetting>  (L"GroupTaskbarIconsPerRepo", 3);
 	AddSetting<BooleanSetting>(L"GroupTaskbarIconsPerRepoOverlay", true);
+	AddSetting<BooleanSetting>(L"LogCachePrefetchPaths", true);
+	AddSetting<BooleanSetting>(L"LogCacheSearchIndex", true);
+	AddSetting<DWORDSetting>  (L"LogFileListPrefetchRows", 50);
 	AddSetting<BooleanSetting>(L"LogFontForFileListCtrl", false);
 	AddSetting<BooleanSetting>(L"LogFontForLogCtrl", false);
 	AddSetting<DWORDSetting>  (L"LogTooManyItemsThreshold", 1000);
@@ -76,6 +79,8 @@ CSettingsAdvanced::CSettingsAdvanced()
 	AddSetting<BooleanSetting>(L"StyleCommitMessages", true);
 	AddSetting<BooleanSetting>(L"StyleGitOutput", true);
 	AddSetting<DWORDSetting>  (L"TGitCacheCheckContentMaxSize", 10 * 1024);
+	AddSetting<DWORDSetting>  (L"TGitCacheCrawlerThreads", 0);
+	AddSetting<BooleanSetting>(L"TGitCacheIndexSnapshot", false);
 	AddSetting<DWORDSetting>  (L"UseCustomWordBreak", 2);
 	AddSetting<BooleanSetting>(L"UseLibgit2", true);
 	AddSetting<BooleanSetting>(L"VersionCheck", true);
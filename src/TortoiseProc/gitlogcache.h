@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2008-2013, 2015-2017, 2023 - TortoiseGit
+// Copyright (C) 2008-2013, 2015-2017, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -20,12 +20,19 @@
 
 #include "GitRevLoglist.h"
 #include "GitHash.h"
+#include "LogSearchIndex.h"
+#include "LogPathLists.h"
 
 #define LOG_INDEX_MAGIC		0x88AA5566
 #define LOG_DATA_MAGIC		0x99BB0FFF
 #define LOG_DATA_ITEM_MAGIC 0x0FCC9ACC
 #define LOG_DATA_FILE_MAGIC 0x19EE9DFF
-#define LOG_INDEX_VERSION	0x11
+#define LOG_INDEX_VERSION	0x12
+
+// items appended to the index are merged into its sorted part as soon as there are more
+// than max(LOG_INDEX_TAIL_MIN, sorted items / LOG_INDEX_TAIL_RATIO) of them
+#define LOG_INDEX_TAIL_MIN		4096
+#define LOG_INDEX_TAIL_RATIO	16
 
 #pragma pack (1)
 struct SLogCacheIndexHeader
@@ -33,6 +40,8 @@ struct SLogCacheIndexHeader
 	DWORD m_Magic;
 	DWORD m_Version;
 	DWORD m_ItemCount;
+	DWORD m_SortedCount; // the first m_SortedCount items are sorted, the remaining ones are appended in arbitrary order
+	DWORD m_FanOut[256]; // number of sorted items whose hash starts with a byte <= index (like in git pack .idx files)
 };
 
 struct SLogCacheIndexItem
@@ -103,10 +112,15 @@ public:
 
 protected:
 	BOOL m_bEnabled = TRUE;
+	BOOL m_bSearchIndex = TRUE;
+
+	CLogSearchIndex m_SearchIndex;
+	CLogPathLists m_PathLists;
 
 	HANDLE m_IndexFile = INVALID_HANDLE_VALUE;
 	HANDLE m_IndexFileMap = nullptr;
 	SLogCacheIndexFile* m_pCacheIndex = nullptr;
+	std::unordered_map<CGitHash, ULONGLONG> m_IndexTail; // unsorted part of the index
 
 	std::set<CGitHash> m_shallowAnchors;
 
@@ -126,6 +140,15 @@ protected:
 		if (header->m_Version != LOG_INDEX_VERSION)
 			return FALSE;
 
+		if (header->m_SortedCount > header->m_ItemCount || header->m_FanOut[255] != header->m_SortedCount)
+			return FALSE;
+
+		for (int i = 1; i < 256; ++i)
+		{
+			if (header->m_FanOut[i - 1] > header->m_FanOut[i])
+				return FALSE;
+		}
+
 		return TRUE;
 	}
 
@@ -160,19 +183,30 @@ protected:
 
 	CString m_GitDir;
 	int RebuildCacheFile();
+	int CompactIndexFile(SLogCacheIndexHeader& header);
+	static bool NeedsCompaction(const SLogCacheIndexHeader& header)
+	{
+		return header.m_ItemCount - header.m_SortedCount > max(static_cast<DWORD>(LOG_INDEX_TAIL_MIN), header.m_SortedCount / LOG_INDEX_TAIL_RATIO);
+	}
 
 public:
 	CLogCache();
 	~CLogCache();
 	int FetchCacheIndex(CString GitDir);
 	int LoadOneItem(GitRevLoglist& Rev, ULONGLONG offset);
-	ULONGLONG GetOffset(const CGitHash& hash, SLogCacheIndexFile* pData = nullptr);
+	ULONGLONG GetOffset(const CGitHash& hash) const;
 
 	CGitHashMap m_HashMap;
 
 	GitRevLoglist* GetCacheData(const CGitHash& hash);
 	int SaveCache();
 
+	const CLogSearchIndex& GetSearchIndex() const { return m_SearchIndex; }
+
+	bool HasSimpleList(const CGitHash& hash) const { return m_PathLists.Contains(hash); }
+	/// fills rev.m_SimpleFileList if the changed paths of the commit are cached
+	bool LoadSimpleList(GitRevLoglist& rev) const { return m_PathLists.GetList(rev.m_CommitHash, rev.m_SimpleFileList); }
+
 	int ClearAllParent();
 	void ClearAllLanes();
 };
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2009-2013, 2015-2020 - TortoiseGit
+// Copyright (C) 2009-2013, 2015-2020, 2026 - TortoiseGit
 // Copyright (C) 2003-2008, 2017 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -172,7 +172,7 @@ STDMETHODIMP CShellExt::IsMemberOf(LPCWSTR pwszPath, DWORD /*dwAttrib*/)
 					break;
 				}
 				TGITCacheResponse itemStatus = { 0 };
-				if (m_remoteCacheLink.GetStatusFromRemoteCache(tpath, &itemStatus, true))
+				if (m_remoteCacheLink.GetStatusFromRemoteCache(tpath, &itemStatus, true, true))
 				{
 					if (itemStatus.m_bAssumeValid)
 						readonlyoverlay = true;
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2009-2017, 2019, 2023 - TortoiseGit
+// Copyright (C) 2009-2017, 2019, 2023, 2026 - TortoiseGit
 // Copyright (C) 2003-2014, 2017 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -25,6 +25,13 @@
 #include "PathUtils.h"
 #include "CreateProcessHelper.h"
 
+// how long prefetched states are used, the explorer asks for all items of a folder in a short time
+#define TGITCACHE_PREFETCH_VALIDITY		2000
+// upper limit of items fetched for one folder
+#define TGITCACHE_PREFETCH_MAX_ITEMS	20000
+// number of folders whose prefetched states are kept
+#define TGITCACHE_PREFETCH_DIRECTORIES	4
+
 CRemoteCacheLink::CRemoteCacheLink()
 {
 }
@@ -138,48 +145,44 @@ void CRemoteCacheLink::CloseCommandPipe()
 	}
 }
 
-bool CRemoteCacheLink::GetStatusFromRemoteCache(const CTGitPath& Path, TGITCacheResponse* pReturnedStatus, bool bRecursive)
+bool CRemoteCacheLink::EnsureCacheRunning()
 {
-	if(!EnsurePipeOpen())
-	{
-		// We've failed to open the pipe - try and start the cache
-		// but only if the last try to start the cache was a certain time
-		// ago. If we just try over and over again without a small pause
-		// in between, the explorer is rendered unusable!
-		// Failing to start the cache can have different reasons: missing exe,
-		// missing registry key, corrupt exe, ...
-		if ((static_cast<LONGLONG>(GetTickCount64()) - m_lastTimeout) < 0)
-			return false;
-		// if we're in protected mode, don't try to start the cache: since we're
-		// here, we know we can't access it anyway and starting a new process will
-		// trigger a warning dialog in IE7+ on Vista - we don't want that.
-		if (GetProcessIntegrityLevel() < SECURITY_MANDATORY_MEDIUM_RID)
-			return false;
+	if (EnsurePipeOpen())
+		return true;
 
-		if (!RunTGitCacheProcess())
-			return false;
+	// We've failed to open the pipe - try and start the cache
+	// but only if the last try to start the cache was a certain time
+	// ago. If we just try over and over again without a small pause
+	// in between, the explorer is rendered unusable!
+	// Failing to start the cache can have different reasons: missing exe,
+	// missing registry key, corrupt exe, ...
+	if ((static_cast<LONGLONG>(GetTickCount64()) - m_lastTimeout) < 0)
+		return false;
+	// if we're in protected mode, don't try to start the cache: since we're
+	// here, we know we can't access it anyway and starting a new process will
+	// trigger a warning dialog in IE7+ on Vista - we don't want that.
+	if (GetProcessIntegrityLevel() < SECURITY_MANDATORY_MEDIUM_RID)
+		return false;
 
-		// Wait for the cache to open
-		LONGLONG endTime = static_cast<LONGLONG>(GetTickCount64()) + 1000;
-		while(!EnsurePipeOpen())
+	if (!RunTGitCacheProcess())
+		return false;
+
+	// Wait for the cache to open
+	LONGLONG endTime = static_cast<LONGLONG>(GetTickCount64()) + 1000;
+	while(!EnsurePipeOpen())
+	{
+		if ((static_cast<LONGLONG>(GetTickCount64()) - endTime) > 0)
 		{
-			if ((static_cast<LONGLONG>(GetTickCount64()) - endTime) > 0)
-			{
-				m_lastTimeout = static_cast<LONGLONG>(GetTickCount64()) + 10000;
-				return false;
-			}
+			m_lastTimeout = static_cast<LONGLONG>(GetTickCount64()) + 10000;
+			return false;
 		}
-		m_lastTimeout = static_cast<LONGLONG>(GetTickCount64()) + 10000;
 	}
+	m_lastTimeout = static_cast<LONGLONG>(GetTickCount64()) + 10000;
+	return true;
+}
 
-	AutoLocker lock(m_critSec);
-
-	DWORD nBytesRead;
-	TGITCacheRequest request;
-	request.flags = TGITCACHE_FLAGS_NONOTIFICATIONS;
-	if(bRecursive)
-		request.flags |= TGITCACHE_FLAGS_RECUSIVE_STATUS;
-	wcsncpy_s(request.path, Path.GetWinPath(), _countof(request.path) - 1);
+bool CRemoteCacheLink::TransactRequest(const void* pRequest, DWORD requestSize, void* pReply, DWORD replySize, DWORD& bytesRead)
+{
 	SecureZeroMemory(&m_Overlapped, sizeof(OVERLAPPED));
 	m_Overlapped.hEvent = m_hEvent;
 	// Do the transaction in overlapped mode.
@@ -197,9 +200,9 @@ bool CRemoteCacheLink::GetStatusFromRemoteCache(const CTGitPath& Path, TGITCache
 	// report back to us so we can investigate further.
 
 	BOOL fSuccess = TransactNamedPipe(m_hPipe,
-		&request, sizeof(request),
-		pReturnedStatus, sizeof(*pReturnedStatus),
-		&nBytesRead, &m_Overlapped);
+		const_cast<void*>(pRequest), requestSize,
+		pReply, replySize,
+		&bytesRead, &m_Overlapped);
 
 	if (!fSuccess)
 	{
@@ -214,7 +217,7 @@ bool CRemoteCacheLink::GetStatusFromRemoteCache(const CTGitPath& Path, TGITCache
 		// Wait for it to finish
 		DWORD dwWait = WaitForSingleObject(m_hEvent, 10000);
 		if (dwWait == WAIT_OBJECT_0)
-			fSuccess = GetOverlappedResult(m_hPipe, &m_Overlapped, &nBytesRead, FALSE);
+			fSuccess = GetOverlappedResult(m_hPipe, &m_Overlapped, &bytesRead, FALSE);
 		else
 		{
 			// the cache didn't respond!
@@ -228,6 +231,153 @@ bool CRemoteCacheLink::GetStatusFromRemoteCache(const CTGitPath& Path, TGITCache
 	return false;
 }
 
+bool CRemoteCacheLink::GetPrefetchedStatus(const CTGitPath& path, bool bRecursive, TGITCacheResponse* pReturnedStatus)
+{
+	const CString& winPath = path.GetWinPathString();
+	const int nameStart = winPath.ReverseFind(L'\\') + 1;
+	if (nameStart <= 0 || nameStart >= winPath.GetLength())
+		return false;
+	CString directory = winPath.Left(nameStart - 1);
+	directory.MakeLower();
+
+	const ULONGLONG now = GetTickCount64();
+	for (auto& prefetched : m_prefetched)
+	{
+		if (prefetched.bRecursive != bRecursive || now > prefetched.validUntil || prefetched.directory != directory)
+			continue;
+		auto it = prefetched.status.find(winPath.Mid(nameStart).MakeLower());
+		if (it == prefetched.status.end())
+			return false;
+		*pReturnedStatus = it->second;
+		prefetched.status.erase(it);
+		return true;
+	}
+	return false;
+}
+
+void CRemoteCacheLink::PrefetchDirectory(const CTGitPath& path, bool bRecursive)
+{
+	const CString& winPath = path.GetWinPathString();
+	const int nameStart = winPath.ReverseFind(L'\\') + 1;
+	if (nameStart <= 0 || nameStart >= winPath.GetLength())
+		return;
+	const CString directory = winPath.Left(nameStart - 1);
+	CString lowerDirectory = directory;
+	lowerDirectory.MakeLower();
+
+	// the explorer asks for all items of a folder at once, only fetch a folder again after the prefetched states expired
+	const ULONGLONG now = GetTickCount64();
+	auto it = std::find_if(m_prefetched.begin(), m_prefetched.end(), [&lowerDirectory, bRecursive](const auto& prefetched) { return prefetched.bRecursive == bRecursive && prefetched.directory == lowerDirectory; });
+	if (it != m_prefetched.end())
+	{
+		std::rotate(m_prefetched.begin(), it, it + 1);
+		if (now <= m_prefetched.front().validUntil)
+			return;
+	}
+	else
+	{
+		if (m_prefetched.size() >= TGITCACHE_PREFETCH_DIRECTORIES)
+			m_prefetched.pop_back();
+		m_prefetched.insert(m_prefetched.begin(), SPrefetchedDirectory());
+	}
+
+	auto& prefetched = m_prefetched.front();
+	prefetched.directory = lowerDirectory;
+	prefetched.bRecursive = bRecursive;
+	prefetched.validUntil = now + TGITCACHE_PREFETCH_VALIDITY;
+	prefetched.status.clear();
+	if (directory.GetLength() >= MAX_PATH - 1)
+		return;
+
+	std::vector<BYTE> request;
+	std::vector<CString> names;
+	std::vector<TGITCacheResponse> replies;
+	auto sendBatch = [&]() {
+		if (names.empty())
+			return true;
+		auto header = reinterpret_cast<TGITCacheBatchRequest*>(request.data());
+		header->count = static_cast<DWORD>(names.size());
+		replies.resize(names.size());
+		DWORD nBytesRead = 0;
+		const DWORD replySize = static_cast<DWORD>(replies.size() * sizeof(TGITCacheResponse));
+		if (!TransactRequest(request.data(), static_cast<DWORD>(request.size()), replies.data(), replySize, nBytesRead) || nBytesRead != replySize)
+			return false;
+		for (size_t i = 0; i < names.size(); ++i)
+			prefetched.status.emplace(names[i].MakeLower(), replies[i]);
+		names.clear();
+		return true;
+	};
+	auto startBatch = [&]() {
+		request.assign(sizeof(TGITCacheBatchRequest), 0);
+		auto header = reinterpret_cast<TGITCacheBatchRequest*>(request.data());
+		header->flags = TGITCACHE_FLAGS_BATCH | TGITCACHE_FLAGS_NONOTIFICATIONS;
+		if (bRecursive)
+			header->flags |= TGITCACHE_FLAGS_RECUSIVE_STATUS;
+		wcsncpy_s(header->directory, directory, _countof(header->directory) - 1);
+	};
+
+	WIN32_FIND_DATA findData;
+	CAutoFindFile hFind = ::FindFirstFileEx(directory + L"\\*", FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+	if (!hFind)
+		return;
+
+	startBatch();
+	size_t total = 0;
+	do
+	{
+		const size_t nameLength = wcslen(findData.cFileName);
+		if ((nameLength == 1 && findData.cFileName[0] == L'.') || (nameLength == 2 && wcscmp(findData.cFileName, L"..") == 0))
+			continue;
+		if (directory.GetLength() + 1 + nameLength >= MAX_PATH)
+			continue;
+
+		const size_t itemSize = 2 * sizeof(WORD) + nameLength * sizeof(wchar_t);
+		if (names.size() >= TGITCACHE_BATCH_MAX_ITEMS || request.size() + itemSize > TGITCACHE_BATCH_MAX_REQUEST_SIZE)
+		{
+			if (!sendBatch())
+				return;
+			startBatch();
+		}
+
+		WORD itemHeader[2] = { TGITCACHE_FLAGS_FOLDERISKNOWN, static_cast<WORD>(nameLength) };
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			itemHeader[0] |= TGITCACHE_FLAGS_ISFOLDER;
+		auto itemBytes = reinterpret_cast<const BYTE*>(itemHeader);
+		request.insert(request.end(), itemBytes, itemBytes + sizeof(itemHeader));
+		auto nameBytes = reinterpret_cast<const BYTE*>(findData.cFileName);
+		request.insert(request.end(), nameBytes, nameBytes + nameLength * sizeof(wchar_t));
+		names.emplace_back(findData.cFileName, static_cast<int>(nameLength));
+	} while (++total < TGITCACHE_PREFETCH_MAX_ITEMS && ::FindNextFile(hFind, &findData));
+
+	sendBatch();
+}
+
+bool CRemoteCacheLink::GetStatusFromRemoteCache(const CTGitPath& Path, TGITCacheResponse* pReturnedStatus, bool bRecursive, bool bPrefetch)
+{
+	if (!EnsureCacheRunning())
+		return false;
+
+	AutoLocker lock(m_critSec);
+
+	// ask for all items of the folder with a few batch requests instead of one request per item
+	if (bPrefetch)
+		PrefetchDirectory(Path, bRecursive);
+	if (GetPrefetchedStatus(Path, bRecursive, pReturnedStatus))
+		return true;
+
+	// a failed batch request closes the pipe
+	if (!EnsurePipeOpen())
+		return false;
+
+	DWORD nBytesRead;
+	TGITCacheRequest request;
+	request.flags = TGITCACHE_FLAGS_NONOTIFICATIONS;
+	if(bRecursive)
+		request.flags |= TGITCACHE_FLAGS_RECUSIVE_STATUS;
+	wcsncpy_s(request.path, Path.GetWinPath(), _countof(request.path) - 1);
+	return TransactRequest(&request, sizeof(request), pReturnedStatus, sizeof(*pReturnedStatus), nBytesRead);
+}
+
 bool CRemoteCacheLink::ReleaseLockForPath(const CTGitPath& path)
 {
 	AutoLocker lock(m_critSec);
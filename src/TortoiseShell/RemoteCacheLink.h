@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2009, 2011, 2014, 2017, 2019, 2023 - TortoiseGit
+// Copyright (C) 2009, 2011, 2014, 2017, 2019, 2023, 2026 - TortoiseGit
 // Copyright (C) 2003-2011, 2014, 2017 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -36,12 +36,22 @@ public:
 	~CRemoteCacheLink();
 
 public:
-	bool GetStatusFromRemoteCache(const CTGitPath& Path, TGITCacheResponse* pReturnedStatus, bool bRecursive);
+	/**
+	 * Asks TGitCache for the status of Path.
+	 * \param bPrefetch fetch the status of all items of the folder of Path with a few batch requests, for the
+	 *                  overlays, where the explorer asks for all items of a folder at once
+	 */
+	bool GetStatusFromRemoteCache(const CTGitPath& Path, TGITCacheResponse* pReturnedStatus, bool bRecursive, bool bPrefetch = false);
 	bool ReleaseLockForPath(const CTGitPath& path);
 
 private:
 	bool InternalEnsurePipeOpen(CAutoFile& hPipe, const CString& pipeName, bool overlapped) const;
 
+	bool EnsureCacheRunning();
+	bool TransactRequest(const void* pRequest, DWORD requestSize, void* pReply, DWORD replySize, DWORD& bytesRead);
+	bool GetPrefetchedStatus(const CTGitPath& path, bool bRecursive, TGITCacheResponse* pReturnedStatus);
+	void PrefetchDirectory(const CTGitPath& path, bool bRecursive);
+
 	bool EnsurePipeOpen();
 	void ClosePipe();
 
@@ -62,4 +72,16 @@ private:
 
 	CComAutoCriticalSection m_critSec;
 	LONGLONG m_lastTimeout = 0;
+
+	// the status of the items of a directory, fetched with batch requests
+	// each status is only used once, so that a repeated request goes to the cache again
+	struct SPrefetchedDirectory
+	{
+		CString directory; // lower case
+		bool bRecursive = false;
+		ULONGLONG validUntil = 0;
+		std::map<CString, TGITCacheResponse> status; // lower case name => status
+	};
+	// the directories asked for last, most recently used first; e.g. the navigation pane and the main view ask for different folders in turn
+	std::vector<SPrefetchedDirectory> m_prefetched;
 };
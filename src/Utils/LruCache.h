@@ -1,5 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
+// Copyright (C) 2026 - TortoiseGit
 // Copyright (C) 2016 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -19,87 +20,284 @@
 
 #pragma once
 
-#include <unordered_map>
-#include <list>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <string_view>
 
-template<typename key_t, typename value_t>
+/**
+ * Hash used by LruCache, defaults to std::hash.
+ * The specializations for strings are transparent, so that string views can be
+ * looked up without building a key first.
+ */
+template<typename key_t>
+struct LruCacheHash : std::hash<key_t>
+{
+};
+
+template<typename char_t>
+struct LruCacheHash<std::basic_string<char_t>>
+{
+	using is_transparent = void;
+
+	size_t operator()(std::basic_string_view<char_t> key) const noexcept
+	{
+		return std::hash<std::basic_string_view<char_t>>{}(key);
+	}
+};
+
+/**
+ * Least recently used cache with a fixed number of entries.
+ * The entries are kept in one array and linked by index, lookups use an open addressing
+ * hash table of entry indexes. Once all maxSize entries are used, inserting reuses the least
+ * recently used entry, so no memory is allocated for the cache itself anymore.
+ * try_get() accepts every type hash_t and equal_t accept, e.g. std::wstring_view for std::wstring keys.
+ */
+template<typename key_t, typename value_t, typename hash_t = LruCacheHash<key_t>, typename equal_t = std::equal_to<>>
 class LruCache
 {
 public:
 	LruCache(size_t maxSize)
-		: maxSize(maxSize)
+		: maxSize(std::clamp(maxSize, static_cast<size_t>(1), static_cast<size_t>(NO_ITEM - 1)))
 	{
 	}
 
 	void insert_or_assign(const key_t & key, const value_t & val)
 	{
-		auto mapIt = itemsMap.find(key);
-		if (mapIt == itemsMap.end())
+		const size_t hash = hasher(key);
+		size_t slot = find_slot(key, hash);
+		if (slot != NO_SLOT)
 		{
-			evict(maxSize - 1);
+			items[slots[slot]].val = val;
+			return;
+		}
 
-			auto listIt = itemsList.insert(itemsList.cend(), ListItem(key, val));
-			itemsMap.insert(std::make_pair(key, listIt));
+		reserve(maxSize);
+		uint32_t index;
+		if (items.size() < maxSize)
+		{
+			index = static_cast<uint32_t>(items.size());
+			items.emplace_back(key, val, hash);
 		}
 		else
 		{
-			mapIt->second->val = val;
+			// reuse the least recently used item
+			index = head;
+			erase_slot(find_slot(items[index].key, items[index].hash));
+			unlink(index);
+			items[index].key = key;
+			items[index].val = val;
+			items[index].hash = hash;
 		}
+		link_back(index);
+
+		for (slot = hash & slotMask; slots[slot] != NO_ITEM; slot = (slot + 1) & slotMask)
+			;
+		slots[slot] = index;
 	}
 
-	const value_t * try_get(const key_t & key)
+	template<typename lookup_t>
+	const value_t * try_get(const lookup_t & key)
 	{
-		auto it = itemsMap.find(key);
-		if (it == itemsMap.end())
+		if (items.empty())
+			return nullptr;
+
+		const size_t slot = find_slot(key, hasher(key));
+		if (slot == NO_SLOT)
 			return nullptr;
 
 		// Move last recently accessed item to the end.
-		if (it->second != itemsList.end())
+		const uint32_t index = slots[slot];
+		if (index != tail)
 		{
-			itemsList.splice(itemsList.end(), itemsList, it->second);
+			unlink(index);
+			link_back(index);
 		}
 
-		return &it->second->val;
+		return &items[index].val;
 	}
 
 	void reserve(size_t size)
 	{
-		itemsMap.reserve(min(maxSize, size));
+		size = std::min(maxSize, size);
+		if (items.capacity() < size)
+			items.reserve(size);
+		if (slots.empty())
+		{
+			// keep the load factor at or below one half, so that probe sequences stay short
+			size_t slotCount = 2;
+			while (slotCount < 2 * maxSize)
+				slotCount *= 2;
+			slots.assign(slotCount, NO_ITEM);
+			slotMask = slotCount - 1;
+		}
 	}
 
 	void clear()
 	{
-		itemsMap.clear();
-		itemsList.clear();
+		items.clear();
+		std::fill(slots.begin(), slots.end(), NO_ITEM);
+		head = NO_ITEM;
+		tail = NO_ITEM;
 	}
 
-protected:
-	void evict(size_t itemsToKeep)
+	size_t size() const
 	{
-		for (auto it = itemsList.begin();
-			itemsList.size() > itemsToKeep && it != itemsList.end();)
-		{
-			itemsMap.erase(it->key);
-			it = itemsList.erase(it);
-		}
+		return items.size();
 	}
 
 private:
-	struct ListItem
+	static constexpr uint32_t NO_ITEM = UINT32_MAX;
+	static constexpr size_t NO_SLOT = SIZE_MAX;
+
+	struct Item
 	{
-		ListItem(const key_t & key, const value_t & val)
-			: key(key), val(val)
+		Item(const key_t & key, const value_t & val, size_t hash)
+			: key(key), val(val), hash(hash)
 		{
 		}
 
 		key_t key;
 		value_t val;
+		size_t hash;
+		uint32_t prev = NO_ITEM;
+		uint32_t next = NO_ITEM;
 	};
 
-	using ItemsList = std::list<ListItem>;
-	using ItemsMap = std::unordered_map<key_t, typename ItemsList::iterator> ;
+	template<typename lookup_t>
+	size_t find_slot(const lookup_t & key, size_t hash) const
+	{
+		if (slots.empty())
+			return NO_SLOT;
+
+		for (size_t slot = hash & slotMask; slots[slot] != NO_ITEM; slot = (slot + 1) & slotMask)
+		{
+			const Item& item = items[slots[slot]];
+			if (item.hash == hash && equal(item.key, key))
+				return slot;
+		}
+		return NO_SLOT;
+	}
+
+	// removes a slot and moves following entries of the probe sequence back, so that no tombstones are needed
+	void erase_slot(size_t slot)
+	{
+		for (size_t next = (slot + 1) & slotMask; slots[next] != NO_ITEM; next = (next + 1) & slotMask)
+		{
+			const size_t home = items[slots[next]].hash & slotMask;
+			// can the entry in next be moved to slot without leaving its probe sequence?
+			if (((next - home) & slotMask) >= ((next - slot) & slotMask))
+			{
+				slots[slot] = slots[next];
+				slot = next;
+			}
+		}
+		slots[slot] = NO_ITEM;
+	}
+
+	void unlink(uint32_t index)
+	{
+		Item& item = items[index];
+		if (item.prev != NO_ITEM)
+			items[item.prev].next = item.next;
+		else
+			head = item.next;
+		if (item.next != NO_ITEM)
+			items[item.next].prev = item.prev;
+		else
+			tail = item.prev;
+		item.prev = NO_ITEM;
+		item.next = NO_ITEM;
+	}
+
+	void link_back(uint32_t index)
+	{
+		Item& item = items[index];
+		item.prev = tail;
+		item.next = NO_ITEM;
+		if (tail != NO_ITEM)
+			items[tail].next = index;
+		else
+			head = index;
+		tail = index;
+	}
 
 	size_t maxSize;
-	ItemsMap itemsMap;
-	ItemsList itemsList;
+	std::vector<Item> items;
+	std::vector<uint32_t> slots;
+	size_t slotMask = 0;
+	uint32_t head = NO_ITEM;
+	uint32_t tail = NO_ITEM;
+	hash_t hasher;
+	equal_t equal;
+};
+
+/**
+ * Thread-safe variant of LruCache. The entries are distributed over several independently
+ * locked LruCaches by their hash, so that concurrent users rarely wait for each other.
+ * Values are returned as copies, because an entry can be evicted by another thread at any time.
+ */
+template<typename key_t, typename value_t, size_t shardCount = 16, typename hash_t = LruCacheHash<key_t>, typename equal_t = std::equal_to<>>
+class ShardedLruCache
+{
+public:
+	ShardedLruCache(size_t maxSize)
+	{
+		for (auto& shard : shards)
+			shard = std::make_unique<Shard>((maxSize + shardCount - 1) / shardCount);
+	}
+
+	void insert_or_assign(const key_t & key, const value_t & val)
+	{
+		auto& shard = get_shard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.cache.insert_or_assign(key, val);
+	}
+
+	template<typename lookup_t>
+	bool try_get(const lookup_t & key, value_t & val)
+	{
+		auto& shard = get_shard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		const value_t* cached = shard.cache.try_get(key);
+		if (!cached)
+			return false;
+		val = *cached;
+		return true;
+	}
+
+	void clear()
+	{
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			shard->cache.clear();
+		}
+	}
+
+private:
+	struct Shard
+	{
+		Shard(size_t maxSize)
+			: cache(maxSize)
+		{
+		}
+
+		std::mutex mutex;
+		LruCache<key_t, value_t, hash_t, equal_t> cache;
+	};
+
+	template<typename lookup_t>
+	Shard& get_shard(const lookup_t & key)
+	{
+		// the low bits select the slot inside of the shard, so use (mixed) high bits here
+		const size_t hash = hash_t{}(key) * static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+		return *shards[(hash >> (std::numeric_limits<size_t>::digits - 16)) % shardCount];
+	}
+
+	std::unique_ptr<Shard> shards[shardCount];
 };
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2009-2024 - TortoiseGit
+// Copyright (C) 2009-2024, 2026 - TortoiseGit
 // Copyright (C) 2003-2008, 2012-2020 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -615,7 +615,7 @@ BOOL CSciEdit::IsMisspelled(const CString& sWord)
 		return FALSE;
 
 	// Check spell checking cache first.
-	const BOOL *cacheResult = m_SpellingCache.try_get(std::wstring(sWord, sWord.GetLength()));
+	const BOOL *cacheResult = m_SpellingCache.try_get(std::wstring_view(sWord, sWord.GetLength()));
 	if (cacheResult)
 		return *cacheResult;
 
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2014-2023, 2025 - TortoiseGit
+// Copyright (C) 2014-2023, 2025-2026 - TortoiseGit
 // based on SmartHandle of TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -138,6 +138,8 @@ using CAutoNote					= CSmartLibgit2Ref<git_note,				git_note_free>;
 using CAutoSignature			= CSmartLibgit2Ref<git_signature,			git_signature_free>;
 using CAutoMailmap				= CSmartLibgit2Ref<git_mailmap,				git_mailmap_free>;
 using CAutoWorktree				= CSmartLibgit2Ref<git_worktree,			git_worktree_free>;
+using CAutoPathspec				= CSmartLibgit2Ref<git_pathspec,			git_pathspec_free>;
+using CAutoIndexConflictIterator	= CSmartLibgit2Ref<git_index_conflict_iterator,	git_index_conflict_iterator_free>;
 
 class CAutoRepository : protected CSmartLibgit2Ref<git_repository, git_repository_free>
 {
@@ -0,0 +1,128 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#pragma once
+#include <functional>
+#include <atomic>
+
+/**
+ * \ingroup Utils
+ * Calls a function for every index in [0, count) on the Windows thread pool.
+ * Start() returns immediately, Wait() blocks until all indexes have been processed.
+ * At most maxWorkers callbacks (default: number of logical processors) run
+ * concurrently, each of them picks the next unprocessed index until none is left.
+ *
+ * \code
+ * CThreadPoolWork work;
+ * work.Start(items.size(), [&items](size_t i) { Process(items[i]); });
+ * // do something else on this thread
+ * work.Wait();
+ * \endcode
+ */
+class CThreadPoolWork
+{
+public:
+	CThreadPoolWork() = default;
+	~CThreadPoolWork()
+	{
+		Wait();
+		if (m_work)
+			CloseThreadpoolWork(m_work);
+	}
+
+	CThreadPoolWork(const CThreadPoolWork&) = delete;
+	CThreadPoolWork& operator=(const CThreadPoolWork&) = delete;
+
+	void Start(size_t count, std::function<void(size_t)> func, size_t maxWorkers = 0)
+	{
+		Wait();
+
+		m_func = std::move(func);
+		m_count = count;
+		m_next = 0;
+		if (!count)
+			return;
+
+		if (!maxWorkers)
+			maxWorkers = GetDefaultWorkerCount();
+		const size_t workers = min(maxWorkers, count);
+		if (workers > 1 && !m_work)
+			m_work = CreateThreadpoolWork(Callback, this, nullptr);
+		if (workers <= 1 || !m_work)
+		{
+			// not worth the overhead or no thread pool available, just do it synchronously
+			Run();
+			return;
+		}
+
+		m_bRunning = true;
+		for (size_t i = 0; i < workers; ++i)
+			SubmitThreadpoolWork(m_work);
+	}
+
+	void Wait()
+	{
+		if (!m_bRunning)
+			return;
+
+		WaitForThreadpoolWorkCallbacks(m_work, FALSE);
+		m_bRunning = false;
+	}
+
+	// indexes which have not been picked up by a worker yet are skipped
+	void Cancel()
+	{
+		m_next = m_count;
+	}
+
+	bool IsRunning() const { return m_bRunning; }
+
+	static size_t GetDefaultWorkerCount()
+	{
+		return max(static_cast<size_t>(1), static_cast<size_t>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS)));
+	}
+
+private:
+	static void CALLBACK Callback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK)
+	{
+		static_cast<CThreadPoolWork*>(context)->Run();
+	}
+
+	void Run()
+	{
+		for (size_t i; (i = m_next++) < m_count;)
+			m_func(i);
+	}
+
+	PTP_WORK m_work = nullptr;
+	bool m_bRunning = false;
+	std::function<void(size_t)> m_func;
+	size_t m_count = 0;
+	std::atomic<size_t> m_next = 0;
+};
+
+/**
+ * \ingroup Utils
+ * Synchronous version of CThreadPoolWork: returns after func was called for all indexes in [0, count).
+ */
+inline void ParallelFor(size_t count, std::function<void(size_t)> func, size_t maxWorkers = 0)
+{
+	CThreadPoolWork work;
+	work.Start(count, std::move(func), maxWorkers);
+	work.Wait();
+}
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2013, 2020, 2023 - TortoiseGit
+// Copyright (C) 2013, 2020, 2023, 2026 - TortoiseGit
 // Copyright (C) 2010-2011, 2015 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -18,12 +18,49 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 //
 #pragma once
+#include <unordered_map>
+#include <string_view>
+
+/**
+ * \ingroup Utils
+ * Hash function used by UniqueQueue, defaults to std::hash.
+ * Specializations have to be consistent with operator< of T, i.e.
+ * values which are neither less nor greater than each other have to get the same hash.
+ */
+template <class T>
+struct UniqueQueueHash : std::hash<T>
+{
+};
+
+template <>
+struct UniqueQueueHash<CStringW>
+{
+	size_t operator()(const CStringW& value) const noexcept
+	{
+		return std::hash<std::wstring_view>{}(std::wstring_view(value, value.GetLength()));
+	}
+};
+
+/**
+ * \ingroup Utils
+ * Equality used by UniqueQueue: two values are the same entry if neither is less than the other.
+ */
+template <class T>
+struct UniqueQueueEqual
+{
+	bool operator()(const T& lhs, const T& rhs) const
+	{
+		return !(lhs < rhs) && !(rhs < lhs);
+	}
+};
 
 /**
  * \ingroup Utils
  * Implements a queue like container which avoids storing duplicates.
  * If an entry is added that's already in the queue, it gets moved to
  * the end of the queue.
+ * The entries are stored in a hash map and linked in queue order, so
+ * all operations take constant time.
  *
  * \code
  * UniqueQueue<CString> myQueue;
@@ -42,98 +79,107 @@ template <class T>
 class UniqueQueue
 {
 public:
-	UniqueQueue();
-	~UniqueQueue();
+	UniqueQueue() = default;
+	UniqueQueue(const UniqueQueue& other);
+	UniqueQueue& operator=(const UniqueQueue& other);
 
 	size_t			Push(const T &value);
 	T				Pop();
 	size_t			erase(const T &value);
-	size_t			size() const { return m_Queue.size(); }
-	bool			empty() const { return m_Queue.empty(); }
+	size_t			size() const { return m_Index.size(); }
+	bool			empty() const { return m_Index.empty(); }
 private:
-	struct UniqueQueueStruct
+	// elements of an unordered_map don't move on rehashing, so they can point to each other
+	struct UniqueQueueLinks
 	{
-		T			value;
-		size_t		priority = 0;
+		std::pair<const T, UniqueQueueLinks>*	prev = nullptr;
+		std::pair<const T, UniqueQueueLinks>*	next = nullptr;
 	};
-	std::map<T, size_t>				m_QueueTMap;
-	std::deque<UniqueQueueStruct>	m_Queue;
-	size_t							m_highestValue = 0;
+	using IndexMap = std::unordered_map<T, UniqueQueueLinks, UniqueQueueHash<T>, UniqueQueueEqual<T>>;
+	using Entry = typename IndexMap::value_type;
+
+	void			Unlink(Entry& entry);
+	void			Append(Entry& entry);
+
+	IndexMap						m_Index;
+	Entry*							m_pFront = nullptr;
+	Entry*							m_pBack = nullptr;
 };
 
 template <class T>
-UniqueQueue<T>::UniqueQueue()
+UniqueQueue<T>::UniqueQueue(const UniqueQueue& other)
+{
+	for (auto entry = other.m_pFront; entry; entry = entry->second.next)
+		Push(entry->first);
+}
+
+template <class T>
+UniqueQueue<T>& UniqueQueue<T>::operator=(const UniqueQueue& other)
 {
+	if (this == &other)
+		return *this;
+
+	m_Index.clear();
+	m_pFront = nullptr;
+	m_pBack = nullptr;
+	for (auto entry = other.m_pFront; entry; entry = entry->second.next)
+		Push(entry->first);
+	return *this;
 }
 
 template <class T>
-UniqueQueue<T>::~UniqueQueue()
+void UniqueQueue<T>::Unlink(Entry& entry)
 {
+	if (entry.second.prev)
+		entry.second.prev->second.next = entry.second.next;
+	else
+		m_pFront = entry.second.next;
+	if (entry.second.next)
+		entry.second.next->second.prev = entry.second.prev;
+	else
+		m_pBack = entry.second.prev;
+	entry.second.prev = nullptr;
+	entry.second.next = nullptr;
+}
+
+template <class T>
+void UniqueQueue<T>::Append(Entry& entry)
+{
+	entry.second.prev = m_pBack;
+	entry.second.next = nullptr;
+	if (m_pBack)
+		m_pBack->second.next = &entry;
+	else
+		m_pFront = &entry;
+	m_pBack = &entry;
 }
 
 template <class T>
 size_t UniqueQueue<T>::Push(const T &value)
 {
-	auto it = m_QueueTMap.find(value);
-	if (it != m_QueueTMap.end())
+	auto [it, inserted] = m_Index.try_emplace(value);
+	if (!inserted)
 	{
 		// value is already in the queue: we don't allow duplicates
 		// so just move the existing value to the end of the queue
-		for (auto qIt = m_Queue.cbegin(); qIt != m_Queue.cend(); ++qIt)
-		{
-			if (qIt->priority == it->second)
-			{
-				m_Queue.erase(qIt);
-				break;
-			}
-		}
-		it->second = m_highestValue;
-		UniqueQueueStruct s;
-		s.priority = m_highestValue++;
-		s.value = it->first;
-		m_Queue.push_back(s);
-	}
-	else
-	{
-		m_QueueTMap.insert(it, std::map<T, size_t>::value_type(value, m_highestValue));
-		UniqueQueueStruct s;
-		s.priority = m_highestValue++;
-		s.value = value;
-		m_Queue.push_back(s);
-		if (m_highestValue == 0)
-		{
-			// overflow of priority value
-			// recreate the whole queue from scratch
-			std::map<T, size_t> tempQueue = m_QueueTMap;
-			m_QueueTMap.clear();
-			m_Queue.clear();
-
-			for (auto tempIt = tempQueue.cbegin(); tempIt != tempQueue.cend(); ++tempIt)
-			{
-				m_QueueTMap.insert(m_QueueTMap.cend(), std::map<T, size_t>::value_type(tempIt->first, m_highestValue));
-				UniqueQueueStruct s2;
-				s2.priority = m_highestValue++;
-				s2.value = tempIt->first;
-				m_Queue.push_back(s2);
-			}
-		}
+		if (&*it == m_pBack)
+			return m_Index.size();
+		Unlink(*it);
 	}
+	Append(*it);
 
-	return m_Queue.size();
+	return m_Index.size();
 }
 
 template <class T>
 T UniqueQueue<T>::Pop()
 {
-	if (m_Queue.empty())
+	if (!m_pFront)
 		return T();
 
-	T value = m_Queue.front().value;
-	m_Queue.pop_front();
-	m_QueueTMap.erase(value);
-
-	if (m_Queue.empty())
-		m_highestValue = 0;
+	T value = m_pFront->first;
+	Unlink(*m_pFront);
+	m_Index.erase(value);
 
 	return value;
 }
@@ -141,19 +187,12 @@ T UniqueQueue<T>::Pop()
 template <class T>
 size_t UniqueQueue<T>::erase(const T &value)
 {
-	auto it = m_QueueTMap.find(value);
-	if (it != m_QueueTMap.end())
+	auto it = m_Index.find(value);
+	if (it != m_Index.end())
 	{
-		for (auto qIt = m_Queue.cbegin(); qIt != m_Queue.cend(); ++qIt)
-		{
-			if (qIt->priority == it->second)
-			{
-				m_Queue.erase(qIt);
-				break;
-			}
-		}
-		m_QueueTMap.erase(it);
+		Unlink(*it);
+		m_Index.erase(it);
 	}
 
-	return m_QueueTMap.size();
+	return m_Index.size();
 }
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2016, 2023 - TortoiseGit
+// Copyright (C) 2016, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -42,3 +42,101 @@ TEST(CFileTextLines, CheckUnicodeType)
 	EXPECT_EQ(CFileTextLines::UnicodeType::UTF16_LE, ftl.CheckUnicodeType(utf16le, sizeof(utf16le)));
 	EXPECT_EQ(CFileTextLines::UnicodeType::UTF16_LEBOM, ftl.CheckUnicodeType(utf16lebom, sizeof(utf16lebom)));
 }
+
+static std::string ReadFileBytes(const CString& path)
+{
+	std::string content;
+	CAutoFile file = ::CreateFile(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (!file)
+		return content;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+		return content;
+	content.resize(static_cast<size_t>(size.QuadPart));
+	DWORD read = 0;
+	if (!ReadFile(file, content.data(), static_cast<DWORD>(content.size()), &read, nullptr))
+		read = 0;
+	content.resize(read);
+	return content;
+}
+
+static void FillLines(CFileTextLines& ftl)
+{
+	ftl.Add(L"First Line", EOL::CRLF);
+	ftl.Add(L"  indented // comment", EOL::LF);
+	ftl.Add(L"\tTab\tand Umlaut \u00e4", EOL::CR);
+	ftl.Add(L"LF CR ending", EOL::LFCR);
+	ftl.Add(L"code /* block", EOL::VT);
+	ftl.Add(L"still comment */ code", EOL::FF);
+	ftl.Add(L"Version 1.2.3", EOL::NEL);
+	ftl.Add(L"", EOL::LS);
+	ftl.Add(L"auto", EOL::AutoLine);
+	ftl.Add(L"last line  ", EOL::NoEnding);
+}
+
+TEST(CFileTextLines, GetNormalizedText)
+{
+	CAutoTempDir tempDir;
+	const std::wregex rx(L"[0-9]+");
+
+	CFileTextLines ftl;
+	FillLines(ftl);
+	CFileTextLines::SaveParams params;
+	params.m_LineEndings = EOL::LF;
+	ftl.SetSaveParams(params);
+
+	std::string text;
+	std::vector<size_t> lineStarts;
+	ASSERT_TRUE(ftl.GetNormalizedText(text, lineStarts));
+	ASSERT_EQ(static_cast<size_t>(ftl.GetCount()) + 1, lineStarts.size());
+	EXPECT_EQ(0U, lineStarts.front());
+	EXPECT_EQ(text.size(), lineStarts.back());
+	EXPECT_EQ("First Line\r\n", text.substr(lineStarts[0], lineStarts[1] - lineStarts[0]));
+	EXPECT_EQ("\tTab\tand Umlaut \xc3\xa4\r", text.substr(lineStarts[2], lineStarts[3] - lineStarts[2]));
+	EXPECT_EQ("auto\n", text.substr(lineStarts[8], lineStarts[9] - lineStarts[8]));
+	EXPECT_EQ("last line  ", text.substr(lineStarts[9]));
+
+	// must be exactly what the svn diff got to read from the converted temp files
+	const CString file = tempDir.GetTempDir() + L"\\converted.txt";
+	ASSERT_TRUE(ftl.Save(file, true, true));
+	EXPECT_EQ(ReadFileBytes(file), text);
+
+	ASSERT_TRUE(ftl.Save(file, true, true, 1, TRUE, false, true, L"//", L"/*", L"*/", rx, L"#"));
+	ASSERT_TRUE(ftl.GetNormalizedText(text, lineStarts, 1, TRUE, false, true, L"//", L"/*", L"*/", rx, L"#"));
+	EXPECT_EQ(ReadFileBytes(file), text);
+	EXPECT_EQ(static_cast<size_t>(ftl.GetCount()) + 1, lineStarts.size());
+
+	ASSERT_TRUE(ftl.Save(file, true, true, 2, FALSE));
+	ASSERT_TRUE(ftl.GetNormalizedText(text, lineStarts, 2, FALSE));
+	EXPECT_EQ(ReadFileBytes(file), text);
+
+	CFileTextLines empty;
+	ASSERT_TRUE(empty.GetNormalizedText(text, lineStarts));
+	EXPECT_TRUE(text.empty());
+	ASSERT_EQ(1U, lineStarts.size());
+	EXPECT_EQ(0U, lineStarts[0]);
+}
+
+TEST(CFileTextLines, GetNormalizedTextManyLines)
+{
+	CAutoTempDir tempDir;
+	CFileTextLines ftl;
+	for (int i = 0; i < 2000; ++i)
+	{
+		CString line;
+		line.Format(L"\tline %d of a large file, with some words to have a realistic line length // %d", i, i * 7);
+		ftl.Add(line, (i % 3) ? EOL::LF : EOL::CRLF);
+	}
+
+	// the way to the svn diff before: write the converted file and let the diff read it again
+	const CString file = tempDir.GetTempDir() + L"\\converted.txt";
+	ASSERT_TRUE(ftl.Save(file, true, true, 0, TRUE, false, true, L"//"));
+
+	std::string text;
+	std::vector<size_t> lineStarts;
+	ASSERT_TRUE(ftl.GetNormalizedText(text, lineStarts, 0, TRUE, false, true, L"//"));
+	EXPECT_EQ(ReadFileBytes(file), text);
+	ASSERT_EQ(static_cast<size_t>(ftl.GetCount()) + 1, lineStarts.size());
+	EXPECT_EQ("\tline 1 of a large file, with some words to have a realistic line length \n", text.substr(lineStarts[1], lineStarts[2] - lineStarts[1]));
+	EXPECT_EQ("\tline 1999 of a large file, with some words to have a realistic line length \n", text.substr(lineStarts[1999]));
+}
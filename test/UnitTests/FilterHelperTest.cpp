@@ -0,0 +1,147 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "FilterHelper.h"
+
+namespace
+{
+class CTestFilter : public CFilterHelper
+{
+public:
+	using CFilterHelper::CFilterHelper;
+
+	bool operator()(const wchar_t* text) const
+	{
+		scratch = text;
+		return CalculateFinalResult(Match(scratch));
+	}
+};
+}
+
+TEST(CFilterHelper, SubStrings)
+{
+	CTestFilter filter(L"crash -dialog", false, UINT_MAX, false);
+	EXPECT_TRUE(filter.IsFilterActive());
+	EXPECT_TRUE(filter.m_jitPatterns.empty());
+	EXPECT_TRUE(filter(L"Fix Crash in the blame\n"));
+	EXPECT_FALSE(filter(L"Fix crash in the log dialog\n"));
+	EXPECT_FALSE(filter(L""));
+
+	CTestFilter negated(L"!crash", false, UINT_MAX, false);
+	EXPECT_FALSE(negated(L"Fix crash\n"));
+	EXPECT_TRUE(negated(L"Update libgit2\n"));
+}
+
+TEST(CFilterHelper, RegexPcre2)
+{
+	CTestFilter filter(L"fix(ed)? crash", true, UINT_MAX, false);
+	EXPECT_TRUE(filter.IsFilterActive());
+	// matched with PCRE2, not with std::wregex
+	ASSERT_EQ(1U, filter.m_jitPatterns.size());
+	EXPECT_TRUE(filter(L"Fixed Crash in the log dialog\n"));
+	EXPECT_TRUE(filter(L"Subject\nfix crash\n"));
+	EXPECT_FALSE(filter(L"crash fix\n"));
+
+	CTestFilter caseSensitive(L"Crash", true, UINT_MAX, true);
+	ASSERT_EQ(1U, caseSensitive.m_jitPatterns.size());
+	EXPECT_TRUE(caseSensitive(L"Crash\n"));
+	EXPECT_FALSE(caseSensitive(L"crash\n"));
+
+	CTestFilter negated(L"!^update", true, UINT_MAX, false);
+	ASSERT_EQ(1U, negated.m_jitPatterns.size());
+	EXPECT_FALSE(negated(L"Update libgit2\n"));
+	EXPECT_TRUE(negated(L"Fix crash\n"));
+}
+
+TEST(CFilterHelper, RegexPcre2LikeECMAScript)
+{
+	// every text to match ends with a "\n", "$" must not match before it
+	CTestFilter dollar(L"dialog$", true, UINT_MAX, false);
+	ASSERT_EQ(1U, dollar.m_jitPatterns.size());
+	EXPECT_FALSE(dollar(L"Fix crash in the log dialog\n"));
+	EXPECT_TRUE(dollar(L"Fix crash in the log dialog"));
+
+	// no Unicode properties, \d only matches ASCII digits
+	CTestFilter digits(L"issue \\d+", true, UINT_MAX, false);
+	ASSERT_EQ(1U, digits.m_jitPatterns.size());
+	EXPECT_TRUE(digits(L"Fixed issue 42\n"));
+	EXPECT_FALSE(digits(L"Fixed issue \u0664\u0662\n"));
+
+	// \u is a hex escape as in ECMAScript
+	CTestFilter unicode(L"caf\\u00e9", true, UINT_MAX, false);
+	ASSERT_EQ(1U, unicode.m_jitPatterns.size());
+	EXPECT_TRUE(unicode(L"Caf\u00e9 au lait\n"));
+	EXPECT_FALSE(unicode(L"Cafe au lait\n"));
+
+	// non-ASCII text is matched as UTF-8
+	CTestFilter umlaut(L"\u00fcber.*fl\u00fcssig", true, UINT_MAX, false);
+	ASSERT_EQ(1U, umlaut.m_jitPatterns.size());
+	EXPECT_TRUE(umlaut(L"\u00dcber ist \u00fcberfl\u00fcssig\n"));
+	EXPECT_FALSE(umlaut(L"uber ist uberflussig\n"));
+}
+
+static std::vector<std::wstring> GetRegexLiterals(const wchar_t* regex, bool caseSensitive = false)
+{
+	std::vector<std::wstring> literals;
+	CFilterHelper::GetRegexLiterals(regex, caseSensitive, literals);
+	return literals;
+}
+
+TEST(CFilterHelper, GetRegexLiterals)
+{
+	using Literals = std::vector<std::wstring>;
+	EXPECT_EQ(Literals({ L"fix", L"crash" }), GetRegexLiterals(L"Fix.*Crash"));
+	EXPECT_EQ(Literals({ L"abc" }), GetRegexLiterals(L"^abc$"));
+	EXPECT_EQ(Literals({ L"abc" }), GetRegexLiterals(L"abc+"));
+	// quantified characters are optional or might be repeated
+	EXPECT_EQ(Literals(), GetRegexLiterals(L"a?bc"));
+	EXPECT_EQ(Literals({ L"def" }), GetRegexLiterals(L"abc?def"));
+	EXPECT_EQ(Literals({ L"abc" }), GetRegexLiterals(L"abcd*"));
+	EXPECT_EQ(Literals(), GetRegexLiterals(L"x{2}yz"));
+	EXPECT_EQ(Literals({ L"abc" }), GetRegexLiterals(L"xyz{2,3}abc"));
+	// classes and escapes are skipped including their arguments
+	EXPECT_EQ(Literals({ L"def" }), GetRegexLiterals(L"[abc]def"));
+	EXPECT_EQ(Literals({ L"def" }), GetRegexLiterals(L"[]abc]def"));
+	EXPECT_EQ(Literals({ L"def" }), GetRegexLiterals(L"[^\\]abc]def"));
+	EXPECT_EQ(Literals(), GetRegexLiterals(L"\\Qfoo\\E"));
+	EXPECT_EQ(Literals({ L"foo", L"bar" }), GetRegexLiterals(L"foo\\.bar"));
+	EXPECT_EQ(Literals({ L"abc" }), GetRegexLiterals(L"\\d{3}abc"));
+	EXPECT_EQ(Literals({ L"abc" }), GetRegexLiterals(L"\\p{L}abc"));
+	// too short to be of any use
+	EXPECT_EQ(Literals(), GetRegexLiterals(L"ab.cd"));
+	// Unicode case folding might differ from the lower casing of the texts
+	EXPECT_EQ(Literals({ L"stra" }), GetRegexLiterals(L"Stra\u00dfe"));
+	EXPECT_EQ(Literals({ L"stra\u00dfe" }), GetRegexLiterals(L"Stra\u00dfe", true));
+	EXPECT_EQ(Literals({ L"abc" }), GetRegexLiterals(L"\u00c4bc.abc"));
+	// alternatives and groups could make any part optional
+	EXPECT_EQ(Literals(), GetRegexLiterals(L"foo|bar"));
+	EXPECT_EQ(Literals(), GetRegexLiterals(L"(foo)bar"));
+	EXPECT_EQ(Literals(), GetRegexLiterals(L"abcdef(?:x)"));
+}
+
+TEST(CFilterHelper, GetRequiredSubStrings)
+{
+	using Literals = std::vector<std::wstring>;
+	EXPECT_EQ(Literals({ L"fix", L"crash" }), CFilterHelper(L"Fix.*Crash", true, UINT_MAX, false).GetRequiredSubStrings());
+	EXPECT_EQ(Literals({ L"fix", L"crash" }), CFilterHelper(L"Fix -log Crash", false, UINT_MAX, true).GetRequiredSubStrings());
+	EXPECT_EQ(Literals(), CFilterHelper(L"fix +crash", false, UINT_MAX, false).GetRequiredSubStrings());
+	EXPECT_EQ(Literals(), CFilterHelper(L"!crash", false, UINT_MAX, false).GetRequiredSubStrings());
+	EXPECT_EQ(Literals(), CFilterHelper(L"!crash", true, UINT_MAX, false).GetRequiredSubStrings());
+}
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2015-2020, 2023-2024 - TortoiseGit
+// Copyright (C) 2015-2020, 2023-2024, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -179,6 +179,152 @@ TEST_P(GitIndexCBasicGitWithTestRepoFixture, ReadIndex)
 	}
 }
 
+TEST_P(GitIndexCBasicGitWithTestRepoFixture, DirectoryIndex)
+{
+	CGitIndexList indexList;
+	ReadAndCheckIndex(indexList, m_Dir.GetTempDir());
+
+	auto dirIndex = indexList.GetDirectoryIndex();
+	ASSERT_TRUE(dirIndex);
+	EXPECT_EQ(dirIndex, indexList.GetDirectoryIndex());
+
+	auto root = dirIndex->Find(L"", 0);
+	ASSERT_TRUE(root);
+	EXPECT_EQ(0U, root->m_Start);
+	EXPECT_EQ(indexList.size(), root->m_End);
+
+	auto copy = dirIndex->Find(L"copy/", 5);
+	ASSERT_TRUE(copy);
+	EXPECT_EQ(1U, copy->m_Start);
+	size_t copyEnd = copy->m_Start;
+	while (copyEnd < indexList.size() && CStringUtils::StartsWith(indexList[copyEnd].m_FileName, L"copy/"))
+		++copyEnd;
+	EXPECT_EQ(copyEnd, copy->m_End);
+	EXPECT_EQ(copyEnd - copy->m_Start, static_cast<size_t>(dirIndex->ChildrenEnd(*copy) - dirIndex->ChildrenBegin(*copy)));
+	for (auto child = dirIndex->ChildrenBegin(*copy); child != dirIndex->ChildrenEnd(*copy); ++child)
+	{
+		EXPECT_EQ(child->m_Start + 1, child->m_End);
+		EXPECT_STREQ(indexList[child->m_Start].m_FileName.GetString() + 5, CString(child->m_pName, child->m_iLength));
+	}
+
+	// root has all top level files plus "copy/"
+	size_t rootChildren = 0;
+	for (auto child = dirIndex->ChildrenBegin(*root); child != dirIndex->ChildrenEnd(*root); ++child)
+	{
+		++rootChildren;
+		if (CString(child->m_pName, child->m_iLength) == L"copy/")
+		{
+			EXPECT_EQ(copy->m_Start, child->m_Start);
+			EXPECT_EQ(copy->m_End, child->m_End);
+		}
+	}
+	EXPECT_EQ(indexList.size() - (copy->m_End - copy->m_Start) + 1, rootChildren);
+
+	EXPECT_FALSE(dirIndex->Find(L"copy", 4));
+	EXPECT_FALSE(dirIndex->Find(L"nonexisting/", 12));
+}
+
+static void CheckTreeMatchesIndex(const CGitHeadFileList& treeList, const CString& gitdir)
+{
+	CGitIndexList indexList;
+	EXPECT_EQ(0, indexList.ReadIndex(gitdir));
+	ASSERT_EQ(14U, indexList.size());
+	ASSERT_EQ(indexList.size(), treeList.size());
+	for (size_t i = 0; i < indexList.size(); ++i)
+	{
+		EXPECT_STREQ(indexList[i].m_FileName, treeList[i].m_FileName);
+		EXPECT_EQ(indexList[i].m_IndexHash, treeList[i].m_Hash);
+	}
+}
+
+TEST_P(GitIndexCBasicGitWithTestRepoFixture, ReadTree)
+{
+	CGitHeadFileList treeList;
+	EXPECT_EQ(0, treeList.ReadHeadHash(m_Dir.GetTempDir()));
+	EXPECT_EQ(0, treeList.ReadTree(false));
+	CheckTreeMatchesIndex(treeList, m_Dir.GetTempDir());
+
+	// only "copy/" changes, all other entries can be taken over from the previous list
+	EXPECT_TRUE(CStringUtils::WriteStringToTextFile(m_Dir.GetTempDir() + L"\\copy\\ansi.txt", L"this is testing file."));
+	CString output;
+	EXPECT_EQ(0, m_Git.Run(L"git.exe commit -a -m \"test\"", &output, CP_UTF8));
+	EXPECT_STRNE(L"", output);
+
+	CGitHeadFileList newTreeList;
+	EXPECT_EQ(0, newTreeList.ReadHeadHash(m_Dir.GetTempDir()));
+	EXPECT_EQ(0, newTreeList.ReadTree(false, &treeList));
+	CheckTreeMatchesIndex(newTreeList, m_Dir.GetTempDir());
+	EXPECT_NE(treeList[1].m_Hash, newTreeList[1].m_Hash);
+	EXPECT_STREQ(L"copy/ansi.txt", newTreeList[1].m_FileName);
+
+	// reusing an identical tree yields the same list
+	CGitHeadFileList sameTreeList;
+	EXPECT_EQ(0, sameTreeList.ReadHeadHash(m_Dir.GetTempDir()));
+	EXPECT_EQ(0, sameTreeList.ReadTree(false, &newTreeList));
+	CheckTreeMatchesIndex(sameTreeList, m_Dir.GetTempDir());
+}
+
+TEST_P(GitIndexCBasicGitWithTestRepoFixture, IndexSnapshot)
+{
+	CString snapshotFile = m_Dir.GetTempDir() + L"\\.git\\tortoisegit.indexcache";
+	EXPECT_FALSE(PathFileExists(snapshotFile));
+
+	{
+		CGitIndexList indexList;
+		ReadAndCheckIndex(indexList, m_Dir.GetTempDir());
+		EXPECT_FALSE(PathFileExists(snapshotFile));
+	}
+
+	{
+		CGitIndexList indexList;
+		indexList.m_bUseIndexSnapshot = true;
+		ReadAndCheckIndex(indexList, m_Dir.GetTempDir());
+		EXPECT_TRUE(PathFileExists(snapshotFile));
+	}
+
+	// now served from the snapshot
+	{
+		CGitIndexList indexList;
+		indexList.m_bUseIndexSnapshot = true;
+		ReadAndCheckIndex(indexList, m_Dir.GetTempDir());
+	}
+
+	// snapshot gets invalidated by changing the index
+	EXPECT_TRUE(CStringUtils::WriteStringToTextFile(m_Dir.GetTempDir() + L"\\1.txt", L"this is testing file."));
+	CString output;
+	EXPECT_EQ(0, m_Git.Run(L"git.exe add 1.txt", &output, CP_UTF8));
+	EXPECT_STREQ(L"", output);
+	{
+		CGitIndexList indexList;
+		indexList.m_bUseIndexSnapshot = true;
+		ReadAndCheckIndex(indexList, m_Dir.GetTempDir(), 1);
+		EXPECT_STREQ(L"1.txt", indexList[0].m_FileName);
+		EXPECT_STREQ(L"e4aac1275dfc440ec521a76e9458476fe07038bb", indexList[0].m_IndexHash.ToString());
+	}
+
+	// a broken snapshot is ignored and replaced
+	{
+		CAutoFile file = ::CreateFile(snapshotFile, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		ASSERT_TRUE(file);
+		LARGE_INTEGER fileSize;
+		ASSERT_TRUE(GetFileSizeEx(file, &fileSize));
+		fileSize.QuadPart /= 2;
+		EXPECT_TRUE(SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN));
+		EXPECT_TRUE(SetEndOfFile(file));
+	}
+	{
+		CGitIndexList indexList;
+		indexList.m_bUseIndexSnapshot = true;
+		ReadAndCheckIndex(indexList, m_Dir.GetTempDir(), 1);
+	}
+	{
+		CGitIndexList indexList;
+		indexList.m_bUseIndexSnapshot = true;
+		ReadAndCheckIndex(indexList, m_Dir.GetTempDir(), 1);
+		EXPECT_STREQ(L"1.txt", indexList[0].m_FileName);
+	}
+}
+
 TEST_P(GitIndexCBasicGitWithTestRepoFixture, GetFileStatus)
 {
 	CGitIndexList indexList;
@@ -499,6 +645,97 @@ TEST(GitIndex, GetRangeInSortVector)
 	CheckRangeInSortVector(true);
 }
 
+TEST(GitIndex, CGitPathArena)
+{
+	CGitPathArena arena;
+	EXPECT_EQ(0U, arena.GetAllocatedSize());
+
+	auto name = arena.StoreUTF8(CString(), "file.txt", false);
+	EXPECT_STREQ(L"file.txt", name);
+	EXPECT_EQ(8, name.GetLength());
+	EXPECT_EQ(-1, name.Find(L'/'));
+
+	auto dir = arena.StoreUTF8(L"sub/", "\xC3\xA4\xE2\x82\xAC", true); // "ae-umlaut" and euro sign
+	EXPECT_STREQ(L"sub/\u00E4\u20AC/", dir);
+	EXPECT_EQ(7, dir.GetLength());
+	EXPECT_EQ(3, dir.Find(L'/'));
+	EXPECT_EQ(6, dir.Find(L'/', 4));
+	EXPECT_EQ(-1, dir.Find(L'/', 7));
+	EXPECT_STREQ(L"\u00E4\u20AC", dir.Mid(4, 2));
+	EXPECT_EQ(0, dir.CompareNoCase(L"SUB/\u00E4\u20AC/"));
+	EXPECT_NE(0, dir.Compare(L"SUB/\u00E4\u20AC/"));
+
+	// names are packed after each other, the first name is not affected by later allocations
+	EXPECT_EQ(name.GetString() + name.GetLength() + 1, dir.GetString());
+	EXPECT_STREQ(L"file.txt", name);
+
+	auto empty = arena.Store(L"", 0);
+	EXPECT_TRUE(empty.IsEmpty());
+	EXPECT_STREQ(L"", empty);
+
+	// names larger than a block get their own block
+	CString longName(L'x', 100 * 1024);
+	auto stored = arena.Store(longName, longName.GetLength());
+	EXPECT_STREQ(longName, stored);
+	EXPECT_STREQ(L"file.txt", name);
+	EXPECT_LE(static_cast<size_t>(longName.GetLength() + 1), arena.GetAllocatedSize() - 64 * 1024);
+
+	arena.Clear();
+	EXPECT_EQ(0U, arena.GetAllocatedSize());
+}
+
+class CTestSharedPtrMap : public SharedPtrMapTmpl<std::shared_ptr<int>>
+{
+public:
+	using SharedPtrMapTmpl<std::shared_ptr<int>>::SafeSet;
+};
+
+TEST(GitIndex, SharedPtrMapTmpl)
+{
+	CAutoTempDir tempDir;
+	const CString root = tempDir.GetTempDir();
+
+	CTestSharedPtrMap map;
+	EXPECT_FALSE(map.SafeGet(root));
+	EXPECT_FALSE(map.SafeClear(root));
+	EXPECT_FALSE(map.SafeClearRecursively(root));
+
+	// fill several shards
+	for (int i = 0; i < 64; ++i)
+	{
+		CString path;
+		path.Format(L"%s\\repo%d", static_cast<LPCWSTR>(root), i);
+		map.SafeSet(path, std::make_shared<int>(i));
+	}
+	map.SafeSet(root + L"\\other\\sub", std::make_shared<int>(100));
+	map.SafeSet(root + L"\\other", std::make_shared<int>(101));
+
+	auto entry = map.SafeGet(root + L"\\repo7");
+	ASSERT_TRUE(entry);
+	EXPECT_EQ(7, *entry);
+	entry = map.SafeGet(root + L"\\REPO7\\"); // keys are normalized
+	ASSERT_TRUE(entry);
+	EXPECT_EQ(7, *entry);
+
+	EXPECT_TRUE(map.SafeClear(root + L"\\repo7"));
+	EXPECT_FALSE(map.SafeGet(root + L"\\repo7"));
+	EXPECT_FALSE(map.SafeClear(root + L"\\repo7"));
+
+	EXPECT_TRUE(map.SafeClearRecursively(root + L"\\other"));
+	EXPECT_FALSE(map.SafeGet(root + L"\\other"));
+	EXPECT_FALSE(map.SafeGet(root + L"\\other\\sub"));
+	ASSERT_TRUE(map.SafeGet(root + L"\\repo8"));
+
+	EXPECT_TRUE(map.SafeClearRecursively(root));
+	for (int i = 0; i < 64; ++i)
+	{
+		CString path;
+		path.Format(L"%s\\repo%d", static_cast<LPCWSTR>(root), i);
+		EXPECT_FALSE(map.SafeGet(path));
+	}
+	EXPECT_FALSE(map.SafeClearRecursively(root));
+}
+
 TEST(GitIndex, CGitIgnoreItem)
 {
 	CAutoTempDir tempDir;
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2015-2021, 2023 - TortoiseGit
+// Copyright (C) 2015-2021, 2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -21,6 +21,7 @@
 #include "Git.h"
 #include "StringUtils.h"
 #include "RepositoryFixtures.h"
+#include "GitCommitGraph.h"
 
 // For performance reason, turn LIBGIT off by default,
 INSTANTIATE_TEST_SUITE_P(CGit, CBasicGitWithEmptyRepositoryFixture, testing::Values(GIT_CLI, /*LIBGIT,*/ LIBGIT2, LIBGIT2_ALL));
@@ -893,6 +894,46 @@ TEST_P(CBasicGitWithEmptyRepositoryFixture, GetHash_EmptyRepo)
 	EXPECT_TRUE(hash.IsEmpty());
 }
 
+TEST_P(CBasicGitWithTestRepoFixture, GetPooledGitRepository)
+{
+	CGitHash hash;
+	git_repository* first = nullptr;
+	{
+		auto repo = m_Git.GetPooledGitRepository();
+		first = repo;
+		ASSERT_NE(nullptr, first);
+		auto repo2 = m_Git.GetPooledGitRepository();
+		EXPECT_NE(nullptr, static_cast<git_repository*>(repo2));
+		EXPECT_NE(first, static_cast<git_repository*>(repo2));
+		EXPECT_EQ(0, CGit::GetHash(repo2, hash, L"HEAD~1"));
+		EXPECT_STREQ(L"1fc3c9688e27596d8717b54f2939dc951568f6cb", hash.ToString());
+	}
+	{
+		// returned repositories are reused
+		auto repo = m_Git.GetPooledGitRepository();
+		EXPECT_EQ(first, static_cast<git_repository*>(repo));
+		EXPECT_EQ(0, CGit::GetHash(repo, hash, L"HEAD"));
+		EXPECT_STREQ(L"7c3cbfe13a929d2291a574dca45e4fd2d2ac1aa6", hash.ToString());
+
+		// a repository borrowed before invalidating is freed on return
+		m_Git.InvalidateRepositoryPool();
+	}
+	{
+		auto repo = m_Git.GetPooledGitRepository();
+		ASSERT_NE(nullptr, static_cast<git_repository*>(repo));
+		EXPECT_EQ(0, CGit::GetHash(repo, hash, L"master"));
+		EXPECT_STREQ(L"7c3cbfe13a929d2291a574dca45e4fd2d2ac1aa6", hash.ToString());
+	}
+
+	const CString currentDir = m_Git.m_CurrentDir;
+	m_Git.m_CurrentDir = m_Dir.GetTempDir() + L"\\non-existing";
+	EXPECT_EQ(nullptr, static_cast<git_repository*>(m_Git.GetPooledGitRepository()));
+	m_Git.m_CurrentDir = currentDir;
+	EXPECT_NE(nullptr, static_cast<git_repository*>(m_Git.GetPooledGitRepository()));
+	EXPECT_EQ(0, m_Git.GetHash(hash, L"HEAD"));
+	EXPECT_STREQ(L"7c3cbfe13a929d2291a574dca45e4fd2d2ac1aa6", hash.ToString());
+}
+
 TEST_P(CBasicGitWithEmptyRepositoryFixture, GetEmptyBranchesTagsRefs)
 {
 	STRING_VECTOR branches;
@@ -4194,7 +4235,7 @@ TEST_P(CBasicGitWithTestRepoFixture, GetWorkingTreeChanges_RefreshGitIndex)
 	// START: this is the undesired behavior
 	// this test is just there so we notice when this change somehow
 	EXPECT_EQ(0, m_Git.GetWorkingTreeChanges(list, false, nullptr));
-	if (m_Git.ms_bCygwinGit || m_Git.ms_bMsys2Git)
+	if (m_Git.ms_bCygwinGit || m_Git.ms_bMsys2Git || m_Git.UsingLibGit2(CGit::GIT_CMD_WORKINGTREECHANGES)) // libgit2 compares the content of stat-dirty files
 		EXPECT_EQ(0, list.GetCount());
 	else
 		EXPECT_EQ(1, list.GetCount());
@@ -4206,6 +4247,66 @@ TEST_P(CBasicGitWithTestRepoFixture, GetWorkingTreeChanges_RefreshGitIndex)
 	EXPECT_EQ(0, list.GetCount());
 }
 
+TEST_P(CBasicGitWithTestRepoFixture, GetWorkingTreeChanges_LibGit2MatchesGitExe)
+{
+	if (GetParam() != 0)
+		return;
+
+	// adding ansi2.txt (as a copy of ansi.txt) produces a warning
+	m_Git.SetConfigValue(L"core.autocrlf", L"false");
+
+	CString output;
+	EXPECT_EQ(0, m_Git.Run(L"git.exe reset --hard master", &output, CP_UTF8));
+	EXPECT_STRNE(L"", output);
+
+	// staged rename, staged and unstaged modification, unstaged deletion
+	EXPECT_EQ(0, m_Git.Run(L"git.exe mv ansi.txt copy/ansi2.txt", &output, CP_UTF8));
+	EXPECT_TRUE(CStringUtils::WriteStringToTextFile(m_Git.m_CurrentDir + L"\\ascii.txt", L"staged\n"));
+	EXPECT_EQ(0, m_Git.Run(L"git.exe add ascii.txt", &output, CP_UTF8));
+	EXPECT_TRUE(CStringUtils::WriteStringToTextFile(m_Git.m_CurrentDir + L"\\ascii.txt", L"staged\nunstaged\n"));
+	EXPECT_TRUE(::DeleteFile(m_Git.m_CurrentDir + L"\\copy\\ansi.txt"));
+
+	auto getChanges = [this](bool libgit2, CTGitPathList& list, bool amend, const CTGitPathList* filter, bool includedStaged, bool getStagingStatus) {
+		const DWORD oldMask = m_Git.m_IsUseLibGit2_mask;
+		if (libgit2)
+			m_Git.m_IsUseLibGit2_mask |= 1 << CGit::GIT_CMD_WORKINGTREECHANGES;
+		else
+			m_Git.m_IsUseLibGit2_mask &= ~(1 << CGit::GIT_CMD_WORKINGTREECHANGES);
+		list.Clear();
+		EXPECT_EQ(0, m_Git.GetWorkingTreeChanges(list, amend, filter, includedStaged, getStagingStatus));
+		m_Git.m_IsUseLibGit2_mask = oldMask;
+		list.SortByPathname();
+	};
+
+	CTGitPathList filter;
+	filter.AddPath(CTGitPath(L"copy"));
+	filter.AddPath(CTGitPath(L"ascii.txt"));
+	for (const CTGitPathList* filterlist : { static_cast<const CTGitPathList*>(nullptr), static_cast<const CTGitPathList*>(&filter) })
+	{
+		for (int flags = 0; flags < 8; ++flags)
+		{
+			const bool amend = (flags & 1) != 0;
+			const bool includedStaged = (flags & 2) != 0;
+			const bool getStagingStatus = (flags & 4) != 0;
+			CTGitPathList expected, actual;
+			getChanges(false, expected, amend, filterlist, includedStaged, getStagingStatus);
+			getChanges(true, actual, amend, filterlist, includedStaged, getStagingStatus);
+			EXPECT_EQ(expected.GetAction(), actual.GetAction());
+			ASSERT_EQ(expected.GetCount(), actual.GetCount()) << "flags: " << flags;
+			for (int i = 0; i < expected.GetCount(); ++i)
+			{
+				EXPECT_STREQ(expected[i].GetGitPathString(), actual[i].GetGitPathString());
+				EXPECT_STREQ(expected[i].GetGitOldPathString(), actual[i].GetGitOldPathString());
+				EXPECT_EQ(expected[i].m_Action, actual[i].m_Action) << static_cast<LPCWSTR>(expected[i].GetGitPathString());
+				EXPECT_STREQ(expected[i].m_StatAdd, actual[i].m_StatAdd);
+				EXPECT_STREQ(expected[i].m_StatDel, actual[i].m_StatDel);
+				EXPECT_EQ(expected[i].IsDirectory(), actual[i].IsDirectory());
+				EXPECT_EQ(expected[i].m_stagingStatus, actual[i].m_stagingStatus);
+			}
+		}
+	}
+}
+
 TEST_P(CBasicGitWithTestRepoFixture, GetBisectTerms)
 {
 	if (m_Git.ms_bCygwinGit)
@@ -4329,6 +4430,74 @@ TEST_P(CBasicGitWithTestRepoFixture, GetRefsCommitIsOn)
 	EXPECT_STREQ(L"refs/remotes/origin/master", list[7]);
 }
 
+TEST_P(CBasicGitWithTestRepoFixture, GetRefsCommitIsOn_CommitGraph)
+{
+	if (m_Git.GetGitVersion(nullptr, nullptr) < 0x02120000)
+		return;
+
+	// once without and once with a commit-graph file, results must be the same
+	for (int withCommitGraph = 0; withCommitGraph < 2; ++withCommitGraph)
+	{
+		CString output;
+		if (withCommitGraph)
+		{
+			EXPECT_EQ(0, m_Git.Run(L"git.exe commit-graph write --reachable", &output, CP_UTF8));
+			CString commitGraphFile;
+			ASSERT_TRUE(GitAdminDir::GetAdminDirPath(m_Git.m_CurrentDir, commitGraphFile));
+			commitGraphFile += L"objects\\info\\commit-graph";
+			EXPECT_TRUE(PathFileExists(commitGraphFile));
+		}
+
+		STRING_VECTOR list;
+		EXPECT_EQ(0, m_Git.GetRefsCommitIsOn(list, CGitHash::FromHexStr(L"b9ef30183497cdad5c30b88d32dc1bed7951dfeb"), true, false));
+		ASSERT_EQ(2U, list.size());
+		EXPECT_STREQ(L"refs/tags/also-signed", list[0]);
+		EXPECT_STREQ(L"refs/tags/normal-tag", list[1]);
+
+		list.clear();
+		EXPECT_EQ(0, m_Git.GetRefsCommitIsOn(list, CGitHash::FromHexStr(L"313a41bc88a527289c87d7531802ab484715974f"), false, true, CGit::BRANCH_ALL));
+		ASSERT_EQ(7U, list.size());
+		EXPECT_STREQ(L"refs/heads/forconflict", list[0]);
+		EXPECT_STREQ(L"refs/remotes/origin/master", list[6]);
+
+		// compare every commit against every branch with libgit2
+		CAutoRepository repo(m_Git.GetGitRepository());
+		ASSERT_TRUE(repo.IsValid());
+		std::vector<std::pair<CString, CGitHash>> branches;
+		output.Empty();
+		EXPECT_EQ(0, m_Git.Run(L"git.exe for-each-ref --format=\"%(objectname) %(refname)\" refs/heads refs/remotes", &output, CP_UTF8));
+		for (int start = 0; start >= 0;)
+		{
+			CString line = output.Tokenize(L"\n", start).Trim();
+			if (line.GetLength() > 41)
+				branches.emplace_back(line.Mid(41), CGitHash::FromHexStr(line.Left(40)));
+		}
+		ASSERT_FALSE(branches.empty());
+
+		output.Empty();
+		EXPECT_EQ(0, m_Git.Run(L"git.exe rev-list --all", &output, CP_UTF8));
+		CGitRefsContainsCache cache;
+		int commits = 0;
+		for (int start = 0; start >= 0;)
+		{
+			CString line = output.Tokenize(L"\n", start).Trim();
+			if (line.IsEmpty())
+				continue;
+			++commits;
+			const CGitHash commit = CGitHash::FromHexStr(line);
+			std::vector<std::pair<CString, CGitRefsContainsCache::RefKind>> refs;
+			EXPECT_EQ(0, cache.GetRefsContaining(repo, commit, refs));
+			for (const auto& [name, tip] : branches)
+			{
+				const bool expected = tip == commit || git_graph_descendant_of(repo, tip, commit) == 1;
+				const bool found = std::any_of(refs.cbegin(), refs.cend(), [&name](const auto& ref) { return ref.first == name; });
+				EXPECT_EQ(expected, found) << static_cast<LPCWSTR>(line) << L" " << static_cast<LPCWSTR>(name);
+			}
+		}
+		EXPECT_LT(0, commits);
+	}
+}
+
 TEST_P(CBasicGitWithTestRepoFixture, GetUnifiedDiff)
 {
 	CString tmpfile = m_Dir.GetTempDir() + L"\\output.txt";
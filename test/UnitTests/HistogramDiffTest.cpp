@@ -0,0 +1,164 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "HistogramDiff.h"
+
+// checks that the runs are ordered, not adjacent and really common, returns the number of common lines
+static size_t CheckRuns(const std::vector<uint32_t>& lines1, const std::vector<uint32_t>& lines2, const std::vector<CHistogramDiff::SCommonRun>& runs)
+{
+	size_t common = 0;
+	size_t end1 = 0;
+	size_t end2 = 0;
+	for (size_t i = 0; i < runs.size(); ++i)
+	{
+		const auto& run = runs[i];
+		EXPECT_LT(0U, run.length);
+		EXPECT_LE(end1, run.start1);
+		EXPECT_LE(end2, run.start2);
+		if (i > 0)
+			EXPECT_FALSE(run.start1 == end1 && run.start2 == end2);
+		EXPECT_LE(run.start1 + run.length, lines1.size());
+		EXPECT_LE(run.start2 + run.length, lines2.size());
+		if (run.start1 + run.length > lines1.size() || run.start2 + run.length > lines2.size())
+			break;
+		for (size_t j = 0; j < run.length; ++j)
+			EXPECT_EQ(lines1[run.start1 + j], lines2[run.start2 + j]);
+		end1 = run.start1 + run.length;
+		end2 = run.start2 + run.length;
+		common += run.length;
+	}
+	return common;
+}
+
+TEST(CHistogramDiff, Simple)
+{
+	const std::vector<uint32_t> empty;
+	const std::vector<uint32_t> lines = { 1, 2, 3, 4, 5 };
+	EXPECT_TRUE(CHistogramDiff::Diff(empty, empty).empty());
+	EXPECT_TRUE(CHistogramDiff::Diff(lines, empty).empty());
+	EXPECT_TRUE(CHistogramDiff::Diff(empty, lines).empty());
+
+	auto runs = CHistogramDiff::Diff(lines, lines);
+	ASSERT_EQ(1U, runs.size());
+	EXPECT_EQ((CHistogramDiff::SCommonRun{ 0, 0, 5 }), runs[0]);
+
+	const std::vector<uint32_t> inserted = { 1, 2, 6, 3, 4, 5 };
+	runs = CHistogramDiff::Diff(lines, inserted);
+	ASSERT_EQ(2U, runs.size());
+	EXPECT_EQ((CHistogramDiff::SCommonRun{ 0, 0, 2 }), runs[0]);
+	EXPECT_EQ((CHistogramDiff::SCommonRun{ 2, 3, 3 }), runs[1]);
+
+	runs = CHistogramDiff::Diff(inserted, lines);
+	ASSERT_EQ(2U, runs.size());
+	EXPECT_EQ((CHistogramDiff::SCommonRun{ 0, 0, 2 }), runs[0]);
+	EXPECT_EQ((CHistogramDiff::SCommonRun{ 3, 2, 3 }), runs[1]);
+
+	const std::vector<uint32_t> changed = { 7, 2, 3, 8, 5 };
+	runs = CHistogramDiff::Diff(lines, changed);
+	EXPECT_EQ(3U, CheckRuns(lines, changed, runs));
+}
+
+TEST(CHistogramDiff, RepeatedLines)
+{
+	// a lockfile like structure: the same few lines all over the place, one unique line per block
+	std::vector<uint32_t> lines1;
+	for (uint32_t block = 0; block < 1000; ++block)
+	{
+		lines1.push_back(1000 + block);
+		lines1.insert(lines1.end(), { 1, 2, 3, 2, 4 });
+	}
+	std::vector<uint32_t> lines2 = lines1;
+	lines2.erase(lines2.begin() + 600, lines2.begin() + 612); // remove two blocks
+	lines2.insert(lines2.begin() + 3000, { 5000, 1, 2, 3, 2, 4 }); // add a block
+
+	const auto runs = CHistogramDiff::Diff(lines1, lines2);
+	EXPECT_EQ(lines1.size() - 12, CheckRuns(lines1, lines2, runs));
+
+	// nothing unique at all, falls back to Myers
+	std::vector<uint32_t> repeated1(5000);
+	for (size_t i = 0; i < repeated1.size(); ++i)
+		repeated1[i] = i % 2;
+	std::vector<uint32_t> repeated2 = repeated1;
+	repeated2.insert(repeated2.begin() + 1000, 7);
+	repeated2.erase(repeated2.begin() + 4000);
+	EXPECT_EQ(repeated1.size() - 1, CheckRuns(repeated1, repeated2, CHistogramDiff::Diff(repeated1, repeated2)));
+}
+
+TEST(CHistogramDiff, RandomEdits)
+{
+	uint32_t seed = 42;
+	auto random = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 8) & 0xffff; };
+	for (int i = 0; i < 500; ++i)
+	{
+		const uint32_t alphabet = 2 + random() % 30;
+		std::vector<uint32_t> lines1(random() % 80);
+		for (auto& line : lines1)
+			line = random() % alphabet;
+		std::vector<uint32_t> lines2;
+		for (auto line : lines1)
+		{
+			const auto action = random() % 10;
+			if (action == 0)
+				continue;
+			if (action == 1)
+				lines2.push_back(random() % alphabet);
+			lines2.push_back(line);
+		}
+		const auto runs = CHistogramDiff::Diff(lines1, lines2);
+		CheckRuns(lines1, lines2, runs);
+		EXPECT_EQ(runs, CHistogramDiff::Diff(lines1, lines2, true));
+	}
+}
+
+TEST(CHistogramDiff, SwappedLines)
+{
+	// every region is a single line, this must neither recurse for every region nor rebuild the histogram of the whole rest every time
+	std::vector<uint32_t> lines1;
+	std::vector<uint32_t> lines2;
+	for (uint32_t i = 0; i < 100000; ++i)
+	{
+		lines1.insert(lines1.end(), { 2 * i, 2 * i + 1 });
+		lines2.insert(lines2.end(), { 2 * i + 1, 2 * i });
+	}
+
+	const auto runs = CHistogramDiff::Diff(lines1, lines2);
+	EXPECT_EQ(100000U, CheckRuns(lines1, lines2, runs));
+	EXPECT_EQ(runs, CHistogramDiff::Diff(lines1, lines2, true));
+}
+
+TEST(CHistogramDiff, Parallel)
+{
+	// large enough to be split for diffing in parallel, with lots of repeated lines and scattered changes
+	std::vector<uint32_t> lines1;
+	for (uint32_t i = 0; i < 100000; ++i)
+		lines1.push_back((i % 4 == 0) ? 1000000 + i : i % 4);
+	std::vector<uint32_t> lines2;
+	for (size_t i = 0; i < lines1.size(); ++i)
+	{
+		if (i % 997 == 0)
+			lines2.push_back(3000000 + static_cast<uint32_t>(i));
+		if (i % 1009 != 0)
+			lines2.push_back(lines1[i]);
+	}
+
+	const auto runs = CHistogramDiff::Diff(lines1, lines2);
+	EXPECT_EQ(runs, CHistogramDiff::Diff(lines1, lines2, true));
+	EXPECT_EQ(lines1.size() - (lines1.size() + 1008) / 1009, CheckRuns(lines1, lines2, runs));
+}
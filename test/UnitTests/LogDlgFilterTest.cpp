@@ -0,0 +1,100 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "GitLogListBase.h"
+#include "LogDlgFilter.h"
+#include "LogSearchIndex.h"
+
+namespace
+{
+class CTestRev : public GitRevLoglist
+{
+public:
+	CTestRev(const CString& hash, const CString& subject, const CString& body, const CString& path, const CString& author)
+	{
+		m_CommitHash = CGitHash::FromHexStr(hash);
+		m_Subject = subject;
+		m_Body = body;
+		m_AuthorName = m_CommitterName = author;
+		m_AuthorEmail = m_CommitterEmail = author + L"@example.com";
+		if (!path.IsEmpty())
+			GetFilesWriter().m_files.AddPath(CTGitPath(path));
+		m_IsDiffFiles = TRUE;
+	}
+};
+}
+
+TEST(CLogDlgFilter, IsRuledOut)
+{
+	CAutoTempDir tempDir;
+	const CString gitDir = tempDir.GetTempDir() + L"\\";
+
+	CTestRev rev1(L"4c5c93d2a0b368bc4570d5ec02ab03b9c4334d44", L"Fix crash in the log dialog", L"", L"src/TortoiseProc/LogDlg.cpp", L"Alice");
+	CTestRev rev2(L"dead91b4aedeaddeaddead2a56d3c473c705dead", L"Update libgit2", L"See issue #4242\nThe crash is gone", L"ext/libgit2", L"Bob");
+	CTestRev rev3(L"1fc3c9688e27596d8717b54f2939dc951568f6cb", L"Add Kelvin units", L"Stra\u00dfe and \u212aelvin", L"src/Units.cpp", L"Crash Test Dummy");
+	CTestRev rev4(L"0123456789abcdef0123456789abcdef01234567", L"Log dialog: show notes", L"", L"src/TortoiseProc/GitLogList.cpp", L"Alice");
+	rev4.m_Notes = L"reviewed, no crash";
+
+	CLogSearchIndex index;
+	ASSERT_EQ(0, index.Update(gitDir, { &rev1, &rev2, &rev3, &rev4 }));
+	ASSERT_EQ(0, index.Load(gitDir));
+
+	MAP_HASH_NAME refs;
+	refs[rev3.m_CommitHash].push_back(L"refs/heads/crash-fixes");
+
+	const wchar_t* filters[] = { L"crash", L"Crash", L"crash dialog", L"crash -dialog", L"crash +kelvin", L"logdlg", L"dialog.*crash", L"fix.*crash",
+		L"[cC]rash", L"crash$", L"issue #4242", L"Kelvin", L"\u212aelvin", L"stra\u00dfe", L"alice", L"example.com", L"4c5c93d2", L"dead91b4", L"notes", L"no crash", L"crash-fixes" };
+	const DWORD selections[] = {
+		LOGFILTER_SUBJECT | LOGFILTER_MESSAGES | LOGFILTER_PATHS | LOGFILTER_AUTHORS | LOGFILTER_EMAILS | LOGFILTER_REVS | LOGFILTER_NOTES | LOGFILTER_REFNAME,
+		LOGFILTER_SUBJECT,
+		LOGFILTER_MESSAGES | LOGFILTER_PATHS,
+		LOGFILTER_SUBJECT | LOGFILTER_AUTHORS,
+		LOGFILTER_MESSAGES | LOGFILTER_REFNAME | LOGFILTER_NOTES,
+	};
+	CTestRev* revs[] = { &rev1, &rev2, &rev3, &rev4 };
+
+	int ruledOut = 0;
+	for (auto filterText : filters)
+	{
+		for (int flags = 0; flags < 4; ++flags)
+		{
+			const bool regex = flags & 1;
+			const bool caseSensitive = flags & 2;
+			for (auto selection : selections)
+			{
+				CLogDlgFilter filter(filterText, regex, selection, caseSensitive);
+				auto query = filter.GetSearchIndexQuery(index);
+				if (!query)
+					continue;
+
+				for (auto rev : revs)
+				{
+					if (!filter.IsRuledOut(*query, rev, refs))
+						continue;
+					++ruledOut;
+					// the log list is only needed for bug IDs, annotated tags and commits without changed files
+					EXPECT_FALSE(filter(rev, nullptr, refs)) << filterText << L" " << regex << caseSensitive << L" " << selection << L" " << static_cast<LPCWSTR>(rev->m_Subject);
+				}
+			}
+		}
+	}
+	// otherwise the test does not prove anything
+	EXPECT_LT(0, ruledOut);
+}
@@ -0,0 +1,105 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "LogPathLists.h"
+#include "GitRevLoglist.h"
+
+namespace
+{
+class CTestRev : public GitRevLoglist
+{
+public:
+	CTestRev(const CString& hash, const STRING_VECTOR& paths)
+	{
+		m_CommitHash = CGitHash::FromHexStr(hash);
+		m_SimpleFileList = paths;
+		m_IsSimpleListReady = TRUE;
+	}
+};
+}
+
+TEST(CLogPathLists, Empty)
+{
+	CAutoTempDir tempDir;
+	CLogPathLists lists;
+	EXPECT_NE(0, lists.Load(tempDir.GetTempDir() + L"\\"));
+	EXPECT_FALSE(lists.IsLoaded());
+	STRING_VECTOR list;
+	EXPECT_FALSE(lists.GetList(CGitHash::FromHexStr(L"4c5c93d2a0b368bc4570d5ec02ab03b9c4334d44"), list));
+}
+
+TEST(CLogPathLists, Update)
+{
+	CAutoTempDir tempDir;
+	const CString gitDir = tempDir.GetTempDir() + L"\\";
+
+	CTestRev rev1(L"4c5c93d2a0b368bc4570d5ec02ab03b9c4334d44", { L"src/TortoiseProc/LogDlg.cpp", L"src/TortoiseProc/LogDlg.h" });
+	CTestRev rev2(L"dead91b4aedeaddeaddead2a56d3c473c705dead", { L"ext/libgit2" });
+	CTestRev rev3(L"1fc3c9688e27596d8717b54f2939dc951568f6cb", { L"src/TortoiseProc/LogDlg.cpp", L"src/Changelog.txt" });
+	CTestRev rev4(L"2fc3c9688e27596d8717b54f2939dc951568f6cb", {});
+	rev4.m_IsSimpleListReady = FALSE;
+
+	CLogPathLists lists;
+	EXPECT_EQ(0, lists.Update(gitDir, { &rev1, &rev2, &rev4 }));
+	ASSERT_EQ(0, lists.Load(gitDir));
+	EXPECT_TRUE(lists.Contains(rev1.m_CommitHash));
+	EXPECT_FALSE(lists.Contains(rev3.m_CommitHash));
+	EXPECT_FALSE(lists.Contains(rev4.m_CommitHash));
+
+	STRING_VECTOR list;
+	EXPECT_TRUE(lists.GetList(rev1.m_CommitHash, list));
+	EXPECT_EQ(rev1.m_SimpleFileList, list);
+	EXPECT_TRUE(lists.GetList(rev2.m_CommitHash, list));
+	EXPECT_EQ(rev2.m_SimpleFileList, list);
+
+	// already stored commits are skipped, new ones get a segment of their own which reuses the known paths
+	EXPECT_EQ(0, lists.Update(gitDir, { &rev1, &rev3 }));
+	EXPECT_FALSE(lists.IsLoaded());
+	ASSERT_EQ(0, lists.Load(gitDir));
+	EXPECT_TRUE(lists.GetList(rev3.m_CommitHash, list));
+	EXPECT_EQ(rev3.m_SimpleFileList, list);
+	EXPECT_TRUE(lists.GetList(rev1.m_CommitHash, list));
+	EXPECT_EQ(rev1.m_SimpleFileList, list);
+}
+
+TEST(CLogPathLists, Merge)
+{
+	CAutoTempDir tempDir;
+	const CString gitDir = tempDir.GetTempDir() + L"\\";
+
+	std::vector<std::unique_ptr<CTestRev>> revs;
+	CLogPathLists lists;
+	for (int i = 0; i < LOG_PATHS_MAX_SEGMENTS + 2; ++i)
+	{
+		CString hash, path;
+		hash.Format(L"%040x", i + 1);
+		path.Format(L"dir%d/file.txt", i % 3);
+		revs.push_back(std::make_unique<CTestRev>(hash, STRING_VECTOR{ path, L"common.txt" }));
+		EXPECT_EQ(0, lists.Update(gitDir, { revs.back().get() }));
+	}
+
+	ASSERT_EQ(0, lists.Load(gitDir));
+	for (const auto& rev : revs)
+	{
+		STRING_VECTOR list;
+		EXPECT_TRUE(lists.GetList(rev->m_CommitHash, list));
+		EXPECT_EQ(rev->m_SimpleFileList, list);
+	}
+}
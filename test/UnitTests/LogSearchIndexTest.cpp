@@ -0,0 +1,114 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "LogSearchIndex.h"
+#include "GitRevLoglist.h"
+
+namespace
+{
+class CTestRev : public GitRevLoglist
+{
+public:
+	CTestRev(const CString& hash, const CString& subject, const CString& body, const CString& path)
+	{
+		m_CommitHash = CGitHash::FromHexStr(hash);
+		m_Subject = subject;
+		m_Body = body;
+		if (!path.IsEmpty())
+			GetFilesWriter().m_files.AddPath(CTGitPath(path));
+		m_IsDiffFiles = TRUE;
+	}
+};
+}
+
+TEST(CLogSearchIndex, Empty)
+{
+	CAutoTempDir tempDir;
+	CLogSearchIndex index;
+	EXPECT_NE(0, index.Load(tempDir.GetTempDir() + L"\\"));
+	EXPECT_FALSE(index.IsLoaded());
+	EXPECT_EQ(nullptr, index.Query({ L"foo" }));
+}
+
+TEST(CLogSearchIndex, Query)
+{
+	CAutoTempDir tempDir;
+	const CString gitDir = tempDir.GetTempDir() + L"\\";
+
+	CTestRev rev1(L"4c5c93d2a0b368bc4570d5ec02ab03b9c4334d44", L"Fix crash in the log dialog", L"", L"src/TortoiseProc/LogDlg.cpp");
+	CTestRev rev2(L"dead91b4aedeaddeaddead2a56d3c473c705dead", L"Update libgit2", L"See issue #4242", L"ext/libgit2");
+	CTestRev rev3(L"1fc3c9688e27596d8717b54f2939dc951568f6cb", L"Add Kelvin units", L"", L"");
+
+	CLogSearchIndex index;
+	EXPECT_EQ(0, index.Update(gitDir, { &rev1, &rev2 }));
+	ASSERT_EQ(0, index.Load(gitDir));
+	ASSERT_TRUE(index.IsLoaded());
+
+	auto query = index.Query({ L"logdlg", L"crash", L"4242" });
+	ASSERT_NE(nullptr, query);
+	EXPECT_EQ(3U, query->GetSubStringCount());
+	EXPECT_STREQ(L"logdlg", query->GetSubString(0));
+
+	ULONGLONG mayContain = 0;
+	EXPECT_TRUE(query->Lookup(rev1.m_CommitHash, mayContain));
+	EXPECT_EQ(0x3U, mayContain);
+	EXPECT_TRUE(query->Lookup(rev2.m_CommitHash, mayContain));
+	EXPECT_EQ(0x4U, mayContain);
+	EXPECT_FALSE(query->Lookup(rev3.m_CommitHash, mayContain));
+
+	// already indexed commits are skipped, new ones get a segment of their own
+	EXPECT_EQ(0, index.Update(gitDir, { &rev1, &rev3 }));
+	EXPECT_FALSE(index.IsLoaded());
+	ASSERT_EQ(0, index.Load(gitDir));
+	query = index.Query({ L"KELVIN", L"ab" });
+	ASSERT_NE(nullptr, query);
+	EXPECT_TRUE(query->Lookup(rev3.m_CommitHash, mayContain));
+	EXPECT_EQ(0x3U, mayContain); // too short sub-strings cannot rule out anything
+	EXPECT_TRUE(query->Lookup(rev1.m_CommitHash, mayContain));
+	EXPECT_EQ(0x2U, mayContain);
+}
+
+TEST(CLogSearchIndex, Merge)
+{
+	CAutoTempDir tempDir;
+	const CString gitDir = tempDir.GetTempDir() + L"\\";
+
+	std::vector<std::unique_ptr<CTestRev>> revs;
+	CLogSearchIndex index;
+	for (int i = 0; i < LOG_SEARCH_MAX_SEGMENTS + 2; ++i)
+	{
+		CString hash, subject, path;
+		hash.Format(L"%040x", i + 1);
+		subject.Format(L"Commit %d", i);
+		path.Format(L"dir%d/file.txt", i % 2);
+		revs.push_back(std::make_unique<CTestRev>(hash, subject, L"", path));
+		EXPECT_EQ(0, index.Update(gitDir, { revs.back().get() }));
+	}
+
+	ASSERT_EQ(0, index.Load(gitDir));
+	auto query = index.Query({ L"dir1/file", L"commit 3" });
+	ASSERT_NE(nullptr, query);
+	for (int i = 0; i < static_cast<int>(revs.size()); ++i)
+	{
+		ULONGLONG mayContain = 0;
+		EXPECT_TRUE(query->Lookup(revs[i]->m_CommitHash, mayContain));
+		EXPECT_EQ((i % 2 ? 0x1U : 0x0U) | (i == 3 ? 0x2U : 0x0U), mayContain);
+	}
+}
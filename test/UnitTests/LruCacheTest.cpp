@@ -1,6 +1,6 @@
 // TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2016 - TortoiseGit
+// Copyright (C) 2016, 2026 - TortoiseGit
 // Copyright (C) 2016 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -20,6 +20,9 @@
 
 #include "stdafx.h"
 #include "LruCache.h"
+#include <list>
+#include <thread>
+#include <unordered_map>
 
 TEST(LruCache, InsertGet)
 {
@@ -70,3 +73,116 @@ TEST(LruCache, EmptyCache)
 	EXPECT_EQ(nullptr, cache.try_get(2));
 	EXPECT_EQ(nullptr, cache.try_get(3));
 }
+
+TEST(LruCache, Eviction)
+{
+	LruCache<int, int> cache(100);
+	for (int i = 0; i < 1000; ++i)
+	{
+		cache.insert_or_assign(i, i * 10);
+		// keep key '0' alive
+		EXPECT_NE(nullptr, cache.try_get(0));
+	}
+	EXPECT_EQ(100U, cache.size());
+	EXPECT_NE(nullptr, cache.try_get(0));
+	for (int i = 1; i < 901; ++i)
+		EXPECT_EQ(nullptr, cache.try_get(i));
+	for (int i = 901; i < 1000; ++i)
+	{
+		ASSERT_NE(nullptr, cache.try_get(i));
+		EXPECT_EQ(i * 10, *cache.try_get(i));
+	}
+}
+
+TEST(LruCache, HeterogeneousLookup)
+{
+	LruCache<std::wstring, int> cache(2);
+	cache.insert_or_assign(L"one", 1);
+	cache.insert_or_assign(L"two", 2);
+
+	const CString two(L"two");
+	const int* result = cache.try_get(std::wstring_view(two, two.GetLength()));
+	ASSERT_NE(nullptr, result);
+	EXPECT_EQ(2, *result);
+	result = cache.try_get(L"one");
+	ASSERT_NE(nullptr, result);
+	EXPECT_EQ(1, *result);
+	EXPECT_EQ(nullptr, cache.try_get(std::wstring_view(L"three")));
+}
+
+TEST(LruCache, Sharded)
+{
+	ShardedLruCache<std::wstring, int> cache(64);
+	int val = 0;
+	EXPECT_FALSE(cache.try_get(L"one", val));
+	cache.insert_or_assign(L"one", 1);
+	EXPECT_TRUE(cache.try_get(std::wstring_view(L"one"), val));
+	EXPECT_EQ(1, val);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&cache, t]() {
+			for (int i = 0; i < 10000; ++i)
+			{
+				const std::wstring key = std::to_wstring(t) + L':' + std::to_wstring(i % 200);
+				int value = 0;
+				if (cache.try_get(key, value))
+					EXPECT_EQ(i % 200, value);
+				else
+					cache.insert_or_assign(key, i % 200);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	cache.clear();
+	EXPECT_FALSE(cache.try_get(L"one", val));
+}
+
+// compares the cache with the std::list/std::unordered_map implementation it replaced
+TEST(LruCache, MatchesListCache)
+{
+	constexpr size_t cacheSize = 200;
+	constexpr int lookups = 20000;
+	std::vector<std::wstring> words;
+	for (size_t i = 0; i < 3 * cacheSize; ++i)
+		words.push_back(L"word" + std::to_wstring(i * 7919));
+
+	LruCache<std::wstring, BOOL> cache(cacheSize);
+	int hits = 0;
+	for (int i = 0; i < lookups; ++i)
+	{
+		// mostly hits, as when spell checking a commit message
+		const auto& word = words[(i % 7 == 0) ? (i * 31) % words.size() : (i * 13) % cacheSize];
+		if (cache.try_get(std::wstring_view(word)))
+			++hits;
+		else
+			cache.insert_or_assign(word, TRUE);
+	}
+
+	std::list<std::pair<std::wstring, BOOL>> itemsList;
+	std::unordered_map<std::wstring, decltype(itemsList)::iterator> itemsMap;
+	int listHits = 0;
+	for (int i = 0; i < lookups; ++i)
+	{
+		const auto& word = words[(i % 7 == 0) ? (i * 31) % words.size() : (i * 13) % cacheSize];
+		if (auto it = itemsMap.find(word); it != itemsMap.end())
+		{
+			itemsList.splice(itemsList.end(), itemsList, it->second);
+			++listHits;
+			continue;
+		}
+		if (itemsList.size() >= cacheSize)
+		{
+			itemsMap.erase(itemsList.front().first);
+			itemsList.pop_front();
+		}
+		itemsMap.emplace(word, itemsList.insert(itemsList.end(), { word, TRUE }));
+	}
+
+	EXPECT_EQ(listHits, hits);
+	EXPECT_LT(0, hits);
+	EXPECT_LT(hits, lookups);
+}
@@ -0,0 +1,70 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "ThreadPoolWork.h"
+
+TEST(ThreadPoolWork, ParallelFor)
+{
+	std::vector<LONG> hits(10000);
+	ParallelFor(hits.size(), [&hits](size_t i) { InterlockedIncrement(&hits[i]); });
+	EXPECT_TRUE(std::all_of(hits.cbegin(), hits.cend(), [](LONG hit) { return hit == 1; }));
+
+	// nothing to do
+	ParallelFor(0, [](size_t) { FAIL(); });
+
+	// single worker runs synchronously and in order
+	std::vector<size_t> order;
+	ParallelFor(100, [&order](size_t i) { order.push_back(i); }, 1);
+	ASSERT_EQ(100U, order.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		EXPECT_EQ(i, order[i]);
+}
+
+TEST(ThreadPoolWork, StartWaitRestart)
+{
+	CThreadPoolWork work;
+	EXPECT_FALSE(work.IsRunning());
+
+	volatile LONG sum = 0;
+	work.Start(1000, [&sum](size_t i) { InterlockedExchangeAdd(&sum, static_cast<LONG>(i)); }, 4);
+	work.Wait();
+	EXPECT_FALSE(work.IsRunning());
+	EXPECT_EQ(999 * 1000 / 2, sum);
+
+	// the same object can be reused
+	sum = 0;
+	work.Start(10, [&sum](size_t) { InterlockedIncrement(&sum); }, 4);
+	work.Wait();
+	EXPECT_EQ(10, sum);
+}
+
+TEST(ThreadPoolWork, Cancel)
+{
+	CThreadPoolWork work;
+	volatile LONG processed = 0;
+	HANDLE release = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	ASSERT_TRUE(release);
+	SCOPE_EXIT { CloseHandle(release); };
+	work.Start(100000, [&processed, release](size_t) { WaitForSingleObject(release, INFINITE); InterlockedIncrement(&processed); }, 2);
+	work.Cancel();
+	SetEvent(release);
+	work.Wait();
+	EXPECT_LE(processed, 2);
+}
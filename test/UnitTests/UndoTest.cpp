@@ -0,0 +1,244 @@
+﻿// TortoiseGit - a Windows shell extension for easy version control
+
+// Copyright (C) 2026 - TortoiseGit
+
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "stdafx.h"
+#include "Undo.h"
+
+static std::vector<std::pair<int, CString>> GetValues(const CUndoLineValues<CString>& values)
+{
+	std::vector<std::pair<int, CString>> result;
+	values.ForEach([&result](int index, const CString& value) { result.emplace_back(index, value); });
+	return result;
+}
+
+TEST(CUndoLineValues, LastValueWins)
+{
+	CUndoLineValues<CString> values;
+	values.Set(1, L"a");
+	values.Set(2, L"b");
+	values.Set(1, L"c"); // overwrites within the last range
+	values.Compact();
+	EXPECT_EQ((std::vector<std::pair<int, CString>>{ { 1, L"c" }, { 2, L"b" } }), GetValues(values));
+
+	values.clear();
+	values.Set(5, L"a");
+	values.Set(6, L"b");
+	values.Set(2, L"c");
+	values.Set(5, L"d");
+	values.Set(2, L"e");
+	values.Set(5, L"f");
+	values.Compact();
+	EXPECT_EQ((std::vector<std::pair<int, CString>>{ { 2, L"e" }, { 5, L"f" }, { 6, L"b" } }), GetValues(values));
+
+	// compacting twice does not change anything
+	values.Compact();
+	EXPECT_EQ((std::vector<std::pair<int, CString>>{ { 2, L"e" }, { 5, L"f" }, { 6, L"b" } }), GetValues(values));
+}
+
+TEST(CUndoLineValues, Ranges)
+{
+	CUndoLineValues<DiffState> values;
+	EXPECT_TRUE(values.empty());
+	values.Set(0, DiffState::Normal);
+	values.Set(1, DiffState::Added);
+	values.Set(2, DiffState::Removed);
+	values.Set(4, DiffState::Normal);
+	values.Set(5, DiffState::Normal);
+	values.Set(10, DiffState::Added);
+	values.Compact();
+	const auto& ranges = values.GetRanges();
+	ASSERT_EQ(3U, ranges.size());
+	EXPECT_EQ(0, ranges[0].start);
+	EXPECT_EQ(3, ranges[0].count);
+	EXPECT_EQ(DiffState::Added, values.GetValues(ranges[0])[1]);
+	EXPECT_EQ(4, ranges[1].start);
+	EXPECT_EQ(2, ranges[1].count);
+	EXPECT_EQ(10, ranges[2].start);
+	EXPECT_EQ(1, ranges[2].count);
+	EXPECT_EQ(DiffState::Added, values.GetValues(ranges[2])[0]);
+
+	// descending and overlapping indexes are joined into consecutive ranges
+	CUndoLineValues<int> descending;
+	for (int i = 9; i >= 3; --i)
+		descending.Set(i, i);
+	descending.Set(2, 2);
+	descending.Set(3, 30);
+	descending.Set(12, 12);
+	descending.Set(11, 11);
+	descending.Compact();
+	const auto& joined = descending.GetRanges();
+	ASSERT_EQ(2U, joined.size());
+	EXPECT_EQ(2, joined[0].start);
+	EXPECT_EQ(8, joined[0].count);
+	EXPECT_EQ(30, descending.GetValues(joined[0])[1]);
+	EXPECT_EQ(9, descending.GetValues(joined[0])[7]);
+	EXPECT_EQ(11, joined[1].start);
+	EXPECT_EQ(2, joined[1].count);
+	EXPECT_EQ(11, descending.GetValues(joined[1])[0]);
+	EXPECT_EQ(12, descending.GetValues(joined[1])[1]);
+
+	descending.clear();
+	EXPECT_TRUE(descending.empty());
+	EXPECT_TRUE(descending.GetRanges().empty());
+}
+
+namespace
+{
+// does the bookkeeping of CUndo::Undo()/Redo() without any views
+class CTestUndo : public CUndo
+{
+public:
+	CTestUndo()
+	{
+		m_maxMemoryUsage = 3 * GetStateMemoryUsage();
+	}
+
+	static allviewstate MakeState()
+	{
+		allviewstate state;
+		state.left.difflines.Set(0, CString(L'x', 1000));
+		state.left.modifies = true;
+		return state;
+	}
+
+	static size_t GetStateMemoryUsage()
+	{
+		auto state = MakeState();
+		state.Compact();
+		return state.GetMemoryUsage();
+	}
+
+	void AddStep() { AddState(MakeState(), POINT{ 0, static_cast<LONG>(m_caretpoints.size()) }); }
+
+	size_t UndoSteps()
+	{
+		const size_t steps = BeginUndo();
+		for (size_t i = 0; i < steps; ++i)
+		{
+			m_memoryUsage -= m_viewstates.back().GetMemoryUsage();
+			m_redoviewstates.push_back(std::move(m_viewstates.back()));
+			m_redocaretpoints.push_back(m_caretpoints.back());
+			m_viewstates.pop_back();
+			m_caretpoints.pop_back();
+		}
+		return steps;
+	}
+
+	size_t RedoSteps()
+	{
+		const size_t steps = BeginRedo();
+		for (size_t i = 0; i < steps; ++i)
+		{
+			m_viewstates.push_back(std::move(m_redoviewstates.back()));
+			m_memoryUsage += m_viewstates.back().GetMemoryUsage();
+			m_caretpoints.push_back(m_redocaretpoints.back());
+			m_redoviewstates.pop_back();
+			m_redocaretpoints.pop_back();
+		}
+		return steps;
+	}
+
+	size_t GetStepCount() const { return m_viewstates.size(); }
+	std::vector<std::list<int>::size_type> GetGroups() const { return { m_groups.cbegin(), m_groups.cend() }; }
+	size_t GetMemoryUsage() const { return m_memoryUsage; }
+	size_t GetMaxMemoryUsage() const { return m_maxMemoryUsage; }
+	void SetMaxMemoryUsage(size_t maxMemoryUsage) { m_maxMemoryUsage = maxMemoryUsage; }
+};
+}
+
+TEST(CUndo, DropOldestStates)
+{
+	CTestUndo undo;
+	for (int i = 0; i < 5; ++i)
+		undo.AddStep();
+	EXPECT_EQ(3U, undo.GetStepCount());
+	EXPECT_LE(undo.GetMemoryUsage(), undo.GetMaxMemoryUsage());
+
+	// the latest step is always kept
+	CTestUndo single;
+	single.SetMaxMemoryUsage(1);
+	single.AddStep();
+	single.AddStep();
+	EXPECT_EQ(1U, single.GetStepCount());
+	EXPECT_TRUE(single.CanUndo());
+}
+
+TEST(CUndo, DroppedGroupBeginningAtZero)
+{
+	CTestUndo undo;
+	undo.BeginGrouping();
+	for (int i = 0; i < 5; ++i)
+		undo.AddStep();
+	undo.EndGrouping();
+	EXPECT_EQ(3U, undo.GetStepCount());
+	EXPECT_EQ((std::vector<std::list<int>::size_type>{ 0, 3 }), undo.GetGroups());
+
+	// the remaining steps of the group are undone at once
+	EXPECT_EQ(3U, undo.UndoSteps());
+	EXPECT_FALSE(undo.CanUndo());
+	EXPECT_TRUE(undo.GetGroups().empty());
+
+	EXPECT_EQ(3U, undo.RedoSteps());
+	EXPECT_FALSE(undo.CanRedo());
+	EXPECT_EQ(3U, undo.GetStepCount());
+	EXPECT_EQ((std::vector<std::list<int>::size_type>{ 0, 3 }), undo.GetGroups());
+}
+
+TEST(CUndo, DroppedCompleteGroup)
+{
+	CTestUndo undo;
+	undo.AddStep();
+	undo.BeginGrouping();
+	undo.AddStep();
+	undo.AddStep();
+	undo.EndGrouping();
+	EXPECT_EQ((std::vector<std::list<int>::size_type>{ 1, 3 }), undo.GetGroups());
+
+	undo.AddStep();
+	EXPECT_EQ((std::vector<std::list<int>::size_type>{ 0, 2 }), undo.GetGroups());
+	undo.AddStep();
+	EXPECT_EQ((std::vector<std::list<int>::size_type>{ 0, 1 }), undo.GetGroups());
+	undo.AddStep();
+	EXPECT_TRUE(undo.GetGroups().empty());
+
+	for (int i = 0; i < 3; ++i)
+		EXPECT_EQ(1U, undo.UndoSteps());
+	EXPECT_FALSE(undo.CanUndo());
+}
+
+TEST(CUndo, DroppedStatesBeforeGroup)
+{
+	CTestUndo undo;
+	for (int i = 0; i < 3; ++i)
+		undo.AddStep();
+	undo.BeginGrouping();
+	EXPECT_TRUE(undo.IsGrouping());
+	undo.AddStep();
+	undo.AddStep();
+	undo.EndGrouping();
+	EXPECT_FALSE(undo.IsGrouping());
+	EXPECT_EQ(3U, undo.GetStepCount());
+	EXPECT_EQ((std::vector<std::list<int>::size_type>{ 1, 3 }), undo.GetGroups());
+
+	EXPECT_EQ(2U, undo.UndoSteps());
+	EXPECT_EQ(1U, undo.GetStepCount());
+	EXPECT_EQ(1U, undo.UndoSteps());
+	EXPECT_FALSE(undo.CanUndo());
+	EXPECT_EQ(0U, undo.GetMemoryUsage());
+}
@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2015, 2018 - TortoiseGit
+// Copyright (C) 2015, 2018, 2026 - TortoiseGit
 // Copyright (C) 2010 - TortoiseSVN
 
 // This program is free software; you can redistribute it and/or
@@ -51,3 +51,69 @@ TEST(UniqueQueue, CString)
 	EXPECT_EQ(0U, myQueue.size());
 	EXPECT_TRUE(myQueue.Pop().IsEmpty());
 }
+
+TEST(UniqueQueue, Copy)
+{
+	UniqueQueue<CString> myQueue;
+	myQueue.Push(CString(L"one"));
+	myQueue.Push(CString(L"two"));
+	myQueue.Push(CString(L"one"));
+
+	UniqueQueue<CString> copy(myQueue);
+	EXPECT_EQ(2U, copy.size());
+	EXPECT_TRUE(myQueue.Pop().Compare(L"two") == 0);
+	EXPECT_EQ(2U, copy.size());
+	EXPECT_TRUE(copy.Pop().Compare(L"two") == 0);
+	EXPECT_TRUE(copy.Pop().Compare(L"one") == 0);
+	EXPECT_TRUE(copy.empty());
+
+	copy = myQueue;
+	EXPECT_EQ(1U, copy.size());
+	EXPECT_TRUE(copy.Pop().Compare(L"one") == 0);
+	EXPECT_EQ(1U, myQueue.size());
+}
+
+// counts the comparisons UniqueQueue does for looking up entries
+static size_t s_comparisons = 0;
+
+struct CountedKey
+{
+	int id;
+	bool operator<(const CountedKey& other) const
+	{
+		++s_comparisons;
+		return id < other.id;
+	}
+};
+
+template <>
+struct UniqueQueueHash<CountedKey>
+{
+	size_t operator()(const CountedKey& value) const noexcept
+	{
+		return std::hash<int>{}(value.id);
+	}
+};
+
+TEST(UniqueQueue, Scaling)
+{
+	const int count = 20000;
+	s_comparisons = 0;
+	UniqueQueue<CountedKey> myQueue;
+	for (int i = 0; i < count; ++i)
+		myQueue.Push(CountedKey{ i });
+	// pushing everything again in reverse order moves every entry
+	for (int i = count - 1; i >= 0; --i)
+		myQueue.Push(CountedKey{ i });
+	EXPECT_EQ(static_cast<size_t>(count), myQueue.size());
+	for (int i = 0; i < count; i += 2)
+		myQueue.erase(CountedKey{ i });
+	EXPECT_EQ(static_cast<size_t>(count / 2), myQueue.size());
+	for (int i = count - 1; i >= 0; i -= 2)
+		EXPECT_EQ(i, myQueue.Pop().id);
+	EXPECT_TRUE(myQueue.empty());
+
+	// moving and erasing entries must not depend on the size of the queue,
+	// a linear scan would need about count * count comparisons
+	EXPECT_LT(s_comparisons, static_cast<size_t>(16 * count));
+}
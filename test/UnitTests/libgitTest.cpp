@@ -1,6 +1,6 @@
 ﻿// TortoiseGit - a Windows shell extension for easy version control
 
-// Copyright (C) 2016-2020, 2022-2023 - TortoiseGit
+// Copyright (C) 2016-2020, 2022-2023, 2026 - TortoiseGit
 
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
@@ -21,6 +21,7 @@
 #include "Git.h"
 #include "StringUtils.h"
 #include "gitdll.h"
+#include <thread>
 
 TEST(libgit, BrokenConfig)
 {
@@ -39,7 +40,36 @@ TEST(libgit, BrokenConfig)
 	CString testFile = tempdir.GetTempDir() + L"\\.git\\config";
 	EXPECT_TRUE(CStringUtils::WriteStringToTextFile(testFile, L"[push]\ndefault=something-that-is-invalid\n"));
 
-	EXPECT_THROW(g_Git.CheckAndInitDll(), const char*);
+	CGitDllSession session;
+	EXPECT_THROW(session.Init(), const char*);
+}
+
+TEST(libgit, Session)
+{
+	CGitDllSession session;
+	EXPECT_TRUE(session.IsActive());
+	{
+		// sessions are reentrant on the same thread
+		CGitDllSession nested;
+		EXPECT_TRUE(nested.IsActive());
+	}
+
+	volatile LONG entered = FALSE;
+	std::thread other([&entered]() {
+		CGitDllSession otherSession;
+		InterlockedExchange(&entered, TRUE);
+	});
+	Sleep(200);
+	EXPECT_EQ(FALSE, entered);
+
+	session.Release();
+	EXPECT_FALSE(session.IsActive());
+	session.Release(); // releasing twice is fine
+	other.join();
+	EXPECT_EQ(TRUE, entered);
+
+	session.Acquire();
+	EXPECT_TRUE(session.IsActive());
 }
 
 TEST(libgit, Mailmap)
@@ -52,7 +82,8 @@ TEST(libgit, Mailmap)
 	CString output;
 	EXPECT_EQ(0, g_Git.Run(L"git.exe init", &output, CP_UTF8));
 	EXPECT_STRNE(L"", output);
-	g_Git.ForceReInitDll();
+	CGitDllSession session;
+	session.ForceReInit();
 
 	GIT_MAILMAP mailmap = reinterpret_cast<void*>(0x12345678);
 	git_read_mailmap(&mailmap);
@@ -320,7 +351,8 @@ TEST(libgit, StoreUninitializedRepositoryConfig)
 	SetCurrentDirectory(g_Git.m_CurrentDir);
 
 	// clear any leftovers in caches
-	EXPECT_THROW(g_Git.CheckAndInitDll(), const char*);
+	CGitDllSession session;
+	EXPECT_THROW(session.Init(), const char*);
 
 	EXPECT_THROW(git_set_config("something", "else", CONFIG_LOCAL), const char*);
 }